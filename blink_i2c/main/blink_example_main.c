@@ -1,12 +1,19 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/i2s_std.h"
 #include "driver/i2c.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "esp_cpu.h"
+#include "loopback_latency.h"
+#include "dds.h"
 
 // GPIO定义
 #define BLINK_GPIO          GPIO_NUM_11       // LED引脚（根据您的板子修改）
@@ -39,6 +46,74 @@ static i2s_chan_handle_t rx_handle = NULL;
 #define AUDIO_BUFFER_SIZE   1024
 static int16_t audio_buffer[AUDIO_BUFFER_SIZE];
 
+// 测试信号（模式2）
+#define TEST_SIGNAL_TONE        0   // 1kHz正弦
+#define TEST_SIGNAL_MULTITONE   1   // 440Hz+1kHz+3150Hz，检查互调失真
+#define TEST_SIGNAL_SWEEP       2   // 20Hz~20kHz线性扫频，5秒重复，检查频率响应
+#define TEST_SIGNAL_PINK        3   // 粉红噪声，校准音量和频响
+#define TEST_SIGNAL_WHITE       4   // 白噪声
+#define TEST_SIGNAL             TEST_SIGNAL_TONE
+#define DDS_BENCHMARK_ENABLED   0   // 启动时测量DDS与sinf每样本的CPU周期数
+
+// DMA队列溢出计数（TX欠载/RX未及时读取），由I2S中断回调累加
+static volatile uint32_t s_tx_underruns = 0;
+static volatile uint32_t s_rx_overflows = 0;
+
+// 回环延迟测量（模式3）
+#define LATENCY_CHIRP_FRAMES    1024            // 约21ms的扫频
+#define LATENCY_CHIRP_F0        800.0f
+#define LATENCY_CHIRP_F1        5000.0f         // 低于粗搜抽取后的奈奎斯特频率（6kHz）
+#define LATENCY_CHIRP_AMPLITUDE 0.5f
+#define LATENCY_WINDOW_MS       300             // 每次试验的录音窗口，需大于最大往返延迟
+#define LATENCY_WINDOW_FRAMES   (SAMPLE_RATE * LATENCY_WINDOW_MS / 1000)
+#define LATENCY_WARMUP_TRIALS   3               // 每个配置开头不计入统计的试验数
+#define LATENCY_TRIALS          20
+#define LATENCY_MIN_SCORE       0.3f            // 相关峰低于此值视为没录到
+#define LATENCY_MIN_FRAME_NUM   120
+#define LATENCY_MAX_FRAME_NUM   1023            // 16位立体声下单个DMA缓冲区上限4092字节
+#define LATENCY_MAX_BLOCKS      (LATENCY_WINDOW_FRAMES / LATENCY_MIN_FRAME_NUM + 2)
+
+typedef struct {
+    uint32_t desc_num;
+    uint32_t frame_num;
+} latency_config_t;
+
+// 先改描述符数，再改帧长；6x240是I2S_CHANNEL_DEFAULT_CONFIG的默认值，8x1023接近播放器工程的DMA配置
+static const latency_config_t s_latency_configs[] = {
+    {2, 240}, {4, 240}, {6, 240}, {8, 240},
+    {6, 120}, {6, 480}, {6, 1023},
+    {8, 1023},
+};
+#define LATENCY_CONFIG_COUNT    (sizeof(s_latency_configs) / sizeof(s_latency_configs[0]))
+
+// 一次试验的录音，采集任务填好后交给分析任务
+typedef struct {
+    uint32_t config;            // s_latency_configs下标
+    bool last;                  // 该配置的最后一次试验
+    uint32_t block_frames;
+    uint32_t frames;            // 录到的帧数
+    uint32_t blocks;
+    int64_t tx_us;              // 写入chirp第一个块之前的时间
+    int32_t stream_base;        // 录音第一帧的RX帧序号 - chirp第一帧的TX帧序号
+    int64_t read_us[LATENCY_MAX_BLOCKS];                            // 每个块读取返回的时间
+    int16_t samples[LATENCY_WINDOW_FRAMES + LATENCY_MAX_FRAME_NUM]; // 左声道
+} latency_trial_t;
+
+typedef struct {
+    loopback_stats_t app_ms;    // 应用层：写入chirp -> 读到含chirp起点的块
+    loopback_stats_t stream_ms; // 样本层：chirp起点在RX流中相对TX流的偏移
+    uint32_t trials;
+    uint32_t detected;
+    float min_score;
+    uint32_t tx_underruns;
+    uint32_t rx_overflows;
+} latency_result_t;
+
+static latency_result_t s_latency_results[LATENCY_CONFIG_COUNT];
+static QueueHandle_t s_trial_queue = NULL;
+static QueueHandle_t s_free_queue = NULL;
+static TaskHandle_t s_latency_task = NULL;
+
 // 初始化GPIO控制引脚
 static void init_control_pins(void)
 {
@@ -185,12 +260,27 @@ static esp_err_t es8311_codec_init(void)
     return ESP_OK;
 }
 
-// 初始化I2S
-static esp_err_t i2s_init(void)
+// I2S中断回调：DMA队列溢出计数
+static IRAM_ATTR bool i2s_tx_overflow_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    s_tx_underruns++;
+    return false;
+}
+
+static IRAM_ATTR bool i2s_rx_overflow_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    s_rx_overflows++;
+    return false;
+}
+
+// 初始化I2S，desc_num/frame_num为DMA描述符数和每个描述符的帧数
+static esp_err_t i2s_init_dma(uint32_t desc_num, uint32_t frame_num)
 {
     // I2S配置
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_PORT_NUM, I2S_ROLE_MASTER);
     chan_cfg.auto_clear = true;
+    chan_cfg.dma_desc_num = desc_num;
+    chan_cfg.dma_frame_num = frame_num;
     
     // 创建TX和RX通道
     ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_handle, &rx_handle));
@@ -213,37 +303,65 @@ static esp_err_t i2s_init(void)
         },
     };
     
-    // 初始化TX通道
+    // 初始化TX通道（回调必须在enable之前注册）
     if (tx_handle != NULL) {
+        i2s_event_callbacks_t tx_cbs = { .on_send_q_ovf = i2s_tx_overflow_cb };
         ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle, &std_cfg));
+        ESP_ERROR_CHECK(i2s_channel_register_event_callback(tx_handle, &tx_cbs, NULL));
         ESP_ERROR_CHECK(i2s_channel_enable(tx_handle));
     }
     
     // 初始化RX通道
     if (rx_handle != NULL) {
+        i2s_event_callbacks_t rx_cbs = { .on_recv_q_ovf = i2s_rx_overflow_cb };
         ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle, &std_cfg));
+        ESP_ERROR_CHECK(i2s_channel_register_event_callback(rx_handle, &rx_cbs, NULL));
         ESP_ERROR_CHECK(i2s_channel_enable(rx_handle));
     }
     
-    ESP_LOGI(TAG, "I2S initialized successfully");
+    ESP_LOGI(TAG, "I2S initialized successfully (DMA %u x %u frames)", (unsigned)desc_num, (unsigned)frame_num);
     return ESP_OK;
 }
 
-// 生成测试音频（正弦波）
-static void generate_sine_wave(int16_t *buffer, int samples, float frequency)
+// 使用默认DMA配置初始化I2S
+static esp_err_t i2s_init(void)
 {
-    static float phase = 0;
-    float phase_increment = 2.0f * M_PI * frequency / SAMPLE_RATE;
-    
-    for (int i = 0; i < samples; i += 2) {
-        int16_t sample = (int16_t)(sinf(phase) * 32767 * 0.5f); // 50%音量
-        buffer[i] = sample;     // 左声道
-        buffer[i + 1] = sample; // 右声道
-        phase += phase_increment;
-        if (phase >= 2.0f * M_PI) {
-            phase -= 2.0f * M_PI;
-        }
+    i2s_chan_config_t defaults = I2S_CHANNEL_DEFAULT_CONFIG(I2S_PORT_NUM, I2S_ROLE_MASTER);
+    return i2s_init_dma(defaults.dma_desc_num, defaults.dma_frame_num);
+}
+
+// 释放I2S通道（用于更换DMA配置）
+static void i2s_deinit(void)
+{
+    if (tx_handle != NULL) {
+        i2s_channel_disable(tx_handle);
+        i2s_del_channel(tx_handle);
+        tx_handle = NULL;
     }
+    if (rx_handle != NULL) {
+        i2s_channel_disable(rx_handle);
+        i2s_del_channel(rx_handle);
+        rx_handle = NULL;
+    }
+}
+
+// 按TEST_SIGNAL配置测试信号发生器
+static void test_signal_init(dds_t *dds)
+{
+    dds_init(dds, SAMPLE_RATE);
+#if TEST_SIGNAL == TEST_SIGNAL_MULTITONE
+    dds_add_tone(dds, 440.0f, 0.15f);
+    dds_add_tone(dds, 1000.0f, 0.15f);
+    dds_add_tone(dds, 3150.0f, 0.15f);
+#elif TEST_SIGNAL == TEST_SIGNAL_SWEEP
+    dds_add_chirp(dds, 20.0f, 20000.0f, 5.0f, 0.5f, true);
+#elif TEST_SIGNAL == TEST_SIGNAL_PINK
+    dds_set_noise(dds, DDS_NOISE_PINK, 0.5f, 0);
+#elif TEST_SIGNAL == TEST_SIGNAL_WHITE
+    dds_set_noise(dds, DDS_NOISE_WHITE, 0.25f, 0);
+#else
+    dds_add_tone(dds, 1000.0f, 0.5f); // 50%音量
+#endif
 }
 
 // 音频回环任务（录音并播放）
@@ -274,11 +392,14 @@ static void play_test_tone_task(void *arg)
 {
     size_t bytes_written = 0;
     
-    ESP_LOGI(TAG, "Playing 1kHz test tone");
+    static dds_t signal;
+    
+    test_signal_init(&signal);
+    ESP_LOGI(TAG, "Playing test signal %d", TEST_SIGNAL);
     
     while (1) {
-        // 生成1kHz正弦波
-        generate_sine_wave(audio_buffer, AUDIO_BUFFER_SIZE, 1000.0f);
+        // 生成下一块测试信号（立体声）
+        dds_render(&signal, audio_buffer, AUDIO_BUFFER_SIZE / 2, 2);
         
         // 播放音频
         if (tx_handle != NULL) {
@@ -289,6 +410,165 @@ static void play_test_tone_task(void *arg)
     }
 }
 
+// 回环延迟分析任务：在录音中找chirp，累计统计
+static void latency_analysis_task(void *arg)
+{
+    const int16_t *chirp = arg;
+    latency_trial_t *trial;
+
+    while (1) {
+        xQueueReceive(s_trial_queue, &trial, portMAX_DELAY);
+        latency_result_t *r = &s_latency_results[trial->config];
+        loopback_match_t match = {0};
+
+        r->trials++;
+        if (loopback_find_chirp(trial->samples, trial->frames, chirp, LATENCY_CHIRP_FRAMES,
+                                LATENCY_MIN_SCORE, &match)) {
+            uint32_t block = match.index / trial->block_frames;
+            loopback_stats_add(&r->app_ms, (trial->read_us[block] - trial->tx_us) / 1000.0);
+            loopback_stats_add(&r->stream_ms, (trial->stream_base + (int32_t)match.index) * 1000.0 / SAMPLE_RATE);
+            if (r->detected == 0 || match.score < r->min_score) {
+                r->min_score = match.score;
+            }
+            r->detected++;
+        } else {
+            ESP_LOGW(TAG, "Chirp not found (score %.2f)", match.score);
+        }
+
+        bool last = trial->last;
+        xQueueSend(s_free_queue, &trial, portMAX_DELAY);
+        if (last) {
+            xTaskNotifyGive(s_latency_task);
+        }
+    }
+}
+
+static void latency_print_result(uint32_t index)
+{
+    const latency_config_t *cfg = &s_latency_configs[index];
+    const latency_result_t *r = &s_latency_results[index];
+    float dma_ms = cfg->desc_num * cfg->frame_num * 1000.0f / SAMPLE_RATE;
+
+    ESP_LOGI(TAG, "%u x %4u (%5.1f ms) | app %6.2f ms [%6.2f, %6.2f] jitter %5.2f | stream %6.2f ms jitter %5.2f | %2u/%2u score>=%.2f | ovf tx %u rx %u",
+             (unsigned)cfg->desc_num, (unsigned)cfg->frame_num, dma_ms,
+             loopback_stats_mean(&r->app_ms), r->app_ms.min, r->app_ms.max, loopback_stats_stddev(&r->app_ms),
+             loopback_stats_mean(&r->stream_ms), loopback_stats_stddev(&r->stream_ms),
+             (unsigned)r->detected, (unsigned)r->trials, r->min_score,
+             (unsigned)r->tx_underruns, (unsigned)r->rx_overflows);
+}
+
+/**
+ * 回环延迟/抖动测量任务
+ * 扬声器播放chirp，麦克风录回后互相关定位起点（需要扬声器对着麦克风）。
+ * 对每个DMA配置重新初始化I2S，用与audio_loopback_task相同的读->写循环（块大小等于frame_num）跑若干次试验：
+ *   app    写入chirp的时刻到读到其起点所在块的时刻，即应用看到的往返延迟，包含任务调度
+ *   stream RX流与TX流的帧序号之差（DMA排队+编解码器+声学路径），与调度无关，
+ *          抖动不为零说明发生了欠载/溢出，流被插入或丢掉了样本
+ */
+static void loopback_latency_task(void *arg)
+{
+    static int16_t chirp[LATENCY_CHIRP_FRAMES];
+    int16_t *rx_buf = malloc(LATENCY_MAX_FRAME_NUM * 2 * sizeof(int16_t));
+    int16_t *tx_buf = malloc(LATENCY_MAX_FRAME_NUM * 2 * sizeof(int16_t));
+
+    loopback_make_chirp(chirp, LATENCY_CHIRP_FRAMES, LATENCY_CHIRP_F0, LATENCY_CHIRP_F1,
+                        SAMPLE_RATE, LATENCY_CHIRP_AMPLITUDE);
+    s_latency_task = xTaskGetCurrentTaskHandle();
+    s_trial_queue = xQueueCreate(2, sizeof(latency_trial_t *));
+    s_free_queue = xQueueCreate(2, sizeof(latency_trial_t *));
+    // 两个录音缓冲区轮换：分析上一次试验时录下一次
+    for (int i = 0; i < 2; i++) {
+        latency_trial_t *trial = malloc(sizeof(latency_trial_t));
+        if (trial == NULL || rx_buf == NULL || tx_buf == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate latency test buffers");
+            vTaskDelete(NULL);
+        }
+        xQueueSend(s_free_queue, &trial, 0);
+    }
+    xTaskCreate(latency_analysis_task, "latency_analysis", 4096, chirp, 4, NULL);
+
+    ESP_LOGI(TAG, "Loopback latency test: %u configs x %d trials, place the speaker near the mic",
+             (unsigned)LATENCY_CONFIG_COUNT, LATENCY_TRIALS);
+
+    for (uint32_t c = 0; c < LATENCY_CONFIG_COUNT; c++) {
+        const latency_config_t *cfg = &s_latency_configs[c];
+        if (cfg->frame_num < LATENCY_MIN_FRAME_NUM || cfg->frame_num > LATENCY_MAX_FRAME_NUM) {
+            ESP_LOGW(TAG, "Skipping DMA %u x %u: frame_num out of range",
+                     (unsigned)cfg->desc_num, (unsigned)cfg->frame_num);
+            continue;
+        }
+        i2s_deinit();
+        ESP_ERROR_CHECK(i2s_init_dma(cfg->desc_num, cfg->frame_num));
+
+        size_t block_bytes = cfg->frame_num * 2 * sizeof(int16_t);
+        uint32_t rx_frames = 0;
+        uint32_t tx_frames = 0;
+        for (int t = 0; t < LATENCY_WARMUP_TRIALS + LATENCY_TRIALS; t++) {
+            latency_trial_t *trial;
+            xQueueReceive(s_free_queue, &trial, portMAX_DELAY);
+            if (t == LATENCY_WARMUP_TRIALS) {
+                s_tx_underruns = 0;
+                s_rx_overflows = 0;
+            }
+            trial->config = c;
+            trial->last = (t == LATENCY_WARMUP_TRIALS + LATENCY_TRIALS - 1);
+            trial->block_frames = cfg->frame_num;
+            trial->frames = 0;
+            trial->blocks = 0;
+            trial->stream_base = (int32_t)(rx_frames - tx_frames);
+
+            uint32_t chirp_pos = 0;
+            while (trial->frames < LATENCY_WINDOW_FRAMES) {
+                size_t bytes = 0;
+
+                // 从麦克风读取，只保留左声道
+                i2s_channel_read(rx_handle, rx_buf, block_bytes, &bytes, portMAX_DELAY);
+                trial->read_us[trial->blocks++] = esp_timer_get_time();
+                uint32_t n = bytes / (2 * sizeof(int16_t));
+                for (uint32_t i = 0; i < n; i++) {
+                    trial->samples[trial->frames + i] = rx_buf[2 * i];
+                }
+                trial->frames += n;
+                rx_frames += n;
+
+                // 扬声器：chirp之后是静音
+                for (uint32_t i = 0; i < cfg->frame_num; i++, chirp_pos++) {
+                    int16_t sample = chirp_pos < LATENCY_CHIRP_FRAMES ? chirp[chirp_pos] : 0;
+                    tx_buf[2 * i] = sample;
+                    tx_buf[2 * i + 1] = sample;
+                }
+                if (chirp_pos == cfg->frame_num) {
+                    trial->tx_us = esp_timer_get_time();
+                }
+                i2s_channel_write(tx_handle, tx_buf, block_bytes, &bytes, portMAX_DELAY);
+                tx_frames += bytes / (2 * sizeof(int16_t));
+            }
+
+            if (t < LATENCY_WARMUP_TRIALS) {
+                xQueueSend(s_free_queue, &trial, portMAX_DELAY);
+            } else {
+                xQueueSend(s_trial_queue, &trial, portMAX_DELAY);
+            }
+        }
+
+        // 之后等待分析时TX在空转，先记下溢出计数
+        uint32_t tx_underruns = s_tx_underruns;
+        uint32_t rx_overflows = s_rx_overflows;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        s_latency_results[c].tx_underruns = tx_underruns;
+        s_latency_results[c].rx_overflows = rx_overflows;
+        latency_print_result(c);
+    }
+
+    ESP_LOGI(TAG, "Loopback latency results (desc x frames, DMA queue per direction):");
+    for (uint32_t c = 0; c < LATENCY_CONFIG_COUNT; c++) {
+        latency_print_result(c);
+    }
+    free(rx_buf);
+    free(tx_buf);
+    vTaskDelete(NULL);
+}
+
 /**
  * @brief LED闪烁任务
  */
@@ -315,6 +595,14 @@ void app_main(void)
     // 初始化控制引脚
     init_control_pins();
     
+#if DDS_BENCHMARK_ENABLED
+    dds_bench_t bench;
+    dds_benchmark(esp_cpu_get_cycle_count, SAMPLE_RATE, &bench);
+    ESP_LOGI(TAG, "Cycles/sample: sinf %u, DDS tone %u, 3 tones %u, chirp %u, white %u, pink %u",
+             (unsigned)bench.sinf_cycles, (unsigned)bench.tone_cycles, (unsigned)bench.multitone_cycles,
+             (unsigned)bench.chirp_cycles, (unsigned)bench.white_cycles, (unsigned)bench.pink_cycles);
+#endif
+    
     // 启动LED闪烁任务
     // xTaskCreate(blink_task, "blink_task", 2048, NULL, 5, NULL);
     
@@ -334,5 +622,8 @@ void app_main(void)
     // 2. 播放测试音调
     // xTaskCreate(play_test_tone_task, "play_test_tone", 4096, NULL, 5, NULL);
     
+    // 3. 回环延迟/抖动测量（扬声器对着麦克风）
+    // xTaskCreate(loopback_latency_task, "loopback_latency", 4096, NULL, 5, NULL);
+    
     ESP_LOGI(TAG, "Audio system initialized and running");
 }
\ No newline at end of file
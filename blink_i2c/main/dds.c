@@ -0,0 +1,222 @@
+#include "dds.h"
+#include <math.h>
+#include <string.h>
+
+#define DDS_TABLE_SIZE      (1 << DDS_TABLE_BITS)
+#define DDS_DEFAULT_SEED    0x2545F491u
+#define DDS_BENCH_BLOCK     256
+
+// sin(pi/2 * i/256)的Q15值，最后一项为插值保护点
+static const int16_t s_quarter_sine[DDS_TABLE_SIZE + 1] = {
+        0,   201,   402,   603,   804,  1005,  1206,  1407,  1608,  1809,  2009,  2210,
+     2410,  2611,  2811,  3012,  3212,  3412,  3612,  3811,  4011,  4210,  4410,  4609,
+     4808,  5007,  5205,  5404,  5602,  5800,  5998,  6195,  6393,  6590,  6786,  6983,
+     7179,  7375,  7571,  7767,  7962,  8157,  8351,  8545,  8739,  8933,  9126,  9319,
+     9512,  9704,  9896, 10087, 10278, 10469, 10659, 10849, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12353, 12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+    14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269, 15446, 15623, 15800, 15976,
+    16151, 16325, 16499, 16673, 16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+    18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357, 19519, 19680, 19841, 20000,
+    20159, 20317, 20475, 20631, 20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+    22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027, 23170, 23311, 23452, 23592,
+    23731, 23870, 24007, 24143, 24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+    25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198, 26319, 26438, 26556, 26674,
+    26790, 26905, 27019, 27133, 27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+    28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803, 28898, 28992, 29085, 29177,
+    29268, 29358, 29447, 29534, 29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+    30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783, 30852, 30919, 30985, 31050,
+    31113, 31176, 31237, 31297, 31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+    31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098, 32137, 32176, 32213, 32250,
+    32285, 32318, 32351, 32382, 32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+    32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717, 32728, 32737, 32745, 32752,
+    32757, 32761, 32765, 32766, 32767,
+};
+
+int32_t dds_sine(uint32_t phase) {
+    // 第2、4象限按表倒序读，第3、4象限取负
+    uint32_t p = phase & 0x3FFFFFFF;
+    if (phase & 0x40000000) {
+        p ^= 0x3FFFFFFF;
+    }
+    uint32_t index = p >> (30 - DDS_TABLE_BITS);
+    int32_t frac = (int32_t)((p >> (15 - DDS_TABLE_BITS)) & 0x7FFF);
+    int32_t a = s_quarter_sine[index];
+    int32_t b = s_quarter_sine[index + 1];
+    int32_t value = a + (((b - a) * frac + (1 << 14)) >> 15);
+    return (phase & 0x80000000) ? -value : value;
+}
+
+static uint32_t freq_to_step(const dds_t *dds, float freq_hz) {
+    // 只在配置时计算，用double保证增量精度
+    double nyquist = dds->sample_rate / 2.0;
+    double f = freq_hz < 0 ? 0 : (freq_hz > nyquist ? nyquist : freq_hz);
+    return (uint32_t)(f * 4294967296.0 / dds->sample_rate);
+}
+
+static int32_t to_q15(float amplitude) {
+    if (amplitude <= 0) {
+        return 0;
+    }
+    return amplitude >= 1.0f ? 32767 : (int32_t)(amplitude * 32768.0f);
+}
+
+void dds_init(dds_t *dds, int sample_rate) {
+    memset(dds, 0, sizeof(*dds));
+    dds->sample_rate = sample_rate;
+    dds->rng = DDS_DEFAULT_SEED;
+}
+
+int dds_add_tone(dds_t *dds, float freq_hz, float amplitude) {
+    return dds_add_chirp(dds, freq_hz, freq_hz, 0, amplitude, false);
+}
+
+int dds_add_chirp(dds_t *dds, float f0_hz, float f1_hz, float seconds, float amplitude, bool repeat) {
+    if (dds->tone_count >= DDS_MAX_TONES) {
+        return -1;
+    }
+    dds_tone_t *tone = &dds->tones[dds->tone_count];
+    memset(tone, 0, sizeof(*tone));
+    tone->step = tone->step_start = freq_to_step(dds, f0_hz);
+    tone->amplitude = to_q15(amplitude);
+    tone->sweep_repeat = repeat;
+
+    uint32_t samples = seconds > 0 ? (uint32_t)(seconds * dds->sample_rate) : 0;
+    if (samples > 0 && f1_hz != f0_hz) {
+        double end = freq_to_step(dds, f1_hz);
+        tone->step_delta = (int32_t)((end - tone->step_start) / samples);
+        tone->sweep_samples = samples;
+    }
+    return (int)dds->tone_count++;
+}
+
+void dds_set_noise(dds_t *dds, dds_noise_t noise, float amplitude, uint32_t seed) {
+    dds->noise = noise;
+    dds->noise_amplitude = to_q15(amplitude);
+    dds->rng = seed ? seed : DDS_DEFAULT_SEED;
+    dds->pink_counter = 0;
+    dds->pink_sum = 0;
+    memset(dds->pink_rows, 0, sizeof(dds->pink_rows));
+}
+
+static inline int32_t white_sample(dds_t *dds) {
+    uint32_t x = dds->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    dds->rng = x;
+    return (int32_t)(int16_t)(x >> 16);
+}
+
+/* Voss-McCartney：第k行每2^k个样本更新一次，各行与一个白噪声样本相加 */
+static inline int32_t pink_sample(dds_t *dds) {
+    uint32_t counter = ++dds->pink_counter;
+    if (counter != 0) {
+        int row = __builtin_ctz(counter);
+        if (row < DDS_PINK_ROWS) {
+            int32_t value = white_sample(dds) >> 4;
+            dds->pink_sum += value - dds->pink_rows[row];
+            dds->pink_rows[row] = value;
+        }
+    }
+    return dds->pink_sum + (white_sample(dds) >> 4);
+}
+
+static inline void tone_advance(dds_tone_t *tone) {
+    tone->phase += tone->step;
+    if (tone->sweep_samples == 0) {
+        return;
+    }
+    tone->step += (uint32_t)tone->step_delta;
+    if (++tone->sweep_pos >= tone->sweep_samples) {
+        if (tone->sweep_repeat) {
+            tone->step = tone->step_start;
+            tone->sweep_pos = 0;
+        } else {
+            tone->sweep_samples = 0;
+        }
+    }
+}
+
+void dds_render(dds_t *dds, int16_t *out, size_t frames, int channels) {
+    for (size_t i = 0; i < frames; i++) {
+        int32_t mix = 0;
+        for (size_t t = 0; t < dds->tone_count; t++) {
+            dds_tone_t *tone = &dds->tones[t];
+            mix += (dds_sine(tone->phase) * tone->amplitude) >> 15;
+            tone_advance(tone);
+        }
+        if (dds->noise == DDS_NOISE_WHITE) {
+            mix += (white_sample(dds) * dds->noise_amplitude) >> 15;
+        } else if (dds->noise == DDS_NOISE_PINK) {
+            mix += (pink_sample(dds) * dds->noise_amplitude) >> 15;
+        }
+
+        if (mix > 32767) {
+            mix = 32767;
+        } else if (mix < -32768) {
+            mix = -32768;
+        }
+        for (int c = 0; c < channels; c++) {
+            *out++ = (int16_t)mix;
+        }
+    }
+}
+
+/* 原来的生成方式：浮点相位累加+sinf */
+static void sinf_render(float *phase, float increment, int16_t *out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        out[i] = (int16_t)(sinf(*phase) * 32767 * 0.5f);
+        *phase += increment;
+        if (*phase >= 2.0f * (float)M_PI) {
+            *phase -= 2.0f * (float)M_PI;
+        }
+    }
+}
+
+static uint32_t bench_dds(dds_t *dds, uint32_t (*get_cycles)(void), size_t frames, int16_t *buf) {
+    uint32_t start = get_cycles();
+    for (size_t done = 0; done < frames; done += DDS_BENCH_BLOCK) {
+        dds_render(dds, buf, DDS_BENCH_BLOCK, 1);
+    }
+    return (get_cycles() - start) / frames;
+}
+
+void dds_benchmark(uint32_t (*get_cycles)(void), size_t frames, dds_bench_t *bench) {
+    static int16_t buf[DDS_BENCH_BLOCK];
+    dds_t dds;
+    const int rate = 48000;
+
+    frames = (frames + DDS_BENCH_BLOCK - 1) / DDS_BENCH_BLOCK * DDS_BENCH_BLOCK;
+    if (frames == 0) {
+        frames = DDS_BENCH_BLOCK;
+    }
+
+    float phase = 0;
+    uint32_t start = get_cycles();
+    for (size_t done = 0; done < frames; done += DDS_BENCH_BLOCK) {
+        sinf_render(&phase, 2.0f * (float)M_PI * 1000.0f / rate, buf, DDS_BENCH_BLOCK);
+    }
+    bench->sinf_cycles = (get_cycles() - start) / frames;
+
+    dds_init(&dds, rate);
+    dds_add_tone(&dds, 1000.0f, 0.5f);
+    bench->tone_cycles = bench_dds(&dds, get_cycles, frames, buf);
+
+    dds_init(&dds, rate);
+    dds_add_tone(&dds, 440.0f, 0.3f);
+    dds_add_tone(&dds, 1000.0f, 0.3f);
+    dds_add_tone(&dds, 3150.0f, 0.3f);
+    bench->multitone_cycles = bench_dds(&dds, get_cycles, frames, buf);
+
+    dds_init(&dds, rate);
+    dds_add_chirp(&dds, 20.0f, 20000.0f, 1.0f, 0.5f, true);
+    bench->chirp_cycles = bench_dds(&dds, get_cycles, frames, buf);
+
+    dds_init(&dds, rate);
+    dds_set_noise(&dds, DDS_NOISE_WHITE, 0.5f, 0);
+    bench->white_cycles = bench_dds(&dds, get_cycles, frames, buf);
+
+    dds_init(&dds, rate);
+    dds_set_noise(&dds, DDS_NOISE_PINK, 0.5f, 0);
+    bench->pink_cycles = bench_dds(&dds, get_cycles, frames, buf);
+}
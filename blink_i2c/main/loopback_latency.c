@@ -0,0 +1,148 @@
+#include "loopback_latency.h"
+#include "dds.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void loopback_make_chirp(int16_t *out, size_t len, float f0, float f1, int sample_rate, float amplitude) {
+    dds_t dds;
+    dds_init(&dds, sample_rate);
+    dds_add_chirp(&dds, f0, f1, (float)len / sample_rate, amplitude, false);
+    dds_render(&dds, out, len, 1);
+
+    // Hann窗：(1 - cos(2*pi*i/(len-1))) / 2，cos为正弦相位加四分之一周期
+    for (size_t i = 0; i < len; i++) {
+        uint32_t phase = len > 1 ? (uint32_t)(((uint64_t)i << 32) / (len - 1)) : 0;
+        int32_t window = (32768 - dds_sine(phase + 0x40000000u)) >> 1;
+        out[i] = (int16_t)((out[i] * window) >> 15);
+    }
+}
+
+/* 按factor抽取（块平均） */
+static size_t decimate(const int16_t *in, size_t len, size_t factor, float *out) {
+    size_t n = len / factor;
+    for (size_t i = 0; i < n; i++) {
+        int32_t sum = 0;
+        for (size_t k = 0; k < factor; k++) {
+            sum += in[i * factor + k];
+        }
+        out[i] = (float)sum / factor;
+    }
+    return n;
+}
+
+/* 在[lo, hi]范围内找|归一化相关|最大的位置 */
+static float best_lag(const float *x, size_t x_len, const float *t, size_t t_len,
+                      size_t lo, size_t hi, size_t *best) {
+    // S3的FPU只支持单精度，相关运算全部用float
+    float t_energy = 0;
+    for (size_t k = 0; k < t_len; k++) {
+        t_energy += t[k] * t[k];
+    }
+    if (hi + t_len > x_len) {
+        hi = x_len - t_len;
+    }
+
+    // 滑动窗口能量
+    float w_energy = 0;
+    for (size_t k = 0; k < t_len; k++) {
+        w_energy += x[lo + k] * x[lo + k];
+    }
+    float best_score = 0;
+    *best = lo;
+    for (size_t lag = lo; lag <= hi; lag++) {
+        if (lag > lo) {
+            float out = x[lag - 1], in = x[lag + t_len - 1];
+            w_energy += in * in - out * out;
+        }
+        float dot = 0;
+        for (size_t k = 0; k < t_len; k++) {
+            dot += x[lag + k] * t[k];
+        }
+        float norm = sqrtf(t_energy * (w_energy > 0 ? w_energy : 0));
+        float score = norm > 0 ? fabsf(dot) / norm : 0;
+        if (score > best_score) {
+            best_score = score;
+            *best = lag;
+        }
+    }
+    return best_score;
+}
+
+bool loopback_find_chirp(const int16_t *capture, size_t capture_len,
+                         const int16_t *chirp, size_t chirp_len,
+                         float min_score, loopback_match_t *match) {
+    if (capture_len < chirp_len || chirp_len < LOOPBACK_DECIMATION * 8) {
+        return false;
+    }
+    float *xd = malloc(capture_len / LOOPBACK_DECIMATION * sizeof(float));
+    float *td = malloc(chirp_len / LOOPBACK_DECIMATION * sizeof(float));
+    float *x = malloc((chirp_len + 2 * LOOPBACK_FINE_RADIUS + 1) * sizeof(float));
+    float *t = malloc(chirp_len * sizeof(float));
+    bool found = false;
+    if (!xd || !td || !x || !t) {
+        goto out;
+    }
+
+    // 粗搜：整个窗口
+    size_t xd_len = decimate(capture, capture_len, LOOPBACK_DECIMATION, xd);
+    size_t td_len = decimate(chirp, chirp_len, LOOPBACK_DECIMATION, td);
+    size_t coarse;
+    best_lag(xd, xd_len, td, td_len, 0, xd_len - td_len, &coarse);
+
+    // 精搜：全采样率，粗结果附近
+    size_t center = coarse * LOOPBACK_DECIMATION;
+    size_t lo = center > LOOPBACK_FINE_RADIUS ? center - LOOPBACK_FINE_RADIUS : 0;
+    size_t hi = center + LOOPBACK_FINE_RADIUS;
+    if (hi + chirp_len > capture_len) {
+        hi = capture_len - chirp_len;
+    }
+    size_t span = hi - lo + chirp_len;
+    for (size_t k = 0; k < span; k++) {
+        x[k] = capture[lo + k];
+    }
+    for (size_t k = 0; k < chirp_len; k++) {
+        t[k] = chirp[k];
+    }
+    size_t fine;
+    float score = best_lag(x, span, t, chirp_len, 0, hi - lo, &fine);
+    match->index = (uint32_t)(lo + fine);
+    match->score = score;
+    found = score >= min_score;
+
+out:
+    free(xd);
+    free(td);
+    free(x);
+    free(t);
+    return found;
+}
+
+void loopback_stats_reset(loopback_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void loopback_stats_add(loopback_stats_t *stats, double value) {
+    if (stats->count == 0 || value < stats->min) {
+        stats->min = value;
+    }
+    if (stats->count == 0 || value > stats->max) {
+        stats->max = value;
+    }
+    stats->count++;
+    stats->sum += value;
+    stats->sum_sq += value * value;
+}
+
+double loopback_stats_mean(const loopback_stats_t *stats) {
+    return stats->count ? stats->sum / stats->count : 0;
+}
+
+double loopback_stats_stddev(const loopback_stats_t *stats) {
+    if (stats->count < 2) {
+        return 0;
+    }
+    double mean = loopback_stats_mean(stats);
+    double var = stats->sum_sq / stats->count - mean * mean;
+    return var > 0 ? sqrt(var) : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef LOOPBACK_LATENCY_H
+#define LOOPBACK_LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 回环延迟测量的信号处理部分（不依赖ESP-IDF）
+ * 扬声器播放加窗的线性扫频（chirp），麦克风录回后与模板做互相关找到起点：
+ * 先在LOOPBACK_DECIMATION倍抽取后的信号上粗搜整个窗口，再在全采样率下于粗结果附近精搜，
+ * 相关峰按两段信号的能量归一化（0~1），低于门限视为没录到。
+ */
+
+#define LOOPBACK_DECIMATION     4       // 粗搜抽取倍数，chirp上限频率应低于sample_rate/2/LOOPBACK_DECIMATION
+#define LOOPBACK_FINE_RADIUS    (2 * LOOPBACK_DECIMATION)
+
+typedef struct {
+    uint32_t index;             // chirp起点在capture中的样本位置
+    float score;                // 归一化相关峰值（极性无关）
+} loopback_match_t;
+
+typedef struct {
+    uint32_t count;
+    double sum;
+    double sum_sq;
+    double min;
+    double max;
+} loopback_stats_t;
+
+/* 生成f0->f1的线性扫频，Hann窗包络，峰值为amplitude（0~1）倍满量程 */
+void loopback_make_chirp(int16_t *out, size_t len, float f0, float f1, int sample_rate, float amplitude);
+
+/* 在capture中查找chirp，score不低于min_score时返回true */
+bool loopback_find_chirp(const int16_t *capture, size_t capture_len,
+                         const int16_t *chirp, size_t chirp_len,
+                         float min_score, loopback_match_t *match);
+
+void loopback_stats_reset(loopback_stats_t *stats);
+void loopback_stats_add(loopback_stats_t *stats, double value);
+double loopback_stats_mean(const loopback_stats_t *stats);
+double loopback_stats_stddev(const loopback_stats_t *stats);
+
+#endif /* LOOPBACK_LATENCY_H */
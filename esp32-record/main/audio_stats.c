@@ -0,0 +1,213 @@
+#include "audio_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Integer square root */
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= result + bit) {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+
+/* log2(v) in Q16 for v > 0, by repeated squaring of the normalized mantissa */
+static int32_t log2_q16(uint64_t v) {
+    int n = 63 - __builtin_clzll(v);
+    uint64_t x = n >= 30 ? v >> (n - 30) : v << (30 - n);    // Q30 in [1, 2)
+    int32_t y = n << 16;
+
+    for (int bit = 15; bit >= 0; bit--) {
+        x = (x * x) >> 30;
+        if (x >= (2ULL << 30)) {
+            x >>= 1;
+            y |= 1 << bit;
+        }
+    }
+    return y;
+}
+
+int16_t audio_stats_power_db_x10(uint64_t mean_square) {
+    if (mean_square == 0) {
+        return AUDIO_STATS_MIN_DB_X10;
+    }
+    // 10*log10(ms / 2^30) = 3.0103 * (log2(ms) - 30), rounded to the nearest 0.1 dB
+    int64_t scaled = ((int64_t)log2_q16(mean_square) - (30 << 16)) * 30103;
+    int64_t db_x10 = (scaled + (scaled < 0 ? -32768000 : 32768000)) / 65536000;
+    return db_x10 < AUDIO_STATS_MIN_DB_X10 ? AUDIO_STATS_MIN_DB_X10 : (int16_t)db_x10;
+}
+
+void audio_stats_init(audio_stats_t *stats, int sample_rate) {
+    memset(stats, 0, sizeof(*stats));
+    stats->sample_rate = sample_rate;
+    stats->min = INT16_MAX;
+    stats->max = INT16_MIN;
+}
+
+void audio_stats_update(audio_stats_t *stats, const int16_t *samples, size_t count, size_t stride) {
+    if (count == 0) {
+        return;
+    }
+
+    // Start the DC tracker at the first block's mean so the first blocks don't read high
+    if (stats->blocks == 0) {
+        int64_t first_sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            first_sum += samples[i * stride];
+        }
+        stats->dc_q16 = (int32_t)(first_sum * 65536 / (int64_t)count);
+    }
+
+    int32_t dc = stats->dc_q16;
+    int64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint64_t ac_sq = 0;
+    int32_t min = stats->min, max = stats->max;
+    uint32_t block_peak = 0, clipped = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t x = samples[i * stride];
+        uint32_t mag = x < 0 ? (uint32_t)-x : (uint32_t)x;
+
+        sum += x;
+        sum_sq += (uint32_t)(x * x);
+        if (x < min) {
+            min = x;
+        }
+        if (x > max) {
+            max = x;
+        }
+        if (mag > block_peak) {
+            block_peak = mag;
+        }
+        if (mag >= AUDIO_STATS_CLIP_LEVEL) {
+            clipped++;
+        }
+
+        dc += (int32_t)(((int64_t)x * 65536 - dc) >> AUDIO_STATS_DC_SHIFT);
+        int64_t ac = x - (dc >> 16);
+        ac_sq += (uint64_t)(ac * ac);
+    }
+
+    stats->dc_q16 = dc;
+    stats->samples += count;
+    stats->sum += sum;
+    stats->sum_sq += sum_sq;
+    stats->min = (int16_t)min;
+    stats->max = (int16_t)max;
+    stats->clipped += clipped;
+    stats->block_peak = block_peak > UINT16_MAX ? UINT16_MAX : (uint16_t)block_peak;
+    if (stats->block_peak > stats->peak) {
+        stats->peak = stats->block_peak;
+    }
+    stats->block_ms = ac_sq / count;
+
+    // Exponential average over AUDIO_STATS_LOUDNESS_MS, weighted by block length
+    uint64_t window = (uint64_t)stats->sample_rate * AUDIO_STATS_LOUDNESS_MS / 1000;
+    if (stats->blocks == 0 || count >= window) {
+        stats->loudness_ms = stats->block_ms;
+    } else {
+        int64_t delta = (int64_t)stats->block_ms - (int64_t)stats->loudness_ms;
+        stats->loudness_ms = (uint64_t)((int64_t)stats->loudness_ms + delta * (int64_t)count / (int64_t)window);
+    }
+    stats->blocks++;
+}
+
+void audio_stats_snapshot(const audio_stats_t *stats, audio_stats_snapshot_t *snap) {
+    memset(snap, 0, sizeof(*snap));
+    snap->samples = (uint32_t)stats->samples;
+    snap->blocks = stats->blocks;
+    snap->clipped = stats->clipped;
+    snap->peak = stats->peak;
+    snap->block_peak = stats->block_peak;
+    snap->dc = (int16_t)(stats->dc_q16 >> 16);
+    snap->block_rms = (uint16_t)isqrt64(stats->block_ms);
+    snap->block_db_x10 = audio_stats_power_db_x10(stats->block_ms);
+    snap->peak_db_x10 = audio_stats_power_db_x10((uint64_t)stats->block_peak * stats->block_peak);
+    snap->loudness_db_x10 = audio_stats_power_db_x10(stats->loudness_ms);
+    if (stats->samples > 0) {
+        uint64_t mean_square = stats->sum_sq / stats->samples;
+        snap->min = stats->min;
+        snap->max = stats->max;
+        snap->mean = (int16_t)(stats->sum / (int64_t)stats->samples);
+        snap->rms = (uint16_t)isqrt64(mean_square);
+        snap->rms_db_x10 = audio_stats_power_db_x10(mean_square);
+    } else {
+        snap->rms_db_x10 = AUDIO_STATS_MIN_DB_X10;
+    }
+}
+
+/* dB x10 as a decimal string, e.g. -235 -> "-23.5" */
+static const char *format_db(int16_t db_x10, char *buf, size_t len) {
+    int magnitude = db_x10 < 0 ? -db_x10 : db_x10;
+    snprintf(buf, len, "%s%d.%d", db_x10 < 0 ? "-" : "", magnitude / 10, magnitude % 10);
+    return buf;
+}
+
+size_t audio_stats_to_json(const audio_stats_snapshot_t *snap, char *buf, size_t len) {
+    char block_db[8], peak_db[8], loudness_db[8], rms_db[8];
+    int n = snprintf(buf, len,
+                     "{\"samples\":%u,\"blocks\":%u,\"peak\":%u,\"block_peak\":%u,\"min\":%d,\"max\":%d,"
+                     "\"dc\":%d,\"mean\":%d,\"rms\":%u,\"block_rms\":%u,\"clipped\":%u,"
+                     "\"block_db\":%s,\"peak_db\":%s,\"loudness_db\":%s,\"rms_db\":%s}",
+                     (unsigned)snap->samples, (unsigned)snap->blocks, (unsigned)snap->peak,
+                     (unsigned)snap->block_peak, snap->min, snap->max, snap->dc, snap->mean,
+                     (unsigned)snap->rms, (unsigned)snap->block_rms, (unsigned)snap->clipped,
+                     format_db(snap->block_db_x10, block_db, sizeof(block_db)),
+                     format_db(snap->peak_db_x10, peak_db, sizeof(peak_db)),
+                     format_db(snap->loudness_db_x10, loudness_db, sizeof(loudness_db)),
+                     format_db(snap->rms_db_x10, rms_db, sizeof(rms_db)));
+    if (n < 0) {
+        return 0;
+    }
+    return (size_t)n < len ? (size_t)n : (len > 0 ? len - 1 : 0);
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    p = put_u16(p, (uint16_t)v);
+    return put_u16(p, (uint16_t)(v >> 16));
+}
+
+size_t audio_stats_to_binary(const audio_stats_snapshot_t *snap, uint8_t *buf, size_t len) {
+    if (len < AUDIO_STATS_BINARY_SIZE) {
+        return 0;
+    }
+    // Header: version, reserved, total size
+    uint8_t *p = buf;
+    *p++ = AUDIO_STATS_BINARY_VERSION;
+    *p++ = 0;
+    p = put_u16(p, AUDIO_STATS_BINARY_SIZE);
+    p = put_u32(p, snap->samples);
+    p = put_u32(p, snap->blocks);
+    p = put_u32(p, snap->clipped);
+    p = put_u16(p, (uint16_t)snap->min);
+    p = put_u16(p, (uint16_t)snap->max);
+    p = put_u16(p, snap->peak);
+    p = put_u16(p, snap->block_peak);
+    p = put_u16(p, (uint16_t)snap->dc);
+    p = put_u16(p, (uint16_t)snap->mean);
+    p = put_u16(p, snap->rms);
+    p = put_u16(p, snap->block_rms);
+    p = put_u16(p, (uint16_t)snap->block_db_x10);
+    p = put_u16(p, (uint16_t)snap->peak_db_x10);
+    p = put_u16(p, (uint16_t)snap->loudness_db_x10);
+    p = put_u16(p, (uint16_t)snap->rms_db_x10);
+    return (size_t)(p - buf);
+}
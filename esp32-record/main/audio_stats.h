@@ -0,0 +1,77 @@
+#ifndef AUDIO_STATS_H
+#define AUDIO_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Streaming audio statistics (no ESP-IDF dependencies)
+ * Each block updates running peak, min/max, DC offset, clipping count, block RMS and a
+ * short-term loudness estimate using integer arithmetic only; nothing is rescanned.
+ * Block RMS and loudness are measured after removing the tracked DC offset, the overall
+ * RMS covers the raw samples. Loudness is the unweighted, ungated mean square averaged
+ * over AUDIO_STATS_LOUDNESS_MS (an exponential average, not a K-weighted LUFS value).
+ * Levels are reported in dBFS x10, where 0 is a full-scale square wave.
+ */
+
+#define AUDIO_STATS_CLIP_LEVEL      32700   // |sample| at or above this counts as clipped
+#define AUDIO_STATS_DC_SHIFT        12      // DC tracker time constant: 2^12 samples (85 ms at 48 kHz)
+#define AUDIO_STATS_LOUDNESS_MS     400
+#define AUDIO_STATS_MIN_DB_X10      (-960)  // reported for silence
+#define AUDIO_STATS_BINARY_VERSION  1
+#define AUDIO_STATS_BINARY_SIZE     40
+
+typedef struct {
+    int sample_rate;
+    uint64_t samples;
+    int64_t sum;                // raw sum, for the mean
+    uint64_t sum_sq;            // raw sum of squares, for the overall RMS
+    int16_t min;
+    int16_t max;
+    uint16_t peak;              // max |sample| since reset
+    uint32_t clipped;
+    int32_t dc_q16;             // tracked DC offset, Q16
+    uint16_t block_peak;
+    uint64_t block_ms;          // last block mean square (DC removed)
+    uint64_t loudness_ms;       // short-term mean square (DC removed)
+    uint32_t blocks;
+} audio_stats_t;
+
+/* Snapshot of the current values, fixed size for logging or transmission */
+typedef struct {
+    uint32_t samples;
+    uint32_t blocks;
+    uint32_t clipped;
+    int16_t min;
+    int16_t max;
+    uint16_t peak;
+    uint16_t block_peak;
+    int16_t dc;                 // tracked DC offset
+    int16_t mean;               // mean of all samples
+    uint16_t rms;               // overall RMS (raw)
+    uint16_t block_rms;         // last block RMS (DC removed)
+    int16_t block_db_x10;
+    int16_t peak_db_x10;        // last block peak
+    int16_t loudness_db_x10;
+    int16_t rms_db_x10;         // overall
+} audio_stats_snapshot_t;
+
+/* Reset all statistics */
+void audio_stats_init(audio_stats_t *stats, int sample_rate);
+
+/* Add count samples taken every stride-th element (stride 2 reads the left channel of stereo data) */
+void audio_stats_update(audio_stats_t *stats, const int16_t *samples, size_t count, size_t stride);
+
+/* Compute the derived values (integer sqrt/log, no floating point) */
+void audio_stats_snapshot(const audio_stats_t *stats, audio_stats_snapshot_t *snap);
+
+/* Serialize as JSON into buf, returns the length (truncated output is still terminated) */
+size_t audio_stats_to_json(const audio_stats_snapshot_t *snap, char *buf, size_t len);
+
+/* Serialize as little-endian binary (AUDIO_STATS_BINARY_SIZE bytes), returns 0 if len is too small */
+size_t audio_stats_to_binary(const audio_stats_snapshot_t *snap, uint8_t *buf, size_t len);
+
+/* Power ratio to dBFS x10: 10*log10(mean_square / 32768^2) */
+int16_t audio_stats_power_db_x10(uint64_t mean_square);
+
+#endif /* AUDIO_STATS_H */
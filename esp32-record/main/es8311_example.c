@@ -1,6 +1,5 @@
 #include <stdio.h>
 #include <string.h>
-#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/i2c.h"
@@ -9,6 +8,7 @@
 #include "es8311.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "audio_stats.h"
 
 /* GPIO Definitions */
 #define CODEC_ENABLE_PIN    GPIO_NUM_6   // PREP_VCC_CTL - ES8311 power enable
@@ -31,22 +31,13 @@
 #define DMA_BUF_LEN         1024
 #define RECORD_TIME_SEC     10     // Record for 10 seconds
 
-static const char *TAG = "ES8311_RECORD";
+/* Level reporting */
+#define LEVEL_REPORT_MS     250    // Snapshot interval (the meter used to redraw every block)
+#define LEVEL_OUTPUT_JSON   0      // One JSON snapshot per interval
+#define LEVEL_OUTPUT_METER  1      // Bar meter, written as a single line per interval
+#define LEVEL_OUTPUT        LEVEL_OUTPUT_JSON
 
-/* Calculate RMS (Root Mean Square) for volume level */
-static float calculate_rms(int16_t *buffer, int num_samples) {
-    int64_t sum = 0;
-    for (int i = 0; i < num_samples; i++) {
-        sum += (int64_t)buffer[i] * buffer[i];
-    }
-    return sqrtf((float)sum / num_samples);
-}
-
-/* Convert RMS to dB */
-static float rms_to_db(float rms) {
-    if (rms <= 0) return -96.0f;  // Minimum dB
-    return 20.0f * log10f(rms / 32768.0f);  // 32768 is max value for 16-bit
-}
+static const char *TAG = "ES8311_RECORD";
 
 /* Initialize I2C bus */
 static esp_err_t i2c_master_init(void) {
@@ -164,15 +155,6 @@ static void audio_record_task(void *pvParameters) {
         return;
     }
     
-    /* Buffer for mono audio (using left channel only) */
-    int16_t *mono_buffer = (int16_t *)malloc(DMA_BUF_LEN * sizeof(int16_t));
-    if (mono_buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate mono buffer");
-        free(audio_buffer);
-        vTaskDelete(NULL);
-        return;
-    }
-    
     ESP_LOGI(TAG, "Starting audio recording...");
     ESP_LOGI(TAG, "Recording for %d seconds at %d Hz", RECORD_TIME_SEC, SAMPLE_RATE);
     
@@ -193,6 +175,12 @@ static void audio_record_task(void *pvParameters) {
         }
     }
     
+    /* Running statistics, updated once per block */
+    audio_stats_t stats;
+    audio_stats_init(&stats, SAMPLE_RATE);
+    const int report_samples = SAMPLE_RATE * LEVEL_REPORT_MS / 1000;
+    int next_report = report_samples;
+    
     uint32_t start_time = xTaskGetTickCount();
     
     while (1) {
@@ -203,71 +191,62 @@ static void audio_record_task(void *pvParameters) {
             continue;
         }
         
-        /* Extract mono audio (left channel) */
+        /* Left channel only: statistics read it in place, recording copies it */
         int samples_read = bytes_read / (2 * sizeof(int16_t));  // Stereo samples
-        for (int i = 0; i < samples_read; i++) {
-            mono_buffer[i] = audio_buffer[i * 2];  // Left channel only
-            
-            /* Store in recording buffer if allocated */
-            if (recording_buffer && sample_count < total_samples) {
-                recording_buffer[sample_count++] = mono_buffer[i];
-            }
+        audio_stats_update(&stats, audio_buffer, samples_read, 2);
+        for (int i = 0; i < samples_read && recording_buffer && sample_count < total_samples; i++) {
+            recording_buffer[sample_count++] = audio_buffer[i * 2];
         }
         
-        /* Calculate and display audio level */
-        float rms = calculate_rms(mono_buffer, samples_read);
-        float db = rms_to_db(rms);
-        
-        /* Create visual level meter */
-        int level_bars = (int)((db + 60) / 3);  // Scale -60dB to 0dB into 0-20 bars
-        if (level_bars < 0) level_bars = 0;
-        if (level_bars > 20) level_bars = 20;
-        
-        /* Calculate recording progress */
-        float progress = (float)sample_count / total_samples * 100.0f;
-        
-        printf("\r[%3.0f%%] Level: [", progress);
-        for (int i = 0; i < 20; i++) {
-            if (i < level_bars) {
-                printf("=");
-            } else {
-                printf(" ");
-            }
+        /* Report the level once per interval */
+        if ((int)stats.samples >= next_report) {
+            next_report += report_samples;
+            audio_stats_snapshot_t snap;
+            audio_stats_snapshot(&stats, &snap);
+            int progress = (int)((int64_t)sample_count * 100 / total_samples);
+#if LEVEL_OUTPUT == LEVEL_OUTPUT_METER
+            /* Scale -60dB to 0dB into 0-20 bars */
+            char line[48];
+            int level_bars = (snap.block_db_x10 + 600) / 30;
+            if (level_bars < 0) level_bars = 0;
+            if (level_bars > 20) level_bars = 20;
+            memset(line, ' ', 20);
+            memset(line, '=', level_bars);
+            line[20] = '\0';
+            printf("\r[%3d%%] Level: [%s] -%d.%d dB ", progress, line,
+                   -snap.block_db_x10 / 10, -snap.block_db_x10 % 10);  // dBFS is never positive
+            fflush(stdout);
+#else
+            char json[320];
+            audio_stats_to_json(&snap, json, sizeof(json));
+            ESP_LOGI(TAG, "[%3d%%] %s", progress, json);
+#endif
         }
-        printf("] %.1f dB", db);
-        fflush(stdout);
         
         /* Check if recording time is reached */
-        if (RECORD_TIME_SEC > 0 && sample_count >= total_samples) {
+        if (RECORD_TIME_SEC > 0 && (int)stats.samples >= total_samples) {
             uint32_t end_time = xTaskGetTickCount();
             float actual_duration = (end_time - start_time) / (float)configTICK_RATE_HZ;
             
+#if LEVEL_OUTPUT == LEVEL_OUTPUT_METER
             printf("\n");
+#endif
             ESP_LOGI(TAG, "Recording completed!");
             ESP_LOGI(TAG, "Duration: %.2f seconds", actual_duration);
             ESP_LOGI(TAG, "Samples recorded: %d", sample_count);
             
-            /* Find max and min values in recording */
+            /* Totals were accumulated while recording, no rescan of the buffer */
+            audio_stats_snapshot_t snap;
+            audio_stats_snapshot(&stats, &snap);
+            ESP_LOGI(TAG, "Audio statistics:");
+            ESP_LOGI(TAG, "  Max amplitude: %d", snap.max);
+            ESP_LOGI(TAG, "  Min amplitude: %d", snap.min);
+            ESP_LOGI(TAG, "  Average: %d (tracked DC %d)", snap.mean, snap.dc);
+            ESP_LOGI(TAG, "  Overall RMS: %u (-%d.%d dB)", (unsigned)snap.rms,
+                     -snap.rms_db_x10 / 10, -snap.rms_db_x10 % 10);
+            ESP_LOGI(TAG, "  Clipped samples: %u", (unsigned)snap.clipped);
+            
             if (recording_buffer) {
-                int16_t max_val = -32768, min_val = 32767;
-                int64_t sum = 0;
-                
-                for (int i = 0; i < sample_count; i++) {
-                    if (recording_buffer[i] > max_val) max_val = recording_buffer[i];
-                    if (recording_buffer[i] < min_val) min_val = recording_buffer[i];
-                    sum += recording_buffer[i];
-                }
-                
-                float avg = (float)sum / sample_count;
-                ESP_LOGI(TAG, "Audio statistics:");
-                ESP_LOGI(TAG, "  Max amplitude: %d", max_val);
-                ESP_LOGI(TAG, "  Min amplitude: %d", min_val);
-                ESP_LOGI(TAG, "  Average: %.2f", avg);
-                
-                /* Calculate overall RMS */
-                float overall_rms = calculate_rms(recording_buffer, sample_count);
-                ESP_LOGI(TAG, "  Overall RMS: %.2f (%.1f dB)", overall_rms, rms_to_db(overall_rms));
-                
                 /* Here you can save the recording_buffer to SD card or process it */
                 ESP_LOGI(TAG, "Recording data is ready for processing/saving");
             }
@@ -278,7 +257,6 @@ static void audio_record_task(void *pvParameters) {
     
     /* Cleanup */
     free(audio_buffer);
-    free(mono_buffer);
     if (recording_buffer) {
         free(recording_buffer);
     }
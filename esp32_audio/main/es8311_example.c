@@ -1,6 +1,5 @@
 #include <stdio.h>
 #include <string.h>
-#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/i2c.h"
@@ -9,6 +8,7 @@
 #include "es8311.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "dds.h"
 
 /* GPIO Definitions */
 #define CODEC_ENABLE_PIN    GPIO_NUM_6   // PREP_VCC_CTL - ES8311 power enable
@@ -34,16 +34,6 @@
 
 static const char *TAG = "ES8311_AUDIO";
 
-/* Generate sine wave samples */
-static void generate_sine_wave(int16_t *buffer, int num_samples, float frequency, int sample_rate) {
-    for (int i = 0; i < num_samples; i++) {
-        float sample = AMPLITUDE * sinf(2.0f * M_PI * frequency * i / sample_rate);
-        // Stereo: same sample for both channels
-        buffer[i * 2] = (int16_t)sample;      // Left channel
-        buffer[i * 2 + 1] = (int16_t)sample;  // Right channel
-    }
-}
-
 /* Initialize I2C bus */
 static esp_err_t i2c_master_init(void) {
     i2c_config_t conf = {
@@ -170,16 +160,19 @@ void app_main(void) {
         return;
     }
     
-    /* Generate sine wave */
-    generate_sine_wave(audio_buffer, DMA_BUF_LEN, SINE_WAVE_FREQ, SAMPLE_RATE);
-    ESP_LOGI(TAG, "Generated %d Hz sine wave", SINE_WAVE_FREQ);
+    /* Sine wave generator - phase continues across buffers, so no click at buffer boundaries */
+    dds_t tone;
+    dds_init(&tone, SAMPLE_RATE);
+    dds_add_tone(&tone, SINE_WAVE_FREQ, AMPLITUDE / 32768.0f);
+    ESP_LOGI(TAG, "Generating %d Hz sine wave", SINE_WAVE_FREQ);
     
     /* Main audio playback loop */
     ESP_LOGI(TAG, "Starting audio playback...");
     size_t bytes_written;
     
     while (1) {
-        /* Write audio data to I2S */
+        /* Generate next buffer (stereo) and write it to I2S */
+        dds_render(&tone, audio_buffer, DMA_BUF_LEN, 2);
         esp_err_t ret = i2s_channel_write(tx_handle, audio_buffer, buf_size, &bytes_written, portMAX_DELAY);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "I2S write failed: %s", esp_err_to_name(ret));
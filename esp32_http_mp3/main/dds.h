@@ -0,0 +1,79 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 定点直接数字频率合成（DDS）信号发生器（不依赖ESP-IDF）
+ * 每个音调一个32位相位累加器（2^32为一个周期，频率分辨率sample_rate/2^32），
+ * 正弦值查257点四分之一周期表并线性插值，每样本只有整数运算，长时间运行相位不漂移。
+ * 支持多音调叠加、线性扫频（chirp）、白噪声和粉红噪声，用于测试音、回环和校准信号。
+ */
+
+#define DDS_MAX_TONES       4
+#define DDS_TABLE_BITS      8                   // 四分之一周期256段
+#define DDS_PINK_ROWS       12                  // Voss-McCartney行数，1/f特性覆盖约12个倍频程
+
+typedef enum {
+    DDS_NOISE_NONE = 0,
+    DDS_NOISE_WHITE,
+    DDS_NOISE_PINK,
+} dds_noise_t;
+
+typedef struct {
+    uint32_t phase;             // 相位累加器
+    uint32_t step;              // 每样本相位增量 = freq * 2^32 / sample_rate
+    uint32_t step_start;        // 扫频起点的增量
+    int32_t step_delta;         // 每样本增量的变化，0为固定频率
+    uint32_t sweep_samples;     // 扫频长度（样本），0为固定频率
+    uint32_t sweep_pos;
+    bool sweep_repeat;          // 扫频结束后回到起点，否则停在终点频率
+    int32_t amplitude;          // Q15
+} dds_tone_t;
+
+typedef struct {
+    int sample_rate;
+    dds_tone_t tones[DDS_MAX_TONES];
+    size_t tone_count;
+    dds_noise_t noise;
+    int32_t noise_amplitude;    // Q15
+    uint32_t rng;               // xorshift32状态
+    uint32_t pink_counter;
+    int32_t pink_rows[DDS_PINK_ROWS];
+    int32_t pink_sum;
+} dds_t;
+
+/* 各信号每样本的CPU周期数 */
+typedef struct {
+    uint32_t sinf_cycles;       // 原来的sinf+浮点相位累加
+    uint32_t tone_cycles;       // 单音调
+    uint32_t multitone_cycles;  // 三音调叠加
+    uint32_t chirp_cycles;
+    uint32_t white_cycles;
+    uint32_t pink_cycles;
+} dds_bench_t;
+
+/* 初始化为静音 */
+void dds_init(dds_t *dds, int sample_rate);
+
+/* 增加一个固定频率的音调，amplitude为满量程的比例（0~1）；返回音调序号，已满返回-1 */
+int dds_add_tone(dds_t *dds, float freq_hz, float amplitude);
+
+/* 增加一个f0->f1的线性扫频，repeat为true时周期性重复 */
+int dds_add_chirp(dds_t *dds, float f0_hz, float f1_hz, float seconds, float amplitude, bool repeat);
+
+/* 设置叠加的噪声，seed为0时使用默认种子；粉红噪声峰值不超过amplitude的0.8倍 */
+void dds_set_noise(dds_t *dds, dds_noise_t noise, float amplitude, uint32_t seed);
+
+/* 生成frames帧，每帧channels个相同的样本（交错），叠加结果饱和到16位 */
+void dds_render(dds_t *dds, int16_t *out, size_t frames, int channels);
+
+/* 相位对应的正弦值（Q15） */
+int32_t dds_sine(uint32_t phase);
+
+/* 用get_cycles（如esp_cpu_get_cycle_count）测量各信号每样本的开销，frames为每项生成的样本数 */
+void dds_benchmark(uint32_t (*get_cycles)(void), size_t frames, dds_bench_t *bench);
+
+#endif /* DDS_H */
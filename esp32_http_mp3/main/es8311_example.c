@@ -1,7 +1,6 @@
 // main/es8311_example.c - 简化版本，不依赖ESP-ADF
 #include <stdio.h>
 #include <string.h>
-#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -15,8 +14,10 @@
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "esp_http_client.h"
-#include "esp_spiffs.h"
+#include "esp_partition.h"
 #include "nvs_flash.h"
+#include "json_stream.h"
+#include "dds.h"
 
 /* WiFi配置 */
 #define WIFI_SSID "CE-Hub-Student"
@@ -49,14 +50,24 @@
 #define DMA_BUF_COUNT       8
 #define DMA_BUF_LEN         1024
 
-/* SPIFFS配置 */
-#define SPIFFS_MOUNT_POINT  "/spiffs"
-#define MAX_FILE_SIZE       (1024 * 1024 * 2)  // 2MB最大文件大小
+/* 音频分区配置 - 原始分区，第一个扇区存放片段头，数据从下一扇区开始，播放时直接映射 */
+#define AUDIO_PARTITION_LABEL   "audio"
+#define AUDIO_SECTOR_SIZE       4096
+#define AUDIO_DATA_OFFSET       AUDIO_SECTOR_SIZE
+#define AUDIO_HEADER_MAGIC      0x4D503341u     // "A3PM"
+
+/* 片段头：数据写完后才写入，头有效即数据完整（预置片段也按此格式烧录） */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    char name[56];
+} audio_clip_header_t;
 
 static const char *TAG = "ESP32_TTS";
 static EventGroupHandle_t s_wifi_event_group;
 static i2s_chan_handle_t tx_handle = NULL;
 static es8311_handle_t codec_handle = NULL;
+static const esp_partition_t *s_audio_partition = NULL;
 
 /* WiFi事件处理 */
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
@@ -126,48 +137,53 @@ static esp_err_t wifi_init_sta(void) {
     }
 }
 
-/* 初始化SPIFFS */
-static esp_err_t spiffs_init(void) {
-    ESP_LOGI(TAG, "初始化SPIFFS");
-
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = SPIFFS_MOUNT_POINT,
-        .partition_label = NULL,
-        .max_files = 5,
-        .format_if_mount_failed = true
-    };
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-
-    if (ret != ESP_OK) {
-        if (ret == ESP_FAIL) {
-            ESP_LOGE(TAG, "挂载或格式化文件系统失败");
-        } else if (ret == ESP_ERR_NOT_FOUND) {
-            ESP_LOGE(TAG, "找不到SPIFFS分区");
-        } else {
-            ESP_LOGE(TAG, "初始化SPIFFS失败 (%s)", esp_err_to_name(ret));
-        }
-        return ret;
-    }
-
-    size_t total = 0, used = 0;
-    ret = esp_spiffs_info(NULL, &total, &used);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "获取SPIFFS分区信息失败 (%s)", esp_err_to_name(ret));
-    } else {
-        ESP_LOGI(TAG, "SPIFFS分区大小: total: %d, used: %d", total, used);
+/* 查找音频分区 */
+static esp_err_t audio_partition_init(void) {
+    s_audio_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                 AUDIO_PARTITION_LABEL);
+    if (!s_audio_partition) {
+        ESP_LOGE(TAG, "找不到音频分区: %s", AUDIO_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
     }
-
+    ESP_LOGI(TAG, "音频分区大小: %d KB, 最大片段: %d KB", (int)(s_audio_partition->size / 1024),
+             (int)((s_audio_partition->size - AUDIO_DATA_OFFSET) / 1024));
     return ESP_OK;
 }
 
 /* HTTP下载回调函数 */
 typedef struct {
-    FILE *fp;
     size_t total_size;
     size_t downloaded;
+    size_t erased;          // 已擦除到的数据区偏移
+    bool overflow;
+    esp_err_t flash_err;
 } download_context_t;
 
+/* 收到的数据直接写入分区，按需擦除前方的扇区，不经过文件系统 */
+static void audio_partition_append(download_context_t *ctx, const void *data, size_t len) {
+    size_t capacity = s_audio_partition->size - AUDIO_DATA_OFFSET;
+    if (ctx->flash_err != ESP_OK || ctx->overflow) {
+        return;
+    }
+    if (ctx->downloaded + len > capacity) {
+        ctx->overflow = true;
+        return;
+    }
+    
+    size_t end = ctx->downloaded + len;
+    if (end > ctx->erased) {
+        size_t erase_len = (end - ctx->erased + AUDIO_SECTOR_SIZE - 1) / AUDIO_SECTOR_SIZE * AUDIO_SECTOR_SIZE;
+        ctx->flash_err = esp_partition_erase_range(s_audio_partition, AUDIO_DATA_OFFSET + ctx->erased, erase_len);
+        ctx->erased += erase_len;
+    }
+    if (ctx->flash_err == ESP_OK) {
+        ctx->flash_err = esp_partition_write(s_audio_partition, AUDIO_DATA_OFFSET + ctx->downloaded, data, len);
+    }
+    if (ctx->flash_err == ESP_OK) {
+        ctx->downloaded += len;
+    }
+}
+
 static esp_err_t http_download_event_handler(esp_http_client_event_t *evt) {
     download_context_t *ctx = (download_context_t *)evt->user_data;
     
@@ -179,12 +195,12 @@ static esp_err_t http_download_event_handler(esp_http_client_event_t *evt) {
             }
             break;
         case HTTP_EVENT_ON_DATA:
-            if (ctx->fp) {
-                size_t written = fwrite(evt->data, 1, evt->data_len, ctx->fp);
-                ctx->downloaded += written;
+            {
+                int last_progress = ctx->total_size > 0 ? (ctx->downloaded * 100) / ctx->total_size : 0;
+                audio_partition_append(ctx, evt->data, evt->data_len);
                 if (ctx->total_size > 0) {
                     int progress = (ctx->downloaded * 100) / ctx->total_size;
-                    if (progress % 20 == 0) {  // 每20%打印一次进度
+                    if (progress / 20 != last_progress / 20) {  // 每20%打印一次进度
                         ESP_LOGI(TAG, "下载进度: %d%%", progress);
                     }
                 }
@@ -196,20 +212,36 @@ static esp_err_t http_download_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-/* 下载音频文件 */
-static esp_err_t download_audio_file(const char *url, const char *local_path) {
-    ESP_LOGI(TAG, "开始下载: %s 到 %s", url, local_path);
+/* TTS响应事件处理器 - 数据到达时直接送入增量JSON解析器 */
+static esp_err_t tts_response_event_handler(esp_http_client_event_t *evt) {
+    json_stream_t *js = (json_stream_t *)evt->user_data;
     
-    FILE *fp = fopen(local_path, "wb");
-    if (!fp) {
-        ESP_LOGE(TAG, "无法创建文件: %s", local_path);
-        return ESP_FAIL;
+    if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        json_stream_feed(js, (const char *)evt->data, evt->data_len);
+    }
+    return ESP_OK;
+}
+
+/* 下载音频文件到音频分区，name记录在片段头中 */
+static esp_err_t download_audio_file(const char *url, const char *name) {
+    if (!s_audio_partition) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "开始下载: %s 到分区 %s", url, AUDIO_PARTITION_LABEL);
+    
+    // 先擦除片段头，下载中途失败时不会留下看似完整的旧片段
+    esp_err_t err = esp_partition_erase_range(s_audio_partition, 0, AUDIO_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "擦除片段头失败: %s", esp_err_to_name(err));
+        return err;
     }
     
     download_context_t ctx = {
-        .fp = fp,
         .total_size = 0,
-        .downloaded = 0
+        .downloaded = 0,
+        .erased = 0,
+        .overflow = false,
+        .flash_err = ESP_OK,
     };
     
     esp_http_client_config_t config = {
@@ -222,26 +254,72 @@ static esp_err_t download_audio_file(const char *url, const char *local_path) {
     };
     
     esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_err_t err = esp_http_client_perform(client);
-    
-    fclose(fp);
+    err = esp_http_client_perform(client);
     
     if (err == ESP_OK) {
         int status_code = esp_http_client_get_status_code(client);
-        if (status_code == 200) {
-            ESP_LOGI(TAG, "下载完成，总共下载: %d 字节", ctx.downloaded);
-        } else {
+        if (status_code != 200) {
             ESP_LOGE(TAG, "HTTP错误码: %d", status_code);
             err = ESP_FAIL;
+        } else if (ctx.overflow) {
+            ESP_LOGE(TAG, "文件超出音频分区大小");
+            err = ESP_ERR_INVALID_SIZE;
+        } else if (ctx.flash_err != ESP_OK) {
+            ESP_LOGE(TAG, "写入音频分区失败: %s", esp_err_to_name(ctx.flash_err));
+            err = ctx.flash_err;
+        } else {
+            ESP_LOGI(TAG, "下载完成，总共下载: %d 字节", ctx.downloaded);
         }
     } else {
         ESP_LOGE(TAG, "HTTP请求失败: %s", esp_err_to_name(err));
     }
     
+    if (err == ESP_OK) {
+        audio_clip_header_t header = {
+            .magic = AUDIO_HEADER_MAGIC,
+            .size = ctx.downloaded,
+        };
+        strncpy(header.name, name, sizeof(header.name) - 1);
+        err = esp_partition_write(s_audio_partition, 0, &header, sizeof(header));
+    }
+    
     esp_http_client_cleanup(client);
     return err;
 }
 
+/* 映射分区中的片段：返回指向flash的只读指针，不复制、不占用堆内存；用完后esp_partition_munmap */
+static esp_err_t audio_clip_map(const uint8_t **data, size_t *size, esp_partition_mmap_handle_t *handle) {
+    if (!s_audio_partition) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    audio_clip_header_t header;
+    esp_err_t err = esp_partition_read(s_audio_partition, 0, &header, sizeof(header));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (header.magic != AUDIO_HEADER_MAGIC || header.size == 0 ||
+        header.size > s_audio_partition->size - AUDIO_DATA_OFFSET) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    err = esp_partition_mmap(s_audio_partition, AUDIO_DATA_OFFSET, header.size, ESP_PARTITION_MMAP_DATA,
+                             (const void **)data, handle);
+    if (err == ESP_OK) {
+        *size = header.size;
+        header.name[sizeof(header.name) - 1] = '\0';
+        ESP_LOGI(TAG, "已映射片段 %s: %d 字节 @ %p", header.name, (int)header.size, *data);
+    }
+    return err;
+}
+
+/* 通过映射指针检查MP3数据开头（ID3标签或帧同步字） */
+static bool audio_clip_is_mp3(const uint8_t *data, size_t size) {
+    if (size >= 3 && memcmp(data, "ID3", 3) == 0) {
+        return true;
+    }
+    return size >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0;
+}
+
 /* I2C初始化 */
 static esp_err_t i2c_master_init(void) {
     i2c_config_t conf = {
@@ -354,17 +432,18 @@ static esp_err_t play_test_tone(void) {
         return ESP_FAIL;
     }
     
+    // 定点DDS，幅度8000与原来一致
+    dds_t tone;
+    dds_init(&tone, SAMPLE_RATE);
+    dds_add_tone(&tone, tone_freq, 8000 / 32768.0f);
+    
     ESP_LOGI(TAG, "开始播放 %dHz 测试音调，持续 %d 秒", tone_freq, duration_ms/1000);
     
     for (int i = 0; i < sample_count; i += DMA_BUF_LEN) {
         int samples_to_generate = (sample_count - i) > DMA_BUF_LEN ? DMA_BUF_LEN : (sample_count - i);
         
-        // 生成正弦波测试音调
-        for (int j = 0; j < samples_to_generate; j++) {
-            float sample = 8000 * sinf(2.0f * M_PI * tone_freq * (i + j) / SAMPLE_RATE);
-            audio_buffer[j * 2] = (int16_t)sample;      // Left channel
-            audio_buffer[j * 2 + 1] = (int16_t)sample;  // Right channel
-        }
+        // 生成正弦波测试音调（立体声）
+        dds_render(&tone, audio_buffer, samples_to_generate, 2);
         
         size_t bytes_written;
         esp_err_t ret = i2s_channel_write(tx_handle, audio_buffer, 
@@ -387,23 +466,27 @@ static esp_err_t play_test_tone(void) {
 static void tts_request_and_play_task(void *pvParameters) {
     char *text = (char *)pvParameters;
     char url[512];
-    char filename[64];
-    char local_path[128];
-    
-    // 生成唯一文件名
-    snprintf(filename, sizeof(filename), "tts_%lld.mp3", time(NULL));
-    snprintf(local_path, sizeof(local_path), "%s/%s", SPIFFS_MOUNT_POINT, filename);
     
     // 构建TTS请求URL
     snprintf(url, sizeof(url), "%s/esp32/tts", TTS_SERVER_URL);
     
     ESP_LOGI(TAG, "请求TTS合成: %s", text);
     
+    // 响应中的filename直接解析到缓冲区，不保存整个响应
+    char server_filename[64];
+    json_field_t fields[] = {
+        { .key = "filename", .type = JSON_FIELD_STRING, .dest = server_filename, .dest_size = sizeof(server_filename) },
+    };
+    json_stream_t tts_json;
+    json_stream_init(&tts_json, fields, sizeof(fields) / sizeof(fields[0]), NULL, NULL);
+    
     // 发送TTS请求
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_POST,
         .timeout_ms = 30000,
+        .event_handler = tts_response_event_handler,
+        .user_data = &tts_json,
     };
     
     esp_http_client_handle_t client = esp_http_client_init(&config);
@@ -427,47 +510,42 @@ static void tts_request_and_play_task(void *pvParameters) {
         ESP_LOGI(TAG, "TTS请求完成，状态码: %d, 内容长度: %d", status_code, content_length);
         
         if (status_code == 200) {
-            // 读取响应
-            char response[1024];
-            int data_read = esp_http_client_read_response(client, response, sizeof(response)-1);
-            response[data_read] = '\0';
-            
-            ESP_LOGI(TAG, "TTS响应: %s", response);
+            if (json_stream_finish(&tts_json) != JSON_STREAM_DONE) {
+                ESP_LOGW(TAG, "TTS响应JSON不完整 (%d 字节)", tts_json.offset);
+            }
             
-            // 简化的JSON解析 - 提取filename
-            char *filename_start = strstr(response, "\"filename\":\"");
-            if (filename_start) {
-                filename_start += 12;  // 跳过 "filename":"
-                char *filename_end = strchr(filename_start, '"');
-                if (filename_end) {
-                    size_t len = filename_end - filename_start;
-                    if (len < sizeof(filename)) {
-                        strncpy(filename, filename_start, len);
-                        filename[len] = '\0';
-                        
-                        // 构建下载URL
-                        char download_url[512];
-                        snprintf(download_url, sizeof(download_url), "%s/esp32/download/%s", TTS_SERVER_URL, filename);
-                        
-                        ESP_LOGI(TAG, "开始下载音频文件: %s", download_url);
-                        
-                        // 下载音频文件
-                        if (download_audio_file(download_url, local_path) == ESP_OK) {
-                            ESP_LOGI(TAG, "音频下载成功！由于暂未实现MP3解码，播放测试音调代替");
-                            
-                            // 播放测试音调代替MP3播放
-                            play_test_tone();
-                            
-                            // 删除下载的文件
-                            if (unlink(local_path) == 0) {
-                                ESP_LOGI(TAG, "临时文件已删除: %s", filename);
-                            } else {
-                                ESP_LOGE(TAG, "删除临时文件失败: %s", local_path);
-                            }
-                        } else {
-                            ESP_LOGE(TAG, "下载音频文件失败");
+            if (!fields[0].found || fields[0].truncated) {
+                ESP_LOGE(TAG, "TTS响应中没有可用的filename");
+            } else if (!s_audio_partition) {
+                ESP_LOGW(TAG, "没有音频分区，跳过下载，播放测试音调代替");
+                play_test_tone();
+            } else {
+                // 构建下载URL
+                char download_url[512];
+                snprintf(download_url, sizeof(download_url), "%s/esp32/download/%s", TTS_SERVER_URL, server_filename);
+                
+                ESP_LOGI(TAG, "开始下载音频文件: %s", download_url);
+                
+                // 下载音频文件
+                if (download_audio_file(download_url, server_filename) == ESP_OK) {
+                    // 直接映射flash中的数据，解码器可按指针读取，无需读入RAM
+                    const uint8_t *mp3_data = NULL;
+                    size_t mp3_size = 0;
+                    esp_partition_mmap_handle_t map_handle;
+                    if (audio_clip_map(&mp3_data, &mp3_size, &map_handle) == ESP_OK) {
+                        if (!audio_clip_is_mp3(mp3_data, mp3_size)) {
+                            ESP_LOGW(TAG, "下载的数据不像MP3 (开头 %02x %02x)", mp3_data[0], mp3_data[1]);
                         }
+                        ESP_LOGI(TAG, "音频下载成功！由于暂未实现MP3解码，播放测试音调代替");
+                        
+                        // 播放测试音调代替MP3播放
+                        play_test_tone();
+                        esp_partition_munmap(map_handle);
+                    } else {
+                        ESP_LOGE(TAG, "映射音频片段失败");
                     }
+                } else {
+                    ESP_LOGE(TAG, "下载音频文件失败");
                 }
             }
         }
@@ -519,8 +597,10 @@ void app_main(void) {
     }
     ESP_ERROR_CHECK(ret);
     
-    // 初始化SPIFFS
-    ESP_ERROR_CHECK(spiffs_init());
+    // 查找音频分区：找不到时只跳过下载和映射播放，测试音调仍然可用
+    if (audio_partition_init() != ESP_OK) {
+        ESP_LOGE(TAG, "音频分区不可用，跳过下载和映射播放");
+    }
     
     // 初始化WiFi
     ESP_ERROR_CHECK(wifi_init_sta());
@@ -544,6 +624,15 @@ void app_main(void) {
     ESP_LOGI(TAG, "播放系统启动提示音");
     play_test_tone();
     
+    // 分区中已有的片段（上次下载或预先烧录）无需联网即可映射播放
+    const uint8_t *preloaded = NULL;
+    size_t preloaded_size = 0;
+    esp_partition_mmap_handle_t preloaded_handle;
+    if (audio_clip_map(&preloaded, &preloaded_size, &preloaded_handle) == ESP_OK) {
+        ESP_LOGI(TAG, "发现预置片段 (%s)", audio_clip_is_mp3(preloaded, preloaded_size) ? "MP3" : "未知格式");
+        esp_partition_munmap(preloaded_handle);
+    }
+    
     // 测试TTS功能
     vTaskDelay(pdMS_TO_TICKS(2000));
     ESP_LOGI(TAG, "开始TTS测试");
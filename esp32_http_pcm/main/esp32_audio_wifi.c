@@ -29,6 +29,8 @@
 #include "driver/gpio.h"
 
 #include "es8311.h"
+#include "json_stream.h"
+#include "http_reader.h"
 
 /* WiFi Configuration */
 #define WIFI_SSID              "CE-Hub-Student"
@@ -69,6 +71,9 @@
 
 /* Ring buffer for audio streaming */
 #define AUDIO_RING_BUF_SIZE    (32 * 1024)  // 32KB ring buffer
+#define AUDIO_RING_ITEM_SIZE   (DMA_BUF_LEN * sizeof(int16_t))  // One mono DMA frame per item, read straight from the socket
+#define AUDIO_RING_ACQUIRE_MS  1000         // Wait per ring buffer slot reservation
+#define AUDIO_RING_MAX_STALLS  10           // Consecutive failed reservations before the stream is aborted
 
 static const char *TAG = "ES8311_POLLING";
 static EventGroupHandle_t s_wifi_event_group;
@@ -88,10 +93,6 @@ typedef struct {
 
 static audio_state_t audio_state = {0};
 
-/* Global buffer for poll response */
-static char poll_response_buffer[1024];
-static int poll_response_len = 0;
-
 /* WiFi event handler */
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                               int32_t event_id, void* event_data) {
@@ -171,24 +172,13 @@ static esp_err_t wifi_init_sta(void) {
     }
 }
 
-/* Global buffer for poll response */
-static char poll_response_buffer[1024];
-// static int poll_response_len = 0;
-
-/* HTTP event handler for polling */
+/* HTTP event handler for polling - feeds the incremental JSON parser, no response buffer */
 static esp_err_t poll_event_handler(esp_http_client_event_t *evt) {
+    json_stream_t *poll_json = (json_stream_t *)evt->user_data;
+    
     switch(evt->event_id) {
         case HTTP_EVENT_ON_DATA:
-            // Copy data to our buffer
-            if (poll_response_len + evt->data_len < sizeof(poll_response_buffer)) {
-                memcpy(poll_response_buffer + poll_response_len, evt->data, evt->data_len);
-                poll_response_len += evt->data_len;
-            }
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            // Reset buffer
-            poll_response_len = 0;
-            memset(poll_response_buffer, 0, sizeof(poll_response_buffer));
+            json_stream_feed(poll_json, (const char *)evt->data, evt->data_len);
             break;
         default:
             break;
@@ -198,12 +188,20 @@ static esp_err_t poll_event_handler(esp_http_client_event_t *evt) {
 
 /* Poll for new TTS tasks */
 static esp_err_t poll_for_tts_task(char *audio_id, size_t audio_id_size) {
+    // Extract audio_id straight into the caller's buffer
+    json_field_t fields[] = {
+        { .key = "audio_id", .type = JSON_FIELD_STRING, .dest = audio_id, .dest_size = audio_id_size },
+    };
+    json_stream_t poll_json;
+    json_stream_init(&poll_json, fields, sizeof(fields) / sizeof(fields[0]), NULL, NULL);
+    
     esp_http_client_config_t config = {
         .url = TTS_SERVER_URL "/esp32/poll",
         .method = HTTP_METHOD_GET,
         .timeout_ms = 30000,  // 30 seconds timeout for long polling
         .buffer_size = 1024,
-        .event_handler = poll_event_handler,  // Use event handler to capture response
+        .event_handler = poll_event_handler,  // Use event handler to parse response
+        .user_data = &poll_json,
     };
     
     esp_http_client_handle_t client = esp_http_client_init(&config);
@@ -217,41 +215,25 @@ static esp_err_t poll_for_tts_task(char *audio_id, size_t audio_id_size) {
     
     ESP_LOGI(TAG, "Polling for new tasks...");
     
-    // Reset response buffer
-    poll_response_len = 0;
-    memset(poll_response_buffer, 0, sizeof(poll_response_buffer));
-    
     // Perform the request
     esp_err_t err = esp_http_client_perform(client);
     
     if (err == ESP_OK) {
         int status_code = esp_http_client_get_status_code(client);
         
-        ESP_LOGI(TAG, "Poll response: status=%d, response_len=%d", status_code, poll_response_len);
+        ESP_LOGI(TAG, "Poll response: status=%d, response_len=%d", status_code, poll_json.offset);
         
-        if (status_code == 200 && poll_response_len > 0) {
-            ESP_LOGI(TAG, "Response: %s", poll_response_buffer);
+        if (status_code == 200 && poll_json.offset > 0) {
+            if (json_stream_finish(&poll_json) != JSON_STREAM_DONE) {
+                ESP_LOGW(TAG, "Malformed JSON at byte %d", poll_json.offset);
+            }
             
-            // Simple JSON parsing to extract audio_id
-            char *audio_id_start = strstr(poll_response_buffer, "\"audio_id\":\"");
-            if (audio_id_start) {
-                audio_id_start += 12;  // Skip to start of audio_id value
-                char *audio_id_end = strchr(audio_id_start, '"');
-                if (audio_id_end) {
-                    size_t id_len = audio_id_end - audio_id_start;
-                    if (id_len < audio_id_size - 1) {
-                        strncpy(audio_id, audio_id_start, id_len);
-                        audio_id[id_len] = '\0';
-                        ESP_LOGI(TAG, "New TTS task available: %s", audio_id);
-                        err = ESP_OK;
-                    } else {
-                        ESP_LOGW(TAG, "Audio ID too long: %d", id_len);
-                        err = ESP_FAIL;
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to find end of audio_id");
-                    err = ESP_FAIL;
-                }
+            if (fields[0].found && !fields[0].truncated) {
+                ESP_LOGI(TAG, "New TTS task available: %s", audio_id);
+                err = ESP_OK;
+            } else if (fields[0].truncated) {
+                ESP_LOGW(TAG, "Audio ID too long");
+                err = ESP_FAIL;
             } else {
                 ESP_LOGW(TAG, "No audio_id found in response");
                 err = ESP_FAIL;
@@ -272,60 +254,7 @@ static esp_err_t poll_for_tts_task(char *audio_id, size_t audio_id_size) {
     return err;
 }
 
-/* HTTP streaming event handler for PCM data */
-static esp_err_t http_stream_event_handler(esp_http_client_event_t *evt) {
-    switch(evt->event_id) {
-        case HTTP_EVENT_ERROR:
-            ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
-            break;
-            
-        case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
-            audio_state.total_received = 0;
-            audio_state.stream_done = false;
-            break;
-            
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            }
-            
-            // Write PCM data directly to ring buffer
-            if (evt->data_len > 0) {
-                size_t bytes_written = xRingbufferSend(audio_ring_buf, 
-                                                      evt->data, 
-                                                      evt->data_len, 
-                                                      pdMS_TO_TICKS(1000));
-                
-                if (bytes_written != evt->data_len) {
-                    ESP_LOGW(TAG, "Ring buffer full, wrote %d/%d bytes", 
-                            bytes_written, evt->data_len);
-                }
-                
-                audio_state.total_received += bytes_written;
-                
-                // Start playing after receiving initial data
-                if (!audio_state.is_playing && audio_state.total_received > 4096) {
-                    audio_state.is_playing = true;
-                    ESP_LOGI(TAG, "Started playback after receiving %d bytes", 
-                            audio_state.total_received);
-                }
-            }
-            break;
-            
-        case HTTP_EVENT_ON_FINISH:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
-            audio_state.stream_done = true;
-            ESP_LOGI(TAG, "Stream complete, received %d bytes", audio_state.total_received);
-            break;
-            
-        default:
-            break;
-    }
-    return ESP_OK;
-}
-
-/* Stream audio data for a specific audio_id */
+/* Stream audio data for a specific audio_id - pull mode, socket data is read straight into ring buffer items */
 static esp_err_t stream_audio_pcm(const char *audio_id) {
     char url[256];
     snprintf(url, sizeof(url), "%s/audio/%s.pcm", TTS_SERVER_URL, audio_id);
@@ -351,28 +280,75 @@ static esp_err_t stream_audio_pcm(const char *audio_id) {
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_GET,
-        .event_handler = http_stream_event_handler,
         .timeout_ms = 30000,
         .buffer_size = 2048,
     };
     
     esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        audio_state.stream_done = true;
+        return ESP_FAIL;
+    }
     
-    // Perform HTTP request (will stream data via event handler)
-    esp_err_t err = esp_http_client_perform(client);
-    
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "HTTP Status = %d, total_received = %d", 
-                status_code, audio_state.total_received);
-                
-        if (status_code != 200) {
-            err = ESP_FAIL;
+    http_reader_t reader;
+    http_reader_init(&reader, AUDIO_RING_ITEM_SIZE);
+    esp_err_t err = http_reader_open(&reader, client);
+    
+    if (err == ESP_OK && reader.status == 200) {
+        int stalls = 0;
+        while (1) {
+            // Reserve the next item in place; blocks while playback drains the ring (backpressure)
+            if (xRingbufferSendAcquire(audio_ring_buf, &item, AUDIO_RING_ITEM_SIZE,
+                                       pdMS_TO_TICKS(AUDIO_RING_ACQUIRE_MS)) != pdTRUE) {
+                // Playback stopped draining - give up instead of holding the connection forever
+                if (++stalls >= AUDIO_RING_MAX_STALLS) {
+                    ESP_LOGE(TAG, "Ring buffer full for %d ms, aborting stream",
+                             AUDIO_RING_ACQUIRE_MS * AUDIO_RING_MAX_STALLS);
+                    err = ESP_ERR_TIMEOUT;
+                    break;
+                }
+                continue;
+            }
+            stalls = 0;
+            
+            int len = http_reader_read(&reader, item, AUDIO_RING_ITEM_SIZE);
+            if (len <= 0) {
+                // Items have a fixed size - the reserved item is sent as silence
+                memset(item, 0, AUDIO_RING_ITEM_SIZE);
+                xRingbufferSendComplete(audio_ring_buf, item);
+                if (len < 0) {
+                    ESP_LOGE(TAG, "Stream read failed (%d)", len);
+                    err = ESP_FAIL;
+                }
+                break;
+            }
+            if ((size_t)len < AUDIO_RING_ITEM_SIZE) {
+                // Last partial frame, pad with silence
+                memset((uint8_t *)item + len, 0, AUDIO_RING_ITEM_SIZE - len);
+            }
+            xRingbufferSendComplete(audio_ring_buf, item);
+            audio_state.total_received += len;
+            
+            // Start playing after receiving initial data
+            if (!audio_state.is_playing && audio_state.total_received > 4096) {
+                audio_state.is_playing = true;
+                ESP_LOGI(TAG, "Started playback after receiving %d bytes", 
+                        audio_state.total_received);
+            }
         }
+        ESP_LOGI(TAG, "Stream complete, received %d bytes", audio_state.total_received);
+    } else if (err == ESP_OK) {
+        ESP_LOGE(TAG, "HTTP Status = %d", reader.status);
+        err = ESP_FAIL;
     } else {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
     }
     
+    http_reader_log_stats(&reader, audio_id);
+    audio_state.stream_done = true;
+    
+    http_reader_close(&reader);
     esp_http_client_cleanup(client);
     return err;
 }
@@ -610,7 +586,7 @@ void app_main(void) {
     ESP_ERROR_CHECK(ret);
 
     /* Create ring buffer for audio streaming */
-    audio_ring_buf = xRingbufferCreate(AUDIO_RING_BUF_SIZE, RINGBUF_TYPE_BYTEBUF);
+    audio_ring_buf = xRingbufferCreate(AUDIO_RING_BUF_SIZE, RINGBUF_TYPE_NOSPLIT);
     if (audio_ring_buf == NULL) {
         ESP_LOGE(TAG, "Failed to create ring buffer");
         return;
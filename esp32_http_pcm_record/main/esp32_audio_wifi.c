@@ -13,6 +13,7 @@
 #include <time.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <stdatomic.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -26,6 +27,7 @@
 #include "esp_event.h"
 #include "esp_http_client.h"
 #include "esp_heap_caps.h"  // 用于PSRAM分配
+#include "esp_timer.h"
 
 #include "nvs_flash.h"
 #include "driver/i2c.h"
@@ -33,6 +35,10 @@
 #include "driver/gpio.h"
 
 #include "es8311.h"
+#include "mic_capture.h"
+#include "json_stream.h"
+#include "http_reader.h"
+#include "latency_trace.h"
 
 /* WiFi Configuration - 保持不变 */
 // #define WIFI_SSID              "CE-Hub-Student"
@@ -81,15 +87,20 @@
 /* Audio buffer configuration - 使用PSRAM后可以增大缓冲区 */
 #define MAX_AUDIO_SIZE         (4 * 1024 * 1024)  // 增大到4MB
 #define DOWNLOAD_CHUNK_SIZE    (64 * 1024)        // 增大到64KB
+#define DOWNLOAD_READ_UNIT     (DMA_BUF_LEN * sizeof(int16_t))  // 每次读取为单声道DMA帧的整数倍
+#define DOWNLOAD_READ_MAX      (8 * DOWNLOAD_READ_UNIT)
 #define POLL_INTERVAL_MS       2000       
 
 /* Microphone Recording Configuration - 新增麦克风配置 */
 #define MIC_SAMPLE_RATE        16000        // STT服务通常使用16kHz
 #define MIC_RECORDING_SIZE     (1024 * 1024) // 1MB recording buffer in PSRAM
-#define MIC_CHUNK_SIZE         (1024 * 4)   // 4KB chunks
+#define MIC_FRAME_BYTES        (DMA_BUF_LEN * 2 * sizeof(int16_t))  // 一个RX DMA缓冲区（立体声）
+#define MIC_STATS_LOG_FRAMES   470          // 约每10秒打印一次采集统计
 #define VOICE_THRESHOLD        1500          // 音量阈值
 #define SILENCE_DURATION_MS    1500         // 静音持续时间
 #define MIN_RECORDING_MS       2000          // 最小录音时长
+#define STT_TEXT_MAX           1024          // 转录文本缓冲区，超长截断
+#define REPLY_JOIN_WINDOW_US   (30 * 1000000LL) // STT响应后这段时间内取到的TTS任务算作同一语音回合
 
 static const char *TAG = "ESP32_POLLING_AUDIO";
 static EventGroupHandle_t s_wifi_event_group;
@@ -108,17 +119,11 @@ typedef struct {
     size_t audio_capacity;
     size_t audio_position;
     char current_audio_id[64];
+    uint16_t trace_turn;        // 当前片段的延迟追踪回合（latency_trace.h）
 } audio_state_t;
 
 static audio_state_t audio_state = {0};
 
-/* HTTP download state */
-typedef struct {
-    uint8_t *buffer;
-    size_t size;
-    size_t capacity;
-} download_state_t;
-
 /* Microphone recording state - 新增麦克风录音状态 */
 typedef struct {
     bool is_recording;          // 是否正在录音
@@ -132,12 +137,18 @@ typedef struct {
 
 static mic_state_t mic_state = {0};
 
+/* 延迟追踪：录音回合上传成功后交给轮询任务，回复的TTS接在同一回合里 */
+static _Atomic uint16_t s_reply_turn = LATENCY_TRACE_TURN_NONE;
+static int64_t s_reply_time_us = 0;
+static int64_t s_poll_sent_us = 0;
+static int64_t s_poll_parsed_us = 0;
+
 /* 函数声明 - 解决编译顺序问题 */
 static esp_err_t wifi_init_sta(void);
-static esp_err_t download_event_handler(esp_http_client_event_t *evt);
+static esp_err_t json_event_handler(esp_http_client_event_t *evt);
 static esp_err_t poll_for_tts_task(char *audio_id, size_t audio_id_size);
 static esp_err_t download_pcm_audio(const char *audio_id);
-static esp_err_t upload_recording_to_stt(uint8_t *recording_data, size_t recording_size);
+static esp_err_t upload_recording_to_stt(uint8_t *recording_data, size_t recording_size, uint16_t turn);
 static esp_err_t i2c_master_init(void);
 static esp_err_t es8311_codec_init(es8311_handle_t *codec_handle);
 static esp_err_t i2s_init(void);
@@ -245,67 +256,30 @@ static esp_err_t wifi_init_sta(void) {
     }
 }
 
-/* HTTP下载事件处理器 - 修改为使用PSRAM */
-static esp_err_t download_event_handler(esp_http_client_event_t *evt) {
-    download_state_t *download_state = (download_state_t *)evt->user_data;
-    
-    switch(evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                // 动态扩展缓冲区如果需要
-                if (download_state->size + evt->data_len > download_state->capacity) {
-                    size_t new_capacity = download_state->capacity + DOWNLOAD_CHUNK_SIZE;
-                    if (new_capacity > MAX_AUDIO_SIZE) {
-                        ESP_LOGW(TAG, "Audio file too large, truncating");
-                        evt->data_len = MAX_AUDIO_SIZE - download_state->size;
-                        if (evt->data_len <= 0) {
-                            return ESP_OK;
-                        }
-                    } else {
-                        uint8_t *new_buffer = psram_realloc(download_state->buffer, new_capacity);
-                        if (!new_buffer) {
-                            ESP_LOGE(TAG, "Failed to reallocate download buffer");
-                            return ESP_FAIL;
-                        }
-                        download_state->buffer = new_buffer;
-                        download_state->capacity = new_capacity;
-                        ESP_LOGD(TAG, "Expanded buffer to %d bytes in PSRAM", new_capacity);
-                    }
-                }
-                
-                if (evt->data_len > 0) {
-                    memcpy(download_state->buffer + download_state->size, evt->data, evt->data_len);
-                    download_state->size += evt->data_len;
-                }
-            }
-            break;
-        
-        case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGD(TAG, "HTTP connected for download");
-            download_state->size = 0;
-            break;
-            
-        default:
-            break;
+/* JSON响应事件处理器 - 数据到达时直接送入增量解析器，不缓冲响应 */
+static esp_err_t json_event_handler(esp_http_client_event_t *evt) {
+    json_stream_t *js = (json_stream_t *)evt->user_data;
+    
+    if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        json_stream_feed(js, (const char *)evt->data, evt->data_len);
     }
     return ESP_OK;
 }
 
 /* 轮询TTS任务 - 保持HTTP API调用不变 */
 static esp_err_t poll_for_tts_task(char *audio_id, size_t audio_id_size) {
-    char poll_buffer[1024];
-    download_state_t poll_state = {
-        .buffer = (uint8_t *)poll_buffer,
-        .capacity = sizeof(poll_buffer) - 1,
-        .size = 0
+    json_field_t fields[] = {
+        { .key = "audio_id", .type = JSON_FIELD_STRING, .dest = audio_id, .dest_size = audio_id_size },
     };
+    json_stream_t poll_json;
+    json_stream_init(&poll_json, fields, sizeof(fields) / sizeof(fields[0]), NULL, NULL);
     
     esp_http_client_config_t config = {
         .url = TTS_SERVER_URL "/esp32/poll",
         .method = HTTP_METHOD_GET,
         .timeout_ms = 30000,  // 30秒长轮询
-        .event_handler = download_event_handler,
-        .user_data = &poll_state,
+        .event_handler = json_event_handler,
+        .user_data = &poll_json,
     };
     
     esp_http_client_handle_t client = esp_http_client_init(&config);
@@ -318,35 +292,25 @@ static esp_err_t poll_for_tts_task(char *audio_id, size_t audio_id_size) {
     
     ESP_LOGD(TAG, "Polling for new tasks...");
     
+    s_poll_sent_us = esp_timer_get_time();
     esp_err_t err = esp_http_client_perform(client);
     
     if (err == ESP_OK) {
         int status_code = esp_http_client_get_status_code(client);
         
-        if (status_code == 200 && poll_state.size > 0) {
-            poll_buffer[poll_state.size] = '\0';
-            ESP_LOGI(TAG, "Poll response: %s", poll_buffer);
+        if (status_code == 200 && poll_json.offset > 0) {
+            json_stream_status_t parse_status = json_stream_finish(&poll_json);
+            s_poll_parsed_us = esp_timer_get_time();
+            ESP_LOGI(TAG, "Poll response: %d bytes (%s)", poll_json.offset,
+                     parse_status == JSON_STREAM_DONE ? "complete" : "malformed");
             
-            // 简单JSON解析提取audio_id
-            char *audio_id_start = strstr(poll_buffer, "\"audio_id\":\"");
-            if (audio_id_start) {
-                audio_id_start += 12;
-                char *audio_id_end = strchr(audio_id_start, '"');
-                if (audio_id_end) {
-                    size_t id_len = audio_id_end - audio_id_start;
-                    if (id_len < audio_id_size - 1) {
-                        strncpy(audio_id, audio_id_start, id_len);
-                        audio_id[id_len] = '\0';
-                        ESP_LOGI(TAG, "New TTS task: %s", audio_id);
-                        err = ESP_OK;
-                    } else {
-                        ESP_LOGW(TAG, "Audio ID too long");
-                        err = ESP_FAIL;
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to parse audio_id");
-                    err = ESP_FAIL;
-                }
+            // 字段在出错位置之前已解析完整的仍然可用
+            if (fields[0].found && !fields[0].truncated) {
+                ESP_LOGI(TAG, "New TTS task: %s", audio_id);
+                err = ESP_OK;
+            } else if (fields[0].truncated) {
+                ESP_LOGW(TAG, "Audio ID too long");
+                err = ESP_FAIL;
             } else {
                 ESP_LOGW(TAG, "No audio_id found in response");
                 err = ESP_FAIL;
@@ -383,72 +347,130 @@ static esp_err_t download_pcm_audio(const char *audio_id) {
         audio_state.has_audio = false;  // 确保状态清除
     }
     
-    // 在PSRAM中分配初始缓冲区
-    uint8_t *initial_buffer = psram_malloc(DOWNLOAD_CHUNK_SIZE);
-    if (!initial_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate initial download buffer");
-        return ESP_FAIL;
-    }
-    
-    download_state_t download_state = {
-        .buffer = initial_buffer,
-        .capacity = DOWNLOAD_CHUNK_SIZE,
-        .size = 0
-    };
-    
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_GET,
         .timeout_ms = 30000,
-        .event_handler = download_event_handler,
-        .user_data = &download_state,
     };
     
     esp_http_client_handle_t client = esp_http_client_init(&config);
     if (!client) {
         ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        free(initial_buffer);
         return ESP_FAIL;
     }
     
     ESP_LOGI(TAG, "Starting download...");
-    esp_err_t err = esp_http_client_perform(client);
     
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "Download complete. Status: %d, Size: %d bytes", status_code, download_state.size);
+    // 拉模式：响应体直接读入PSRAM缓冲区，不经过事件回调再复制
+    http_reader_t reader;
+    http_reader_init(&reader, DOWNLOAD_READ_UNIT);
+    latency_trace_mark(audio_state.trace_turn, LATENCY_DL_CONNECT, 0);
+    esp_err_t err = http_reader_open(&reader, client);
+    latency_trace_mark(audio_state.trace_turn, LATENCY_DL_FIRST_BYTE, reader.status);
+    uint8_t *buffer = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    
+    if (err == ESP_OK && reader.status == 200) {
+        // 已知长度时一次分配到位，避免扩容时realloc搬移数据
+        if (reader.content_length > 0) {
+            capacity = reader.content_length < MAX_AUDIO_SIZE ? reader.content_length : MAX_AUDIO_SIZE;
+        } else {
+            capacity = DOWNLOAD_CHUNK_SIZE;
+        }
+        buffer = psram_malloc(capacity);
+        if (!buffer) {
+            ESP_LOGE(TAG, "Failed to allocate download buffer");
+            err = ESP_ERR_NO_MEM;
+        }
         
-        if (status_code == 200 && download_state.size > 0) {
-            // 成功下载，转移缓冲区所有权给audio_state
-            audio_state.audio_buffer = download_state.buffer;
-            audio_state.audio_size = download_state.size;
-            audio_state.audio_capacity = download_state.capacity;
-            audio_state.audio_position = 0;
-            audio_state.has_audio = true;
-            audio_state.download_complete = true;
-            strncpy(audio_state.current_audio_id, audio_id, sizeof(audio_state.current_audio_id) - 1);
+        while (buffer) {
+            if (size == capacity) {
+                if (reader.content_length > 0 && size >= (size_t)reader.content_length) {
+                    break;
+                }
+                if (capacity >= MAX_AUDIO_SIZE) {
+                    ESP_LOGW(TAG, "Audio file too large, truncating");
+                    break;
+                }
+                size_t new_capacity = capacity + DOWNLOAD_CHUNK_SIZE;
+                if (new_capacity > MAX_AUDIO_SIZE) {
+                    new_capacity = MAX_AUDIO_SIZE;
+                }
+                uint8_t *new_buffer = psram_realloc(buffer, new_capacity);
+                if (!new_buffer) {
+                    ESP_LOGE(TAG, "Failed to reallocate download buffer");
+                    err = ESP_ERR_NO_MEM;
+                    break;
+                }
+                if (new_buffer != buffer) {
+                    // realloc搬移了已有数据
+                    http_reader_note_copy(&reader, size);
+                }
+                buffer = new_buffer;
+                capacity = new_capacity;
+                ESP_LOGD(TAG, "Expanded buffer to %d bytes in PSRAM", capacity);
+            }
             
-            ESP_LOGI(TAG, "✅ Downloaded %d bytes for audio: %s", download_state.size, audio_id);
-            ESP_LOGI(TAG, "Free heap after download: %d bytes", esp_get_free_heap_size());
-            ESP_LOGI(TAG, "Free PSRAM after download: %d bytes", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
-            ESP_LOGI(TAG, "Audio state - has_audio: %d, download_complete: %d", 
-                    audio_state.has_audio, audio_state.download_complete);
+            size_t want = capacity - size;
+            if (want > DOWNLOAD_READ_MAX) {
+                want = DOWNLOAD_READ_MAX;
+            }
+            int len = http_reader_read(&reader, buffer + size, want);
+            if (len < 0) {
+                ESP_LOGE(TAG, "Download read failed (%d)", len);
+                err = ESP_FAIL;
+                break;
+            }
+            if (len == 0) {
+                break;
+            }
+            size += len;
+        }
+    } else if (err == ESP_OK) {
+        err = ESP_FAIL;
+    }
+    
+    if (reader.status > 0) {
+        ESP_LOGI(TAG, "Download complete. Status: %d, Size: %d bytes", reader.status, size);
+        http_reader_log_stats(&reader, audio_id);
+    }
+    
+    if (err == ESP_OK && size > 0) {
+        // 成功下载，转移缓冲区所有权给audio_state
+        audio_state.audio_buffer = buffer;
+        audio_state.audio_size = size;
+        audio_state.audio_capacity = capacity;
+        audio_state.audio_position = 0;
+        audio_state.has_audio = true;
+        audio_state.download_complete = true;
+        strncpy(audio_state.current_audio_id, audio_id, sizeof(audio_state.current_audio_id) - 1);
+        latency_trace_mark(audio_state.trace_turn, LATENCY_WATERMARK, size);
+        
+        ESP_LOGI(TAG, "✅ Downloaded %d bytes for audio: %s", size, audio_id);
+        ESP_LOGI(TAG, "Free heap after download: %d bytes", esp_get_free_heap_size());
+        ESP_LOGI(TAG, "Free PSRAM after download: %d bytes", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+        ESP_LOGI(TAG, "Audio state - has_audio: %d, download_complete: %d", 
+                audio_state.has_audio, audio_state.download_complete);
+    } else {
+        if (reader.status > 0) {
+            ESP_LOGW(TAG, "❌ Download failed: status=%d, size=%d", reader.status, size);
         } else {
-            ESP_LOGW(TAG, "❌ Download failed: status=%d, size=%d", status_code, download_state.size);
-            free(download_state.buffer);
+            ESP_LOGE(TAG, "❌ HTTP download failed: %s", esp_err_to_name(err));
+        }
+        free(buffer);
+        if (err == ESP_OK) {
             err = ESP_FAIL;
         }
-    } else {
-        ESP_LOGE(TAG, "❌ HTTP download failed: %s", esp_err_to_name(err));
-        free(download_state.buffer);
     }
     
+    http_reader_close(&reader);
     esp_http_client_cleanup(client);
     return err;
 }
 
 /* 上传录音到STT服务 - 修改版本 */
-static esp_err_t upload_recording_to_stt(uint8_t *recording_data, size_t recording_size) {
+static esp_err_t upload_recording_to_stt(uint8_t *recording_data, size_t recording_size, uint16_t turn) {
     char url[256];
     snprintf(url, sizeof(url), "%s/upload_pcm", STT_SERVER_URL);
     
@@ -508,6 +530,7 @@ static esp_err_t upload_recording_to_stt(uint8_t *recording_data, size_t recordi
     esp_http_client_set_header(client, "X-Device-ID", DEVICE_ID);  // 额外添加header作为备份
     
     // 打开连接
+    latency_trace_mark(turn, LATENCY_UPLOAD_START, recording_size);
     esp_err_t err = esp_http_client_open(client, total_size);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open HTTP client: %s", esp_err_to_name(err));
@@ -571,51 +594,42 @@ static esp_err_t upload_recording_to_stt(uint8_t *recording_data, size_t recordi
         // 获取响应
         int content_length = esp_http_client_fetch_headers(client);
         int status_code = esp_http_client_get_status_code(client);
+        latency_trace_mark(turn, LATENCY_UPLOAD_RESPONSE, status_code);
         
         ESP_LOGI(TAG, "STT response - Status: %d, Content-Length: %d", status_code, content_length);
         
         if (status_code == 200) {
             ESP_LOGI(TAG, "✅ STT upload successful");
             
-            // 读取响应
-            if (content_length > 0 && content_length < 4096) {
-                char *response = malloc(content_length + 1);
-                if (response) {
-                    int read_len = esp_http_client_read(client, response, content_length);
-                    if (read_len > 0) {
-                        response[read_len] = '\0';
-                        ESP_LOGI(TAG, "STT response: %s", response);
-                        
-                        // 解析JSON获取转录文本
-                        char *text_start = strstr(response, "\"text\":\"");
-                        if (text_start) {
-                            text_start += 8;
-                            char *text_end = strchr(text_start, '"');
-                            if (text_end) {
-                                *text_end = '\0';
-                                ESP_LOGI(TAG, "📝 Transcribed: \"%s\"", text_start);
-                            }
-                        }
-                        
-                        // 解析返回的device_id（用于验证）
-                        char *device_start = strstr(response, "\"device_id\":\"");
-                        if (device_start) {
-                            device_start += 13;
-                            char *device_end = strchr(device_start, '"');
-                            if (device_end) {
-                                char returned_device[64];
-                                size_t device_len = device_end - device_start;
-                                if (device_len < sizeof(returned_device) - 1) {
-                                    strncpy(returned_device, device_start, device_len);
-                                    returned_device[device_len] = '\0';
-                                    ESP_LOGI(TAG, "✅ Confirmed device_id: %s", returned_device);
-                                }
-                            }
-                        }
-                    }
-                    free(response);
+            // 边读边解析，响应长度不受缓冲区限制，字段顺序无关
+            static char transcript[STT_TEXT_MAX];
+            char returned_device[64];
+            json_field_t fields[] = {
+                { .key = "text", .type = JSON_FIELD_STRING, .dest = transcript, .dest_size = sizeof(transcript) },
+                { .key = "device_id", .type = JSON_FIELD_STRING, .dest = returned_device, .dest_size = sizeof(returned_device) },
+            };
+            json_stream_t stt_json;
+            json_stream_init(&stt_json, fields, sizeof(fields) / sizeof(fields[0]), NULL, NULL);
+            
+            char chunk[256];
+            int read_len;
+            while ((read_len = esp_http_client_read(client, chunk, sizeof(chunk))) > 0) {
+                if (json_stream_feed(&stt_json, chunk, read_len) != JSON_STREAM_MORE) {
+                    break;
                 }
             }
+            
+            if (json_stream_finish(&stt_json) != JSON_STREAM_DONE) {
+                ESP_LOGW(TAG, "Malformed STT response at byte %d", stt_json.offset);
+            }
+            if (fields[0].found) {
+                ESP_LOGI(TAG, "📝 Transcribed: \"%s\"%s", transcript, fields[0].truncated ? " (truncated)" : "");
+            }
+            
+            // 解析返回的device_id（用于验证）
+            if (fields[1].found && !fields[1].truncated) {
+                ESP_LOGI(TAG, "✅ Confirmed device_id: %s", returned_device);
+            }
         } else {
             ESP_LOGW(TAG, "❌ STT upload failed with status: %d", status_code);
             
@@ -736,6 +750,10 @@ static esp_err_t i2s_init(void) {
 
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle, &std_cfg));
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle, &std_cfg));
+
+    // RX事件回调必须在通道使能之前注册
+    ESP_ERROR_CHECK(mic_capture_init(rx_handle, MIC_FRAME_BYTES));
+
     ESP_ERROR_CHECK(i2s_channel_enable(tx_handle));
     ESP_ERROR_CHECK(i2s_channel_enable(rx_handle));
 
@@ -774,6 +792,16 @@ static int calculate_volume(int16_t *samples, size_t num_samples) {
     return (int)(sum / num_samples);
 }
 
+/* 打印一个回合各阶段的耗时 */
+static void log_turn_latency(uint16_t turn) {
+    static char line[320];
+    latency_turn_t t;
+    if (latency_trace_summarize(turn, &t)) {
+        latency_trace_format(&t, line, sizeof(line));
+        ESP_LOGI(TAG, "⏱️ Latency %s", line);
+    }
+}
+
 /* 音频播放任务 - 播放缓冲区使用内部RAM以保证性能 */
 static void audio_playback_task(void *pvParameters) {
     size_t bytes_written;
@@ -809,8 +837,10 @@ static void audio_playback_task(void *pvParameters) {
                 audio_state.is_playing = false;
                 audio_state.has_audio = false;
                 audio_state.download_complete = false;
+                latency_trace_mark(audio_state.trace_turn, LATENCY_LAST_SAMPLE, audio_state.audio_size);
                 ESP_LOGI(TAG, "✅ Playback complete: %s (played %d chunks)", 
                         audio_state.current_audio_id, play_counter);
+                log_turn_latency(audio_state.trace_turn);
                 
                 // 释放音频缓冲区
                 if (audio_state.audio_buffer) {
@@ -851,6 +881,9 @@ static void audio_playback_task(void *pvParameters) {
             esp_err_t ret = i2s_channel_write(tx_handle, stereo_buffer, stereo_bytes, &bytes_written, portMAX_DELAY);
             
             if (ret == ESP_OK) {
+                if (play_counter == 0) {
+                    latency_trace_mark(audio_state.trace_turn, LATENCY_FIRST_I2S, bytes_written);
+                }
                 audio_state.audio_position += input_chunk_size;
                 play_counter++;
                 
@@ -875,15 +908,13 @@ static void audio_playback_task(void *pvParameters) {
     vTaskDelete(NULL);
 }
 
-/* 麦克风录音任务 - 新增任务 */
+/* 麦克风录音任务 - 消费mic_capture帧队列，进行VAD和上传 */
 static void microphone_recording_task(void *pvParameters) {
-    size_t bytes_read;
-    const size_t chunk_size = MIC_CHUNK_SIZE;
-    int16_t *stereo_buffer = malloc(chunk_size);  // 立体声输入缓冲区
-    int16_t *mono_buffer = malloc(chunk_size / 2); // 单声道缓冲区
-    int16_t *downsampled_buffer = malloc(chunk_size / 6); // 下采样后的缓冲区
+    const size_t frame_bytes = MIC_FRAME_BYTES;
+    int16_t *mono_buffer = malloc(frame_bytes / 2); // 单声道缓冲区
+    int16_t *downsampled_buffer = malloc(frame_bytes / 6 + sizeof(int16_t)); // 下采样后的缓冲区
     
-    if (!stereo_buffer || !mono_buffer || !downsampled_buffer) {
+    if (!mono_buffer || !downsampled_buffer) {
         ESP_LOGE(TAG, "Failed to allocate microphone buffers");
         vTaskDelete(NULL);
         return;
@@ -893,7 +924,6 @@ static void microphone_recording_task(void *pvParameters) {
     mic_state.recording_buffer = psram_malloc(MIC_RECORDING_SIZE);
     if (!mic_state.recording_buffer) {
         ESP_LOGE(TAG, "Failed to allocate recording buffer in PSRAM");
-        free(stereo_buffer);
         free(mono_buffer);
         free(downsampled_buffer);
         vTaskDelete(NULL);
@@ -905,111 +935,137 @@ static void microphone_recording_task(void *pvParameters) {
     ESP_LOGI(TAG, "Voice threshold: %d, Silence duration: %dms", VOICE_THRESHOLD, SILENCE_DURATION_MS);
     
     int sample_counter = 0;
+    int stats_counter = 0;
+    uint16_t turn = LATENCY_TRACE_TURN_NONE;
+    mic_capture_stats_t last_stats = {0};
     
     while (1) {
-        // 如果正在播放音频，暂停录音
+        // 等待采集任务送来一帧（由I2S RX事件驱动，无需轮询延时）
+        const int16_t *stereo_frame;
+        size_t bytes_read;
+        esp_err_t ret = mic_capture_pop(&stereo_frame, &bytes_read, pdMS_TO_TICKS(1000));
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "No microphone frames for 1s: %s", esp_err_to_name(ret));
+            continue;
+        }
+        
+        // 定期打印采集统计，证明在Wi-Fi负载下没有丢失样本
+        if (++stats_counter >= MIC_STATS_LOG_FRAMES) {
+            mic_capture_stats_t stats;
+            mic_capture_get_stats(&stats);
+            ESP_LOGI(TAG, "Capture stats: frames=%lu, rx_overflows=%lu (+%lu), dropped=%lu (+%lu), read_errors=%lu, queue_hwm=%lu/%d",
+                    stats.frames_captured,
+                    stats.rx_overflows, stats.rx_overflows - last_stats.rx_overflows,
+                    stats.frames_dropped, stats.frames_dropped - last_stats.frames_dropped,
+                    stats.read_errors, stats.queue_high_water, MIC_FRAME_QUEUE_LEN);
+            last_stats = stats;
+            stats_counter = 0;
+        }
+        
+        // 如果正在播放音频，丢弃该帧（采集仍在排空DMA，不会溢出）
         if (audio_state.is_playing) {
-            vTaskDelay(pdMS_TO_TICKS(100));
+            mic_capture_release();
             continue;
         }
         
-        // 从I2S读取音频数据
-        esp_err_t ret = i2s_channel_read(rx_handle, stereo_buffer, chunk_size, &bytes_read, pdMS_TO_TICKS(100));
+        size_t stereo_samples = bytes_read / sizeof(int16_t);
+        size_t mono_samples = stereo_samples / 2;
         
-        if (ret == ESP_OK && bytes_read > 0) {
-            size_t stereo_samples = bytes_read / sizeof(int16_t);
-            size_t mono_samples = stereo_samples / 2;
-            
-            // 转换立体声到单声道（取左声道）
-            for (size_t i = 0; i < mono_samples; i++) {
-                mono_buffer[i] = stereo_buffer[i * 2];
+        // 转换立体声到单声道（取左声道）
+        for (size_t i = 0; i < mono_samples; i++) {
+            mono_buffer[i] = stereo_frame[i * 2];
+        }
+        
+        // 帧数据已复制，尽早归还帧槽
+        mic_capture_release();
+        
+        // 下采样：48kHz -> 16kHz
+        size_t downsampled_samples;
+        downsample_audio(mono_buffer, mono_samples, downsampled_buffer, &downsampled_samples);
+        
+        // 计算音量
+        int volume = calculate_volume(downsampled_buffer, downsampled_samples);
+        
+        // 语音活动检测（VAD）
+        if (volume > VOICE_THRESHOLD) {
+            if (!mic_state.is_recording) {
+                // 开始录音
+                mic_state.is_recording = true;
+                mic_state.voice_detected = true;
+                mic_state.recording_size = 0;
+                mic_state.silence_counter = 0;
+                mic_state.recording_duration = 0;
+                turn = latency_trace_begin_turn();
+                latency_trace_mark(turn, LATENCY_VAD_START, volume);
+                ESP_LOGI(TAG, "Voice detected, start recording (volume: %d)", volume);
             }
             
-            // 下采样：48kHz -> 16kHz
-            size_t downsampled_samples;
-            downsample_audio(mono_buffer, mono_samples, downsampled_buffer, &downsampled_samples);
+            // 重置静音计数器
+            mic_state.silence_counter = 0;
             
-            // 计算音量
-            int volume = calculate_volume(downsampled_buffer, downsampled_samples);
+            // 将数据写入录音缓冲区
+            if (mic_state.recording_size + downsampled_samples * sizeof(int16_t) < mic_state.recording_capacity) {
+                memcpy(mic_state.recording_buffer + mic_state.recording_size, 
+                       downsampled_buffer, 
+                       downsampled_samples * sizeof(int16_t));
+                mic_state.recording_size += downsampled_samples * sizeof(int16_t);
+            }
+        } else if (mic_state.is_recording) {
+            // 静音期间
+            mic_state.silence_counter += (downsampled_samples * 1000) / MIC_SAMPLE_RATE;
             
-            // 语音活动检测（VAD）
-            if (volume > VOICE_THRESHOLD) {
-                if (!mic_state.is_recording) {
-                    // 开始录音
-                    mic_state.is_recording = true;
-                    mic_state.voice_detected = true;
-                    mic_state.recording_size = 0;
-                    mic_state.silence_counter = 0;
-                    mic_state.recording_duration = 0;
-                    ESP_LOGI(TAG, "Voice detected, start recording (volume: %d)", volume);
-                }
-                
-                // 重置静音计数器
-                mic_state.silence_counter = 0;
+            // 继续记录静音数据
+            if (mic_state.recording_size + downsampled_samples * sizeof(int16_t) < mic_state.recording_capacity) {
+                memcpy(mic_state.recording_buffer + mic_state.recording_size, 
+                       downsampled_buffer, 
+                       downsampled_samples * sizeof(int16_t));
+                mic_state.recording_size += downsampled_samples * sizeof(int16_t);
+            }
+            
+            // 检查是否超过静音阈值
+            if (mic_state.silence_counter >= SILENCE_DURATION_MS) {
+                // 停止录音
+                latency_trace_mark(turn, LATENCY_VAD_STOP, mic_state.recording_size);
+                mic_state.is_recording = false;
+                mic_state.voice_detected = false;
                 
-                // 将数据写入录音缓冲区
-                if (mic_state.recording_size + downsampled_samples * sizeof(int16_t) < mic_state.recording_capacity) {
-                    memcpy(mic_state.recording_buffer + mic_state.recording_size, 
-                           downsampled_buffer, 
-                           downsampled_samples * sizeof(int16_t));
-                    mic_state.recording_size += downsampled_samples * sizeof(int16_t);
-                }
-            } else if (mic_state.is_recording) {
-                // 静音期间
-                mic_state.silence_counter += (downsampled_samples * 1000) / MIC_SAMPLE_RATE;
+                // 计算录音时长
+                mic_state.recording_duration = (mic_state.recording_size / sizeof(int16_t)) * 1000 / MIC_SAMPLE_RATE;
                 
-                // 继续记录静音数据
-                if (mic_state.recording_size + downsampled_samples * sizeof(int16_t) < mic_state.recording_capacity) {
-                    memcpy(mic_state.recording_buffer + mic_state.recording_size, 
-                           downsampled_buffer, 
-                           downsampled_samples * sizeof(int16_t));
-                    mic_state.recording_size += downsampled_samples * sizeof(int16_t);
-                }
+                ESP_LOGI(TAG, "Recording stopped (silence), duration: %dms, size: %d bytes", 
+                        mic_state.recording_duration, mic_state.recording_size);
                 
-                // 检查是否超过静音阈值
-                if (mic_state.silence_counter >= SILENCE_DURATION_MS) {
-                    // 停止录音
-                    mic_state.is_recording = false;
-                    mic_state.voice_detected = false;
-                    
-                    // 计算录音时长
-                    mic_state.recording_duration = (mic_state.recording_size / sizeof(int16_t)) * 1000 / MIC_SAMPLE_RATE;
-                    
-                    ESP_LOGI(TAG, "Recording stopped (silence), duration: %dms, size: %d bytes", 
-                            mic_state.recording_duration, mic_state.recording_size);
-                    
-                    // 如果录音时长足够，上传到STT服务
-                    if (mic_state.recording_duration >= MIN_RECORDING_MS) {
-                        upload_recording_to_stt(mic_state.recording_buffer, mic_state.recording_size);
-                    } else {
-                        ESP_LOGW(TAG, "Recording too short, discarding");
+                // 如果录音时长足够，上传到STT服务
+                if (mic_state.recording_duration >= MIN_RECORDING_MS) {
+                    if (upload_recording_to_stt(mic_state.recording_buffer, mic_state.recording_size, turn) == ESP_OK) {
+                        // 服务器回复的TTS由轮询任务取到，接在本回合后面
+                        s_reply_time_us = esp_timer_get_time();
+                        atomic_store(&s_reply_turn, turn);
                     }
-                    
-                    // 重置状态
-                    mic_state.recording_size = 0;
-                    mic_state.silence_counter = 0;
+                } else {
+                    ESP_LOGW(TAG, "Recording too short, discarding");
                 }
-            }
-            
-            // 更新录音时长
-            if (mic_state.is_recording) {
-                mic_state.recording_duration += (downsampled_samples * 1000) / MIC_SAMPLE_RATE;
                 
-                // 每秒打印一次状态
-                sample_counter += downsampled_samples;
-                if (sample_counter >= MIC_SAMPLE_RATE) {
-                    ESP_LOGI(TAG, "Recording... duration: %dms, size: %d bytes, volume: %d", 
-                            mic_state.recording_duration, mic_state.recording_size, volume);
-                    sample_counter = 0;
-                }
+                // 重置状态
+                mic_state.recording_size = 0;
+                mic_state.silence_counter = 0;
             }
         }
         
-        // 短暂延时
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // 更新录音时长
+        if (mic_state.is_recording) {
+            mic_state.recording_duration += (downsampled_samples * 1000) / MIC_SAMPLE_RATE;
+            
+            // 每秒打印一次状态
+            sample_counter += downsampled_samples;
+            if (sample_counter >= MIC_SAMPLE_RATE) {
+                ESP_LOGI(TAG, "Recording... duration: %dms, size: %d bytes, volume: %d", 
+                        mic_state.recording_duration, mic_state.recording_size, volume);
+                sample_counter = 0;
+            }
+        }
     }
     
-    free(stereo_buffer);
     free(mono_buffer);
     free(downsampled_buffer);
     if (mic_state.recording_buffer) {
@@ -1043,6 +1099,15 @@ static void tts_polling_task(void *pvParameters) {
         if (err == ESP_OK && strlen(audio_id) > 0) {
             ESP_LOGI(TAG, "🎵 New TTS task: %s", audio_id);
             
+            // 刚上传过录音时这是对它的回复，沿用录音的追踪回合，得到从说完话到出声的完整耗时
+            uint16_t turn = atomic_exchange(&s_reply_turn, LATENCY_TRACE_TURN_NONE);
+            if (turn == LATENCY_TRACE_TURN_NONE || esp_timer_get_time() - s_reply_time_us > REPLY_JOIN_WINDOW_US) {
+                turn = latency_trace_begin_turn();
+            }
+            latency_trace_mark_at(turn, LATENCY_POLL_SENT, 0, s_poll_sent_us);
+            latency_trace_mark_at(turn, LATENCY_POLL_PARSED, 0, s_poll_parsed_us);
+            audio_state.trace_turn = turn;
+            
             // 下载PCM音频文件
             esp_err_t download_err = download_pcm_audio(audio_id);
             if (download_err == ESP_OK) {
@@ -1084,6 +1149,9 @@ void app_main(void) {
         ESP_LOGW(TAG, "PSRAM not found! Large audio files may fail.");
     }
     
+    // 语音回合延迟追踪
+    latency_trace_init(esp_timer_get_time);
+    
     // 初始化NVS
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
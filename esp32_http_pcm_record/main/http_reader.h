@@ -0,0 +1,57 @@
+#ifndef HTTP_READER_H
+#define HTTP_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+/**
+ * 拉模式HTTP读取器 - 基于esp_http_client_open/fetch_headers/read
+ * 调用方提供目标内存（段池空间或FIFO条目），响应体直接从socket读入，
+ * 不经过事件回调的evt->data再memcpy一次。读取长度按read_unit
+ * （DMA帧的整数倍）对齐，使目标缓冲区中的数据边界与播放块一致。
+ */
+
+#define HTTP_READER_MAX_REDIRECTS  3
+
+typedef struct {
+    esp_http_client_handle_t client;
+    size_t read_unit;           // 读取长度对齐单位，0表示不对齐
+    int status;
+    int64_t content_length;     // -1表示未知（chunked）
+    int redirects;
+
+    // 统计
+    size_t received;            // 读入调用方内存的响应体字节数
+    size_t discarded;           // 读出后丢弃的字节数（续传时服务器忽略Range）
+    size_t copied;              // 调用方读入后又复制的字节数
+    uint32_t reads;
+    uint32_t short_reads;       // 返回少于请求长度的读取（响应结束或超时）
+} http_reader_t;
+
+/* 清零统计，read_unit为读取长度对齐单位 */
+void http_reader_init(http_reader_t *reader, size_t read_unit);
+
+/* 发送GET请求并读取响应头，自动跟随重定向；统计在多次请求（续传）间累计 */
+esp_err_t http_reader_open(http_reader_t *reader, esp_http_client_handle_t client);
+
+/* 读取到buf，长度向下对齐到read_unit（不足一个单位时按原长度）；返回字节数，0表示结束，负数为错误 */
+int http_reader_read(http_reader_t *reader, void *buf, size_t len);
+
+/* 读出并丢弃len字节，返回实际丢弃的字节数 */
+size_t http_reader_discard(http_reader_t *reader, size_t len);
+
+/* 调用方把读到的数据再复制了一次时记账 */
+void http_reader_note_copy(http_reader_t *reader, size_t len);
+
+/* 每接收1字节的复制次数，放大100倍（100表示每字节复制一次） */
+uint32_t http_reader_copy_ratio_x100(const http_reader_t *reader);
+
+/* 打印统计 */
+void http_reader_log_stats(const http_reader_t *reader, const char *label);
+
+/* 关闭连接（不释放client） */
+void http_reader_close(http_reader_t *reader);
+
+#endif /* HTTP_READER_H */
@@ -0,0 +1,82 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 增量JSON解析器 - 不使用堆，状态大小固定
+ * 数据可以分任意多次喂入（直接来自HTTP_EVENT_ON_DATA），
+ * 按键名把字符串/整数字段写入调用方提供的缓冲区，字段顺序无关。
+ * 不依赖ESP-IDF，可在主机上测试。
+ */
+
+#define JSON_STREAM_MAX_DEPTH  16
+#define JSON_STREAM_KEY_MAX    32
+
+typedef enum {
+    JSON_FIELD_STRING = 0,      // 写入char[dest_size]，超长截断并置truncated
+    JSON_FIELD_INT,             // 写入int64_t，小数部分忽略
+} json_field_type_t;
+
+/* 需要提取的字段，按键名匹配任意深度 */
+typedef struct {
+    const char *key;
+    json_field_type_t type;
+    void *dest;
+    size_t dest_size;           // 字符串缓冲区大小（含结尾'\0'）
+    bool found;
+    bool truncated;
+    uint8_t depth;              // 键所在对象的深度（顶层对象为1）
+} json_field_t;
+
+typedef enum {
+    JSON_STREAM_MORE = 0,       // 需要更多数据
+    JSON_STREAM_DONE,           // 顶层值已完整
+    JSON_STREAM_ERROR,          // 语法错误或嵌套过深，之后的输入被忽略
+} json_stream_status_t;
+
+/* 对象结束回调，depth为该对象所在深度（顶层对象为1） */
+typedef void (*json_object_end_cb_t)(void *ctx, int depth);
+
+typedef struct {
+    // 调用方配置
+    json_field_t *fields;
+    size_t field_count;
+    json_object_end_cb_t on_object_end;
+    void *cb_ctx;
+
+    // 解析状态
+    uint8_t state;
+    uint8_t substate;           // 数字/字面量/\u转义的子状态
+    uint8_t depth;
+    uint32_t array_bits;        // 每层是否为数组
+    char key[JSON_STREAM_KEY_MAX];
+    uint8_t key_len;
+    bool key_overflow;
+    bool in_key;                // 当前字符串是键
+    json_field_t *target;       // 当前值要写入的字段
+    size_t str_len;
+    const char *literal;
+    uint32_t unicode;           // \uXXXX累积值
+    uint32_t high_surrogate;
+    int64_t number;
+    bool negative;
+    size_t offset;              // 已处理字节数，便于定位错误
+} json_stream_t;
+
+/* 初始化解析器并清空字段 */
+void json_stream_init(json_stream_t *js, json_field_t *fields, size_t field_count,
+                      json_object_end_cb_t on_object_end, void *cb_ctx);
+
+/* 喂入一段数据 */
+json_stream_status_t json_stream_feed(json_stream_t *js, const char *data, size_t len);
+
+/* 输入结束，返回最终状态（顶层值不完整视为错误） */
+json_stream_status_t json_stream_finish(json_stream_t *js);
+
+/* 清空字段的值和标志，用于逐个解析数组中的对象 */
+void json_stream_reset_fields(json_field_t *fields, size_t field_count);
+
+#endif /* JSON_STREAM_H */
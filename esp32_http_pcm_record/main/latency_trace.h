@@ -0,0 +1,96 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 语音回合延迟追踪（不依赖ESP-IDF，可在主机上测试）
+ * 在"服务器有任务"到"第一个样本送进I2S"之间的各个环节打时间戳，
+ * 事件写入无锁环形缓冲区：写入方用原子加法领取槽位，每个槽位带序号，
+ * 读取方发现序号前后不一致（正被覆盖）时跳过该槽，任何任务都可以随时打点。
+ * 每个回合一个编号，回合结束后按编号汇总出各阶段耗时，回归时能定位到具体阶段。
+ */
+
+#define LATENCY_TRACE_RING_SIZE     128         // 必须是2的幂，约10个回合
+#define LATENCY_TRACE_TURN_NONE     0           // 不追踪
+
+/* 追踪点，按一个完整回合中出现的先后顺序排列 */
+typedef enum {
+    LATENCY_VAD_START = 0,      // 检测到说话
+    LATENCY_VAD_STOP,           // 静音超时，录音结束
+    LATENCY_UPLOAD_START,       // 开始上传录音
+    LATENCY_UPLOAD_RESPONSE,    // 收到STT响应
+    LATENCY_POLL_SENT,          // 发出取到该任务的轮询请求
+    LATENCY_POLL_PARSED,        // 轮询响应解析完成
+    LATENCY_DL_CONNECT,         // 发出下载请求
+    LATENCY_DL_FIRST_BYTE,      // 收到下载响应头
+    LATENCY_WATERMARK,          // 缓冲到起播水位（或整段下载完成）
+    LATENCY_FIRST_I2S,          // 第一次i2s_channel_write返回
+    LATENCY_LAST_SAMPLE,        // 最后一个样本写入I2S
+    LATENCY_POINT_COUNT
+} latency_point_t;
+
+typedef struct {
+    int64_t time_us;
+    uint32_t arg;               // 附加数值（字节数等）
+    uint16_t turn;
+    uint8_t point;
+} latency_event_t;
+
+/* 一个回合的汇总：每个追踪点取第一次出现的时间 */
+typedef struct {
+    uint16_t turn;
+    uint32_t mask;              // 出现过的追踪点
+    int64_t stamp_us[LATENCY_POINT_COUNT];
+    uint32_t arg[LATENCY_POINT_COUNT];
+} latency_turn_t;
+
+/* 各阶段累计：阶段耗时 = 该点与前一个出现过的点之差 */
+typedef struct {
+    uint32_t count;
+    int64_t sum_us;
+    int64_t max_us;
+} latency_stage_stats_t;
+
+/* 打点监听：每次打点后在打点方的上下文中调用，用于同时写入其他追踪（如event_trace） */
+typedef void (*latency_trace_listener_t)(uint16_t turn, latency_point_t point, uint32_t arg);
+
+/* 设置时钟（设备上为esp_timer_get_time），并清空缓冲区 */
+void latency_trace_init(int64_t (*clock_us)(void));
+
+/* 设置打点监听，NULL表示不监听 */
+void latency_trace_set_listener(latency_trace_listener_t listener);
+
+/* 开始新回合，返回非零编号 */
+uint16_t latency_trace_begin_turn(void);
+
+/* 打点；turn为LATENCY_TRACE_TURN_NONE时忽略 */
+void latency_trace_mark(uint16_t turn, latency_point_t point, uint32_t arg);
+
+/* 补记之前保存的时间戳（例如取到任务后补记轮询发出的时间） */
+void latency_trace_mark_at(uint16_t turn, latency_point_t point, uint32_t arg, int64_t time_us);
+
+/* 当前时钟 */
+int64_t latency_trace_now(void);
+
+/* 按时间先后复制缓冲区中仍然有效的事件，返回事件数 */
+size_t latency_trace_snapshot(latency_event_t *out, size_t max);
+
+/* 汇总一个回合，缓冲区中没有该回合的事件时返回false */
+bool latency_trace_summarize(uint16_t turn, latency_turn_t *out);
+
+/* 把回合汇总累加到各阶段统计 */
+void latency_trace_accumulate(const latency_turn_t *t, latency_stage_stats_t stats[LATENCY_POINT_COUNT]);
+
+/* 格式化为一行，如"turn 7: poll_parsed +35.2 | dl_connect +1.0 | ... | first sample 241.7 ms"，返回写入长度 */
+int latency_trace_format(const latency_turn_t *t, char *buf, size_t len);
+
+/* 追踪点名称 */
+const char *latency_point_name(latency_point_t point);
+
+/* 累计写入的事件数（包括已被覆盖的） */
+uint32_t latency_trace_event_count(void);
+
+#endif /* LATENCY_TRACE_H */
@@ -0,0 +1,187 @@
+/**
+ * I2S RX事件驱动的麦克风采集
+ *
+ * on_recv回调在每个RX DMA缓冲区完成时唤醒采集任务，采集任务以零超时
+ * 取走所有已就绪的DMA缓冲区，放入单生产者/单消费者的无锁帧队列。
+ * VAD/上传在消费者任务中进行，即使消费者阻塞（如HTTP上传），DMA仍会
+ * 被及时取走，丢失只会体现在统计计数中而不是静默发生。
+ */
+
+#include "mic_capture.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "MIC_CAPTURE";
+
+static i2s_chan_handle_t s_rx = NULL;
+static size_t s_frame_bytes = 0;
+static uint8_t *s_frames = NULL;            // MIC_FRAME_QUEUE_LEN个帧槽（PSRAM）
+static size_t s_frame_lens[MIC_FRAME_QUEUE_LEN];
+static uint8_t *s_scratch = NULL;           // 队列满时用于排空DMA的临时缓冲区
+static atomic_uint_fast32_t s_head = 0;     // 仅采集任务写
+static atomic_uint_fast32_t s_tail = 0;     // 仅消费者任务写
+static TaskHandle_t s_capture_task = NULL;
+static TaskHandle_t s_consumer_task = NULL;
+static mic_capture_stats_t s_stats = {0};
+
+/* RX DMA缓冲区完成 - ISR上下文，只做唤醒 */
+static bool IRAM_ATTR mic_on_recv(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    BaseType_t high_task_woken = pdFALSE;
+    s_stats.rx_events++;
+    if (s_capture_task) {
+        vTaskNotifyGiveFromISR(s_capture_task, &high_task_woken);
+    }
+    return high_task_woken == pdTRUE;
+}
+
+/* 驱动内部队列溢出 - 采集任务没有及时取走DMA缓冲区 */
+static bool IRAM_ATTR mic_on_recv_q_ovf(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    s_stats.rx_overflows++;
+    return false;
+}
+
+static inline uint8_t *frame_slot(uint32_t index) {
+    return s_frames + (index % MIC_FRAME_QUEUE_LEN) * s_frame_bytes;
+}
+
+/* 采集任务 - 每次被唤醒后排空所有已就绪的DMA缓冲区 */
+static void mic_capture_task(void *pvParameters) {
+    ESP_LOGI(TAG, "Capture task started, frame size: %d bytes, queue: %d frames",
+             s_frame_bytes, MIC_FRAME_QUEUE_LEN);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (1) {
+            uint32_t head = atomic_load_explicit(&s_head, memory_order_relaxed);
+            uint32_t tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+            bool full = (head - tail) >= MIC_FRAME_QUEUE_LEN;
+            uint8_t *dst = full ? s_scratch : frame_slot(head);
+
+            size_t bytes_read = 0;
+            esp_err_t ret = i2s_channel_read(s_rx, dst, s_frame_bytes, &bytes_read, 0);
+            if (ret == ESP_ERR_TIMEOUT || (ret == ESP_OK && bytes_read == 0)) {
+                break;  // 没有更多就绪的DMA缓冲区
+            }
+            if (ret != ESP_OK) {
+                s_stats.read_errors++;
+                break;
+            }
+
+            if (full) {
+                // 消费者太慢 - 数据已从DMA取走但丢弃，计数以便排查
+                s_stats.frames_dropped++;
+                continue;
+            }
+
+            s_frame_lens[head % MIC_FRAME_QUEUE_LEN] = bytes_read;
+            atomic_store_explicit(&s_head, head + 1, memory_order_release);
+            s_stats.frames_captured++;
+
+            uint32_t depth = head + 1 - tail;
+            if (depth > s_stats.queue_high_water) {
+                s_stats.queue_high_water = depth;
+            }
+
+            TaskHandle_t consumer = s_consumer_task;
+            if (consumer) {
+                xTaskNotifyGive(consumer);
+            }
+        }
+    }
+}
+
+static void mic_capture_free_buffers(void) {
+    free(s_frames);
+    free(s_scratch);
+    s_frames = NULL;
+    s_scratch = NULL;
+}
+
+/* 初始化采集 - 必须在RX通道使能之前注册回调；失败时释放已分配的一切 */
+esp_err_t mic_capture_init(i2s_chan_handle_t rx, size_t frame_bytes) {
+    if (!rx || frame_bytes == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_rx = rx;
+    s_frame_bytes = frame_bytes;
+
+    s_frames = heap_caps_malloc(MIC_FRAME_QUEUE_LEN * frame_bytes, MALLOC_CAP_SPIRAM);
+    if (!s_frames) {
+        ESP_LOGW(TAG, "PSRAM allocation failed, falling back to internal RAM");
+        s_frames = malloc(MIC_FRAME_QUEUE_LEN * frame_bytes);
+    }
+    s_scratch = heap_caps_malloc(frame_bytes, MALLOC_CAP_INTERNAL);
+    if (!s_frames || !s_scratch) {
+        ESP_LOGE(TAG, "Failed to allocate capture frame queue");
+        mic_capture_free_buffers();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 先注册回调再创建任务：注册失败时不会留下一个永远等不到唤醒的采集任务
+    // （通道尚未使能，回调在任务创建前不会触发；ISR中也检查了任务句柄）
+    i2s_event_callbacks_t cbs = {
+        .on_recv = mic_on_recv,
+        .on_recv_q_ovf = mic_on_recv_q_ovf,
+        .on_sent = NULL,
+        .on_send_q_ovf = NULL,
+    };
+    esp_err_t ret = i2s_channel_register_event_callback(rx, &cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register RX callbacks: %s", esp_err_to_name(ret));
+        mic_capture_free_buffers();
+        return ret;
+    }
+
+    if (xTaskCreate(mic_capture_task, "mic_capture", 3072, NULL,
+                    MIC_CAPTURE_TASK_PRIO, &s_capture_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create capture task");
+        i2s_event_callbacks_t none = {0};
+        i2s_channel_register_event_callback(rx, &none, NULL);
+        s_capture_task = NULL;
+        mic_capture_free_buffers();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Event-driven capture initialized");
+    return ESP_OK;
+}
+
+/* 取出一帧 - 单消费者 */
+esp_err_t mic_capture_pop(const int16_t **frame, size_t *bytes, TickType_t timeout) {
+    if (!frame || !bytes || !s_frames) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_consumer_task = xTaskGetCurrentTaskHandle();
+
+    uint32_t tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    while (atomic_load_explicit(&s_head, memory_order_acquire) == tail) {
+        if (ulTaskNotifyTake(pdTRUE, timeout) == 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    *frame = (const int16_t *)frame_slot(tail);
+    *bytes = s_frame_lens[tail % MIC_FRAME_QUEUE_LEN];
+    return ESP_OK;
+}
+
+/* 归还帧槽给采集任务 */
+void mic_capture_release(void) {
+    uint32_t tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    atomic_store_explicit(&s_tail, tail + 1, memory_order_release);
+}
+
+/* 获取统计快照 */
+void mic_capture_get_stats(mic_capture_stats_t *stats) {
+    if (stats) {
+        *stats = s_stats;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef MIC_CAPTURE_H
+#define MIC_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/i2s_std.h"
+
+/* 采集帧队列配置 - 每帧对应一个I2S RX DMA缓冲区 */
+#define MIC_FRAME_QUEUE_LEN    64           // 64帧 ≈ 1.3s @ 48kHz立体声，放在PSRAM
+#define MIC_CAPTURE_TASK_PRIO  12           // 高于播放任务，保证DMA及时被取走
+
+/* 采集统计 - 用于证明Wi-Fi负载下不丢样本 */
+typedef struct {
+    uint32_t rx_events;          // on_recv回调次数（DMA缓冲区完成数）
+    uint32_t rx_overflows;       // 驱动内部队列溢出次数（on_recv_q_ovf），DMA数据已丢失
+    uint32_t frames_captured;    // 成功放入帧队列的帧数
+    uint32_t frames_dropped;     // 帧队列已满被丢弃的帧数（消费者太慢）
+    uint32_t read_errors;        // i2s_channel_read失败次数
+    uint32_t queue_high_water;   // 帧队列最高占用
+} mic_capture_stats_t;
+
+/* 注册RX事件回调并创建采集任务，必须在i2s_channel_enable(rx)之前调用 */
+esp_err_t mic_capture_init(i2s_chan_handle_t rx, size_t frame_bytes);
+
+/* 取出一帧（单消费者），超时返回ESP_ERR_TIMEOUT */
+esp_err_t mic_capture_pop(const int16_t **frame, size_t *bytes, TickType_t timeout);
+
+/* 归还mic_capture_pop取出的帧 */
+void mic_capture_release(void);
+
+/* 获取采集统计快照 */
+void mic_capture_get_stats(mic_capture_stats_t *stats);
+
+#endif /* MIC_CAPTURE_H */
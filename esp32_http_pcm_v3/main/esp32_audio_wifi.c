@@ -20,6 +20,7 @@
 #include "esp_heap_caps.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
+#include "profiler.h"
 
 /* Network Configuration */
 #define TTS_SERVER_URL         "http://10.129.113.191:8001"  // 更新为您的服务器地址
@@ -124,9 +125,11 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        profiler_count(PROFILER_WIFI_DISCONNECT);
         if (s_retry_num < WIFI_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
+            profiler_count(PROFILER_WIFI_RETRY);
             ESP_LOGI(TAG, "Retry to connect to the AP");
         } else {
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
@@ -366,6 +369,7 @@ static esp_err_t poll_for_tts_task_with_retry(char *audio_id, size_t audio_id_si
         }
         
         retry_count++;
+        profiler_count(PROFILER_POLL_RETRY);
         ESP_LOGW(TAG, "Poll failed, retry %d/%d", retry_count, max_retries);
         vTaskDelay(pdMS_TO_TICKS(1000 * retry_count));  // 递增延迟
     }
@@ -472,6 +476,7 @@ static esp_err_t download_pcm_audio_with_retry(const char *audio_id) {
         }
         
         retry_count++;
+        profiler_count(PROFILER_DOWNLOAD_RETRY);
         ESP_LOGW(TAG, "Download failed, retry %d/%d", retry_count, max_retries);
         vTaskDelay(pdMS_TO_TICKS(2000 * retry_count));  // 递增延迟
     }
@@ -580,6 +585,9 @@ static esp_err_t i2s_init(void) {
     
     /* Initialize TX channel */
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle, &std_cfg));
+    
+    /* 剖析服务的欠载/溢出统计，回调须在使能前注册 */
+    ESP_ERROR_CHECK(profiler_attach_i2s(tx_handle, rx_handle));
     ESP_ERROR_CHECK(i2s_channel_enable(tx_handle));
     
     /* Initialize RX channel if needed */
@@ -685,31 +693,6 @@ static void tts_polling_task(void *pvParameters) {
     }
 }
 
-/* 系统信息任务 */
-static void system_info_task(void *pvParameters) {
-    ESP_LOGI(TAG, "System Info - Free heap: %d bytes, Free PSRAM: %d bytes, Min heap: %d bytes",
-             esp_get_free_heap_size(),
-             heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
-             esp_get_minimum_free_heap_size());
-    
-    while (1) {
-        ESP_LOGI(TAG, "System Info - Free heap: %d bytes, Free PSRAM: %d bytes, Min heap: %d bytes",
-                 esp_get_free_heap_size(),
-                 heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
-                 esp_get_minimum_free_heap_size());
-        
-        if (audio_state.is_playing) {
-            ESP_LOGI(TAG, "Audio playing: %s, progress: %d/%d bytes (buffer in %s)",
-                     audio_state.current_audio_id,
-                     audio_state.audio_position,
-                     audio_state.audio_size,
-                     audio_state.use_psram ? "PSRAM" : "Internal RAM");
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(10000));  // 每10秒打印一次
-    }
-}
-
 void app_main(void) {
     ESP_LOGI(TAG, "ESP32 Polling Audio System Starting...");
     
@@ -748,8 +731,10 @@ void app_main(void) {
     // 创建TTS轮询任务
     xTaskCreate(tts_polling_task, "tts_poll", 4096, NULL, 5, NULL);
     
-    // 创建系统信息任务
-    xTaskCreate(system_info_task, "sys_info", 2048, NULL, 1, NULL);
+    // 剖析服务：周期打印任务/核心占用、栈余量和各计数器的变化，并提供/metrics
+    if (profiler_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Profiler not available");
+    }
     
     ESP_LOGI(TAG, "System initialized successfully");
 }
\ No newline at end of file
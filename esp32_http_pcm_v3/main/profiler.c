@@ -0,0 +1,383 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_wifi.h"
+#include "esp_http_server.h"
+
+static const char *TAG = "PROFILER";
+
+/* 每个任务的累计运行时间，采样间隔内计数器的32位回绕在这里展开 */
+typedef struct {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+    int core;                   // 绑定的核心，-1为不绑定
+    uint32_t last_counter;
+    uint64_t runtime_us;
+    uint64_t logged_runtime_us; // 上次打印日志时的值，日志按此求差
+    uint32_t stack_free;        // 栈最小余量（字节）
+    uint32_t logged_stack_free;
+    bool seen;
+} task_entry_t;
+
+/* 计数器在日志和/metrics中的名称 */
+static const struct {
+    const char *log_name;
+    const char *metric;
+    const char *labels;
+} counter_info[PROFILER_COUNTER_COUNT] = {
+    [PROFILER_WIFI_DISCONNECT] = { "wifi disc",   "esp_wifi_disconnects_total",        "" },
+    [PROFILER_WIFI_RETRY]      = { "wifi retry",  "esp_wifi_reconnect_attempts_total", "" },
+    [PROFILER_POLL_RETRY]      = { "poll retry",  "esp_http_retries_total",            "{op=\"poll\"}" },
+    [PROFILER_DOWNLOAD_RETRY]  = { "dl retry",    "esp_http_retries_total",            "{op=\"download\"}" },
+};
+
+static task_entry_t s_tasks[PROFILER_MAX_TASKS];
+static size_t s_task_count = 0;
+static uint32_t s_last_total = 0;
+static uint64_t s_total_us = 0;                 // 运行时间时钟的累计值
+static uint64_t s_logged_total_us = 0;
+static uint8_t s_core_load[portNUM_PROCESSORS]; // 最近一个日志间隔的占用百分比
+static SemaphoreHandle_t s_lock = NULL;
+
+// 中断和各任务都会累加，放在内部RAM的静态区
+static _Atomic uint32_t s_counters[PROFILER_COUNTER_COUNT];
+static _Atomic uint32_t s_i2s_sent = 0;
+static _Atomic uint32_t s_i2s_underrun = 0;
+static _Atomic uint32_t s_i2s_rx_overflow = 0;
+static uint32_t s_logged_counters[PROFILER_COUNTER_COUNT];
+static uint32_t s_logged_underrun = 0;
+static uint32_t s_logged_rx_overflow = 0;
+
+/* ==================== 事件来源 ==================== */
+
+static IRAM_ATTR bool i2s_sent_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    atomic_fetch_add_explicit(&s_i2s_sent, 1, memory_order_relaxed);
+    return false;
+}
+
+static IRAM_ATTR bool i2s_underrun_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    atomic_fetch_add_explicit(&s_i2s_underrun, 1, memory_order_relaxed);
+    return false;
+}
+
+static IRAM_ATTR bool i2s_rx_overflow_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    atomic_fetch_add_explicit(&s_i2s_rx_overflow, 1, memory_order_relaxed);
+    return false;
+}
+
+esp_err_t profiler_attach_i2s(i2s_chan_handle_t tx, i2s_chan_handle_t rx) {
+    i2s_event_callbacks_t tx_cbs = {
+        .on_sent = i2s_sent_cb,
+        .on_send_q_ovf = i2s_underrun_cb,
+    };
+    esp_err_t err = i2s_channel_register_event_callback(tx, &tx_cbs, NULL);
+    if (err == ESP_OK && rx) {
+        i2s_event_callbacks_t rx_cbs = {
+            .on_recv_q_ovf = i2s_rx_overflow_cb,
+        };
+        err = i2s_channel_register_event_callback(rx, &rx_cbs, NULL);
+    }
+    return err;
+}
+
+void profiler_count(profiler_counter_t counter) {
+    if (counter < PROFILER_COUNTER_COUNT) {
+        atomic_fetch_add_explicit(&s_counters[counter], 1, memory_order_relaxed);
+    }
+}
+
+/* ==================== 采样 ==================== */
+
+static task_entry_t *find_task(TaskHandle_t handle) {
+    for (size_t i = 0; i < s_task_count; i++) {
+        if (s_tasks[i].handle == handle) {
+            return &s_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+/* 读取所有任务的运行时间计数器并累加，调用方持有s_lock */
+static void sample_tasks(void) {
+    static TaskStatus_t status[PROFILER_MAX_TASKS];
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, PROFILER_MAX_TASKS, &total);
+
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, increase PROFILER_MAX_TASKS", PROFILER_MAX_TASKS);
+        return;
+    }
+    s_total_us += (uint32_t)((uint32_t)total - s_last_total);
+    s_last_total = (uint32_t)total;
+
+    for (size_t i = 0; i < s_task_count; i++) {
+        s_tasks[i].seen = false;
+    }
+    for (UBaseType_t i = 0; i < count; i++) {
+        task_entry_t *t = find_task(status[i].xHandle);
+        if (!t) {
+            if (s_task_count == PROFILER_MAX_TASKS) {
+                continue;
+            }
+            // 新任务：创建以来的运行时间全部计入
+            t = &s_tasks[s_task_count++];
+            memset(t, 0, sizeof(*t));
+            t->handle = status[i].xHandle;
+            strncpy(t->name, status[i].pcTaskName, sizeof(t->name) - 1);
+            BaseType_t core = xTaskGetCoreID(t->handle);
+            t->core = core == tskNO_AFFINITY ? -1 : (int)core;
+            t->logged_stack_free = UINT32_MAX;
+        }
+        t->runtime_us += (uint32_t)((uint32_t)status[i].ulRunTimeCounter - t->last_counter);
+        t->last_counter = (uint32_t)status[i].ulRunTimeCounter;
+        t->stack_free = status[i].usStackHighWaterMark;     // ESP-IDF中单位为字节
+        t->seen = true;
+    }
+
+    // 移除已删除的任务
+    size_t kept = 0;
+    for (size_t i = 0; i < s_task_count; i++) {
+        if (s_tasks[i].seen) {
+            s_tasks[kept++] = s_tasks[i];
+        }
+    }
+    s_task_count = kept;
+}
+
+/* ==================== 周期日志 ==================== */
+
+#define APPEND(...) do { \
+        int n = snprintf(line + pos, pos < sizeof(line) ? sizeof(line) - pos : 0, __VA_ARGS__); \
+        if (n > 0) pos += (size_t)n; \
+    } while (0)
+
+/* 与上次日志相比的变化：CPU占用、栈余量下降的任务、非零的计数器增量 */
+static void log_deltas(void) {
+    char line[384];
+    size_t pos = 0;
+    uint64_t interval = s_total_us - s_logged_total_us;
+
+    if (interval == 0) {
+        return;
+    }
+
+    // 各核心占用 = 1 - 该核心空闲任务的运行时间占比
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        task_entry_t *idle = find_task(xTaskGetIdleTaskHandleForCore(core));
+        uint64_t idle_us = idle ? idle->runtime_us - idle->logged_runtime_us : 0;
+        uint64_t busy = interval > idle_us ? interval - idle_us : 0;
+        s_core_load[core] = (uint8_t)(busy * 100 / interval);
+        APPEND("%scpu%d %u%%", core ? " " : "", core, s_core_load[core]);
+    }
+    APPEND(" |");
+    for (size_t i = 0; i < s_task_count; i++) {
+        task_entry_t *t = &s_tasks[i];
+        unsigned pct = (unsigned)((t->runtime_us - t->logged_runtime_us) * 100 / interval);
+        if (pct >= PROFILER_LOG_MIN_CPU && strncmp(t->name, "IDLE", 4) != 0) {
+            APPEND(" %s %u%%", t->name, pct);
+        }
+        t->logged_runtime_us = t->runtime_us;
+    }
+    ESP_LOGI(TAG, "%s", line);
+
+    pos = 0;
+    APPEND("heap %uk psram %uk min %uk",
+           (unsigned)(heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024),
+           (unsigned)(heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024),
+           (unsigned)(esp_get_minimum_free_heap_size() / 1024));
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        APPEND(" | rssi %d", ap.rssi);
+    }
+    uint32_t underrun = atomic_load(&s_i2s_underrun);
+    uint32_t rx_overflow = atomic_load(&s_i2s_rx_overflow);
+    if (underrun != s_logged_underrun) {
+        APPEND(" | i2s underrun +%u", (unsigned)(underrun - s_logged_underrun));
+        s_logged_underrun = underrun;
+    }
+    if (rx_overflow != s_logged_rx_overflow) {
+        APPEND(" | i2s rx overflow +%u", (unsigned)(rx_overflow - s_logged_rx_overflow));
+        s_logged_rx_overflow = rx_overflow;
+    }
+    for (int c = 0; c < PROFILER_COUNTER_COUNT; c++) {
+        uint32_t value = atomic_load(&s_counters[c]);
+        if (value != s_logged_counters[c]) {
+            APPEND(" | %s +%u", counter_info[c].log_name, (unsigned)(value - s_logged_counters[c]));
+            s_logged_counters[c] = value;
+        }
+    }
+    // 栈余量只在创下新低时打印
+    for (size_t i = 0; i < s_task_count; i++) {
+        task_entry_t *t = &s_tasks[i];
+        if (t->stack_free < t->logged_stack_free) {
+            APPEND(" | stack %s %u", t->name, (unsigned)t->stack_free);
+            t->logged_stack_free = t->stack_free;
+        }
+    }
+    ESP_LOGI(TAG, "%s", line);
+
+    s_logged_total_us = s_total_us;
+}
+
+#undef APPEND
+
+static void profiler_task(void *pvParameters) {
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(PROFILER_INTERVAL_MS));
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        sample_tasks();
+        log_deltas();
+        xSemaphoreGive(s_lock);
+    }
+}
+
+/* ==================== /metrics ==================== */
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+} metrics_buf_t;
+
+static void metrics_printf(metrics_buf_t *m, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void metrics_printf(metrics_buf_t *m, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(m->buf + m->pos, m->pos < m->len ? m->len - m->pos : 0, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        m->pos += (size_t)n;
+    }
+}
+
+static void metrics_header(metrics_buf_t *m, const char *name, const char *type, const char *help) {
+    metrics_printf(m, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* 生成Prometheus文本，调用方持有s_lock */
+static void render_metrics(metrics_buf_t *m) {
+    metrics_header(m, "esp_uptime_seconds", "gauge", "Time since boot");
+    metrics_printf(m, "esp_uptime_seconds %.3f\n", esp_timer_get_time() / 1e6);
+
+    metrics_header(m, "esp_task_runtime_seconds_total", "counter", "CPU time used by each task");
+    for (size_t i = 0; i < s_task_count; i++) {
+        const task_entry_t *t = &s_tasks[i];
+        char core[8];
+        snprintf(core, sizeof(core), t->core < 0 ? "any" : "%d", t->core);
+        metrics_printf(m, "esp_task_runtime_seconds_total{task=\"%s\",core=\"%s\"} %.6f\n",
+                       t->name, core, t->runtime_us / 1e6);
+    }
+    metrics_header(m, "esp_task_stack_free_min_bytes", "gauge", "Stack high-water mark (minimum free stack)");
+    for (size_t i = 0; i < s_task_count; i++) {
+        metrics_printf(m, "esp_task_stack_free_min_bytes{task=\"%s\"} %u\n",
+                       s_tasks[i].name, (unsigned)s_tasks[i].stack_free);
+    }
+    metrics_header(m, "esp_cpu_load_percent", "gauge", "CPU load per core over the last log interval");
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        metrics_printf(m, "esp_cpu_load_percent{core=\"%d\"} %u\n", core, s_core_load[core]);
+    }
+
+    metrics_header(m, "esp_heap_free_bytes", "gauge", "Free heap");
+    metrics_printf(m, "esp_heap_free_bytes{heap=\"internal\"} %u\n",
+                   (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    metrics_printf(m, "esp_heap_free_bytes{heap=\"psram\"} %u\n",
+                   (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    metrics_header(m, "esp_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    metrics_printf(m, "esp_heap_min_free_bytes %u\n", (unsigned)esp_get_minimum_free_heap_size());
+
+    metrics_header(m, "esp_i2s_dma_buffers_sent_total", "counter", "I2S TX DMA buffers played");
+    metrics_printf(m, "esp_i2s_dma_buffers_sent_total %u\n", (unsigned)atomic_load(&s_i2s_sent));
+    metrics_header(m, "esp_i2s_tx_underrun_total", "counter", "I2S TX queue overflows (DMA ran out of new audio)");
+    metrics_printf(m, "esp_i2s_tx_underrun_total %u\n", (unsigned)atomic_load(&s_i2s_underrun));
+    metrics_header(m, "esp_i2s_rx_overflow_total", "counter", "I2S RX queue overflows (received data not read)");
+    metrics_printf(m, "esp_i2s_rx_overflow_total %u\n", (unsigned)atomic_load(&s_i2s_rx_overflow));
+
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        metrics_header(m, "esp_wifi_rssi_dbm", "gauge", "RSSI of the associated AP");
+        metrics_printf(m, "esp_wifi_rssi_dbm %d\n", ap.rssi);
+    }
+    for (int c = 0; c < PROFILER_COUNTER_COUNT; c++) {
+        // 同一指标的多个标签只写一次头
+        if (c == 0 || strcmp(counter_info[c].metric, counter_info[c - 1].metric) != 0) {
+            metrics_header(m, counter_info[c].metric, "counter", counter_info[c].log_name);
+        }
+        metrics_printf(m, "%s%s %u\n", counter_info[c].metric, counter_info[c].labels,
+                       (unsigned)atomic_load(&s_counters[c]));
+    }
+}
+
+static esp_err_t metrics_handler(httpd_req_t *req) {
+    metrics_buf_t m = {
+        .buf = heap_caps_malloc(PROFILER_METRICS_BUF, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT),
+        .len = PROFILER_METRICS_BUF,
+    };
+    if (!m.buf) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "out of memory");
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    sample_tasks();
+    render_metrics(&m);
+    xSemaphoreGive(s_lock);
+
+    if (m.pos >= m.len) {
+        ESP_LOGW(TAG, "Metrics truncated at %d bytes", PROFILER_METRICS_BUF);
+        m.pos = m.len - 1;
+    }
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    esp_err_t err = httpd_resp_send(req, m.buf, m.pos);
+    free(m.buf);
+    return err;
+}
+
+esp_err_t profiler_start(void) {
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    sample_tasks();
+    s_logged_total_us = s_total_us;
+    for (size_t i = 0; i < s_task_count; i++) {
+        s_tasks[i].logged_runtime_us = s_tasks[i].runtime_us;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (xTaskCreate(profiler_task, "profiler", 3072, NULL, 1, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = PROFILER_HTTP_PORT;
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics server failed to start: %s", esp_err_to_name(err));
+        return err;
+    }
+    httpd_uri_t metrics_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = metrics_handler,
+    };
+    httpd_register_uri_handler(server, &metrics_uri);
+
+    ESP_LOGI(TAG, "Profiler started: log every %d s, Prometheus metrics on :%d/metrics",
+             PROFILER_INTERVAL_MS / 1000, PROFILER_HTTP_PORT);
+    return ESP_OK;
+}
@@ -0,0 +1,40 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2s_std.h"
+
+/**
+ * 运行时剖析服务 - 取代原来每10秒打印空闲堆的system_info_task
+ * 周期采样：各任务/各核心的CPU占用（FreeRTOS运行时间计数器）、栈最小余量、堆、
+ * I2S欠载/溢出、WiFi RSSI以及重连/重试计数，日志中只打印相对上次有变化的部分；
+ * 本地HTTP服务器的GET /metrics按Prometheus文本格式返回全部指标，每次请求即时采样。
+ * 需要CONFIG_FREERTOS_USE_TRACE_FACILITY和CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS（见sdkconfig）。
+ */
+
+#define PROFILER_INTERVAL_MS    10000
+#define PROFILER_MAX_TASKS      24
+#define PROFILER_HTTP_PORT      80
+#define PROFILER_LOG_MIN_CPU    1           // 日志只列出占用不低于1%的任务
+#define PROFILER_METRICS_BUF    8192
+
+/* 由应用代码累加的计数器 */
+typedef enum {
+    PROFILER_WIFI_DISCONNECT = 0,   // 与AP断开
+    PROFILER_WIFI_RETRY,            // 重连尝试
+    PROFILER_POLL_RETRY,            // 轮询重试
+    PROFILER_DOWNLOAD_RETRY,        // 下载重试
+    PROFILER_COUNTER_COUNT
+} profiler_counter_t;
+
+/* 注册I2S回调统计DMA缓冲区、发送欠载和接收溢出，必须在通道使能前调用；rx可为NULL */
+esp_err_t profiler_attach_i2s(i2s_chan_handle_t tx, i2s_chan_handle_t rx);
+
+/* 计数器加一，任意任务可调用 */
+void profiler_count(profiler_counter_t counter);
+
+/* 启动采样任务和/metrics服务器（网络初始化之后调用） */
+esp_err_t profiler_start(void);
+
+#endif /* PROFILER_H */
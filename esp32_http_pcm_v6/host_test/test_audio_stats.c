@@ -0,0 +1,200 @@
+/**
+ * audio_stats主机端精度测试（esp32-record的电平统计）
+ * 直接包含audio_stats.c以测试静态的isqrt64/log2_q16：0、满量程、2的幂和相邻值等边界，
+ * 再以双精度log10为参考检查dBFS换算，最后用已知电平的正弦/方波/静音检查整条统计流程。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "test_check.h"
+#include "audio_stats.c"
+
+#define RATE            48000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* isqrt64(v)必须是满足r*r <= v的最大r */
+static void check_isqrt(uint64_t v) {
+    uint64_t r = isqrt64(v);
+    CHECK(r * r <= v);
+    CHECK(r == UINT32_MAX || (r + 1) * (r + 1) > v);
+}
+
+static void test_isqrt(void) {
+    CHECK(isqrt64(0) == 0);
+    CHECK(isqrt64(1) == 1);
+    CHECK(isqrt64(UINT64_MAX) == UINT32_MAX);
+    // 样本平方的满量程：(-32768)^2
+    CHECK(isqrt64(32768ULL * 32768) == 32768);
+    CHECK(isqrt64(32768ULL * 32768 - 1) == 32767);
+
+    for (uint64_t v = 0; v < 1000000; v++) {
+        check_isqrt(v);
+    }
+    for (int n = 0; n < 64; n++) {
+        uint64_t p = 1ULL << n;
+        check_isqrt(p - 1);
+        check_isqrt(p);
+        check_isqrt(p + 1);
+    }
+    // 完全平方数和它两侧的值
+    for (uint64_t k = 1; k <= UINT32_MAX; k = k * 3 + 1) {
+        CHECK(isqrt64(k * k) == k);
+        CHECK(isqrt64(k * k - 1) == k - 1);
+        check_isqrt(k * k + 1);
+    }
+    for (int i = 0; i < 1000000; i++) {
+        check_isqrt(rng_next() >> (rng_next() & 63));
+    }
+}
+
+/* log2_q16按位截断：不大于真值，误差小于2个Q16单位 */
+static void check_log2(uint64_t v, double *max_err) {
+    double exact = log2((double)v) * 65536.0;
+    double err = exact - log2_q16(v);
+    CHECK(err > -1e-6);
+    CHECK(err < 2.0);
+    if (err > *max_err) {
+        *max_err = err;
+    }
+}
+
+static void test_log2(void) {
+    double max_err = 0;
+    for (int n = 0; n < 64; n++) {
+        CHECK(log2_q16(1ULL << n) == n << 16);
+        if (n > 1) {
+            check_log2((1ULL << n) - 1, &max_err);
+            check_log2((1ULL << n) + 1, &max_err);
+        }
+    }
+    check_log2(3, &max_err);
+    check_log2(UINT64_MAX, &max_err);
+    for (uint64_t v = 1; v < 100000; v++) {
+        check_log2(v, &max_err);
+    }
+    for (int i = 0; i < 1000000; i++) {
+        uint64_t v = rng_next() >> (rng_next() & 63);
+        check_log2(v ? v : 1, &max_err);
+    }
+    printf("log2_q16: max error %.3f Q16 units\n", max_err);
+}
+
+/* dBFS x10四舍五入：与10*log10(ms/32768^2)的误差不超过0.05 dB（加log2截断的约0.0001 dB） */
+static void check_db(uint64_t ms, double *max_err) {
+    double exact = 100.0 * log10((double)ms / (32768.0 * 32768.0));
+    int16_t db = audio_stats_power_db_x10(ms);
+    if (exact < AUDIO_STATS_MIN_DB_X10) {
+        CHECK(db == AUDIO_STATS_MIN_DB_X10);
+        return;
+    }
+    double err = fabs(db - exact);
+    CHECK(err <= 0.501);
+    if (err > *max_err) {
+        *max_err = err;
+    }
+}
+
+static void test_power_db(void) {
+    double max_err = 0;
+    CHECK(audio_stats_power_db_x10(0) == AUDIO_STATS_MIN_DB_X10);
+    CHECK(audio_stats_power_db_x10(1) == -903);                          // 1 LSB
+    CHECK(audio_stats_power_db_x10(32768ULL * 32768) == 0);              // 满量程方波
+    CHECK(audio_stats_power_db_x10(32768ULL * 32768 / 2) == -30);        // 满量程正弦
+    CHECK(audio_stats_power_db_x10(32768ULL * 32768 / 100) == -200);     // -20 dB
+    CHECK(audio_stats_power_db_x10(32768ULL * 32768 * 4) == 60);         // 超过满量程（叠加后的和）
+    for (int n = 0; n < 64; n++) {
+        check_db(1ULL << n, &max_err);
+    }
+    for (uint64_t ms = 1; ms < 200000; ms++) {
+        check_db(ms, &max_err);
+    }
+    for (int i = 0; i < 1000000; i++) {
+        check_db((rng_next() >> (rng_next() % 34)) & ((1ULL << 32) - 1), &max_err);
+    }
+    printf("power_db_x10: max error %.3f (x0.1 dB)\n", max_err);
+}
+
+/* 已知电平的信号：正弦（带直流偏置）、满量程方波、静音 */
+static void test_levels(void) {
+    static int16_t buf[2 * RATE / 10];
+    audio_stats_t stats;
+    audio_stats_snapshot_t snap;
+
+    // -6 dBFS正弦（峰值16384）加直流偏置500，立体声只统计左声道
+    const double amplitude = 16384.0, dc = 500.0;
+    audio_stats_init(&stats, RATE);
+    size_t frames = sizeof(buf) / sizeof(buf[0]) / 2;
+    for (int block = 0; block < 20; block++) {
+        for (size_t i = 0; i < frames; i++) {
+            double t = (double)(block * frames + i) / RATE;
+            buf[2 * i] = (int16_t)lrint(dc + amplitude * sin(2 * M_PI * 1000.0 * t));
+            buf[2 * i + 1] = 0x7FFF;
+        }
+        audio_stats_update(&stats, buf, frames, 2);
+    }
+    audio_stats_snapshot(&stats, &snap);
+    double sine_db = 100.0 * log10(amplitude * amplitude / 2 / (32768.0 * 32768.0));
+    printf("sine: dc %d, block_rms %u, block_db %d (expected %.1f), peak_db %d, loudness %d, rms_db %d\n",
+           snap.dc, snap.block_rms, snap.block_db_x10, sine_db, snap.peak_db_x10, snap.loudness_db_x10,
+           snap.rms_db_x10);
+    // 单极点直流跟踪器对1 kHz的衰减约为a/w（a=2^-AUDIO_STATS_DC_SHIFT），残留的正弦纹波叠加在直流读数上
+    double ripple = amplitude / (2 * M_PI * 1000.0 / RATE * (1 << AUDIO_STATS_DC_SHIFT));
+    CHECK(fabs(snap.dc - dc) <= ripple * 1.1 + 2);
+    CHECK(snap.mean == (int16_t)dc);
+    CHECK(abs((int)snap.block_rms - (int)lrint(amplitude / sqrt(2.0))) <= 2);
+    CHECK(fabs(snap.block_db_x10 - sine_db) <= 0.6);
+    CHECK(fabs(snap.loudness_db_x10 - sine_db) <= 0.6);
+    CHECK(snap.max == (int16_t)(dc + amplitude) && snap.min == (int16_t)(dc - amplitude));
+    CHECK(snap.clipped == 0);
+    CHECK(snap.samples == 20 * frames);
+
+    // 满量程方波：0 dBFS，每个样本都算削波
+    audio_stats_init(&stats, RATE);
+    for (size_t i = 0; i < frames; i++) {
+        buf[i] = (i / 24) % 2 ? -32768 : 32767;
+    }
+    audio_stats_update(&stats, buf, frames, 1);
+    audio_stats_snapshot(&stats, &snap);
+    printf("square: rms %u, rms_db %d, peak_db %d, clipped %u\n", snap.rms, snap.rms_db_x10, snap.peak_db_x10,
+           (unsigned)snap.clipped);
+    CHECK(snap.rms_db_x10 == 0);
+    CHECK(snap.peak_db_x10 == 0);
+    CHECK(snap.peak == 32768);
+    CHECK(snap.clipped == frames);
+
+    // 静音：最低电平
+    audio_stats_init(&stats, RATE);
+    memset(buf, 0, sizeof(buf));
+    audio_stats_update(&stats, buf, frames, 1);
+    audio_stats_snapshot(&stats, &snap);
+    CHECK(snap.rms == 0 && snap.block_rms == 0);
+    CHECK(snap.rms_db_x10 == AUDIO_STATS_MIN_DB_X10);
+    CHECK(snap.block_db_x10 == AUDIO_STATS_MIN_DB_X10);
+    CHECK(snap.peak_db_x10 == AUDIO_STATS_MIN_DB_X10);
+
+    // 未更新过：不读未初始化的min/max
+    audio_stats_init(&stats, RATE);
+    audio_stats_snapshot(&stats, &snap);
+    CHECK(snap.samples == 0 && snap.min == 0 && snap.max == 0);
+    CHECK(snap.rms_db_x10 == AUDIO_STATS_MIN_DB_X10);
+}
+
+int main(void) {
+    test_isqrt();
+    test_log2();
+    test_power_db();
+    test_levels();
+    printf("audio_stats: all tests passed\n");
+    return 0;
+}
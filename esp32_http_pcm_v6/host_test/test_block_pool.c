@@ -0,0 +1,143 @@
+/**
+ * block_pool主机端碎片化浸泡测试
+ * 模拟长时间运行下大小各异的片段反复分配/释放（下载下一段的同时播放上一段），
+ * 验证：池内空闲块足够时分配永不失败、数据互不覆盖、统计一致、
+ * 浸泡结束后仍能一次性分配满整个池（即没有碎片）。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "test_check.h"
+#include "block_pool.h"
+
+#define SEGMENT_SIZE    (64 * 1024)
+#define SEGMENT_COUNT   64
+#define SOAK_CLIPS      20000
+#define MAX_LIVE_CLIPS  2
+
+typedef struct {
+    uint8_t *segments[SEGMENT_COUNT];
+    size_t segment_count;
+    uint8_t tag;
+} clip_t;
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void clip_fill(clip_t *clip) {
+    for (size_t i = 0; i < clip->segment_count; i++) {
+        // 只写首尾字节，足以检测块重叠
+        clip->segments[i][0] = clip->tag;
+        clip->segments[i][SEGMENT_SIZE - 1] = (uint8_t)~clip->tag;
+    }
+}
+
+static void clip_verify_and_free(block_pool_t *pool, clip_t *clip) {
+    const uint8_t tail = (uint8_t)~clip->tag;
+    for (size_t i = 0; i < clip->segment_count; i++) {
+        CHECK(clip->segments[i][0] == clip->tag);
+        CHECK(clip->segments[i][SEGMENT_SIZE - 1] == tail);
+        CHECK(block_pool_free(pool, clip->segments[i]));
+    }
+    clip->segment_count = 0;
+}
+
+static void test_basic(void) {
+    static uint8_t storage[4 * 16];
+    static uint8_t meta[64];
+    block_pool_t pool;
+
+    CHECK(block_pool_meta_size(4) <= sizeof(meta));
+    CHECK(block_pool_init(&pool, storage, 16, 4, meta));
+
+    void *blocks[4];
+    for (int i = 0; i < 4; i++) {
+        blocks[i] = block_pool_alloc(&pool);
+        CHECK(blocks[i] != NULL);
+    }
+    CHECK(blocks[0] == storage);
+    CHECK(block_pool_alloc(&pool) == NULL);
+    CHECK(pool.stats.fail_count == 1);
+
+    // 重复释放、越界指针、未对齐指针都应被拒绝
+    CHECK(block_pool_free(&pool, blocks[1]));
+    CHECK(!block_pool_free(&pool, blocks[1]));
+    CHECK(!block_pool_free(&pool, storage + 3));
+    CHECK(!block_pool_free(&pool, storage + sizeof(storage)));
+    CHECK(pool.stats.invalid_free_count == 3);
+
+    // LIFO：刚释放的块被立即复用
+    CHECK(block_pool_alloc(&pool) == blocks[1]);
+    CHECK(pool.stats.peak_in_use == 4);
+    printf("basic: ok\n");
+}
+
+static void test_soak(void) {
+    uint8_t *storage = malloc((size_t)SEGMENT_SIZE * SEGMENT_COUNT);
+    uint8_t *meta = malloc(block_pool_meta_size(SEGMENT_COUNT));
+    CHECK(storage && meta);
+
+    block_pool_t pool;
+    CHECK(block_pool_init(&pool, storage, SEGMENT_SIZE, SEGMENT_COUNT, meta));
+
+    clip_t clips[MAX_LIVE_CLIPS] = {0};
+    size_t total_segments = 0;
+
+    for (int n = 0; n < SOAK_CLIPS; n++) {
+        clip_t *clip = &clips[n % MAX_LIVE_CLIPS];
+        clip_verify_and_free(&pool, clip);
+
+        // 片段大小 1KB - 2MB，两个并存片段最多占满整个池
+        size_t clip_bytes = 1024 + rng_next() % (SEGMENT_SIZE * SEGMENT_COUNT / MAX_LIVE_CLIPS - 1024);
+        size_t needed = (clip_bytes + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+        uint32_t free_before = pool.block_count - pool.stats.in_use;
+
+        clip->tag = (uint8_t)n;
+        for (size_t i = 0; i < needed; i++) {
+            clip->segments[i] = block_pool_alloc(&pool);
+            // 空闲块足够时绝不能失败（固定几何，无碎片）
+            CHECK(clip->segments[i] != NULL || needed > free_before);
+            if (!clip->segments[i]) {
+                break;
+            }
+            clip->segment_count++;
+        }
+        total_segments += clip->segment_count;
+        clip_fill(clip);
+
+        CHECK(pool.stats.in_use == pool.stats.alloc_count - pool.stats.free_count);
+    }
+
+    for (int i = 0; i < MAX_LIVE_CLIPS; i++) {
+        clip_verify_and_free(&pool, &clips[i]);
+    }
+
+    // 浸泡之后整个池仍可一次分配满
+    CHECK(pool.stats.in_use == 0);
+    for (int i = 0; i < SEGMENT_COUNT; i++) {
+        CHECK(block_pool_alloc(&pool) != NULL);
+    }
+    CHECK(pool.stats.fail_count == 0);
+    CHECK(pool.stats.invalid_free_count == 0);
+
+    printf("soak: %d clips, %zu segments, peak %u/%u blocks, 0 failures\n",
+           SOAK_CLIPS, total_segments, pool.stats.peak_in_use, pool.stats.block_count);
+
+    free(storage);
+    free(meta);
+}
+
+int main(void) {
+    test_basic();
+    test_soak();
+    printf("All block_pool tests passed\n");
+    return 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * clip_index主机端测试
+ * 用内存模拟的flash（擦除为0xFF、写入只能把1变成0）按clip_cache的流程反复
+ * 存取片段，验证：CRC与zlib一致、索引损坏可检测、同键覆盖、未写完的项不会命中、
+ * LRU淘汰不会选中最近使用的项、各项占用的块互不重叠且数据完整、
+ * 两份索引交替写入时任一份写坏都能恢复，以及磨损在块之间分布均匀。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "test_check.h"
+#include "clip_index.h"
+
+#define BLOCKS          63
+#define STORE_ROUNDS    4000
+#define KEY_POOL        120
+#define MAX_CLIP_BLOCKS 4
+
+/* 模拟flash：两个索引扇区 + 数据块 */
+static uint8_t flash_index[2][4096];
+static uint8_t *flash_data;
+static uint32_t block_erases[BLOCKS];
+
+static uint32_t rng_state = 0x2545F491;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void flash_write(uint8_t *dst, const void *src, size_t len) {
+    const uint8_t *s = (const uint8_t *)src;
+    for (size_t i = 0; i < len; i++) {
+        // NOR flash只能把1写成0，写入前必须擦除
+        CHECK((dst[i] & s[i]) == s[i]);
+        dst[i] = s[i];
+    }
+}
+
+static void write_index(clip_index_t *idx) {
+    clip_index_seal(idx);
+    uint8_t *sector = flash_index[idx->seq % 2];
+    memset(sector, 0xFF, sizeof(flash_index[0]));
+    flash_write(sector, idx, sizeof(*idx));
+}
+
+static bool load_index(clip_index_t *idx) {
+    clip_index_t a, b;
+    memcpy(&a, flash_index[0], sizeof(a));
+    memcpy(&b, flash_index[1], sizeof(b));
+    bool va = clip_index_valid(&a, BLOCKS);
+    bool vb = clip_index_valid(&b, BLOCKS);
+    if (!va && !vb) {
+        return false;
+    }
+    *idx = (vb && (!va || b.seq > a.seq)) ? b : a;
+    return true;
+}
+
+/* 片段内容由键和长度决定，读回时可校验 */
+static void fill_clip(uint8_t *buf, size_t size, uint32_t key_id) {
+    uint32_t x = key_id * 2654435761u + (uint32_t)size;
+    for (size_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(x >> 16);
+    }
+}
+
+static int store_clip(clip_index_t *idx, const char *key, const uint8_t *data, size_t size, int *evicted) {
+    int entry = clip_index_alloc(idx, key, (uint32_t)size, evicted);
+    if (entry < 0) {
+        return -1;
+    }
+    const clip_index_entry_t *e = &idx->entries[entry];
+    for (uint16_t i = 0; i < e->block_count; i++) {
+        uint16_t block = e->first_block + i;
+        memset(flash_data + (size_t)block * CLIP_INDEX_BLOCK_SIZE, 0xFF, CLIP_INDEX_BLOCK_SIZE);
+        block_erases[block]++;
+        clip_index_note_erase(idx, block);
+    }
+    flash_write(flash_data + (size_t)e->first_block * CLIP_INDEX_BLOCK_SIZE, data, size);
+    clip_index_commit(idx, entry, clip_index_crc32(0, data, size));
+    write_index(idx);
+    return entry;
+}
+
+static bool load_clip_ok(const clip_index_t *idx, int entry) {
+    const clip_index_entry_t *e = &idx->entries[entry];
+    const uint8_t *data = flash_data + (size_t)e->first_block * CLIP_INDEX_BLOCK_SIZE;
+    return clip_index_crc32(0, data, e->size) == e->crc;
+}
+
+static void check_layout(const clip_index_t *idx) {
+    uint8_t owner[BLOCKS];
+    memset(owner, 0xFF, sizeof(owner));
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        const clip_index_entry_t *e = &idx->entries[i];
+        if (!(e->flags & CLIP_INDEX_FLAG_VALID)) {
+            continue;
+        }
+        CHECK(e->block_count > 0);
+        CHECK((size_t)e->first_block + e->block_count <= BLOCKS);
+        CHECK(e->size > (uint32_t)(e->block_count - 1) * CLIP_INDEX_BLOCK_SIZE);
+        CHECK(e->size <= (uint32_t)e->block_count * CLIP_INDEX_BLOCK_SIZE);
+        for (uint16_t b = 0; b < e->block_count; b++) {
+            CHECK(owner[e->first_block + b] == 0xFF);
+            owner[e->first_block + b] = (uint8_t)i;
+        }
+        CHECK(load_clip_ok(idx, i));
+        CHECK(clip_index_find(idx, e->key) == i);
+    }
+}
+
+static void test_crc(void) {
+    CHECK(clip_index_crc32(0, "123456789", 9) == 0xCBF43926u);
+    uint32_t crc = clip_index_crc32(0, "1234", 4);
+    CHECK(clip_index_crc32(crc, "56789", 5) == 0xCBF43926u);
+    CHECK(clip_index_crc32(0, "", 0) == 0);
+}
+
+static void test_index_integrity(void) {
+    clip_index_t idx;
+    clip_index_init(&idx, BLOCKS);
+    CHECK(clip_index_valid(&idx, BLOCKS));
+    CHECK(!clip_index_valid(&idx, BLOCKS - 1));
+
+    int entry = clip_index_alloc(&idx, "greeting", 1000, NULL);
+    CHECK(entry >= 0);
+    CHECK(clip_index_find(&idx, "greeting") < 0);   // 未写完不命中
+    clip_index_commit(&idx, entry, 0x1234);
+    clip_index_seal(&idx);
+    CHECK(clip_index_valid(&idx, BLOCKS));
+    CHECK(clip_index_find(&idx, "greeting") == entry);
+
+    clip_index_t bad = idx;
+    ((uint8_t *)&bad)[100] ^= 0x01;
+    CHECK(!clip_index_valid(&bad, BLOCKS));
+
+    // CRC正确但位置越界的索引同样拒绝
+    bad = idx;
+    bad.entries[entry].first_block = BLOCKS;
+    bad.crc = clip_index_crc32(0, &bad, offsetof(clip_index_t, crc));
+    CHECK(!clip_index_valid(&bad, BLOCKS));
+
+    // 超长的键和过大的片段放不下
+    char long_key[CLIP_INDEX_KEY_LEN + 8];
+    memset(long_key, 'k', sizeof(long_key) - 1);
+    long_key[sizeof(long_key) - 1] = '\0';
+    CHECK(clip_index_alloc(&idx, long_key, 1000, NULL) < 0);
+    CHECK(clip_index_alloc(&idx, "huge", (uint32_t)(BLOCKS + 1) * CLIP_INDEX_BLOCK_SIZE, NULL) < 0);
+    CHECK(clip_index_alloc(&idx, "", 1000, NULL) < 0);
+
+    // 未写完的项在下次分配时回收
+    int pending = clip_index_alloc(&idx, "interrupted", 3 * CLIP_INDEX_BLOCK_SIZE, NULL);
+    CHECK(pending >= 0);
+    CHECK(clip_index_used_blocks(&idx) == 4);
+    int next = clip_index_alloc(&idx, "next", 100, NULL);
+    CHECK(next >= 0);
+    CHECK(clip_index_used_blocks(&idx) == 2);
+
+    // 同键重新写入替换旧项
+    clip_index_commit(&idx, next, 1);
+    int again = clip_index_alloc(&idx, "next", 100, NULL);
+    clip_index_commit(&idx, again, 2);
+    CHECK(clip_index_entry_count(&idx) == 2);
+    CHECK(idx.entries[clip_index_find(&idx, "next")].crc == 2);
+}
+
+static void test_lru(void) {
+    clip_index_t idx;
+    uint8_t *clip = malloc(CLIP_INDEX_BLOCK_SIZE);
+    CHECK(clip);
+    clip_index_init(&idx, BLOCKS);
+
+    // 填满索引项：48个单块片段
+    char key[16];
+    for (int i = 0; i < BLOCKS - 15; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        fill_clip(clip, 5000, i);
+        CHECK(store_clip(&idx, key, clip, 5000, NULL) >= 0);
+    }
+    CHECK(clip_index_entry_count(&idx) == BLOCKS - 15);
+
+    // 最早写入的k0被频繁命中，不能被淘汰
+    int hot = clip_index_find(&idx, "k0");
+    for (int round = 0; round < 200; round++) {
+        clip_index_touch(&idx, hot);
+        snprintf(key, sizeof(key), "n%d", round);
+        fill_clip(clip, CLIP_INDEX_BLOCK_SIZE, 1000 + round);
+        int evicted = 0;
+        CHECK(store_clip(&idx, key, clip, CLIP_INDEX_BLOCK_SIZE, &evicted) >= 0);
+        CHECK(clip_index_find(&idx, "k0") >= 0);
+        CHECK(clip_index_find(&idx, key) >= 0);
+        check_layout(&idx);
+    }
+    // 条目数上限同样触发淘汰
+    CHECK(clip_index_entry_count(&idx) <= CLIP_INDEX_MAX_ENTRIES);
+    free(clip);
+}
+
+static void test_soak(void) {
+    clip_index_t idx;
+    uint8_t *clip = malloc((size_t)MAX_CLIP_BLOCKS * CLIP_INDEX_BLOCK_SIZE);
+    size_t key_size[KEY_POOL] = {0};
+    uint32_t hits = 0, misses = 0, evictions = 0;
+    CHECK(clip);
+
+    memset(flash_index, 0xFF, sizeof(flash_index));
+    memset(block_erases, 0, sizeof(block_erases));
+    CHECK(!load_index(&idx));
+    clip_index_init(&idx, BLOCKS);
+    write_index(&idx);
+
+    for (int round = 0; round < STORE_ROUNDS; round++) {
+        // 少数提示音反复出现，多数只出现一两次
+        uint32_t r = rng_next();
+        uint32_t key_id = (r & 3) ? r % 12 : r % KEY_POOL;
+        char key[24];
+        snprintf(key, sizeof(key), "hash-%08x", key_id * 0x9E3779B9u);
+
+        int entry = clip_index_find(&idx, key);
+        if (entry >= 0) {
+            CHECK(load_clip_ok(&idx, entry));
+            CHECK(idx.entries[entry].size == key_size[key_id]);
+            clip_index_touch(&idx, entry);
+            hits++;
+        } else {
+            misses++;
+            if (key_size[key_id] == 0) {
+                key_size[key_id] = 1 + rng_next() % ((size_t)MAX_CLIP_BLOCKS * CLIP_INDEX_BLOCK_SIZE);
+            }
+            fill_clip(clip, key_size[key_id], key_id);
+            int evicted = 0;
+            CHECK(store_clip(&idx, key, clip, key_size[key_id], &evicted) >= 0);
+            evictions += evicted;
+        }
+
+        if (round % 1000 == 0) {
+            check_layout(&idx);
+
+            // 模拟掉电重启：写坏最新的一份索引，应回到上一份
+            clip_index_t reloaded;
+            CHECK(load_index(&reloaded));
+            CHECK(reloaded.seq == idx.seq);
+            uint8_t saved[sizeof(flash_index[0])];
+            memcpy(saved, flash_index[idx.seq % 2], sizeof(saved));
+            flash_index[idx.seq % 2][64] ^= 0x5A;
+            CHECK(load_index(&reloaded));
+            CHECK(reloaded.seq == idx.seq - 1);
+            memcpy(flash_index[idx.seq % 2], saved, sizeof(saved));
+        }
+    }
+    check_layout(&idx);
+
+    uint32_t min = UINT32_MAX, max = 0, total = 0;
+    for (int b = 0; b < BLOCKS; b++) {
+        CHECK(block_erases[b] == idx.erase_count[b]);
+        min = block_erases[b] < min ? block_erases[b] : min;
+        max = block_erases[b] > max ? block_erases[b] : max;
+        total += block_erases[b];
+    }
+    uint32_t avg = total / BLOCKS;
+    printf("soak: %u hits, %u misses, %u evictions; block erases min=%u avg=%u max=%u\n",
+           hits, misses, evictions, min, avg, max);
+    CHECK(hits > misses);
+    // 擦除分布均匀：最多的块不超过平均值的1.5倍
+    CHECK(max * 2 <= avg * 3);
+    free(clip);
+}
+
+int main(void) {
+    flash_data = malloc((size_t)BLOCKS * CLIP_INDEX_BLOCK_SIZE);
+    CHECK(flash_data);
+    memset(flash_data, 0xFF, (size_t)BLOCKS * CLIP_INDEX_BLOCK_SIZE);
+
+    test_crc();
+    test_index_integrity();
+    test_lru();
+    test_soak();
+
+    free(flash_data);
+    printf("clip_index: all tests passed\n");
+    return 0;
+}
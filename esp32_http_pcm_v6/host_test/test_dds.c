@@ -0,0 +1,215 @@
+/**
+ * dds主机端精度测试（blink_i2c/esp32_audio/esp32_http_mp3共用的dds.c）
+ * 以双精度sin为参考，验证：查表插值的正弦误差、固定频率音调的频率和幅度、
+ * 长时间运行相位累加无漂移、扫频终点、噪声峰值不超过设定幅度、多音调叠加饱和不回绕。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "test_check.h"
+#include "dds.h"
+
+#define RATE            48000
+#define TONE_SECONDS    10
+
+static int16_t *render_tone(float freq, float amplitude, size_t frames, dds_t *dds) {
+    int16_t *out = malloc(frames * sizeof(int16_t));
+    CHECK(out != NULL);
+    dds_init(dds, RATE);
+    CHECK(dds_add_tone(dds, freq, amplitude) == 0);
+    dds_render(dds, out, frames, 1);
+    return out;
+}
+
+/* 查表+线性插值与sin的最大误差（LSB） */
+static void test_sine_table(void) {
+    CHECK(dds_sine(0) == 0);
+    CHECK(dds_sine(0x40000000u) == 32767);
+    CHECK(dds_sine(0x80000000u) == 0);
+    CHECK(dds_sine(0xC0000000u) == -32767);
+
+    double max_err = 0;
+    for (uint64_t p = 0; p < (1ull << 32); p += 65537) {
+        double ref = 32767.0 * sin(2 * M_PI * (double)p / 4294967296.0);
+        double err = fabs(dds_sine((uint32_t)p) - ref);
+        if (err > max_err) {
+            max_err = err;
+        }
+        // 奇对称
+        CHECK(dds_sine((uint32_t)p) == -dds_sine((uint32_t)p + 0x80000000u));
+    }
+    printf("sine table: max error %.2f LSB (%.1f dBFS)\n", max_err, 20 * log10(max_err / 32768));
+    CHECK(max_err <= 2.0);
+}
+
+/* 插值过零点估计频率：首末上升过零之间的周期数 / 时间 */
+static double measure_freq(const int16_t *x, size_t n) {
+    double first = -1, last = -1;
+    long crossings = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (x[i - 1] < 0 && x[i] >= 0) {
+            double t = (double)(i - 1) + (double)-x[i - 1] / (x[i] - x[i - 1]);
+            if (first < 0) {
+                first = t;
+            } else {
+                crossings++;
+            }
+            last = t;
+        }
+    }
+    CHECK(crossings > 0);
+    return crossings * RATE / (last - first);
+}
+
+static void test_frequency(void) {
+    static const float freqs[] = { 20.0f, 440.0f, 1000.0f, 3150.7f, 12345.6f };
+    size_t frames = (size_t)RATE * TONE_SECONDS;
+    for (size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++) {
+        dds_t dds;
+        int16_t *x = render_tone(freqs[i], 0.5f, frames, &dds);
+        double f = measure_freq(x, frames);
+        double err = f - freqs[i];
+        printf("tone %8.1f Hz: measured %.4f Hz (%+.4f)\n", freqs[i], f, err);
+        // 频率分辨率RATE/2^32约1e-5 Hz，误差主要来自float参数和过零插值
+        CHECK(fabs(err) < 0.01);
+        free(x);
+    }
+}
+
+/* 幅度：RMS与设定值一致，残差（相对理想正弦）低于-80 dBFS */
+static void test_amplitude(void) {
+    static const float amps[] = { 1.0f, 0.5f, 0.1f, 0.01f };
+    size_t frames = RATE;
+    for (size_t i = 0; i < sizeof(amps) / sizeof(amps[0]); i++) {
+        dds_t dds;
+        int16_t *x = render_tone(1000.0f, amps[i], frames, &dds);
+        uint32_t step = dds.tones[0].step;
+        int32_t amp_q15 = dds.tones[0].amplitude;
+
+        double sum_sq = 0, err_sq = 0;
+        int peak = 0;
+        for (size_t k = 0; k < frames; k++) {
+            uint32_t phase = (uint32_t)(step * (uint32_t)k);
+            double ideal = 32767.0 * amp_q15 / 32768.0 * sin(2 * M_PI * (double)phase / 4294967296.0);
+            sum_sq += (double)x[k] * x[k];
+            err_sq += (x[k] - ideal) * (x[k] - ideal);
+            if (abs(x[k]) > peak) {
+                peak = abs(x[k]);
+            }
+        }
+        // 电平与量化后的Q15幅度比较（amplitude*32768截断到整数）
+        double rms_db = 20 * log10(sqrt(sum_sq / frames) * sqrt(2.0) / (32767.0 * amp_q15 / 32768.0));
+        double residual_dbfs = 10 * log10(err_sq / frames / (32768.0 * 32768.0));
+        printf("amplitude %.2f: peak %d, level error %+.4f dB, residual %.1f dBFS\n",
+               amps[i], peak, rms_db, residual_dbfs);
+        CHECK(peak <= (int)(amps[i] * 32768.0f));
+        CHECK(fabs(rms_db) < 0.01);
+        CHECK(residual_dbfs < -80);
+        free(x);
+    }
+}
+
+/* 相位累加是整数运算：任意长度后相位都等于step*N（模2^32），分块渲染与一次渲染结果相同 */
+static void test_phase_exact(void) {
+    static int16_t a[4096], b[4096];
+    dds_t one, blocks;
+    dds_init(&one, RATE);
+    dds_init(&blocks, RATE);
+    dds_add_tone(&one, 997.0f, 0.7f);
+    dds_add_tone(&blocks, 997.0f, 0.7f);
+
+    const uint32_t total = 1u << 24;   // 约350秒
+    for (uint32_t done = 0; done < total; done += sizeof(a) / sizeof(a[0])) {
+        dds_render(&one, a, sizeof(a) / sizeof(a[0]), 1);
+        for (size_t off = 0; off < sizeof(b) / sizeof(b[0]); off += 1000) {
+            size_t n = sizeof(b) / sizeof(b[0]) - off < 1000 ? sizeof(b) / sizeof(b[0]) - off : 1000;
+            dds_render(&blocks, b + off, n, 1);
+        }
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+    }
+    CHECK(one.tones[0].phase == (uint32_t)(one.tones[0].step * total));
+}
+
+/* 单次扫频停在终点频率，重复扫频回到起点 */
+static void test_chirp(void) {
+    static int16_t buf[RATE / 10];
+    dds_t dds;
+    dds_init(&dds, RATE);
+    dds_add_chirp(&dds, 100.0f, 10000.0f, 0.5f, 0.5f, false);
+    dds_add_chirp(&dds, 100.0f, 10000.0f, 0.5f, 0.5f, true);
+    for (int i = 0; i < 6; i++) {
+        dds_render(&dds, buf, sizeof(buf) / sizeof(buf[0]), 1);
+    }
+    double end_hz = (double)dds.tones[0].step * RATE / 4294967296.0;
+    printf("chirp: one-shot ends at %.2f Hz, repeating at %.2f Hz after 0.6 s\n", end_hz,
+           (double)dds.tones[1].step * RATE / 4294967296.0);
+    CHECK(dds.tones[0].sweep_samples == 0);
+    CHECK(fabs(end_hz - 10000.0) < 1.0);
+    CHECK(dds.tones[1].sweep_pos == RATE / 10);
+    CHECK(dds.tones[1].step == dds.tones[1].step_start + (uint32_t)(dds.tones[1].step_delta * (RATE / 10)));
+}
+
+/* 噪声：白噪声均值接近0、峰值不超过幅度；粉红噪声峰值不超过幅度的0.8倍 */
+static void test_noise(void) {
+    static int16_t buf[RATE];
+    const float amplitude = 0.5f;
+    const dds_noise_t kinds[] = { DDS_NOISE_WHITE, DDS_NOISE_PINK };
+    for (size_t k = 0; k < 2; k++) {
+        dds_t dds;
+        dds_init(&dds, RATE);
+        dds_set_noise(&dds, kinds[k], amplitude, 0);
+        int peak = 0;
+        double sum = 0;
+        for (int s = 0; s < 10; s++) {
+            dds_render(&dds, buf, RATE, 1);
+            for (size_t i = 0; i < RATE; i++) {
+                sum += buf[i];
+                if (abs(buf[i]) > peak) {
+                    peak = abs(buf[i]);
+                }
+            }
+        }
+        double limit = amplitude * 32768.0 * (kinds[k] == DDS_NOISE_PINK ? 0.8 : 1.0);
+        printf("%s noise: peak %d (limit %.0f), mean %.1f\n", kinds[k] == DDS_NOISE_PINK ? "pink" : "white",
+               peak, limit, sum / (10.0 * RATE));
+        CHECK(peak <= limit);
+        CHECK(fabs(sum / (10.0 * RATE)) < 100);
+    }
+}
+
+/* 满幅多音调叠加饱和到16位，不回绕；立体声两个声道相同 */
+static void test_saturation(void) {
+    static int16_t buf[2 * RATE / 10];
+    dds_t dds;
+    dds_init(&dds, RATE);
+    for (int i = 0; i < DDS_MAX_TONES; i++) {
+        CHECK(dds_add_tone(&dds, 1000.0f, 1.0f) == i);
+    }
+    CHECK(dds_add_tone(&dds, 1000.0f, 1.0f) == -1);
+    dds_render(&dds, buf, RATE / 10, 2);
+
+    int clipped = 0;
+    for (size_t i = 0; i < RATE / 10; i++) {
+        CHECK(buf[2 * i] == buf[2 * i + 1]);
+        int16_t expected_sign = (int16_t)dds_sine((uint32_t)(dds.tones[0].step * (uint32_t)i));
+        // 四个同相音调：符号与单音调一致，越过满量程的部分饱和
+        CHECK((int32_t)buf[2 * i] * expected_sign >= 0);
+        clipped += buf[2 * i] == 32767 || buf[2 * i] == -32768;
+    }
+    CHECK(clipped > 0);
+}
+
+int main(void) {
+    test_sine_table();
+    test_frequency();
+    test_amplitude();
+    test_phase_exact();
+    test_chirp();
+    test_noise();
+    test_saturation();
+    printf("dds: all tests passed\n");
+    return 0;
+}
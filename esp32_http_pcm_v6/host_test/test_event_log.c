@@ -0,0 +1,237 @@
+/**
+ * event_log主机端测试
+ * 验证：环形覆盖后按从旧到新的两段导出、暂停期间丢弃并计数、
+ * 多个线程（模拟中断、调度器钩子和各任务）同时写入时，暂停后导出的记录完整且不丢不重。
+ * 带路径参数运行时另外写出一个覆盖所有事件类型的样例导出，供event_trace_to_chrome.py的测试使用。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+#include "test_check.h"
+#include "event_log.h"
+
+#define CAPACITY            1024
+#define WRITER_THREADS      4
+#define EVENTS_PER_THREAD   200000
+#define BIG_CAPACITY        (1u << 20)      // 大于总写入数，并发测试中不会整圈覆盖（见event_log.h）
+#define CHECK_XOR           0x5A5AA5A5u
+
+static event_record_t records[CAPACITY];
+static event_record_t big_records[BIG_CAPACITY];
+
+static void test_init(void) {
+    event_log_t log;
+    CHECK(!event_log_init(&log, records, 1000));
+    CHECK(!event_log_init(&log, NULL, CAPACITY));
+    CHECK(event_log_init(&log, records, CAPACITY));
+}
+
+/* 按导出顺序取第i条记录 */
+static const event_record_t *nth(const event_record_t *first, uint32_t first_count,
+                                 const event_record_t *second, uint32_t i) {
+    return i < first_count ? &first[i] : &second[i - first_count];
+}
+
+static void test_spans_and_wrap(void) {
+    event_log_t log;
+    const event_record_t *first, *second;
+    uint32_t first_count, second_count;
+    event_log_header_t header;
+
+    CHECK(event_log_init(&log, records, CAPACITY));
+    CHECK(event_log_spans(&log, &first, &first_count, &second, &second_count) == 0);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        event_log_write(&log, 100 + i, EVENT_MARK, 0, 0, i, 0);
+    }
+    CHECK(event_log_spans(&log, &first, &first_count, &second, &second_count) == 10);
+    CHECK(first_count == 10 && second_count == 0 && first == records);
+
+    // 写满后再多写5条，最旧的5条被覆盖
+    for (uint32_t i = 10; i < CAPACITY + 5; i++) {
+        event_log_write(&log, 100 + i, EVENT_MARK, 1, 0, i, 0);
+    }
+    uint32_t count = event_log_spans(&log, &first, &first_count, &second, &second_count);
+    CHECK(count == CAPACITY);
+    CHECK(first_count == CAPACITY - 5 && second_count == 5);
+    for (uint32_t i = 0; i < count; i++) {
+        CHECK(nth(first, first_count, second, i)->a == i + 5);
+    }
+
+    event_log_build_header(&log, 3, &header);
+    CHECK(header.magic == EVENT_LOG_MAGIC);
+    CHECK(header.record_size == sizeof(event_record_t) && sizeof(event_record_t) == 16);
+    CHECK(header.task_count == 3);
+    CHECK(header.record_count == CAPACITY);
+    CHECK(header.first_index == 5);
+    CHECK(header.capacity == CAPACITY);
+}
+
+static void test_pause(void) {
+    event_log_t log;
+    const event_record_t *first, *second;
+    uint32_t first_count, second_count;
+    event_log_header_t header;
+
+    CHECK(event_log_init(&log, records, CAPACITY));
+    event_log_write(&log, 1, EVENT_I2S_SENT, 0, 0, 4096, 0);
+    event_log_pause(&log);
+    CHECK(event_log_quiescent(&log));
+    event_log_write(&log, 2, EVENT_I2S_SENT, 0, 0, 4096, 0);
+    event_log_write(&log, 3, EVENT_I2S_SENT, 0, 0, 4096, 0);
+    CHECK(event_log_spans(&log, &first, &first_count, &second, &second_count) == 1);
+    event_log_build_header(&log, 0, &header);
+    CHECK(header.dropped == 2);
+
+    // 清空后重新计数，丢弃数保留到下一次导出
+    event_log_resume(&log, true);
+    event_log_write(&log, 4, EVENT_I2S_SENT, 0, 0, 4096, 0);
+    CHECK(event_log_spans(&log, &first, &first_count, &second, &second_count) == 1);
+    CHECK(first->time_us == 4);
+    event_log_build_header(&log, 0, &header);
+    CHECK(header.dropped == 2);
+
+    // 不清空时记录保留
+    event_log_pause(&log);
+    event_log_resume(&log, false);
+    CHECK(event_log_spans(&log, &first, &first_count, &second, &second_count) == 1);
+}
+
+typedef struct {
+    event_log_t *log;
+    uint8_t core;
+} writer_arg_t;
+
+static void *writer(void *arg) {
+    writer_arg_t *w = arg;
+    for (uint32_t i = 0; i < EVENTS_PER_THREAD; i++) {
+        uint32_t a = ((uint32_t)w->core << 24) | i;
+        event_log_write(w->log, i, EVENT_HTTP, w->core, (uint16_t)(i & 0xFFFF), a, a ^ CHECK_XOR);
+    }
+    return NULL;
+}
+
+/* 暂停、核对所有记录完整后清空，返回本次导出覆盖的写入数 */
+static uint64_t dump_and_check(event_log_t *log) {
+    const event_record_t *first, *second;
+    uint32_t first_count, second_count;
+    event_log_header_t header;
+
+    event_log_pause(log);
+    while (!event_log_quiescent(log)) {
+        sched_yield();
+    }
+    uint32_t count = event_log_spans(log, &first, &first_count, &second, &second_count);
+    event_log_build_header(log, 0, &header);
+    CHECK(header.record_count == count);
+    for (uint32_t i = 0; i < count; i++) {
+        const event_record_t *r = nth(first, first_count, second, i);
+        CHECK(r->type == EVENT_HTTP);
+        CHECK(r->b == (r->a ^ CHECK_XOR));
+        CHECK(r->core == (r->a >> 24) && r->core < WRITER_THREADS);
+        CHECK(r->aux == (r->a & 0xFFFF) && r->time_us == (r->a & 0xFFFFFF));
+    }
+    event_log_resume(log, true);
+    return (uint64_t)header.first_index + header.record_count;
+}
+
+static void test_concurrent_writers(void) {
+    static event_log_t log;
+    pthread_t threads[WRITER_THREADS];
+    writer_arg_t args[WRITER_THREADS];
+    uint64_t written = 0;
+    int dumps = 0;
+
+    CHECK(event_log_init(&log, big_records, BIG_CAPACITY));
+    for (int i = 0; i < WRITER_THREADS; i++) {
+        args[i].log = &log;
+        args[i].core = (uint8_t)i;
+        CHECK(pthread_create(&threads[i], NULL, writer, &args[i]) == 0);
+    }
+    for (int i = 0; i < 200; i++) {
+        written += dump_and_check(&log);
+        dumps++;
+        sched_yield();
+    }
+    for (int i = 0; i < WRITER_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    written += dump_and_check(&log);
+
+    // 每次写入要么写进日志（之后被导出或覆盖），要么在暂停期间被丢弃
+    event_log_header_t header;
+    event_log_build_header(&log, 0, &header);
+    CHECK(written + header.dropped == (uint64_t)WRITER_THREADS * EVENTS_PER_THREAD);
+    printf("concurrent: %d dumps, %llu written, %u dropped while paused\n",
+           dumps + 1, (unsigned long long)written, (unsigned)header.dropped);
+}
+
+/* 样例导出：两个核心的任务切换、I2S、HTTP、分配和追踪点，时间戳跨越32位回绕 */
+static void write_sample(const char *path) {
+    static const event_log_task_t tasks[] = {
+        { 0x3FC90000, "audio_playback" },
+        { 0x3FC91000, "tts_polling" },
+        { 0x3FC92000, "IDLE0" },
+        { 0x3FC93000, "IDLE1" },
+    };
+    event_log_t log;
+    uint32_t t = 0xFFFFF000u;
+
+    CHECK(event_log_init(&log, records, CAPACITY));
+    event_log_write(&log, t, EVENT_TASK_SWITCH, 0, 0, tasks[2].handle, 0);
+    event_log_write(&log, t, EVENT_TASK_SWITCH, 1, 0, tasks[3].handle, 0);
+    for (int turn = 1; turn <= 3; turn++) {
+        event_log_write(&log, t += 100, EVENT_TASK_SWITCH, 1, 0, tasks[1].handle, 0);
+        event_log_write(&log, t += 10, EVENT_MARK, 1, 4, turn, 0);
+        event_log_write(&log, t += 50, EVENT_HTTP, 1, 1, 0, 0x3FCA0000);
+        event_log_write(&log, t += 10, EVENT_ALLOC, 1, EVENT_ALLOC_SPIRAM, 0x3D800000 + turn * 0x10000, 65536);
+        event_log_write(&log, t += 5, EVENT_ALLOC, 1, EVENT_ALLOC_INTERNAL, 0x3FCB0000, 512);
+        event_log_write(&log, t += 800, EVENT_HTTP_READ, 1, 0, 8192, 750);
+        event_log_write(&log, t += 5, EVENT_FREE, 1, 0, 0x3FCB0000, 0);
+        event_log_write(&log, t += 20, EVENT_TASK_SWITCH, 1, 0, tasks[3].handle, 0);
+        event_log_write(&log, t += 100, EVENT_TASK_SWITCH, 0, 0, tasks[0].handle, 0);
+        event_log_write(&log, t += 10, EVENT_MARK, 0, 9, turn, 4096);
+        for (int i = 0; i < 4; i++) {
+            event_log_write(&log, t += 2000, EVENT_I2S_SENT, 0, 0, 2048, 0);
+        }
+        event_log_write(&log, t += 500, EVENT_I2S_UNDERFLOW, 0, 0, 2048, 0);
+        event_log_write(&log, t += 10, EVENT_FREE, 0, 0, 0x3D800000 + turn * 0x10000, 0);
+        event_log_write(&log, t += 10, EVENT_FREE, 0, 0, 0x3D000000, 0);    // 窗口开始前的分配
+        event_log_write(&log, t += 10, EVENT_TASK_SWITCH, 0, 0, tasks[2].handle, 0);
+    }
+    CHECK(t < 0x10000);
+
+    const event_record_t *first, *second;
+    uint32_t first_count, second_count;
+    event_log_header_t header;
+    uint32_t task_count = sizeof(tasks) / sizeof(tasks[0]);
+    event_log_pause(&log);
+    event_log_spans(&log, &first, &first_count, &second, &second_count);
+    event_log_build_header(&log, task_count, &header);
+
+    FILE *f = fopen(path, "wb");
+    CHECK(f != NULL);
+    CHECK(fwrite(&header, sizeof(header), 1, f) == 1);
+    CHECK(fwrite(tasks, sizeof(tasks[0]), task_count, f) == task_count);
+    CHECK(fwrite(first, sizeof(event_record_t), first_count, f) == first_count);
+    CHECK(fwrite(second, sizeof(event_record_t), second_count, f) == second_count);
+    CHECK(fclose(f) == 0);
+    printf("sample trace: %u records written to %s\n", (unsigned)header.record_count, path);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        write_sample(argv[1]);
+        return 0;
+    }
+    test_init();
+    test_spans_and_wrap();
+    test_pause();
+    test_concurrent_writers();
+    printf("event_log: all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,319 @@
+/**
+ * json_stream主机端测试和模糊测试
+ * 验证：轮询/STT响应的字段提取、转义和UTF-8、截断、非法输入报错，
+ * 任意切分喂入与一次性喂入结果完全一致，
+ * 随机变异和随机字节输入下不越界（缓冲区后放哨兵字节）。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "test_check.h"
+#include "json_stream.h"
+
+#define FUZZ_ITERATIONS  200000
+#define GUARD_BYTE       0xA5
+#define MAX_OBJECTS      16
+
+static uint32_t rng_state = 0x2468ACE1;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* 一次解析的全部输出，用于比较不同切分方式 */
+typedef struct {
+    char audio_id[16 + 1];          // 最后一个字节是哨兵
+    char text[48 + 1];
+    char filename[24 + 1];
+    int64_t size;
+    json_field_t fields[4];
+    json_stream_status_t status;
+    int object_ends;
+    char objects[MAX_OBJECTS][16];  // 每个带audio_id的对象结束时记录
+} result_t;
+
+static void on_object_end(void *ctx, int depth) {
+    result_t *r = (result_t *)ctx;
+    r->object_ends++;
+    if (r->fields[0].found && r->fields[0].depth == depth) {
+        int n = r->object_ends - 1;
+        if (n < MAX_OBJECTS) {
+            memcpy(r->objects[n], r->audio_id, sizeof(r->objects[n]));
+        }
+        json_stream_reset_fields(r->fields, 4);
+    }
+}
+
+static void result_init(result_t *r, json_stream_t *js) {
+    memset(r, 0, sizeof(*r));
+    r->audio_id[sizeof(r->audio_id) - 1] = (char)GUARD_BYTE;
+    r->text[sizeof(r->text) - 1] = (char)GUARD_BYTE;
+    r->filename[sizeof(r->filename) - 1] = (char)GUARD_BYTE;
+    r->fields[0] = (json_field_t){ .key = "audio_id", .type = JSON_FIELD_STRING, .dest = r->audio_id, .dest_size = sizeof(r->audio_id) - 1 };
+    r->fields[1] = (json_field_t){ .key = "text", .type = JSON_FIELD_STRING, .dest = r->text, .dest_size = sizeof(r->text) - 1 };
+    r->fields[2] = (json_field_t){ .key = "filename", .type = JSON_FIELD_STRING, .dest = r->filename, .dest_size = sizeof(r->filename) - 1 };
+    r->fields[3] = (json_field_t){ .key = "size", .type = JSON_FIELD_INT, .dest = &r->size, .dest_size = sizeof(r->size) };
+    json_stream_init(js, r->fields, 4, on_object_end, r);
+}
+
+static void result_check_bounds(const result_t *r) {
+    CHECK((uint8_t)r->audio_id[sizeof(r->audio_id) - 1] == GUARD_BYTE);
+    CHECK((uint8_t)r->text[sizeof(r->text) - 1] == GUARD_BYTE);
+    CHECK((uint8_t)r->filename[sizeof(r->filename) - 1] == GUARD_BYTE);
+    CHECK(memchr(r->audio_id, '\0', sizeof(r->audio_id) - 1) != NULL);
+    CHECK(memchr(r->text, '\0', sizeof(r->text) - 1) != NULL);
+    CHECK(memchr(r->filename, '\0', sizeof(r->filename) - 1) != NULL);
+}
+
+/* 按chunks[]给出的长度依次喂入，chunks为NULL时随机切分 */
+static void parse(result_t *r, const char *data, size_t len, const size_t *chunks, size_t chunk_count) {
+    json_stream_t js;
+    result_init(r, &js);
+
+    size_t pos = 0;
+    for (size_t i = 0; pos < len; i++) {
+        size_t n;
+        if (chunks) {
+            n = i < chunk_count ? chunks[i] : len - pos;
+        } else {
+            n = 1 + rng_next() % 17;
+        }
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        json_stream_feed(&js, data + pos, n);
+        CHECK(js.depth <= JSON_STREAM_MAX_DEPTH);
+        pos += n;
+    }
+    r->status = json_stream_finish(&js);
+    result_check_bounds(r);
+}
+
+static void parse_whole(result_t *r, const char *data) {
+    size_t len = strlen(data);
+    parse(r, data, len, &len, 1);
+}
+
+static void result_compare(const result_t *a, const result_t *b) {
+    CHECK(a->status == b->status);
+    CHECK(a->object_ends == b->object_ends);
+    CHECK(strcmp(a->audio_id, b->audio_id) == 0);
+    CHECK(strcmp(a->text, b->text) == 0);
+    CHECK(strcmp(a->filename, b->filename) == 0);
+    CHECK(a->size == b->size);
+    for (int i = 0; i < 4; i++) {
+        CHECK(a->fields[i].found == b->fields[i].found);
+        CHECK(a->fields[i].truncated == b->fields[i].truncated);
+    }
+    CHECK(memcmp(a->objects, b->objects, sizeof(a->objects)) == 0);
+}
+
+/* 合法输入样本，也是模糊测试的种子 */
+static const char *corpus[] = {
+    "{\"audio_id\":\"job_0001\",\"url\":\"/audio/job_0001.pcm\",\"format\":\"pcm_s16le_16k\",\"size\":96000}",
+    "{\"jobs\":[{\"audio_id\":\"a1\",\"size\":10},{\"size\":20,\"audio_id\":\"a2\"},{\"audio_id\":\"a3\"}]}",
+    "{ \"status\" : \"ok\" ,\n\t\"text\" : \"hello \\\"world\\\"\\n\" , \"device_id\":\"ESP32_VOICE_01\" }",
+    "{\"text\":\"\\u4f60\\u597d \\ud83d\\ude00\",\"filename\":\"tts_1.mp3\"}",
+    "{\"meta\":{\"audio_id\":\"inner\",\"list\":[1,2.5,-3e+2,true,false,null,{}]},\"audio_id\":\"outer\"}",
+    "{\"filename\":\"a\\/b\\\\c\\b\\f\\r\\t\",\"size\":-0.5e-3}",
+    "[{\"audio_id\":\"x\"},[],[[]],\"s\",0]",
+    "{\"text\":\"This transcript is much longer than the destination buffer on purpose\"}",
+    "{\"a_key_that_is_definitely_longer_than_thirty_two_bytes\":\"v\",\"size\":123456789012345678901234}",
+    "\"top level string\"",
+    "  42  ",
+};
+
+static void test_fields(void) {
+    result_t r;
+
+    parse_whole(&r, corpus[0]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(r.object_ends == 1);
+    CHECK(strcmp(r.objects[0], "job_0001") == 0);
+
+    // 批量格式，字段顺序不同
+    parse_whole(&r, corpus[1]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(strcmp(r.objects[0], "a1") == 0);
+    CHECK(strcmp(r.objects[1], "a2") == 0);
+    CHECK(strcmp(r.objects[2], "a3") == 0);
+    CHECK(r.object_ends == 4);
+
+    parse_whole(&r, corpus[2]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(strcmp(r.text, "hello \"world\"\n") == 0);
+
+    // \u转义和代理对转成UTF-8
+    parse_whole(&r, corpus[3]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(strcmp(r.text, "\xe4\xbd\xa0\xe5\xa5\xbd \xf0\x9f\x98\x80") == 0);
+    CHECK(strcmp(r.filename, "tts_1.mp3") == 0);
+
+    // 嵌套对象里的audio_id属于内层对象
+    parse_whole(&r, corpus[4]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(strcmp(r.objects[1], "inner") == 0);
+    CHECK(strcmp(r.objects[2], "outer") == 0);
+
+    parse_whole(&r, corpus[5]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(strcmp(r.filename, "a/b\\c\b\f\r\t") == 0);
+    CHECK(r.fields[3].found && r.size == 0);
+
+    // 超长值截断但仍以'\0'结尾
+    parse_whole(&r, corpus[7]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(r.fields[1].found && r.fields[1].truncated);
+    CHECK(strlen(r.text) == sizeof(r.text) - 2);
+    CHECK(strncmp(r.text, "This transcript", 15) == 0);
+
+    // 超长键不匹配，超大整数不溢出
+    parse_whole(&r, corpus[8]);
+    CHECK(r.status == JSON_STREAM_DONE);
+    CHECK(r.fields[3].found && r.size > 0);
+
+    parse_whole(&r, corpus[10]);
+    CHECK(r.status == JSON_STREAM_DONE);
+
+    printf("fields: ok\n");
+}
+
+static void test_invalid(void) {
+    static const char *invalid[] = {
+        "",
+        "{",
+        "{\"audio_id\":\"abc\"",
+        "{\"audio_id\" \"abc\"}",
+        "{\"audio_id\":abc}",
+        "{\"a\":1,}",
+        "[1,2,]",
+        "{\"a\":01}",
+        "{\"a\":1.}",
+        "{\"a\":-}",
+        "{\"a\":1e}",
+        "{\"a\":tru}",
+        "{\"a\":\"\\x\"}",
+        "{\"a\":\"\\u12G4\"}",
+        "{\"a\":\"line\nbreak\"}",
+        "{\"a\":[}",
+        "{\"a\":{]}",
+        "{} {}",
+        "{\"a\":1}}",
+        "[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]",
+    };
+    result_t r;
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        parse_whole(&r, invalid[i]);
+        if (r.status != JSON_STREAM_ERROR) {
+            fprintf(stderr, "accepted invalid input: %s\n", invalid[i]);
+        }
+        CHECK(r.status == JSON_STREAM_ERROR);
+    }
+
+    // 出错前已完整的字段仍然可用
+    parse_whole(&r, "{\"audio_id\":\"ok_1\",\"size\":12,\"url\":");
+    CHECK(r.status == JSON_STREAM_ERROR);
+    CHECK(r.fields[0].found && strcmp(r.audio_id, "ok_1") == 0);
+    CHECK(r.fields[3].found && r.size == 12);
+
+    printf("invalid: %zu inputs rejected\n", sizeof(invalid) / sizeof(invalid[0]));
+}
+
+/* 每个样本在所有两段切分点和逐字节喂入下结果一致 */
+static void test_splits(void) {
+    size_t splits = 0;
+
+    for (size_t c = 0; c < sizeof(corpus) / sizeof(corpus[0]); c++) {
+        const char *doc = corpus[c];
+        size_t len = strlen(doc);
+        result_t whole, part;
+        parse_whole(&whole, doc);
+        CHECK(whole.status == JSON_STREAM_DONE);
+
+        for (size_t cut = 0; cut <= len; cut++) {
+            size_t chunks[2] = { cut, len - cut };
+            parse(&part, doc, len, chunks, 2);
+            result_compare(&whole, &part);
+            splits++;
+        }
+
+        size_t ones[256];
+        for (size_t i = 0; i < len && i < 256; i++) {
+            ones[i] = 1;
+        }
+        parse(&part, doc, len, ones, len < 256 ? len : 256);
+        result_compare(&whole, &part);
+    }
+
+    printf("splits: %zu split points identical\n", splits);
+}
+
+/* 随机变异样本和纯随机字节，随机切分与一次性结果一致且不越界 */
+static void test_fuzz(void) {
+    static const char alphabet[] = "{}[]:,\"\\ u0123456789eE+-.tfnrlsa_idx";
+    char buf[512];
+    size_t accepted = 0;
+
+    for (int iter = 0; iter < FUZZ_ITERATIONS; iter++) {
+        size_t len;
+        if (iter % 8 == 0) {
+            // 纯随机输入，偏向JSON字符
+            len = rng_next() % 128;
+            for (size_t i = 0; i < len; i++) {
+                buf[i] = (rng_next() & 3) ? alphabet[rng_next() % (sizeof(alphabet) - 1)] : (char)rng_next();
+            }
+        } else {
+            const char *seed = corpus[rng_next() % (sizeof(corpus) / sizeof(corpus[0]))];
+            len = strlen(seed);
+            memcpy(buf, seed, len);
+            int mutations = 1 + rng_next() % 4;
+            for (int m = 0; m < mutations && len > 0; m++) {
+                size_t pos = rng_next() % len;
+                switch (rng_next() % 4) {
+                case 0:     // 替换
+                    buf[pos] = (rng_next() & 1) ? alphabet[rng_next() % (sizeof(alphabet) - 1)] : (char)rng_next();
+                    break;
+                case 1:     // 删除
+                    memmove(buf + pos, buf + pos + 1, len - pos - 1);
+                    len--;
+                    break;
+                case 2:     // 插入
+                    if (len < sizeof(buf) - 1) {
+                        memmove(buf + pos + 1, buf + pos, len - pos);
+                        buf[pos] = alphabet[rng_next() % (sizeof(alphabet) - 1)];
+                        len++;
+                    }
+                    break;
+                default:    // 截断
+                    len = pos;
+                    break;
+                }
+            }
+        }
+
+        result_t whole, part;
+        parse(&whole, buf, len, &len, 1);
+        parse(&part, buf, len, NULL, 0);
+        result_compare(&whole, &part);
+        if (whole.status == JSON_STREAM_DONE) {
+            accepted++;
+        }
+    }
+
+    printf("fuzz: %d inputs, %zu still valid JSON, no overruns\n", FUZZ_ITERATIONS, accepted);
+}
+
+int main(void) {
+    test_fields();
+    test_invalid();
+    test_splits();
+    test_fuzz();
+    printf("All json_stream tests passed\n");
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * latency_trace主机端测试
+ * 验证：回合汇总和阶段耗时正确、环形缓冲区覆盖后只返回仍然有效的事件、
+ * 多个线程同时打点（模拟轮询/下载/播放/录音任务）时不丢事件也不读到撕裂的事件。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "test_check.h"
+#include "latency_trace.h"
+
+#define WRITER_THREADS      4
+#define EVENTS_PER_THREAD   200000
+
+static int64_t fake_now_us = 0;
+
+static int64_t fake_clock(void) {
+    return fake_now_us;
+}
+
+static void test_turn_summary(void) {
+    latency_trace_init(fake_clock);
+
+    uint16_t turn = latency_trace_begin_turn();
+    CHECK(turn != LATENCY_TRACE_TURN_NONE);
+    uint16_t other = latency_trace_begin_turn();
+    CHECK(other != turn);
+
+    // 轮询发出时尚不知道是否有任务，取到任务后补记
+    latency_trace_mark_at(turn, LATENCY_POLL_SENT, 0, 1000);
+    fake_now_us = 36000;
+    latency_trace_mark(turn, LATENCY_POLL_PARSED, 0);
+    latency_trace_mark(other, LATENCY_POLL_PARSED, 0);
+    fake_now_us = 37000;
+    latency_trace_mark(turn, LATENCY_DL_CONNECT, 0);
+    fake_now_us = 117000;
+    latency_trace_mark(turn, LATENCY_DL_FIRST_BYTE, 0);
+    fake_now_us = 237000;
+    latency_trace_mark(turn, LATENCY_WATERMARK, 131072);
+    fake_now_us = 241000;
+    latency_trace_mark(turn, LATENCY_FIRST_I2S, 4096);
+    latency_trace_mark(turn, LATENCY_FIRST_I2S, 8192);     // 只取第一次
+    fake_now_us = 3241000;
+    latency_trace_mark(turn, LATENCY_LAST_SAMPLE, 0);
+    latency_trace_mark(LATENCY_TRACE_TURN_NONE, LATENCY_LAST_SAMPLE, 0);
+
+    latency_turn_t t;
+    CHECK(latency_trace_summarize(turn, &t));
+    CHECK(t.mask == ((1u << LATENCY_POLL_SENT) | (1u << LATENCY_POLL_PARSED) | (1u << LATENCY_DL_CONNECT) |
+                     (1u << LATENCY_DL_FIRST_BYTE) | (1u << LATENCY_WATERMARK) | (1u << LATENCY_FIRST_I2S) |
+                     (1u << LATENCY_LAST_SAMPLE)));
+    CHECK(t.stamp_us[LATENCY_POLL_SENT] == 1000);
+    CHECK(t.arg[LATENCY_WATERMARK] == 131072);
+    CHECK(t.arg[LATENCY_FIRST_I2S] == 4096);
+
+    char line[256];
+    int n = latency_trace_format(&t, line, sizeof(line));
+    CHECK(n > 0 && (size_t)n == strlen(line));
+    CHECK(strstr(line, "first_byte +80.0") != NULL);
+    CHECK(strstr(line, "first sample 240.0 ms") != NULL);
+    CHECK(strstr(line, "total 3240.0 ms") != NULL);
+    CHECK(strstr(line, "speech end") == NULL);
+
+    // 截断的缓冲区仍以0结尾
+    char small[16];
+    n = latency_trace_format(&t, small, sizeof(small));
+    CHECK(n == (int)strlen(small) && n < (int)sizeof(small));
+
+    latency_stage_stats_t stats[LATENCY_POINT_COUNT] = {0};
+    latency_trace_accumulate(&t, stats);
+    latency_trace_accumulate(&t, stats);
+    CHECK(stats[LATENCY_POLL_SENT].count == 0);
+    CHECK(stats[LATENCY_DL_FIRST_BYTE].count == 2);
+    CHECK(stats[LATENCY_DL_FIRST_BYTE].sum_us == 160000);
+    CHECK(stats[LATENCY_WATERMARK].max_us == 120000);
+
+    CHECK(!latency_trace_summarize(999, &t));
+    printf("turn summary: %s\n", line);
+}
+
+static void test_voice_turn(void) {
+    latency_trace_init(fake_clock);
+    uint16_t turn = latency_trace_begin_turn();
+
+    const latency_point_t points[] = {
+        LATENCY_VAD_START, LATENCY_VAD_STOP, LATENCY_UPLOAD_START, LATENCY_UPLOAD_RESPONSE,
+        LATENCY_POLL_PARSED, LATENCY_DL_CONNECT, LATENCY_DL_FIRST_BYTE, LATENCY_WATERMARK, LATENCY_FIRST_I2S,
+    };
+    const int64_t times[] = { 0, 2500000, 2500100, 3400000, 3500000, 3500200, 3560000, 3700000, 3702000 };
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++) {
+        latency_trace_mark_at(turn, points[i], 0, times[i]);
+    }
+
+    latency_turn_t t;
+    char line[512];
+    CHECK(latency_trace_summarize(turn, &t));
+    latency_trace_format(&t, line, sizeof(line));
+    CHECK(strstr(line, "first sample 3702.0 ms (1202.0 ms after speech end)") != NULL);
+    printf("voice turn: %s\n", line);
+}
+
+static void test_wraparound(void) {
+    latency_trace_init(fake_clock);
+    uint16_t old_turn = latency_trace_begin_turn();
+    latency_trace_mark_at(old_turn, LATENCY_POLL_SENT, 0, 1);
+
+    uint16_t turn = latency_trace_begin_turn();
+    for (int i = 0; i < LATENCY_TRACE_RING_SIZE * 3 + 5; i++) {
+        latency_trace_mark_at(turn, (latency_point_t)(i % LATENCY_POINT_COUNT), (uint32_t)i, i);
+    }
+    CHECK(!latency_trace_summarize(old_turn, &(latency_turn_t){0}));
+
+    static latency_event_t events[LATENCY_TRACE_RING_SIZE];
+    size_t count = latency_trace_snapshot(events, LATENCY_TRACE_RING_SIZE);
+    CHECK(count == LATENCY_TRACE_RING_SIZE);
+    for (size_t i = 1; i < count; i++) {
+        CHECK(events[i].arg == events[i - 1].arg + 1);
+    }
+    CHECK(events[count - 1].arg == LATENCY_TRACE_RING_SIZE * 3 + 4);
+    CHECK(latency_trace_event_count() == LATENCY_TRACE_RING_SIZE * 3 + 6);
+
+    // 回合编号跳过0
+    for (int i = 0; i < 70000; i++) {
+        CHECK(latency_trace_begin_turn() != LATENCY_TRACE_TURN_NONE);
+    }
+}
+
+/* 每个线程一个回合，事件的时间和附加值编码线程号和序号，读取方据此检查撕裂 */
+static void *writer_thread(void *arg) {
+    uint16_t turn = (uint16_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < EVENTS_PER_THREAD; i++) {
+        latency_trace_mark_at(turn, (latency_point_t)(i % LATENCY_POINT_COUNT), i, (int64_t)turn * 1000000000 + i);
+    }
+    return NULL;
+}
+
+static volatile int writers_done = 0;
+
+static void *reader_thread(void *arg) {
+    (void)arg;
+    static latency_event_t events[LATENCY_TRACE_RING_SIZE];
+    uint32_t snapshots = 0;
+
+    while (!writers_done) {
+        size_t count = latency_trace_snapshot(events, LATENCY_TRACE_RING_SIZE);
+        for (size_t i = 0; i < count; i++) {
+            const latency_event_t *ev = &events[i];
+            CHECK(ev->turn >= 1 && ev->turn <= WRITER_THREADS);
+            CHECK(ev->time_us == (int64_t)ev->turn * 1000000000 + ev->arg);
+            CHECK(ev->point == ev->arg % LATENCY_POINT_COUNT);
+        }
+        snapshots++;
+    }
+    printf("reader: %u consistent snapshots\n", snapshots);
+    return NULL;
+}
+
+static void test_concurrent_writers(void) {
+    latency_trace_init(fake_clock);
+    pthread_t writers[WRITER_THREADS];
+    pthread_t reader;
+
+    CHECK(pthread_create(&reader, NULL, reader_thread, NULL) == 0);
+    for (int i = 0; i < WRITER_THREADS; i++) {
+        uint16_t turn = latency_trace_begin_turn();
+        CHECK(pthread_create(&writers[i], NULL, writer_thread, (void *)(uintptr_t)turn) == 0);
+    }
+    for (int i = 0; i < WRITER_THREADS; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    writers_done = 1;
+    pthread_join(reader, NULL);
+
+    // 没有写入方领取到同一个槽位
+    CHECK(latency_trace_event_count() == WRITER_THREADS * EVENTS_PER_THREAD);
+    static latency_event_t events[LATENCY_TRACE_RING_SIZE];
+    CHECK(latency_trace_snapshot(events, LATENCY_TRACE_RING_SIZE) == LATENCY_TRACE_RING_SIZE);
+}
+
+static int listener_calls;
+static latency_point_t listener_point;
+
+static void count_listener(uint16_t turn, latency_point_t point, uint32_t arg) {
+    (void)turn;
+    (void)arg;
+    listener_calls++;
+    listener_point = point;
+}
+
+static void test_listener(void) {
+    latency_trace_init(fake_clock);
+    uint16_t turn = latency_trace_begin_turn();
+
+    latency_trace_set_listener(count_listener);
+    latency_trace_mark(turn, LATENCY_DL_CONNECT, 0);
+    latency_trace_mark(LATENCY_TRACE_TURN_NONE, LATENCY_WATERMARK, 0);   // 不追踪的不通知
+    CHECK(listener_calls == 1 && listener_point == LATENCY_DL_CONNECT);
+    latency_trace_set_listener(NULL);
+    latency_trace_mark(turn, LATENCY_WATERMARK, 0);
+    CHECK(listener_calls == 1);
+}
+
+int main(void) {
+    test_turn_summary();
+    test_listener();
+    test_voice_turn();
+    test_wraparound();
+    test_concurrent_writers();
+    printf("latency_trace: all tests passed\n");
+    return 0;
+}
@@ -6,6 +6,9 @@
 #include "driver/i2c.h"
 #include "driver/gpio.h"
 #include "es8311.h"
+#include "esp_heap_caps.h"
+#include "mem_track.h"
+#include "i2s_monitor.h"
 
 static const char *TAG = "AUDIO_HAL";
 
@@ -104,6 +107,8 @@ static esp_err_t i2s_init(void) {
     
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle, &std_cfg));
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle, &std_cfg));
+    // 回调必须在使能前注册
+    ESP_ERROR_CHECK(i2s_monitor_attach(tx_handle));
     ESP_ERROR_CHECK(i2s_channel_enable(tx_handle));
     ESP_ERROR_CHECK(i2s_channel_enable(rx_handle));
     
@@ -117,6 +122,9 @@ esp_err_t audio_hal_init(void) {
     ESP_ERROR_CHECK(i2c_master_init());
     ESP_LOGI(TAG, "I2C initialized");
 
+    // 编解码器句柄和I2S DMA缓冲区由驱动内部分配，按前后空闲差值记账
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
     // 初始化ES8311编解码器
     es8311_handle_t codec_handle;
     ESP_ERROR_CHECK(es8311_codec_init(&codec_handle));
@@ -124,6 +132,11 @@ esp_err_t audio_hal_init(void) {
     // 初始化I2S
     ESP_ERROR_CHECK(i2s_init());
 
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    if (free_before > free_after) {
+        mem_track_charge(MEM_TAG_CODEC, free_before - free_after);
+    }
+
     return ESP_OK;
 }
 
@@ -2,54 +2,133 @@
 #include <string.h>
 #include "esp_log.h"
 #include "audio_hal.h"
+#include "audio_stage.h"
+#include "i2s_monitor.h"
+#include "latency_trace.h"
 
 static const char *TAG = "AUDIO_PLAYER";
-static audio_state_t audio_state = {0};
+static audio_state_t s_slots[AUDIO_PLAYER_SLOTS];
+static uint32_t s_submit_seq = 0;
+static latency_stage_stats_t s_stage_stats[LATENCY_POINT_COUNT];
+static uint32_t s_traced_turns = 0;
+
+/* 打印本回合各阶段耗时，每LATENCY_SUMMARY_TURNS个回合打印一次各阶段平均/最大值 */
+static void log_turn_latency(uint16_t turn) {
+    static char line[320];
+    latency_turn_t t;
+    if (!latency_trace_summarize(turn, &t)) {
+        return;
+    }
+    latency_trace_format(&t, line, sizeof(line));
+    ESP_LOGI(TAG, "Latency %s", line);
+    
+    latency_trace_accumulate(&t, s_stage_stats);
+    if (++s_traced_turns % LATENCY_SUMMARY_TURNS != 0) {
+        return;
+    }
+    for (int p = 0; p < LATENCY_POINT_COUNT; p++) {
+        const latency_stage_stats_t *s = &s_stage_stats[p];
+        if (s->count > 0) {
+            ESP_LOGI(TAG, "  %-16s avg %6.1f ms  max %6.1f ms  (%u turns)", latency_point_name(p),
+                     s->sum_us / 1000.0 / s->count, s->max_us / 1000.0, (unsigned)s->count);
+        }
+    }
+}
 
 /* 初始化音频播放器 */
 void audio_player_init(void) {
-    memset(&audio_state, 0, sizeof(audio_state));
+    memset(s_slots, 0, sizeof(s_slots));
+    
+    // PSRAM -> 内部RAM中转缓冲区
+    ESP_ERROR_CHECK(audio_stage_init());
+    
     ESP_LOGI(TAG, "Audio player initialized");
 }
 
-/* 获取音频状态 */
-audio_state_t* audio_player_get_state(void) {
-    return &audio_state;
+audio_state_t* audio_player_get_slot(int index) {
+    return (index >= 0 && index < AUDIO_PLAYER_SLOTS) ? &s_slots[index] : NULL;
+}
+
+audio_state_t* audio_player_free_slot(void) {
+    for (int i = 0; i < AUDIO_PLAYER_SLOTS; i++) {
+        audio_state_t *state = &s_slots[i];
+        if (!state->has_audio && !state->is_playing && !state->finished) {
+            return state;
+        }
+    }
+    return NULL;
+}
+
+/* 只由下载端（轮询任务）调用，序号按提交顺序递增 */
+void audio_player_submit(audio_state_t *state) {
+    state->seq = ++s_submit_seq;
+    state->has_audio = true;
+}
+
+bool audio_player_busy(void) {
+    for (int i = 0; i < AUDIO_PLAYER_SLOTS; i++) {
+        if (s_slots[i].has_audio || s_slots[i].is_playing) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 下一个要播放的slot：已提交的片段中序号最小的 */
+static audio_state_t *next_submitted_slot(void) {
+    audio_state_t *next = NULL;
+    for (int i = 0; i < AUDIO_PLAYER_SLOTS; i++) {
+        audio_state_t *state = &s_slots[i];
+        if (state->has_audio && !state->is_playing &&
+            (!next || (int32_t)(state->seq - next->seq) < 0)) {
+            next = state;
+        }
+    }
+    return next;
 }
 
 /* 音频播放任务 - 保持不变 */
 void audio_playback_task(void *pvParameters) {
-    const size_t chunk_size = 4096;  // 每次写入的数据大小
+    const size_t chunk_size = AUDIO_STAGE_CHUNK_SIZE;  // 每次写入的数据大小
     
     ESP_LOGI(TAG, "Audio playback task started");
     
     while (1) {
         // 检查是否有音频需要播放
-        if (audio_state.has_audio && audio_state.download_complete && !audio_state.is_playing) {
-            ESP_LOGI(TAG, "Starting playback of %s (%d bytes)", 
-                    audio_state.current_audio_id, audio_state.audio_size);
+        audio_state_t *state = next_submitted_slot();
+        if (state && (state->download_complete || state->streaming)) {
+            audio_clip_t *clip = &state->clip;
+            ESP_LOGI(TAG, "Starting %s playback of %s (%d bytes buffered)", 
+                    state->streaming ? "streaming" : "buffered",
+                    state->current_audio_id, audio_clip_available(clip));
             
-            audio_state.is_playing = true;
-            audio_state.audio_position = 0;
+            state->is_playing = true;
+            state->audio_position = 0;
             
-            // 播放音频数据
-            while (audio_state.audio_position < audio_state.audio_size) {
-                size_t remaining = audio_state.audio_size - audio_state.audio_position;
-                size_t to_write = (remaining > chunk_size) ? chunk_size : remaining;
-                
-                esp_err_t ret = audio_hal_play_pcm(
-                    audio_state.audio_buffer + audio_state.audio_position, 
-                    to_write
-                );
+            // 播放音频数据 - 从内部RAM中转缓冲区写I2S，下一块同时由GDMA预取
+            audio_stage_begin(clip, 0);
+            i2s_monitor_clip_begin();
+            const uint8_t *chunk;
+            size_t to_write;
+            while ((chunk = audio_stage_next(&to_write)) != NULL) {
+                esp_err_t ret = audio_hal_play_pcm(chunk, to_write);
                 
                 if (ret == ESP_OK) {
-                    audio_state.audio_position += to_write;
+                    if (state->audio_position == 0) {
+                        latency_trace_mark(state->trace_turn, LATENCY_FIRST_I2S, to_write);
+                    }
+                    state->audio_position += to_write;
+                    i2s_monitor_note_write(state->audio_position, audio_clip_available(clip));
+                    
+                    // 流式播放：已播放的段立即归还给下载端
+                    if (state->streaming) {
+                        audio_clip_release_before(clip, state->audio_position);
+                    }
                     
                     // 显示播放进度
-                    if (audio_state.audio_position % (chunk_size * 10) == 0 || 
-                        audio_state.audio_position >= audio_state.audio_size) {
-                        int progress = (audio_state.audio_position * 100) / audio_state.audio_size;
-                        ESP_LOGD(TAG, "Playback progress: %d%%", progress);
+                    if (state->audio_position % (chunk_size * 10) == 0) {
+                        ESP_LOGD(TAG, "Playback progress: %d/%d bytes", 
+                                 state->audio_position, audio_clip_available(clip));
                     }
                 } else {
                     ESP_LOGE(TAG, "Audio playback error: %s", esp_err_to_name(ret));
@@ -60,15 +139,38 @@ void audio_playback_task(void *pvParameters) {
                 taskYIELD();
             }
             
-            ESP_LOGI(TAG, "Playback completed for %s", audio_state.current_audio_id);
+            i2s_monitor_clip_end(state->current_audio_id);
+            audio_stage_end();
+            latency_trace_mark(state->trace_turn, LATENCY_LAST_SAMPLE, state->audio_position);
+            ESP_LOGI(TAG, "Playback completed for %s (%d bytes)", 
+                     state->current_audio_id, state->audio_position);
+            log_turn_latency(state->trace_turn);
             
-            // 重置播放状态
-            audio_state.is_playing = false;
-            audio_state.has_audio = false;
-            audio_state.download_complete = false;
+#if AUDIO_STAGE_AB_COMPARE
+            // 下一个片段切换到另一种中转模式
+            audio_stage_stats_t stage_stats;
+            audio_stage_get_stats(&stage_stats);
+            audio_stage_set_mode(stage_stats.mode == AUDIO_STAGE_MODE_GDMA ?
+                                 AUDIO_STAGE_MODE_CPU : AUDIO_STAGE_MODE_GDMA);
+#endif
+            
+            // 归还段池（待写入缓存的片段和flash映射的片段由下载端回收时处理）
+            if (!state->keep_clip && !clip->external) {
+                audio_clip_release(clip);
+            }
+            
+            // 重置播放状态，slot由下载端回收后复用
+            state->finished = true;
+            state->is_playing = false;
+            state->has_audio = false;
+            state->download_complete = false;
+            state->streaming = false;
             
             // 清空音频ID以允许重新播放相同的音频
-            memset(audio_state.current_audio_id, 0, sizeof(audio_state.current_audio_id));
+            memset(state->current_audio_id, 0, sizeof(state->current_audio_id));
+            
+            // 下一个片段可能已经下载好，立即接着播放
+            continue;
         }
         
         // 短暂延迟以避免忙等待
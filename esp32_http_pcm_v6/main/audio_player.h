@@ -6,24 +6,42 @@
 #include <stddef.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "audio_pool.h"
+#include "clip_index.h"
 
-/* Audio playback state */
+#define LATENCY_SUMMARY_TURNS  10  // 每N个回合打印一次各阶段统计
+#define AUDIO_PLAYER_SLOTS     2   // 播放一个片段的同时下载下一个
+
+/* Audio playback state - 每个slot一个片段，按提交顺序播放 */
 typedef struct {
     bool is_playing;
     bool has_audio;
     bool download_complete;
-    uint8_t *audio_buffer;      // 将使用PSRAM分配
-    size_t audio_size;
-    size_t audio_capacity;
+    bool streaming;             // 边下边播：段播放后立即归还
+    bool keep_clip;             // 播放结束后不归还段，由下载端写入片段缓存后归还
+    bool finished;              // 已播放完，等下载端回收（解除映射、写入缓存）后才能复用
+    audio_clip_t clip;          // 分段存储在PSRAM段池中
     size_t audio_position;
     char current_audio_id[64];
+    char cache_key[CLIP_INDEX_KEY_LEN];  // keep_clip时写入片段缓存的键
+    uint16_t trace_turn;        // 当前片段的延迟追踪回合（latency_trace.h）
+    uint32_t seq;               // 提交序号，决定播放顺序
 } audio_state_t;
 
 /* 初始化音频播放器 */
 void audio_player_init(void);
 
-/* 获取音频状态 */
-audio_state_t* audio_player_get_state(void);
+/* 获取第index个slot */
+audio_state_t* audio_player_get_slot(int index);
+
+/* 可以装入下一个片段的slot（未提交、未播放、已回收），没有返回NULL */
+audio_state_t* audio_player_free_slot(void);
+
+/* 片段已可播放（整段下载完或到达起播水位），排到已提交的片段之后 */
+void audio_player_submit(audio_state_t *state);
+
+/* 是否有片段正在播放或等待播放 */
+bool audio_player_busy(void);
 
 /* 音频播放任务 */
 void audio_playback_task(void *pvParameters);
@@ -0,0 +1,240 @@
+#include "audio_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "mem_track.h"
+
+static const char *TAG = "AUDIO_POOL";
+
+/* 池几何配置 */
+typedef struct {
+    const char *name;
+    size_t block_size;
+    uint16_t block_count;
+    uint32_t caps;
+    size_t align;               // 块存储区对齐，满足GDMA访问要求
+} audio_pool_config_t;
+
+static const audio_pool_config_t s_pool_configs[AUDIO_POOL_COUNT] = {
+    [AUDIO_POOL_SEGMENT] = { "segment", AUDIO_SEGMENT_SIZE, AUDIO_SEGMENT_COUNT, MALLOC_CAP_SPIRAM, 64 },
+    [AUDIO_POOL_FRAME]   = { "frame",   AUDIO_FRAME_SIZE,   AUDIO_FRAME_COUNT,   MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, 4 },
+};
+
+static block_pool_t s_pools[AUDIO_POOL_COUNT];
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_initialized = false;
+
+/* 释放前count个池已预留的内存（仅用于初始化失败时回退） */
+static void release_pools(int count, void *storage[], void *meta[]) {
+    for (int i = 0; i < count; i++) {
+        mem_track_free(MEM_TAG_PLAYER, storage[i]);
+        mem_track_free(MEM_TAG_PLAYER, meta[i]);
+    }
+    memset(s_pools, 0, sizeof(s_pools));
+}
+
+/* 启动时预留内存，之后不再向堆申请/归还；任一池失败时归还已预留的池 */
+esp_err_t audio_pool_init(void) {
+    if (s_initialized) {
+        return ESP_OK;
+    }
+
+    void *storage[AUDIO_POOL_COUNT] = {0};
+    void *meta[AUDIO_POOL_COUNT] = {0};
+    for (int i = 0; i < AUDIO_POOL_COUNT; i++) {
+        const audio_pool_config_t *cfg = &s_pool_configs[i];
+        size_t storage_size = cfg->block_size * cfg->block_count;
+
+        storage[i] = mem_track_aligned_alloc(MEM_TAG_PLAYER, cfg->align, storage_size, cfg->caps);
+        meta[i] = mem_track_malloc(MEM_TAG_PLAYER, block_pool_meta_size(cfg->block_count), MALLOC_CAP_INTERNAL);
+        if (!storage[i] || !meta[i] ||
+            !block_pool_init(&s_pools[i], storage[i], cfg->block_size, cfg->block_count, meta[i])) {
+            ESP_LOGE(TAG, "Failed to reserve %s pool (%d x %d bytes)",
+                     cfg->name, cfg->block_count, cfg->block_size);
+            release_pools(i + 1, storage, meta);
+            return ESP_ERR_NO_MEM;
+        }
+        ESP_LOGI(TAG, "Reserved %s pool: %d x %d bytes", cfg->name, cfg->block_count, cfg->block_size);
+    }
+
+    s_initialized = true;
+    return ESP_OK;
+}
+
+void *audio_pool_alloc(audio_pool_id_t id) {
+    if (!s_initialized || id >= AUDIO_POOL_COUNT) {
+        return NULL;
+    }
+
+    portENTER_CRITICAL(&s_pool_lock);
+    void *block = block_pool_alloc(&s_pools[id]);
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (!block) {
+        ESP_LOGW(TAG, "%s pool exhausted", s_pool_configs[id].name);
+    }
+    return block;
+}
+
+void audio_pool_free(audio_pool_id_t id, void *block) {
+    if (!s_initialized || id >= AUDIO_POOL_COUNT || !block) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_pool_lock);
+    bool ok = block_pool_free(&s_pools[id], block);
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Invalid free of %p to %s pool", block, s_pool_configs[id].name);
+    }
+}
+
+void audio_pool_get_stats(audio_pool_id_t id, block_pool_stats_t *stats) {
+    if (!s_initialized || id >= AUDIO_POOL_COUNT || !stats) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_pool_lock);
+    *stats = s_pools[id].stats;
+    portEXIT_CRITICAL(&s_pool_lock);
+}
+
+void audio_pool_log_stats(void) {
+    for (int i = 0; i < AUDIO_POOL_COUNT; i++) {
+        block_pool_stats_t stats;
+        audio_pool_get_stats(i, &stats);
+        ESP_LOGI(TAG, "%s pool: in_use=%lu/%lu, peak=%lu, allocs=%lu, fails=%lu, invalid_frees=%lu",
+                 s_pool_configs[i].name, stats.in_use, stats.block_count, stats.peak_in_use,
+                 stats.alloc_count, stats.fail_count, stats.invalid_free_count);
+    }
+}
+
+size_t audio_pool_free_segments(void) {
+    block_pool_stats_t stats = {0};
+    audio_pool_get_stats(AUDIO_POOL_SEGMENT, &stats);
+    return stats.block_count - stats.in_use;
+}
+
+uint8_t *audio_clip_reserve(audio_clip_t *clip, size_t max_live_segments, size_t *space) {
+    size_t size = clip->size;
+    size_t offset = size % AUDIO_SEGMENT_SIZE;
+
+    if (max_live_segments > AUDIO_SEGMENT_COUNT) {
+        max_live_segments = AUDIO_SEGMENT_COUNT;
+    }
+
+    if (offset == 0 && size / AUDIO_SEGMENT_SIZE == clip->segment_count) {
+        // 当前段已满，取新段
+        size_t released = __atomic_load_n(&clip->released_count, __ATOMIC_ACQUIRE);
+        if (clip->segment_count - released >= max_live_segments) {
+            return NULL;
+        }
+        uint8_t *segment = audio_pool_alloc(AUDIO_POOL_SEGMENT);
+        if (!segment) {
+            return NULL;
+        }
+        clip->segments[clip->segment_count % AUDIO_SEGMENT_COUNT] = segment;
+        clip->segment_count++;
+    }
+
+    *space = AUDIO_SEGMENT_SIZE - offset;
+    return AUDIO_CLIP_SEGMENT(clip, size);
+}
+
+void audio_clip_commit(audio_clip_t *clip, size_t len) {
+    // 数据写完后再发布新的长度
+    __atomic_store_n(&clip->size, clip->size + len, __ATOMIC_RELEASE);
+}
+
+bool audio_clip_preallocate(audio_clip_t *clip, size_t total) {
+    size_t needed = (total + AUDIO_SEGMENT_SIZE - 1) / AUDIO_SEGMENT_SIZE;
+    if (needed - clip->released_count > AUDIO_SEGMENT_COUNT) {
+        return false;
+    }
+    while (clip->segment_count < needed) {
+        uint8_t *segment = audio_pool_alloc(AUDIO_POOL_SEGMENT);
+        if (!segment) {
+            return false;
+        }
+        clip->segments[clip->segment_count % AUDIO_SEGMENT_COUNT] = segment;
+        clip->segment_count++;
+    }
+    return true;
+}
+
+void audio_clip_publish(audio_clip_t *clip, size_t size) {
+    if (size > clip->size) {
+        __atomic_store_n(&clip->size, size, __ATOMIC_RELEASE);
+    }
+}
+
+size_t audio_clip_append(audio_clip_t *clip, const uint8_t *data, size_t len, size_t max_live_segments) {
+    size_t appended = 0;
+
+    while (appended < len) {
+        size_t space;
+        uint8_t *dst = audio_clip_reserve(clip, max_live_segments, &space);
+        if (!dst) {
+            break;
+        }
+        size_t to_copy = (len - appended) < space ? (len - appended) : space;
+        memcpy(dst, data + appended, to_copy);
+        audio_clip_commit(clip, to_copy);
+        appended += to_copy;
+    }
+    return appended;
+}
+
+size_t audio_clip_available(const audio_clip_t *clip) {
+    return __atomic_load_n(&clip->size, __ATOMIC_ACQUIRE);
+}
+
+void audio_clip_set_complete(audio_clip_t *clip) {
+    __atomic_store_n(&clip->complete, true, __ATOMIC_RELEASE);
+}
+
+bool audio_clip_is_complete(const audio_clip_t *clip) {
+    return __atomic_load_n(&clip->complete, __ATOMIC_ACQUIRE);
+}
+
+void audio_clip_release_before(audio_clip_t *clip, size_t position) {
+    size_t released = clip->released_count;
+    size_t limit = position / AUDIO_SEGMENT_SIZE;
+
+    while (released < limit && released < clip->segment_count) {
+        if (!clip->external) {
+            audio_pool_free(AUDIO_POOL_SEGMENT, clip->segments[released % AUDIO_SEGMENT_COUNT]);
+        }
+        clip->segments[released % AUDIO_SEGMENT_COUNT] = NULL;
+        released++;
+    }
+    __atomic_store_n(&clip->released_count, released, __ATOMIC_RELEASE);
+}
+
+void audio_clip_release(audio_clip_t *clip) {
+    for (size_t i = clip->released_count; i < clip->segment_count; i++) {
+        if (!clip->external) {
+            audio_pool_free(AUDIO_POOL_SEGMENT, clip->segments[i % AUDIO_SEGMENT_COUNT]);
+        }
+        clip->segments[i % AUDIO_SEGMENT_COUNT] = NULL;
+    }
+    clip->segment_count = 0;
+    clip->released_count = 0;
+    clip->size = 0;
+    clip->complete = false;
+    clip->external = false;
+}
+
+void audio_clip_attach(audio_clip_t *clip, const uint8_t *data, size_t size) {
+    audio_clip_release(clip);
+    clip->segment_count = (size + AUDIO_SEGMENT_SIZE - 1) / AUDIO_SEGMENT_SIZE;
+    for (size_t i = 0; i < clip->segment_count; i++) {
+        clip->segments[i] = (uint8_t *)data + i * AUDIO_SEGMENT_SIZE;
+    }
+    clip->external = true;
+    clip->size = size;
+    __atomic_store_n(&clip->complete, true, __ATOMIC_RELEASE);
+}
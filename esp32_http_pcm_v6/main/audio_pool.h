@@ -0,0 +1,93 @@
+#ifndef AUDIO_POOL_H
+#define AUDIO_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "block_pool.h"
+
+/* 音频段池 - 片段按固定大小分段存储，替代psram_realloc逐步扩容 */
+#define AUDIO_SEGMENT_SIZE     (64 * 1024)        // 64KB，沿用原DOWNLOAD_CHUNK_SIZE
+#define AUDIO_SEGMENT_COUNT    64                 // 64 x 64KB = 4MB，即MAX_AUDIO_SIZE
+
+/* 帧缓冲池 - 内部DMA可用RAM，供I2S写入等热路径使用 */
+#define AUDIO_FRAME_SIZE       4096
+#define AUDIO_FRAME_COUNT      4
+
+typedef enum {
+    AUDIO_POOL_SEGMENT = 0,     // PSRAM
+    AUDIO_POOL_FRAME,           // 内部RAM，DMA可用
+    AUDIO_POOL_COUNT
+} audio_pool_id_t;
+
+/**
+ * 分段存储的音频片段
+ * 段按序号对AUDIO_SEGMENT_COUNT取模存放，流式播放时已播放的段可提前归还，
+ * 片段因此可以超过段池容量。size/released_count/complete由下载端和播放端
+ * 并发访问，需通过下面的audio_clip_*函数读写。
+ */
+typedef struct {
+    uint8_t *segments[AUDIO_SEGMENT_COUNT];
+    size_t segment_count;       // 已取得的段总数（段序号上限）
+    size_t released_count;      // 已归还的段数（段序号下限）
+    size_t size;                // 有效数据字节数
+    bool complete;              // 下载端不会再追加数据
+    bool external;              // 段指向池外的只读内存（flash映射），释放时不归还段池
+} audio_clip_t;
+
+#define AUDIO_CLIP_SEGMENT(clip, pos) \
+    ((clip)->segments[((pos) / AUDIO_SEGMENT_SIZE) % AUDIO_SEGMENT_COUNT] + (pos) % AUDIO_SEGMENT_SIZE)
+
+/* 启动时一次性预留所有池的内存 */
+esp_err_t audio_pool_init(void);
+
+/* O(1)分配一个块，池耗尽返回NULL */
+void *audio_pool_alloc(audio_pool_id_t id);
+
+/* O(1)释放一个块 */
+void audio_pool_free(audio_pool_id_t id, void *block);
+
+/* 获取池统计 */
+void audio_pool_get_stats(audio_pool_id_t id, block_pool_stats_t *stats);
+
+/* 打印所有池统计 */
+void audio_pool_log_stats(void);
+
+/* 当前空闲段数 */
+size_t audio_pool_free_segments(void);
+
+/* 取得当前段内可直接写入的连续空间（零拷贝接收），按需取新段；
+ * 超出max_live_segments或段池耗尽返回NULL。写入后用audio_clip_commit发布 */
+uint8_t *audio_clip_reserve(audio_clip_t *clip, size_t max_live_segments, size_t *space);
+
+/* 发布audio_clip_reserve空间中已写入的len字节 */
+void audio_clip_commit(audio_clip_t *clip, size_t len);
+
+/* 一次取足容纳total字节所需的段（并行分段下载，各连接按偏移直接写入），段池不足返回false */
+bool audio_clip_preallocate(audio_clip_t *clip, size_t total);
+
+/* 发布已连续写入的长度，只能增大（并行下载的连续前缀） */
+void audio_clip_publish(audio_clip_t *clip, size_t size);
+
+/* 把一段连续的只读内存（如esp_partition_mmap映射的flash）作为完整片段，不复制数据 */
+void audio_clip_attach(audio_clip_t *clip, const uint8_t *data, size_t size);
+
+/* 追加数据到片段，按需从段池取新段，最多同时持有max_live_segments段，返回实际追加的字节数 */
+size_t audio_clip_append(audio_clip_t *clip, const uint8_t *data, size_t len, size_t max_live_segments);
+
+/* 已写入的字节数（播放端调用） */
+size_t audio_clip_available(const audio_clip_t *clip);
+
+/* 标记下载结束（下载端调用） */
+void audio_clip_set_complete(audio_clip_t *clip);
+
+/* 下载是否已结束（播放端调用） */
+bool audio_clip_is_complete(const audio_clip_t *clip);
+
+/* 归还position之前已完整播放的段（流式播放） */
+void audio_clip_release_before(audio_clip_t *clip, size_t position);
+
+/* 归还片段的所有段并清空 */
+void audio_clip_release(audio_clip_t *clip);
+
+#endif /* AUDIO_POOL_H */
@@ -0,0 +1,216 @@
+#include "audio_stage.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_async_memcpy.h"
+#include "esp_cache.h"
+
+static const char *TAG = "AUDIO_STAGE";
+
+static async_memcpy_handle_t s_dma = NULL;
+static SemaphoreHandle_t s_copy_done = NULL;
+static uint8_t *s_bufs[2] = {NULL, NULL};      // 帧池中的两块内部DMA缓冲区
+static const uint8_t *s_direct[2];             // flash映射片段的块地址，非NULL时不经过中转缓冲区
+static size_t s_lens[2];
+static bool s_pending[2];                      // 对应缓冲区是否有GDMA搬运未完成
+static bool s_deferred[2];                     // 对应缓冲区的数据尚未下载到，推迟到使用时再取
+static uint32_t s_fetch_us[2];                 // 对应块的CPU取数时间
+static int s_cur = 0;
+
+static const audio_clip_t *s_clip = NULL;
+static size_t s_next_pos = 0;                  // 下一块要预取的片段偏移
+static audio_stage_mode_t s_mode = AUDIO_STAGE_DEFAULT_MODE;
+static audio_stage_mode_t s_active_mode = AUDIO_STAGE_MODE_CPU;
+static audio_stage_stats_t s_stats = {0};
+
+/* GDMA搬运完成 - ISR上下文 */
+static bool IRAM_ATTR stage_copy_done_cb(async_memcpy_handle_t mcp, async_memcpy_event_t *event, void *cb_args) {
+    BaseType_t high_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(s_copy_done, &high_task_woken);
+    return high_task_woken == pdTRUE;
+}
+
+esp_err_t audio_stage_init(void) {
+    s_bufs[0] = audio_pool_alloc(AUDIO_POOL_FRAME);
+    s_bufs[1] = audio_pool_alloc(AUDIO_POOL_FRAME);
+    s_copy_done = xSemaphoreCreateBinary();
+    if (!s_bufs[0] || !s_bufs[1] || !s_copy_done) {
+        ESP_LOGE(TAG, "Failed to allocate staging buffers");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 源数据由下载任务经CPU写入PSRAM，可能还在cache里，每次搬运前由stage_fetch显式回写
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.backlog = 2;
+    config.psram_trans_align = AUDIO_STAGE_PSRAM_ALIGN;
+    config.sram_trans_align = 4;
+    esp_err_t ret = esp_async_memcpy_install(&config, &s_dma);
+    if (ret != ESP_OK) {
+        // GDMA不可用时退回CPU搬运，功能不受影响
+        ESP_LOGW(TAG, "Async memcpy unavailable (%s), using CPU staging", esp_err_to_name(ret));
+        s_dma = NULL;
+        s_mode = AUDIO_STAGE_MODE_CPU;
+    }
+
+    ESP_LOGI(TAG, "Audio staging initialized, mode: %s",
+             s_mode == AUDIO_STAGE_MODE_GDMA ? "GDMA" : "CPU");
+    return ESP_OK;
+}
+
+void audio_stage_set_mode(audio_stage_mode_t mode) {
+    if (mode == AUDIO_STAGE_MODE_GDMA && !s_dma) {
+        ESP_LOGW(TAG, "GDMA staging not available");
+        return;
+    }
+    s_mode = mode;
+}
+
+/* 把下一块搬到指定缓冲区：GDMA异步发起，或CPU同步复制 */
+static void stage_fetch(int index) {
+    // 先读complete再读长度，保证complete时看到的是最终长度
+    bool complete = audio_clip_is_complete(s_clip);
+    size_t remaining = audio_clip_available(s_clip) - s_next_pos;
+
+    if (remaining < AUDIO_STAGE_CHUNK_SIZE && !complete) {
+        // 流式播放：整块数据尚未到达
+        s_deferred[index] = true;
+        return;
+    }
+    s_deferred[index] = false;
+
+    if (remaining == 0) {
+        s_lens[index] = 0;
+        return;
+    }
+
+    size_t len = remaining < AUDIO_STAGE_CHUNK_SIZE ? remaining : AUDIO_STAGE_CHUNK_SIZE;
+    uint8_t *src = AUDIO_CLIP_SEGMENT(s_clip, s_next_pos);
+    s_lens[index] = len;
+    s_next_pos += len;
+    
+    if (s_clip->external) {
+        // flash映射：I2S写入时经cache读取，省去一次复制
+        s_direct[index] = src;
+        s_fetch_us[index] = 0;
+        s_stats.direct_chunks++;
+        return;
+    }
+    s_direct[index] = NULL;
+
+    int64_t start = esp_timer_get_time();
+
+    bool dma_started = false;
+    if (s_active_mode == AUDIO_STAGE_MODE_GDMA &&
+        (len % AUDIO_STAGE_PSRAM_ALIGN) == 0 &&
+        ((uintptr_t)src % AUDIO_STAGE_PSRAM_ALIGN) == 0 &&
+        esp_cache_msync(src, len, ESP_CACHE_MSYNC_FLAG_DIR_C2M) == ESP_OK) {
+        // GDMA绕过cache直接读PSRAM，上面先把下载任务写入、尚未回写的cache行写回
+        if (esp_async_memcpy(s_dma, s_bufs[index], src, len, stage_copy_done_cb, NULL) == ESP_OK) {
+            s_pending[index] = true;
+            dma_started = true;
+            s_stats.gdma_chunks++;
+        }
+    }
+
+    if (!dma_started) {
+        // CPU模式或未对齐的尾块
+        memcpy(s_bufs[index], src, len);
+        s_stats.cpu_chunks++;
+    }
+
+    s_fetch_us[index] = (uint32_t)(esp_timer_get_time() - start);
+}
+
+/* 等待指定缓冲区的GDMA搬运完成 */
+static void stage_wait(int index) {
+    if (!s_pending[index]) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    if (xSemaphoreTake(s_copy_done, 0) != pdTRUE) {
+        s_stats.stall_count++;
+        if (xSemaphoreTake(s_copy_done, pdMS_TO_TICKS(100)) != pdTRUE) {
+            ESP_LOGE(TAG, "GDMA copy timeout");
+        }
+    }
+    s_pending[index] = false;
+    s_fetch_us[index] += (uint32_t)(esp_timer_get_time() - start);
+}
+
+esp_err_t audio_stage_begin(const audio_clip_t *clip, size_t position) {
+    if (!clip || !s_bufs[0] || position > audio_clip_available(clip)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_clip = clip;
+    s_next_pos = position;
+    s_cur = 0;
+    s_deferred[0] = s_deferred[1] = false;
+    s_direct[0] = s_direct[1] = NULL;
+    s_active_mode = s_mode;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.mode = s_active_mode;
+
+    stage_fetch(0);
+    return ESP_OK;
+}
+
+const uint8_t *audio_stage_next(size_t *len) {
+    if (!s_clip) {
+        return NULL;
+    }
+
+    int index = s_cur;
+    if (s_deferred[index]) {
+        s_stats.data_waits++;
+        do {
+            vTaskDelay(pdMS_TO_TICKS(AUDIO_STAGE_DATA_WAIT_MS));
+            stage_fetch(index);
+        } while (s_deferred[index]);
+    }
+    if (s_lens[index] == 0) {
+        return NULL;
+    }
+
+    stage_wait(index);
+
+    s_stats.chunks++;
+    s_stats.fetch_us_total += s_fetch_us[index];
+    if (s_fetch_us[index] > s_stats.fetch_us_max) {
+        s_stats.fetch_us_max = s_fetch_us[index];
+    }
+
+    // 另一块缓冲区上次已交给I2S写完，可以开始预取
+    stage_fetch(index ^ 1);
+    s_cur = index ^ 1;
+
+    *len = s_lens[index];
+    return s_direct[index] ? s_direct[index] : s_bufs[index];
+}
+
+void audio_stage_end(void) {
+    if (!s_clip) {
+        return;
+    }
+
+    stage_wait(0);
+    stage_wait(1);
+    s_clip = NULL;
+
+    uint32_t avg_us = s_stats.chunks ? (uint32_t)(s_stats.fetch_us_total / s_stats.chunks) : 0;
+    ESP_LOGI(TAG, "Staging [%s]: %lu chunks (gdma=%lu, cpu=%lu, direct=%lu), fetch avg=%luus max=%luus, stalls=%lu, data_waits=%lu",
+             s_stats.mode == AUDIO_STAGE_MODE_GDMA ? "GDMA" : "CPU",
+             s_stats.chunks, s_stats.gdma_chunks, s_stats.cpu_chunks, s_stats.direct_chunks,
+             avg_us, s_stats.fetch_us_max, s_stats.stall_count, s_stats.data_waits);
+}
+
+void audio_stage_get_stats(audio_stage_stats_t *stats) {
+    if (stats) {
+        *stats = s_stats;
+    }
+}
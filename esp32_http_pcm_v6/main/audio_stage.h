@@ -0,0 +1,59 @@
+#ifndef AUDIO_STAGE_H
+#define AUDIO_STAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "audio_pool.h"
+
+/**
+ * PSRAM -> 内部RAM双缓冲中转
+ * 播放当前块时，用GDMA（async memcpy）预取下一块到内部DMA可用缓冲区，
+ * 避免CPU直接读取PSRAM时的cache miss停顿。
+ * flash映射的片段（GDMA无法访问）不中转，直接返回映射地址，由I2S驱动经flash cache读取。
+ */
+
+#define AUDIO_STAGE_CHUNK_SIZE     AUDIO_FRAME_SIZE     // 每块4KB，整除段大小
+#define AUDIO_STAGE_PSRAM_ALIGN    64                   // GDMA访问PSRAM的对齐要求
+#define AUDIO_STAGE_DEFAULT_MODE   AUDIO_STAGE_MODE_GDMA
+#define AUDIO_STAGE_AB_COMPARE     0                    // 1: 每个片段交替CPU/GDMA模式，对比每块取数耗时
+#define AUDIO_STAGE_DATA_WAIT_MS   5                    // 流式播放等待下载数据的轮询间隔
+
+typedef enum {
+    AUDIO_STAGE_MODE_CPU = 0,   // CPU memcpy（对照基线）
+    AUDIO_STAGE_MODE_GDMA,      // async memcpy预取
+} audio_stage_mode_t;
+
+/* 每个片段的中转统计 - fetch_us为CPU在取数上花费的时间 */
+typedef struct {
+    audio_stage_mode_t mode;
+    uint32_t chunks;
+    uint32_t gdma_chunks;       // 由GDMA搬运的块
+    uint32_t cpu_chunks;        // 由CPU搬运的块（CPU模式或未对齐的尾块）
+    uint32_t direct_chunks;     // 直接从flash映射读取、未中转的块
+    uint64_t fetch_us_total;    // CPU取数总时间（memcpy或发起DMA+等待完成）
+    uint32_t fetch_us_max;
+    uint32_t stall_count;       // GDMA模式下预取未完成需要等待的次数
+    uint32_t data_waits;        // 流式播放时数据尚未下载到而等待的次数
+} audio_stage_stats_t;
+
+/* 安装async memcpy并从帧池取两块中转缓冲区 */
+esp_err_t audio_stage_init(void);
+
+/* 切换中转模式，下一个片段生效 */
+void audio_stage_set_mode(audio_stage_mode_t mode);
+
+/* 开始中转一个片段，立即预取第一块 */
+esp_err_t audio_stage_begin(const audio_clip_t *clip, size_t position);
+
+/* 返回已在内部RAM中的下一块并预取其后一块，片段结束返回NULL
+ * 流式播放时若下一块尚未下载到，会阻塞等待直到数据到达或下载结束 */
+const uint8_t *audio_stage_next(size_t *len);
+
+/* 结束当前片段，等待未完成的预取并打印统计 */
+void audio_stage_end(void);
+
+/* 获取最近一个片段的统计 */
+void audio_stage_get_stats(audio_stage_stats_t *stats);
+
+#endif /* AUDIO_STAGE_H */
@@ -0,0 +1,77 @@
+#include "block_pool.h"
+#include <string.h>
+
+/* 元数据：空闲索引栈 + 使用标志 */
+size_t block_pool_meta_size(uint16_t block_count) {
+    return block_count * sizeof(uint16_t) + block_count * sizeof(uint8_t);
+}
+
+bool block_pool_init(block_pool_t *pool, void *storage, size_t block_size,
+                     uint16_t block_count, void *meta) {
+    if (!pool || !storage || !meta || block_size == 0 || block_count == 0) {
+        return false;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->base = storage;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+    pool->free_stack = meta;
+    pool->in_use_map = (uint8_t *)meta + block_count * sizeof(uint16_t);
+    memset(pool->in_use_map, 0, block_count);
+
+    // 逆序压栈，使首次分配从低地址块开始
+    for (uint16_t i = 0; i < block_count; i++) {
+        pool->free_stack[i] = block_count - 1 - i;
+    }
+    pool->free_top = block_count;
+
+    pool->stats.block_size = block_size;
+    pool->stats.block_count = block_count;
+    return true;
+}
+
+void *block_pool_alloc(block_pool_t *pool) {
+    if (pool->free_top == 0) {
+        pool->stats.fail_count++;
+        return NULL;
+    }
+
+    uint16_t index = pool->free_stack[--pool->free_top];
+    pool->in_use_map[index] = 1;
+
+    pool->stats.alloc_count++;
+    pool->stats.in_use++;
+    if (pool->stats.in_use > pool->stats.peak_in_use) {
+        pool->stats.peak_in_use = pool->stats.in_use;
+    }
+    return pool->base + (size_t)index * pool->block_size;
+}
+
+bool block_pool_owns(const block_pool_t *pool, const void *block) {
+    const uint8_t *p = block;
+    if (p < pool->base || p >= pool->base + (size_t)pool->block_count * pool->block_size) {
+        return false;
+    }
+    return ((size_t)(p - pool->base) % pool->block_size) == 0;
+}
+
+bool block_pool_free(block_pool_t *pool, void *block) {
+    if (!block_pool_owns(pool, block)) {
+        pool->stats.invalid_free_count++;
+        return false;
+    }
+
+    uint16_t index = (uint16_t)(((uint8_t *)block - pool->base) / pool->block_size);
+    if (!pool->in_use_map[index]) {
+        pool->stats.invalid_free_count++;
+        return false;
+    }
+
+    pool->in_use_map[index] = 0;
+    pool->free_stack[pool->free_top++] = index;
+
+    pool->stats.free_count++;
+    pool->stats.in_use--;
+    return true;
+}
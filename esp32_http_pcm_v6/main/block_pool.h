@@ -0,0 +1,52 @@
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * 固定块大小的内存池（不依赖ESP-IDF，可在主机上测试）
+ * 空闲块索引保存在栈中，分配/释放均为O(1)，不会产生碎片。
+ * 本模块不加锁，多任务访问由调用者负责（见audio_pool.c）。
+ */
+
+/* 内存池统计 */
+typedef struct {
+    size_t block_size;
+    uint32_t block_count;
+    uint32_t in_use;            // 当前已分配块数
+    uint32_t peak_in_use;       // 历史最高已分配块数
+    uint32_t alloc_count;       // 成功分配次数
+    uint32_t free_count;        // 成功释放次数
+    uint32_t fail_count;        // 池耗尽导致的分配失败次数
+    uint32_t invalid_free_count;// 非法/重复释放次数
+} block_pool_stats_t;
+
+typedef struct {
+    uint8_t *base;              // 块存储区起始地址
+    size_t block_size;
+    uint16_t block_count;
+    uint16_t free_top;          // 空闲栈中的元素个数
+    uint16_t *free_stack;       // 空闲块索引栈（block_count个元素）
+    uint8_t *in_use_map;        // 每块一个标志，用于检测重复释放
+    block_pool_stats_t stats;
+} block_pool_t;
+
+/* 计算block_pool_init所需的元数据字节数 */
+size_t block_pool_meta_size(uint16_t block_count);
+
+/* 在调用者提供的存储区和元数据区上初始化内存池 */
+bool block_pool_init(block_pool_t *pool, void *storage, size_t block_size,
+                     uint16_t block_count, void *meta);
+
+/* 分配一个块，池耗尽时返回NULL */
+void *block_pool_alloc(block_pool_t *pool);
+
+/* 释放一个块，非本池或重复释放返回false */
+bool block_pool_free(block_pool_t *pool, void *block);
+
+/* 判断指针是否属于本池 */
+bool block_pool_owns(const block_pool_t *pool, const void *block);
+
+#endif /* BLOCK_POOL_H */
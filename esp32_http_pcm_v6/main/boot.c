@@ -0,0 +1,115 @@
+#include "boot.h"
+#include <string.h>
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "BOOT";
+
+static EventGroupHandle_t s_boot_group = NULL;
+static const boot_phase_t *s_phases = NULL;
+static boot_timing_t s_timings[BOOT_MAX_PHASES];
+static int64_t s_boot_start = 0;
+static uint32_t s_failed = 0;          // 失败或被跳过的阶段
+
+/* 阶段任务：等待依赖、运行、置位完成标志 */
+static void boot_phase_task(void *pvParameters) {
+    size_t index = (size_t)pvParameters;
+    const boot_phase_t *phase = &s_phases[index];
+    boot_timing_t *timing = &s_timings[index];
+
+    if (phase->deps) {
+        xEventGroupWaitBits(s_boot_group, phase->deps, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    timing->ready_us = esp_timer_get_time() - s_boot_start;
+
+    if (__atomic_load_n(&s_failed, __ATOMIC_ACQUIRE) & phase->deps) {
+        // 依赖失败，跳过但仍置位完成标志，让后续阶段也能结束
+        ESP_LOGW(TAG, "Skipping %s: a dependency failed", phase->name);
+        timing->result = ESP_ERR_INVALID_STATE;
+    } else {
+        timing->result = phase->run();
+    }
+
+    timing->done_us = esp_timer_get_time() - s_boot_start;
+    timing->run_us = (uint32_t)(timing->done_us - timing->ready_us);
+
+    if (timing->result != ESP_OK) {
+        if (timing->result != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(TAG, "Phase %s failed: %s", phase->name, esp_err_to_name(timing->result));
+        }
+        __atomic_or_fetch(&s_failed, BOOT_DEP(index), __ATOMIC_RELEASE);
+    }
+    xEventGroupSetBits(s_boot_group, BOOT_DEP(index));
+    vTaskDelete(NULL);
+}
+
+esp_err_t boot_run(const boot_phase_t *phases, size_t count, TickType_t timeout) {
+    if (!phases || count == 0 || count > BOOT_MAX_PHASES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 依赖只能指向表中已声明的阶段，且不能依赖自己
+    for (size_t i = 0; i < count; i++) {
+        if ((phases[i].deps >> count) != 0 || (phases[i].deps & BOOT_DEP(i))) {
+            ESP_LOGE(TAG, "Invalid dependencies for %s", phases[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (!s_boot_group) {
+        s_boot_group = xEventGroupCreate();
+        if (!s_boot_group) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xEventGroupClearBits(s_boot_group, 0x00FFFFFF);
+    memset(s_timings, 0, sizeof(s_timings));
+    s_failed = 0;
+    s_phases = phases;
+    s_boot_start = esp_timer_get_time();
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t stack = phases[i].stack_size ? phases[i].stack_size : BOOT_DEFAULT_STACK;
+        if (xTaskCreate(boot_phase_task, phases[i].name, stack, (void *)i, BOOT_TASK_PRIO, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create task for %s", phases[i].name);
+            s_timings[i].result = ESP_ERR_NO_MEM;
+            __atomic_or_fetch(&s_failed, BOOT_DEP(i), __ATOMIC_RELEASE);
+            xEventGroupSetBits(s_boot_group, BOOT_DEP(i));
+        }
+    }
+
+    uint32_t all_bits = BOOT_DEP(count) - 1;
+    EventBits_t bits = xEventGroupWaitBits(s_boot_group, all_bits, pdFALSE, pdTRUE, timeout);
+    int64_t total_us = esp_timer_get_time() - s_boot_start;
+
+    // 打印启动时间线
+    uint64_t serial_us = 0;
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < count; i++) {
+        const boot_timing_t *t = &s_timings[i];
+        if (!(bits & BOOT_DEP(i))) {
+            ESP_LOGE(TAG, "  %-10s did not finish", phases[i].name);
+            ret = ESP_ERR_TIMEOUT;
+            continue;
+        }
+        ESP_LOGI(TAG, "  %-10s ready=%5lldms done=%5lldms run=%5lums %s",
+                 phases[i].name, t->ready_us / 1000, t->done_us / 1000, t->run_us / 1000,
+                 t->result == ESP_OK ? "" : esp_err_to_name(t->result));
+        serial_us += t->run_us;
+        if (t->result != ESP_OK && ret == ESP_OK) {
+            ret = t->result;
+        }
+    }
+    ESP_LOGI(TAG, "Time to ready: %lldms (serial boot would take %llums)",
+             total_us / 1000, serial_us / 1000);
+
+    return ret;
+}
+
+void boot_get_timing(size_t index, boot_timing_t *timing) {
+    if (index < BOOT_MAX_PHASES && timing) {
+        *timing = s_timings[index];
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * 并行启动编排
+ * 每个启动阶段在独立任务中运行，只等待自己声明的依赖（如"播放器依赖编解码器"、
+ * "轮询依赖IP"），WiFi关联和编解码器/I2S初始化因此可以同时进行。
+ */
+
+#define BOOT_MAX_PHASES        16
+#define BOOT_DEP(id)           (1UL << (id))
+#define BOOT_DEFAULT_STACK     3072
+#define BOOT_TASK_PRIO         5
+
+typedef struct {
+    const char *name;
+    esp_err_t (*run)(void);
+    uint32_t deps;              // BOOT_DEP(...)按位或
+    uint32_t stack_size;        // 0使用BOOT_DEFAULT_STACK
+} boot_phase_t;
+
+/* 每个阶段的耗时，时间相对boot_run开始 */
+typedef struct {
+    int64_t ready_us;           // 依赖满足的时刻
+    int64_t done_us;            // 阶段完成的时刻
+    uint32_t run_us;            // 阶段自身运行时间
+    esp_err_t result;           // 依赖失败被跳过时为ESP_ERR_INVALID_STATE
+} boot_timing_t;
+
+/* 并行运行所有阶段并等待完成，任一阶段失败返回其错误码 */
+esp_err_t boot_run(const boot_phase_t *phases, size_t count, TickType_t timeout);
+
+/* 获取阶段耗时 */
+void boot_get_timing(size_t index, boot_timing_t *timing);
+
+#endif /* BOOT_H */
@@ -0,0 +1,290 @@
+#include "clip_cache.h"
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+static const char *TAG = "CLIP_CACHE";
+
+static const esp_partition_t *s_partition = NULL;
+static clip_index_t s_index;
+static clip_cache_stats_t s_stats;
+static uint32_t s_unflushed_hits = 0;
+static uint64_t s_verified = 0;                 // 本次启动后已校验过CRC的项（按项下标）
+static esp_partition_mmap_handle_t s_map_handle;
+static bool s_mapped = false;
+
+static size_t block_offset(uint16_t block) {
+    return CLIP_CACHE_DATA_OFFSET + (size_t)block * CLIP_INDEX_BLOCK_SIZE;
+}
+
+/* 序号为seq的索引保存在第seq%2个扇区 */
+static esp_err_t read_index_copy(int sector, clip_index_t *idx) {
+    return esp_partition_read(s_partition, sector * CLIP_CACHE_INDEX_SECTOR, idx, sizeof(*idx));
+}
+
+static esp_err_t write_index(void) {
+    clip_index_seal(&s_index);
+    size_t offset = (s_index.seq % 2) * CLIP_CACHE_INDEX_SECTOR;
+
+    esp_err_t err = esp_partition_erase_range(s_partition, offset, CLIP_CACHE_INDEX_SECTOR);
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_partition, offset, &s_index, sizeof(s_index));
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Index write failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_stats.index_writes++;
+    s_unflushed_hits = 0;
+    return ESP_OK;
+}
+
+/* 数据CRC不符：删除该项 */
+static void drop_corrupt(int entry, const char *key) {
+    ESP_LOGW(TAG, "Cached clip %s failed CRC check, dropping it", key);
+    s_stats.corrupt++;
+    s_verified &= ~(1ULL << entry);
+    clip_index_remove(&s_index, entry);
+    write_index();
+}
+
+/* 命中：更新LRU，累计CLIP_CACHE_FLUSH_HITS次后写回索引 */
+static void note_hit(int entry, const char *key, int64_t start_us, const char *how) {
+    clip_index_touch(&s_index, entry);
+    s_stats.hits++;
+    if (++s_unflushed_hits >= CLIP_CACHE_FLUSH_HITS) {
+        write_index();
+    }
+    ESP_LOGI(TAG, "Hit %s (%s): %u bytes ready in %u us", key, how, (unsigned)s_index.entries[entry].size,
+             (unsigned)(esp_timer_get_time() - start_us));
+}
+
+esp_err_t clip_cache_init(void) {
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                           CLIP_CACHE_PARTITION_LABEL);
+    if (!s_partition || s_partition->size <= CLIP_CACHE_DATA_OFFSET) {
+        ESP_LOGW(TAG, "No '%s' partition, clip cache disabled", CLIP_CACHE_PARTITION_LABEL);
+        s_partition = NULL;
+        return ESP_ERR_NOT_FOUND;
+    }
+    _Static_assert(sizeof(clip_index_t) <= CLIP_CACHE_INDEX_SECTOR, "clip index must fit one sector");
+
+    uint16_t blocks = (s_partition->size - CLIP_CACHE_DATA_OFFSET) / CLIP_INDEX_BLOCK_SIZE;
+    if (blocks > CLIP_INDEX_MAX_BLOCKS) {
+        blocks = CLIP_INDEX_MAX_BLOCKS;
+    }
+
+    // 两个扇区中取序号较大的有效副本，写索引中途掉电时另一份仍然可用
+    clip_index_t *other = malloc(sizeof(clip_index_t));
+    if (!other) {
+        return ESP_ERR_NO_MEM;
+    }
+    bool valid0 = read_index_copy(0, &s_index) == ESP_OK && clip_index_valid(&s_index, blocks);
+    bool valid1 = read_index_copy(1, other) == ESP_OK && clip_index_valid(other, blocks);
+    if (valid1 && (!valid0 || other->seq > s_index.seq)) {
+        memcpy(&s_index, other, sizeof(s_index));
+    }
+    free(other);
+
+    if (!valid0 && !valid1) {
+        ESP_LOGW(TAG, "No valid index, formatting %d blocks", blocks);
+        clip_index_init(&s_index, blocks);
+        esp_err_t err = write_index();
+        if (err != ESP_OK) {
+            s_partition = NULL;
+            return err;
+        }
+    }
+
+    s_stats.capacity = (size_t)s_index.block_count * CLIP_INDEX_BLOCK_SIZE;
+    clip_cache_log_stats();
+    return ESP_OK;
+}
+
+bool clip_cache_contains(const char *key) {
+    return s_partition && key[0] != '\0' && clip_index_find(&s_index, key) >= 0;
+}
+
+esp_err_t clip_cache_load(const char *key, audio_clip_t *clip) {
+    int entry = (s_partition && key[0] != '\0') ? clip_index_find(&s_index, key) : -1;
+    if (entry < 0) {
+        s_stats.misses++;
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const clip_index_entry_t *e = &s_index.entries[entry];
+    int64_t start_us = esp_timer_get_time();
+    size_t base = block_offset(e->first_block);
+    size_t pos = 0;
+    uint32_t crc = 0;
+    esp_err_t err = ESP_OK;
+
+    // 直接读入段池，不经过中转缓冲区
+    while (pos < e->size) {
+        size_t space;
+        uint8_t *dst = audio_clip_reserve(clip, AUDIO_SEGMENT_COUNT, &space);
+        if (!dst) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        size_t len = (e->size - pos) < space ? (e->size - pos) : space;
+        err = esp_partition_read(s_partition, base + pos, dst, len);
+        if (err != ESP_OK) {
+            break;
+        }
+        crc = clip_index_crc32(crc, dst, len);
+        audio_clip_commit(clip, len);
+        pos += len;
+    }
+
+    if (err == ESP_OK && crc != e->crc) {
+        drop_corrupt(entry, key);
+        err = ESP_ERR_INVALID_CRC;
+    }
+    if (err != ESP_OK) {
+        audio_clip_release(clip);
+        s_stats.misses++;
+        return err;
+    }
+
+    s_verified |= 1ULL << entry;
+    note_hit(entry, key, start_us, "read");
+    return ESP_OK;
+}
+
+esp_err_t clip_cache_map(const char *key, audio_clip_t *clip) {
+    int entry = (s_partition && key[0] != '\0') ? clip_index_find(&s_index, key) : -1;
+    if (entry < 0) {
+        s_stats.misses++;
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    clip_cache_unmap();
+    const clip_index_entry_t *e = &s_index.entries[entry];
+    int64_t start_us = esp_timer_get_time();
+    const void *data = NULL;
+    esp_err_t err = esp_partition_mmap(s_partition, block_offset(e->first_block), e->size,
+                                       ESP_PARTITION_MMAP_DATA, &data, &s_map_handle);
+    if (err != ESP_OK) {
+        // MMU页用完等情况由调用方退回clip_cache_load，不计入未命中
+        ESP_LOGW(TAG, "mmap of %s failed: %s", key, esp_err_to_name(err));
+        return err;
+    }
+    s_mapped = true;
+
+    // 数据写入后不再改变，每次启动只需校验一次
+    if (!(s_verified & (1ULL << entry))) {
+        if (clip_index_crc32(0, data, e->size) != e->crc) {
+            clip_cache_unmap();
+            drop_corrupt(entry, key);
+            s_stats.misses++;
+            return ESP_ERR_INVALID_CRC;
+        }
+        s_verified |= 1ULL << entry;
+    }
+
+    audio_clip_attach(clip, (const uint8_t *)data, e->size);
+    s_stats.mapped_hits++;
+    note_hit(entry, key, start_us, "mapped");
+    return ESP_OK;
+}
+
+void clip_cache_unmap(void) {
+    if (s_mapped) {
+        esp_partition_munmap(s_map_handle);
+        s_mapped = false;
+    }
+}
+
+esp_err_t clip_cache_store(const char *key, const audio_clip_t *clip) {
+    if (!s_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t size = audio_clip_available(clip);
+    if (size == 0 || size > CLIP_CACHE_MAX_CLIP || clip->released_count != 0 || !audio_clip_is_complete(clip)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 正在映射的块可能被淘汰并擦除
+    clip_cache_unmap();
+
+    int evicted = 0;
+    int entry = clip_index_alloc(&s_index, key, size, &evicted);
+    if (entry < 0) {
+        s_stats.store_failures++;
+        return ESP_ERR_NO_MEM;
+    }
+    s_verified &= ~(1ULL << entry);
+    s_stats.evictions += evicted;
+
+    // 先写数据再写索引：中途掉电时旧索引里被覆盖的项会在命中时CRC校验失败并被丢弃
+    int64_t start_us = esp_timer_get_time();
+    const clip_index_entry_t *e = &s_index.entries[entry];
+    uint32_t crc = 0;
+    esp_err_t err = ESP_OK;
+    for (uint16_t i = 0; i < e->block_count && err == ESP_OK; i++) {
+        uint16_t block = e->first_block + i;
+        size_t len = size - (size_t)i * CLIP_INDEX_BLOCK_SIZE;
+        if (len > CLIP_INDEX_BLOCK_SIZE) {
+            len = CLIP_INDEX_BLOCK_SIZE;
+        }
+
+        err = esp_partition_erase_range(s_partition, block_offset(block), CLIP_INDEX_BLOCK_SIZE);
+        if (err != ESP_OK) {
+            break;
+        }
+        clip_index_note_erase(&s_index, block);
+
+        // 段和块同为64KB，第i段正好写入第i块
+        const uint8_t *src = clip->segments[i];
+        err = esp_partition_write(s_partition, block_offset(block), src, len);
+        crc = clip_index_crc32(crc, src, len);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Store %s failed: %s", key, esp_err_to_name(err));
+        clip_index_remove(&s_index, entry);
+        write_index();
+        s_stats.store_failures++;
+        return err;
+    }
+
+    clip_index_commit(&s_index, entry, crc);
+    err = write_index();
+    if (err == ESP_OK) {
+        s_stats.stores++;
+        ESP_LOGI(TAG, "Stored %s: %u bytes in blocks %u-%u (%d evicted) in %u ms", key, (unsigned)size,
+                 e->first_block, e->first_block + e->block_count - 1, evicted,
+                 (unsigned)((esp_timer_get_time() - start_us) / 1000));
+    }
+    return err;
+}
+
+esp_err_t clip_cache_flush(void) {
+    if (!s_partition || s_unflushed_hits == 0) {
+        return ESP_OK;
+    }
+    return write_index();
+}
+
+void clip_cache_get_stats(clip_cache_stats_t *stats) {
+    *stats = s_stats;
+    if (s_partition) {
+        stats->entries = clip_index_entry_count(&s_index);
+        stats->used_bytes = clip_index_used_blocks(&s_index) * CLIP_INDEX_BLOCK_SIZE;
+        stats->max_erase = clip_index_max_erase(&s_index);
+    }
+}
+
+void clip_cache_log_stats(void) {
+    clip_cache_stats_t stats;
+    clip_cache_get_stats(&stats);
+    ESP_LOGI(TAG, "Clip cache: %d entries, %d/%d KB, hits=%u (mapped %u) misses=%u stores=%u evictions=%u "
+             "corrupt=%u, max block erases=%u, index writes=%u",
+             stats.entries, stats.used_bytes / 1024, stats.capacity / 1024,
+             (unsigned)stats.hits, (unsigned)stats.mapped_hits, (unsigned)stats.misses, (unsigned)stats.stores,
+             (unsigned)stats.evictions, (unsigned)stats.corrupt, stats.max_erase,
+             (unsigned)stats.index_writes);
+}
@@ -0,0 +1,67 @@
+#ifndef CLIP_CACHE_H
+#define CLIP_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audio_pool.h"
+#include "clip_index.h"
+
+/**
+ * 片段缓存 - 重复的TTS提示音（问候、"没听清"、确认）存放在专用flash分区中，
+ * 按内容哈希（X-Content-Hash响应头或任务中的hash字段）或audio_id查找，
+ * 命中时把片段所在的块用esp_partition_mmap映射后直接播放（映射失败时读入段池），
+ * 不产生任何网络流量，也不占用PSRAM。
+ * 分区开头两个扇区交替保存索引，数据区按64KB块分配（见clip_index.h）。
+ * 只由轮询任务调用，不加锁。
+ */
+
+#define CLIP_CACHE_PARTITION_LABEL  "clipcache"
+#define CLIP_CACHE_INDEX_SECTOR     4096
+#define CLIP_CACHE_DATA_OFFSET      CLIP_INDEX_BLOCK_SIZE   // 第一个64KB块留给索引
+#define CLIP_CACHE_MAX_CLIP         (512 * 1024)            // 更长的片段不缓存
+#define CLIP_CACHE_FLUSH_HITS       8                       // 命中只更新内存中的LRU，累计N次再写索引
+
+typedef struct {
+    uint32_t hits;
+    uint32_t mapped_hits;       // 通过flash映射播放的命中
+    uint32_t misses;
+    uint32_t stores;
+    uint32_t store_failures;
+    uint32_t evictions;
+    uint32_t corrupt;           // 数据CRC不符而丢弃的项
+    uint32_t index_writes;
+    size_t entries;
+    size_t used_bytes;
+    size_t capacity;
+    uint16_t max_erase;         // 数据块的最大擦除次数
+} clip_cache_stats_t;
+
+/* 打开分区并加载索引；没有缓存分区时返回ESP_ERR_NOT_FOUND，其余接口按未命中处理 */
+esp_err_t clip_cache_init(void);
+
+/* 是否已缓存（不计入命中统计） */
+bool clip_cache_contains(const char *key);
+
+/* 命中时把片段读入clip并返回ESP_OK；未命中返回ESP_ERR_NOT_FOUND，数据损坏返回ESP_ERR_INVALID_CRC */
+esp_err_t clip_cache_load(const char *key, audio_clip_t *clip);
+
+/* 命中时把片段映射到地址空间并挂到clip上（不复制、不占PSRAM）；每次启动后首次映射某项时校验CRC。
+ * 同时只保持一个映射，播放结束、clip释放后调用clip_cache_unmap */
+esp_err_t clip_cache_map(const char *key, audio_clip_t *clip);
+
+/* 解除当前映射 */
+void clip_cache_unmap(void);
+
+/* 把完整的片段写入缓存，必要时淘汰旧项；clip在写入期间不能被释放 */
+esp_err_t clip_cache_store(const char *key, const audio_clip_t *clip);
+
+/* 把内存中的LRU信息写回flash */
+esp_err_t clip_cache_flush(void);
+
+/* 获取/打印统计 */
+void clip_cache_get_stats(clip_cache_stats_t *stats);
+void clip_cache_log_stats(void);
+
+#endif /* CLIP_CACHE_H */
@@ -0,0 +1,258 @@
+#include "clip_index.h"
+#include <string.h>
+
+static bool entry_in_use(const clip_index_entry_t *e) {
+    return (e->flags & (CLIP_INDEX_FLAG_PENDING | CLIP_INDEX_FLAG_VALID)) != 0;
+}
+
+uint32_t clip_index_crc32(uint32_t crc, const void *data, size_t len) {
+    // 半字节查表，不占用额外的1KB表空间
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    const uint8_t *p = (const uint8_t *)data;
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t index_crc(const clip_index_t *idx) {
+    return clip_index_crc32(0, idx, offsetof(clip_index_t, crc));
+}
+
+void clip_index_init(clip_index_t *idx, uint16_t block_count) {
+    memset(idx, 0, sizeof(*idx));
+    idx->magic = CLIP_INDEX_MAGIC;
+    idx->version = CLIP_INDEX_VERSION;
+    idx->block_count = block_count < CLIP_INDEX_MAX_BLOCKS ? block_count : CLIP_INDEX_MAX_BLOCKS;
+    idx->crc = index_crc(idx);
+}
+
+bool clip_index_valid(const clip_index_t *idx, uint16_t block_count) {
+    if (block_count > CLIP_INDEX_MAX_BLOCKS) {
+        block_count = CLIP_INDEX_MAX_BLOCKS;
+    }
+    if (idx->magic != CLIP_INDEX_MAGIC || idx->version != CLIP_INDEX_VERSION ||
+        idx->block_count != block_count || idx->crc != index_crc(idx)) {
+        return false;
+    }
+    // 损坏的项不能指向分区外
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        const clip_index_entry_t *e = &idx->entries[i];
+        if (entry_in_use(e) && (size_t)e->first_block + e->block_count > idx->block_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void clip_index_seal(clip_index_t *idx) {
+    idx->seq++;
+    idx->crc = index_crc(idx);
+}
+
+int clip_index_find(const clip_index_t *idx, const char *key) {
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        const clip_index_entry_t *e = &idx->entries[i];
+        if ((e->flags & CLIP_INDEX_FLAG_VALID) && strncmp(e->key, key, CLIP_INDEX_KEY_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void clip_index_touch(clip_index_t *idx, int entry) {
+    clip_index_entry_t *e = &idx->entries[entry];
+    e->last_used = ++idx->clock;
+    e->hits++;
+}
+
+void clip_index_remove(clip_index_t *idx, int entry) {
+    memset(&idx->entries[entry], 0, sizeof(idx->entries[entry]));
+}
+
+/* 已被占用的块标记为1 */
+static void build_block_map(const clip_index_t *idx, uint8_t *used) {
+    memset(used, 0, CLIP_INDEX_MAX_BLOCKS);
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        const clip_index_entry_t *e = &idx->entries[i];
+        if (entry_in_use(e)) {
+            memset(used + e->first_block, 1, e->block_count);
+        }
+    }
+}
+
+/* 在空闲块中找need块的连续区域：先比最大擦除次数，再比总擦除次数，返回起始块或-1 */
+static int find_run(const clip_index_t *idx, const uint8_t *used, uint16_t need) {
+    int best = -1;
+    uint32_t best_max = UINT32_MAX;
+    uint32_t best_sum = UINT32_MAX;
+    uint16_t run = 0;
+
+    for (uint16_t b = 0; b < idx->block_count; b++) {
+        run = used[b] ? 0 : run + 1;
+        if (run < need) {
+            continue;
+        }
+        uint16_t start = b + 1 - need;
+        uint32_t max = 0;
+        uint32_t sum = 0;
+        for (uint16_t i = start; i <= b; i++) {
+            uint16_t count = idx->erase_count[i];
+            if (count > max) {
+                max = count;
+            }
+            sum += count;
+        }
+        if (max < best_max || (max == best_max && sum < best_sum)) {
+            best = start;
+            best_max = max;
+            best_sum = sum;
+        }
+    }
+    return best;
+}
+
+/* 从最久未用的几项中选块擦除次数最少的一项 */
+static int pick_victim(const clip_index_t *idx) {
+    int window[CLIP_INDEX_EVICT_WINDOW];
+    int count = 0;
+
+    // 按last_used从小到大取前EVICT_WINDOW项
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        const clip_index_entry_t *e = &idx->entries[i];
+        if (!(e->flags & CLIP_INDEX_FLAG_VALID)) {
+            continue;
+        }
+        int pos = count < CLIP_INDEX_EVICT_WINDOW ? count++ : CLIP_INDEX_EVICT_WINDOW;
+        while (pos > 0 && idx->entries[window[pos - 1]].last_used > e->last_used) {
+            if (pos < CLIP_INDEX_EVICT_WINDOW) {
+                window[pos] = window[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < CLIP_INDEX_EVICT_WINDOW) {
+            window[pos] = i;
+        }
+    }
+    if (count == 0) {
+        return -1;
+    }
+
+    int victim = window[0];
+    uint32_t victim_wear = UINT32_MAX;
+    for (int w = 0; w < count; w++) {
+        const clip_index_entry_t *e = &idx->entries[window[w]];
+        uint32_t wear = 0;
+        for (uint16_t b = 0; b < e->block_count; b++) {
+            wear += idx->erase_count[e->first_block + b];
+        }
+        wear /= e->block_count ? e->block_count : 1;
+        if (wear < victim_wear) {
+            victim = window[w];
+            victim_wear = wear;
+        }
+    }
+    return victim;
+}
+
+int clip_index_alloc(clip_index_t *idx, const char *key, uint32_t size, int *evicted) {
+    uint16_t need = (uint16_t)((size + CLIP_INDEX_BLOCK_SIZE - 1) / CLIP_INDEX_BLOCK_SIZE);
+    uint8_t used[CLIP_INDEX_MAX_BLOCKS];
+    int slot = -1;
+
+    if (evicted) {
+        *evicted = 0;
+    }
+    if (size == 0 || need > idx->block_count || key[0] == '\0' || strlen(key) >= CLIP_INDEX_KEY_LEN) {
+        return -1;
+    }
+
+    // 回收上次未写完的项和同键的旧项
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        clip_index_entry_t *e = &idx->entries[i];
+        if ((e->flags & CLIP_INDEX_FLAG_PENDING) ||
+            ((e->flags & CLIP_INDEX_FLAG_VALID) && strncmp(e->key, key, CLIP_INDEX_KEY_LEN) == 0)) {
+            clip_index_remove(idx, i);
+        }
+    }
+
+    while (1) {
+        slot = -1;
+        for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES && slot < 0; i++) {
+            if (!entry_in_use(&idx->entries[i])) {
+                slot = i;
+            }
+        }
+        build_block_map(idx, used);
+        int start = slot >= 0 ? find_run(idx, used, need) : -1;
+        if (start >= 0) {
+            clip_index_entry_t *e = &idx->entries[slot];
+            memset(e, 0, sizeof(*e));
+            strncpy(e->key, key, CLIP_INDEX_KEY_LEN - 1);
+            e->first_block = (uint16_t)start;
+            e->block_count = need;
+            e->size = size;
+            e->flags = CLIP_INDEX_FLAG_PENDING;
+            return slot;
+        }
+
+        int victim = pick_victim(idx);
+        if (victim < 0) {
+            return -1;
+        }
+        clip_index_remove(idx, victim);
+        if (evicted) {
+            (*evicted)++;
+        }
+    }
+}
+
+void clip_index_note_erase(clip_index_t *idx, uint16_t block) {
+    if (block < idx->block_count && idx->erase_count[block] < UINT16_MAX) {
+        idx->erase_count[block]++;
+    }
+}
+
+void clip_index_commit(clip_index_t *idx, int entry, uint32_t crc) {
+    clip_index_entry_t *e = &idx->entries[entry];
+    e->crc = crc;
+    e->flags = CLIP_INDEX_FLAG_VALID;
+    e->last_used = ++idx->clock;
+}
+
+size_t clip_index_entry_count(const clip_index_t *idx) {
+    size_t count = 0;
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        if (idx->entries[i].flags & CLIP_INDEX_FLAG_VALID) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t clip_index_used_blocks(const clip_index_t *idx) {
+    size_t blocks = 0;
+    for (int i = 0; i < CLIP_INDEX_MAX_ENTRIES; i++) {
+        if (entry_in_use(&idx->entries[i])) {
+            blocks += idx->entries[i].block_count;
+        }
+    }
+    return blocks;
+}
+
+uint16_t clip_index_max_erase(const clip_index_t *idx) {
+    uint16_t max = 0;
+    for (uint16_t b = 0; b < idx->block_count; b++) {
+        if (idx->erase_count[b] > max) {
+            max = idx->erase_count[b];
+        }
+    }
+    return max;
+}
@@ -0,0 +1,86 @@
+#ifndef CLIP_INDEX_H
+#define CLIP_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 片段缓存索引 - 与存储无关的部分（可在主机上测试）
+ * 缓存分区按64KB块管理，每个片段占一段连续的块（便于整段读取或映射）。
+ * 索引记录每个片段的键、位置、长度、数据CRC和LRU时钟，以及每个块的擦除次数：
+ *   - 放置：在所有放得下的连续空闲块中选擦除次数最少的一段
+ *   - 淘汰：从最久未用的几项中选块擦除次数最少的一项，LRU近似换取磨损均衡
+ * 索引整体带CRC，由调用方在两个扇区间交替写入，上电时取序号较大的有效副本。
+ */
+
+#define CLIP_INDEX_MAGIC          0x43504C43u   // "CLPC"
+#define CLIP_INDEX_VERSION        1
+#define CLIP_INDEX_BLOCK_SIZE     (64 * 1024)
+#define CLIP_INDEX_MAX_BLOCKS     128
+#define CLIP_INDEX_MAX_ENTRIES    48
+#define CLIP_INDEX_KEY_LEN        48
+#define CLIP_INDEX_EVICT_WINDOW   3             // 淘汰时比较的最久未用项数
+
+#define CLIP_INDEX_FLAG_PENDING   0x1           // 已分配块，数据尚未写完
+#define CLIP_INDEX_FLAG_VALID     0x2           // 数据完整，可以命中
+
+typedef struct {
+    char key[CLIP_INDEX_KEY_LEN];
+    uint16_t first_block;
+    uint16_t block_count;
+    uint32_t size;
+    uint32_t crc;                   // 数据的CRC-32
+    uint32_t last_used;             // LRU时钟
+    uint32_t hits;
+    uint32_t flags;
+} clip_index_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_count;           // 数据块数
+    uint32_t seq;                   // 每次封存加1
+    uint32_t clock;                 // LRU时钟
+    clip_index_entry_t entries[CLIP_INDEX_MAX_ENTRIES];
+    uint16_t erase_count[CLIP_INDEX_MAX_BLOCKS];
+    uint32_t crc;                   // 以上内容的CRC-32
+} clip_index_t;
+
+/* 标准CRC-32（与zlib相同），crc初值为0，可分段累加 */
+uint32_t clip_index_crc32(uint32_t crc, const void *data, size_t len);
+
+/* 建立空索引 */
+void clip_index_init(clip_index_t *idx, uint16_t block_count);
+
+/* 检查从存储读回的索引是否完整且与分区大小一致 */
+bool clip_index_valid(const clip_index_t *idx, uint16_t block_count);
+
+/* 写入存储前调用：序号加1并更新CRC */
+void clip_index_seal(clip_index_t *idx);
+
+/* 按键查找，返回项下标，未找到返回-1 */
+int clip_index_find(const clip_index_t *idx, const char *key);
+
+/* 命中：更新LRU时钟和命中次数 */
+void clip_index_touch(clip_index_t *idx, int entry);
+
+/* 删除一项（只改索引，数据块变为空闲） */
+void clip_index_remove(clip_index_t *idx, int entry);
+
+/* 为size字节分配连续块，必要时淘汰旧项；返回待写入的新项下标，放不下返回-1。
+ * 上次未写完的项先被回收。evicted可为NULL，返回淘汰的项数 */
+int clip_index_alloc(clip_index_t *idx, const char *key, uint32_t size, int *evicted);
+
+/* 数据块擦除后记账 */
+void clip_index_note_erase(clip_index_t *idx, uint16_t block);
+
+/* 数据写完后填写CRC并标记为最近使用 */
+void clip_index_commit(clip_index_t *idx, int entry, uint32_t crc);
+
+/* 统计 */
+size_t clip_index_entry_count(const clip_index_t *idx);
+size_t clip_index_used_blocks(const clip_index_t *idx);
+uint16_t clip_index_max_erase(const clip_index_t *idx);
+
+#endif /* CLIP_INDEX_H */
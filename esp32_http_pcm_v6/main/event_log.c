@@ -0,0 +1,80 @@
+#include "event_log.h"
+#include <string.h>
+
+bool event_log_init(event_log_t *log, event_record_t *records, uint32_t capacity) {
+    if (!records || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    log->records = records;
+    log->capacity = capacity;
+    atomic_store(&log->head, 0);
+    atomic_store(&log->writers, 0);
+    atomic_store(&log->dropped, 0);
+    atomic_store(&log->paused, false);
+    return true;
+}
+
+void event_log_write(event_log_t *log, uint32_t time_us, uint8_t type, uint8_t core,
+                     uint16_t aux, uint32_t a, uint32_t b) {
+    // 先登记再检查暂停标志，导出方看到writers为0后就不会再有人写入
+    atomic_fetch_add(&log->writers, 1);
+    if (atomic_load(&log->paused)) {
+        atomic_fetch_sub(&log->writers, 1);
+        atomic_fetch_add(&log->dropped, 1);
+        return;
+    }
+
+    uint32_t index = atomic_fetch_add_explicit(&log->head, 1, memory_order_relaxed);
+    event_record_t *r = &log->records[index & (log->capacity - 1)];
+    r->time_us = time_us;
+    r->type = type;
+    r->core = core;
+    r->aux = aux;
+    r->a = a;
+    r->b = b;
+    atomic_fetch_sub_explicit(&log->writers, 1, memory_order_release);
+}
+
+void event_log_pause(event_log_t *log) {
+    atomic_store(&log->paused, true);
+}
+
+bool event_log_quiescent(const event_log_t *log) {
+    return atomic_load_explicit(&log->writers, memory_order_acquire) == 0;
+}
+
+void event_log_resume(event_log_t *log, bool clear) {
+    // 丢弃数不清零：导出期间丢掉的事件在下一次导出的头中报告
+    if (clear) {
+        atomic_store(&log->head, 0);
+    }
+    atomic_store(&log->paused, false);
+}
+
+uint32_t event_log_spans(const event_log_t *log, const event_record_t **first, uint32_t *first_count,
+                         const event_record_t **second, uint32_t *second_count) {
+    uint32_t head = atomic_load(&log->head);
+    uint32_t count = head < log->capacity ? head : log->capacity;
+    uint32_t start = (head - count) & (log->capacity - 1);
+
+    *first = &log->records[start];
+    *first_count = count < log->capacity - start ? count : log->capacity - start;
+    *second = log->records;
+    *second_count = count - *first_count;
+    return count;
+}
+
+void event_log_build_header(const event_log_t *log, uint32_t task_count, event_log_header_t *header) {
+    uint32_t head = atomic_load(&log->head);
+    uint32_t count = head < log->capacity ? head : log->capacity;
+
+    memset(header, 0, sizeof(*header));
+    header->magic = EVENT_LOG_MAGIC;
+    header->version = EVENT_LOG_VERSION;
+    header->record_size = sizeof(event_record_t);
+    header->task_count = task_count;
+    header->record_count = count;
+    header->first_index = head - count;
+    header->dropped = atomic_load(&log->dropped);
+    header->capacity = log->capacity;
+}
@@ -0,0 +1,101 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * 二进制事件日志（不依赖ESP-IDF，可在主机上测试）
+ * 定长16字节记录写入调用者提供的环形存储（设备上在PSRAM中），写满后覆盖最旧的记录。
+ * 写入方（包括中断和调度器钩子）只做一次原子加法领取槽位，不加锁；
+ * 导出前暂停写入并等待正在写的一方完成，导出期间产生的事件计入丢弃数。
+ * 原子变量都在日志结构体中，结构体必须放在内部RAM（PSRAM不支持原子指令）。
+ * 槽位不带序号：被抢占的写入方若在写完前被其他写入方整圈追上（设备上16384条，远大于一次抢占
+ * 期间的事件数），该槽可能混有两条记录的字段，转换工具会拒绝其中非法的事件类型。
+ *
+ * 导出格式（小端）：event_log_header_t、task_count个event_log_task_t、
+ * record_count条event_record_t（从旧到新），由tools/event_trace_to_chrome.py转换为Chrome trace JSON。
+ */
+
+#define EVENT_LOG_MAGIC         0x474C5645u     // "EVLG"
+#define EVENT_LOG_VERSION       1
+#define EVENT_LOG_TASK_NAME_LEN 16
+
+/* 事件类型 */
+typedef enum {
+    EVENT_TASK_SWITCH = 1,      // a=切入的任务句柄
+    EVENT_I2S_SENT,             // a=DMA缓冲区字节数（一个DMA缓冲区播放完）
+    EVENT_I2S_UNDERFLOW,        // 发送队列溢出，DMA在没有新数据时重复/清零
+    EVENT_HTTP,                 // aux=esp_http_client_event_id_t, a=数据长度, b=客户端句柄
+    EVENT_HTTP_READ,            // 拉模式读取：a=字节数, b=阻塞时间(us)，time为读取结束
+    EVENT_ALLOC,                // aux=堆类型标志, a=指针, b=字节数
+    EVENT_FREE,                 // a=指针
+    EVENT_MARK,                 // 延迟追踪点：aux=latency_point_t, a=回合, b=附加值
+    EVENT_TYPE_COUNT
+} event_type_t;
+
+/* EVENT_ALLOC的aux */
+#define EVENT_ALLOC_INTERNAL    0x1
+#define EVENT_ALLOC_SPIRAM      0x2
+#define EVENT_ALLOC_DMA         0x4
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;           // esp_timer的低32位，约71分钟回绕一次，由转换工具展开
+    uint8_t type;
+    uint8_t core;
+    uint16_t aux;
+    uint32_t a;
+    uint32_t b;
+} event_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t task_count;
+    uint32_t record_count;
+    uint32_t first_index;       // 第一条导出记录的序号，之前的已被覆盖
+    uint32_t dropped;           // 启动以来暂停期间丢弃的事件数
+    uint32_t capacity;
+} event_log_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t handle;
+    char name[EVENT_LOG_TASK_NAME_LEN];
+} event_log_task_t;
+
+typedef struct {
+    event_record_t *records;    // 可以在PSRAM中
+    uint32_t capacity;          // 2的幂
+    _Atomic uint32_t head;      // 下一条记录的序号
+    _Atomic uint32_t writers;   // 正在写入的一方个数
+    _Atomic uint32_t dropped;
+    _Atomic bool paused;
+} event_log_t;
+
+/* 在records[capacity]上初始化，capacity必须是2的幂 */
+bool event_log_init(event_log_t *log, event_record_t *records, uint32_t capacity);
+
+/* 写入一条记录，可在中断中调用；暂停期间丢弃 */
+void event_log_write(event_log_t *log, uint32_t time_us, uint8_t type, uint8_t core,
+                     uint16_t aux, uint32_t a, uint32_t b);
+
+/* 暂停写入；之后仍可能有写入方在写，需等到event_log_quiescent返回true */
+void event_log_pause(event_log_t *log);
+
+/* 没有正在写的一方；被抢占的任务可能正持有槽位，设备上等待时要让出CPU */
+bool event_log_quiescent(const event_log_t *log);
+
+/* 恢复写入；clear为true时丢弃已导出的记录 */
+void event_log_resume(event_log_t *log, bool clear);
+
+/* 暂停状态下取出有效记录：最多两段连续存储，按从旧到新的顺序，返回记录总数 */
+uint32_t event_log_spans(const event_log_t *log, const event_record_t **first, uint32_t *first_count,
+                         const event_record_t **second, uint32_t *second_count);
+
+/* 填写导出头 */
+void event_log_build_header(const event_log_t *log, uint32_t task_count, event_log_header_t *header);
+
+#endif /* EVENT_LOG_H */
@@ -0,0 +1,262 @@
+#include "event_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_memory_utils.h"
+#include "esp_private/cache_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "http_client.h"
+#include "latency_trace.h"
+
+static const char *TAG = "EVENT_TRACE";
+
+// 日志结构体（含原子变量）在内部RAM，记录在PSRAM
+static event_log_t s_log;
+static volatile bool s_ready = false;
+static volatile bool s_dump_requested = false;
+
+/* 写入一条记录；缓存关闭时（flash操作期间）PSRAM不可访问，直接跳过 */
+static inline IRAM_ATTR void trace_write(event_type_t type, uint16_t aux, uint32_t a, uint32_t b) {
+    if (!s_ready || !spi_flash_cache_enabled()) {
+        return;
+    }
+    event_log_write(&s_log, (uint32_t)esp_timer_get_time(), (uint8_t)type,
+                    (uint8_t)esp_cpu_get_core_id(), aux, a, b);
+}
+
+/* latency_trace打点同时写入时间线 */
+static void latency_listener(uint16_t turn, latency_point_t point, uint32_t arg) {
+    trace_write(EVENT_MARK, (uint16_t)point, turn, arg);
+}
+
+esp_err_t event_trace_init(void) {
+#if EVENT_TRACE_ENABLED
+    event_record_t *records = heap_caps_malloc(EVENT_TRACE_RECORDS * sizeof(event_record_t), MALLOC_CAP_SPIRAM);
+    if (!records || !event_log_init(&s_log, records, EVENT_TRACE_RECORDS)) {
+        ESP_LOGE(TAG, "Failed to allocate %d trace records", EVENT_TRACE_RECORDS);
+        heap_caps_free(records);
+        return ESP_ERR_NO_MEM;
+    }
+    latency_trace_set_listener(latency_listener);
+    s_ready = true;
+    ESP_LOGI(TAG, "Event trace: %d records (%d KB PSRAM), sink %s", EVENT_TRACE_RECORDS,
+             (int)(EVENT_TRACE_RECORDS * sizeof(event_record_t) / 1024),
+             EVENT_TRACE_SINK == EVENT_TRACE_SINK_HTTP ? "http" : "uart");
+#endif
+    return ESP_OK;
+}
+
+void IRAM_ATTR event_trace_record(event_type_t type, uint16_t aux, uint32_t a, uint32_t b) {
+    trace_write(type, aux, a, b);
+}
+
+/* ==================== 事件来源 ==================== */
+
+void IRAM_ATTR event_trace_task_switched_in(void) {
+    trace_write(EVENT_TASK_SWITCH, 0, (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle(), 0);
+}
+
+static inline IRAM_ATTR uint16_t alloc_flags(void *ptr, uint32_t caps) {
+    uint16_t flags = esp_ptr_external_ram(ptr) ? EVENT_ALLOC_SPIRAM : EVENT_ALLOC_INTERNAL;
+    if (caps & MALLOC_CAP_DMA) {
+        flags |= EVENT_ALLOC_DMA;
+    }
+    return flags;
+}
+
+#if EVENT_TRACE_ENABLED && !CONFIG_HEAP_USE_HOOKS
+#warning "CONFIG_HEAP_USE_HOOKS未开启，时间线中不会有分配/释放事件"
+#endif
+
+/* CONFIG_HEAP_USE_HOOKS：每次分配/释放都会调用，可能在中断或缓存关闭时 */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    if (ptr && s_ready) {
+        trace_write(EVENT_ALLOC, alloc_flags(ptr, caps), (uint32_t)(uintptr_t)ptr, (uint32_t)size);
+    }
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+    if (ptr) {
+        trace_write(EVENT_FREE, 0, (uint32_t)(uintptr_t)ptr, 0);
+    }
+}
+
+void event_trace_http(const esp_http_client_event_t *evt) {
+    trace_write(EVENT_HTTP, (uint16_t)evt->event_id, evt->data_len > 0 ? (uint32_t)evt->data_len : 0,
+                (uint32_t)(uintptr_t)evt->client);
+}
+
+void event_trace_http_read(int64_t start_us, int bytes) {
+    trace_write(EVENT_HTTP_READ, 0, bytes > 0 ? (uint32_t)bytes : 0,
+                (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+/* ==================== 导出 ==================== */
+
+void event_trace_request_dump(void) {
+    if (s_ready) {
+        s_dump_requested = true;
+    }
+}
+
+bool event_trace_dump_pending(void) {
+    return s_dump_requested;
+}
+
+/* 导出目标：HTTP直接写入请求体；UART按48字节一行base64打印 */
+typedef struct {
+    esp_http_client_handle_t client;
+    uint8_t pending[48];
+    size_t pending_len;
+    esp_err_t err;
+} dump_sink_t;
+
+static void uart_emit_line(const uint8_t *data, size_t len) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char line[65];
+    size_t pos = 0;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        line[pos++] = alphabet[(v >> 18) & 0x3F];
+        line[pos++] = alphabet[(v >> 12) & 0x3F];
+        line[pos++] = i + 1 < len ? alphabet[(v >> 6) & 0x3F] : '=';
+        line[pos++] = i + 2 < len ? alphabet[v & 0x3F] : '=';
+    }
+    line[pos] = '\0';
+    printf("%s\n", line);
+}
+
+static void sink_write(dump_sink_t *sink, const void *data, size_t len) {
+    if (sink->err != ESP_OK || len == 0) {
+        return;
+    }
+#if EVENT_TRACE_SINK == EVENT_TRACE_SINK_HTTP
+    // PSRAM中的记录直接交给lwIP，不经中转缓冲区
+    if (esp_http_client_write(sink->client, (const char *)data, len) != (int)len) {
+        sink->err = ESP_FAIL;
+    }
+#else
+    const uint8_t *p = data;
+    while (len > 0) {
+        size_t n = sizeof(sink->pending) - sink->pending_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(sink->pending + sink->pending_len, p, n);
+        sink->pending_len += n;
+        p += n;
+        len -= n;
+        if (sink->pending_len == sizeof(sink->pending)) {
+            uart_emit_line(sink->pending, sink->pending_len);
+            sink->pending_len = 0;
+        }
+    }
+#endif
+}
+
+/* 任务名表：记录中只有句柄，转换工具据此显示任务名
+ * uxTaskGetSystemState需要CONFIG_FREERTOS_USE_TRACE_FACILITY，未开启时导出空表 */
+static uint32_t collect_tasks(event_log_task_t *tasks, uint32_t max) {
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    static TaskStatus_t status[EVENT_TRACE_MAX_TASKS];
+    UBaseType_t count = uxTaskGetSystemState(status, EVENT_TRACE_MAX_TASKS, NULL);
+
+    if (count > max) {
+        count = max;
+    }
+    for (UBaseType_t i = 0; i < count; i++) {
+        memset(&tasks[i], 0, sizeof(tasks[i]));
+        tasks[i].handle = (uint32_t)(uintptr_t)status[i].xHandle;
+        strncpy(tasks[i].name, status[i].pcTaskName, EVENT_LOG_TASK_NAME_LEN - 1);
+    }
+    return count;
+#else
+    (void)tasks;
+    (void)max;
+    return 0;
+#endif
+}
+
+esp_err_t event_trace_dump(void) {
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_dump_requested = false;
+
+    static event_log_task_t tasks[EVENT_TRACE_MAX_TASKS];
+    uint32_t task_count = collect_tasks(tasks, EVENT_TRACE_MAX_TASKS);
+
+    // 暂停后日志内容固定，导出期间（包括导出本身的分配和网络事件）的记录计入丢弃数
+    event_log_pause(&s_log);
+    while (!event_log_quiescent(&s_log)) {
+        vTaskDelay(1);
+    }
+
+    event_log_header_t header;
+    const event_record_t *first, *second;
+    uint32_t first_count, second_count;
+    uint32_t count = event_log_spans(&s_log, &first, &first_count, &second, &second_count);
+    event_log_build_header(&s_log, task_count, &header);
+    size_t total = sizeof(header) + task_count * sizeof(event_log_task_t) + count * sizeof(event_record_t);
+
+    dump_sink_t sink = { .err = ESP_OK };
+    int64_t start_us = esp_timer_get_time();
+
+#if EVENT_TRACE_SINK == EVENT_TRACE_SINK_HTTP
+    char url[160];
+    snprintf(url, sizeof(url), "%s%s?device_id=%s", TTS_SERVER_URL, EVENT_TRACE_UPLOAD_PATH, DEVICE_ID);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = 10000,
+    };
+    sink.client = esp_http_client_init(&config);
+    if (!sink.client) {
+        event_log_resume(&s_log, false);
+        return ESP_FAIL;
+    }
+    esp_http_client_set_header(sink.client, "Content-Type", "application/octet-stream");
+    sink.err = esp_http_client_open(sink.client, total);
+#else
+    printf("EVENT_TRACE_BEGIN %u\n", (unsigned)total);
+#endif
+
+    sink_write(&sink, &header, sizeof(header));
+    sink_write(&sink, tasks, task_count * sizeof(event_log_task_t));
+    sink_write(&sink, first, first_count * sizeof(event_record_t));
+    sink_write(&sink, second, second_count * sizeof(event_record_t));
+
+#if EVENT_TRACE_SINK == EVENT_TRACE_SINK_HTTP
+    if (sink.err == ESP_OK) {
+        esp_http_client_fetch_headers(sink.client);
+        int status = esp_http_client_get_status_code(sink.client);
+        if (status != 200) {
+            ESP_LOGW(TAG, "Trace upload rejected: HTTP %d", status);
+            sink.err = ESP_FAIL;
+        }
+    }
+    esp_http_client_close(sink.client);
+    esp_http_client_cleanup(sink.client);
+#else
+    if (sink.pending_len > 0) {
+        uart_emit_line(sink.pending, sink.pending_len);
+    }
+    printf("EVENT_TRACE_END\n");
+#endif
+
+    // 发送失败时保留记录，下次请求可以重试
+    event_log_resume(&s_log, sink.err == ESP_OK);
+
+    ESP_LOGI(TAG, "Trace dump: %u records, %u tasks, %u bytes, %u dropped so far, %lld ms (%s)",
+             (unsigned)count, (unsigned)task_count, (unsigned)total, (unsigned)header.dropped,
+             (esp_timer_get_time() - start_us) / 1000, esp_err_to_name(sink.err));
+    return sink.err;
+}
@@ -0,0 +1,53 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "event_log.h"
+
+/**
+ * 时间线追踪 - 把任务切换、I2S DMA、HTTP事件、堆分配和延迟追踪点写入PSRAM中的event_log，
+ * 导出后用tools/event_trace_to_chrome.py转换，在Perfetto/chrome://tracing中查看各任务的交错：
+ * audio_playback_task何时阻塞、tts_polling_task何时运行、I2S DMA何时排空。
+ *
+ * 事件来源：
+ *   - 任务切换：traceTASK_SWITCHED_IN钩子，需用-DEVENT_TRACE_TASK_SWITCH=ON构建（见顶层CMakeLists和trace_hooks.h）
+ *   - 堆分配：CONFIG_HEAP_USE_HOOKS的esp_heap_trace_alloc_hook/free_hook
+ *   - I2S：发送通道的on_sent/on_send_q_ovf回调，由i2s_monitor注册后转发
+ *   - HTTP：各事件回调和拉模式读取
+ * 服务器在轮询响应头X-Trace-Dump或推送事件trace中请求导出，当前片段播放完后按EVENT_TRACE_SINK发送。
+ */
+
+#define EVENT_TRACE_ENABLED     1
+#define EVENT_TRACE_RECORDS     16384               // 16字节/条，256KB PSRAM
+#define EVENT_TRACE_SINK_UART   0                   // base64打印到控制台，转换工具可直接读取串口日志
+#define EVENT_TRACE_SINK_HTTP   1                   // POST到服务器
+#define EVENT_TRACE_SINK        EVENT_TRACE_SINK_HTTP
+#define EVENT_TRACE_UPLOAD_PATH "/esp32/telemetry/trace"
+#define EVENT_TRACE_MAX_TASKS   24
+
+/* 在PSRAM中分配日志并开始记录 */
+esp_err_t event_trace_init(void);
+
+/* 记录一个HTTP客户端事件，在各event_handler开头调用 */
+void event_trace_http(const esp_http_client_event_t *evt);
+
+/* 记录一次拉模式读取，start_us为读取开始时间 */
+void event_trace_http_read(int64_t start_us, int bytes);
+
+/* 通用记录接口，可在中断中调用 */
+void event_trace_record(event_type_t type, uint16_t aux, uint32_t a, uint32_t b);
+
+/* 服务器请求导出；实际导出在轮询任务空闲时进行 */
+void event_trace_request_dump(void);
+bool event_trace_dump_pending(void);
+
+/* 按EVENT_TRACE_SINK导出并清空日志 */
+esp_err_t event_trace_dump(void);
+
+/* 调度器钩子，见trace_hooks.h */
+void event_trace_task_switched_in(void);
+
+#endif /* EVENT_TRACE_H */
@@ -1,45 +1,80 @@
 #include "http_client.h"
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_heap_caps.h"
 #include "audio_player.h"
+#include "mem_track.h"
+#include "wifi_manager.h"
+#include "net_power.h"
+#include "push_client.h"
+#include "http_reader.h"
+#include "range_download.h"
+#include "clip_cache.h"
+#include "esp_timer.h"
+#include "latency_trace.h"
+#include "event_trace.h"
 
 static const char *TAG = "HTTP_CLIENT";
 
-/* 使用PSRAM分配内存的辅助函数 - 保持不变 */
-static void* psram_malloc(size_t size) {
-    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
-    if (!ptr) {
-        // 如果PSRAM分配失败，尝试使用普通内存
-        ESP_LOGW(TAG, "PSRAM allocation failed, trying regular heap");
-        ptr = malloc(size);
-    }
-    return ptr;
+/* 创建HTTP客户端并把句柄和收发缓冲区记到网络子系统
+ * 按前后空闲差值记账，其他任务同时分配时不准，见mem_track.h */
+esp_http_client_handle_t tracked_client_init(const esp_http_client_config_t *config, size_t *charged) {
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    esp_http_client_handle_t client = esp_http_client_init(config);
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    *charged = (client && free_before > free_after) ? free_before - free_after : 0;
+    mem_track_charge(MEM_TAG_NETWORK, *charged);
+    return client;
+}
+
+void tracked_client_cleanup(esp_http_client_handle_t client, size_t charged) {
+    esp_http_client_cleanup(client);
+    mem_track_discharge(MEM_TAG_NETWORK, charged);
 }
 
-static void* psram_realloc(void* ptr, size_t size) {
-    // 如果原指针为空，直接分配新内存
-    if (!ptr) {
-        return psram_malloc(size);
+/* 发送一个小的POST请求，忽略响应内容 */
+static esp_err_t http_post(const char *url, const char *content_type, const char *data, size_t len) {
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = 5000,
+    };
+    
+    size_t client_mem = 0;
+    esp_http_client_handle_t client = tracked_client_init(&config, &client_mem);
+    if (!client) {
+        return ESP_FAIL;
     }
     
-    // 尝试在PSRAM中重新分配
-    void* new_ptr = heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM);
-    if (new_ptr) {
-        return new_ptr;
+    esp_http_client_set_header(client, "X-Device-ID", DEVICE_ID);
+    esp_http_client_set_header(client, "Content-Type", content_type);
+    esp_http_client_set_post_field(client, data, len);
+    
+    esp_err_t err = esp_http_client_perform(client);
+    if (err == ESP_OK && esp_http_client_get_status_code(client) >= 300) {
+        err = ESP_FAIL;
     }
     
-    // 如果PSRAM重分配失败，尝试普通realloc
-    return realloc(ptr, size);
+    tracked_client_cleanup(client, client_mem);
+    return err;
 }
 
-/* HTTP下载事件处理器 - 修改为使用PSRAM */
-static esp_err_t download_event_handler(esp_http_client_event_t *evt) {
-    download_state_t *download_state = (download_state_t *)evt->user_data;
+/* 轮询响应状态 - 数据到达时直接送入任务解析器，不缓冲整个响应 */
+typedef struct {
+    tts_job_parser_t parser;
+    size_t received;
+} poll_state_t;
+
+/* HTTP响应事件处理器 - 轮询响应（分块和非分块都由esp_http_client解包后送到这里） */
+static esp_err_t poll_event_handler(esp_http_client_event_t *evt) {
+    poll_state_t *poll_state = (poll_state_t *)evt->user_data;
     
+    event_trace_http(evt);
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
             ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
@@ -47,46 +82,23 @@ static esp_err_t download_event_handler(esp_http_client_event_t *evt) {
             
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
-            download_state->size = 0;
-            break;
-            
-        case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
             
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            // 服务器请求导出时间线，等当前片段播放完再发
+            if (strcasecmp(evt->header_key, "X-Trace-Dump") == 0) {
+                event_trace_request_dump();
+            }
             break;
             
         case HTTP_EVENT_ON_DATA:
-            ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                // 动态扩展缓冲区如果需要
-                if (download_state->size + evt->data_len > download_state->capacity) {
-                    size_t new_capacity = download_state->capacity + DOWNLOAD_CHUNK_SIZE;
-                    if (new_capacity > MAX_AUDIO_SIZE) {
-                        ESP_LOGW(TAG, "Audio file too large, truncating");
-                        evt->data_len = MAX_AUDIO_SIZE - download_state->size;
-                        if (evt->data_len <= 0) {
-                            return ESP_OK;
-                        }
-                    } else {
-                        uint8_t *new_buffer = psram_realloc(download_state->buffer, new_capacity);
-                        if (!new_buffer) {
-                            ESP_LOGE(TAG, "Failed to reallocate download buffer");
-                            return ESP_FAIL;
-                        }
-                        download_state->buffer = new_buffer;
-                        download_state->capacity = new_capacity;
-                        ESP_LOGD(TAG, "Expanded buffer to %d bytes in PSRAM", new_capacity);
-                    }
-                }
-                
-                if (evt->data_len > 0) {
-                    memcpy(download_state->buffer + download_state->size, evt->data, evt->data_len);
-                    download_state->size += evt->data_len;
-                }
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
+            // 只解析成功响应，错误响应体只计数
+            if (esp_http_client_get_status_code(evt->client) == 200) {
+                tts_job_parser_feed(&poll_state->parser, (const char *)evt->data, evt->data_len);
             }
+            poll_state->received += evt->data_len;
             break;
             
         case HTTP_EVENT_ON_FINISH:
@@ -103,24 +115,267 @@ static esp_err_t download_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-/* 轮询新的TTS内容 - 保持不变 */
-esp_err_t tts_poll_new_content(char *audio_id, size_t id_size) {
-    char poll_buffer[1024];
-    download_state_t poll_state = {
-        .buffer = (uint8_t *)poll_buffer,
-        .capacity = sizeof(poll_buffer) - 1,
-        .size = 0
-    };
+/* 下载模式 - 由准入控制在收到响应头后决定 */
+typedef enum {
+    DOWNLOAD_MODE_PENDING = 0,  // 尚未收到数据
+    DOWNLOAD_MODE_BUFFERED,     // 整段缓冲后播放
+    DOWNLOAD_MODE_STREAM,       // 边下边播，段播放后归还
+    DOWNLOAD_MODE_REJECTED,     // 非200响应或内存不足，丢弃数据
+} download_mode_t;
+
+static const char *download_mode_names[] = { "pending", "buffered", "stream", "rejected" };
+
+/* 音频下载上下文 */
+typedef struct {
+    audio_state_t *state;
+    const char *audio_id;
+    download_mode_t mode;
+    int64_t content_length;     // -1表示未知（chunked）
+    size_t received;
+    size_t max_live_segments;
+    size_t start_segments;
+    bool truncated;
+    size_t resume_offset;       // 断点续传的起始偏移，0表示首次请求
+    size_t skip;                // 服务器忽略Range时需丢弃的字节数
+    int resumes;
+    int64_t request_start_us;   // 用于测量首字节延迟
+    int64_t expected_size;      // 推送通知中的大小，服务器未给Content-Length时使用
+    const char *url;
+    int connections;            // 配置的并行连接数，下载后为实际使用的连接数
+    size_t read_limit;          // 并行下载时首个连接只读块0，0表示不限
+    char content_hash[CLIP_INDEX_KEY_LEN];  // X-Content-Hash响应头，片段缓存的键
+} clip_download_t;
+
+/* 上一次下载的结果，随下一次轮询上报给服务器 */
+static char s_download_report[256] = {0};
+
+/* 片段缓存的键：任务中的内容哈希，否则用audio_id */
+static const char *clip_cache_key(const tts_job_t *job) {
+    return job->hash[0] != '\0' ? job->hash : job->audio_id;
+}
+
+/* 下载响应头 - 记录内容哈希 */
+static esp_err_t clip_header_handler(esp_http_client_event_t *evt) {
+    clip_download_t *ctx = (clip_download_t *)evt->user_data;
+    
+    event_trace_http(evt);
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && strcasecmp(evt->header_key, "X-Content-Hash") == 0 &&
+        strlen(evt->header_value) < sizeof(ctx->content_hash)) {
+        strcpy(ctx->content_hash, evt->header_value);
+    }
+    return ESP_OK;
+}
+
+/* 准入控制 - 根据Content-Length和当前空闲段决定下载模式 */
+static void clip_download_admit(clip_download_t *ctx, esp_http_client_handle_t client) {
+    ctx->content_length = esp_http_client_get_content_length(client);
+    if (ctx->content_length <= 0 && ctx->expected_size > 0) {
+        ctx->content_length = ctx->expected_size;
+    }
+    size_t free_segments = audio_pool_free_segments();
+    size_t free_bytes = free_segments * AUDIO_SEGMENT_SIZE;
+    size_t budget = free_bytes < AUDIO_MEMORY_BUDGET ? free_bytes : AUDIO_MEMORY_BUDGET;
+
+    if (esp_http_client_get_status_code(client) != 200) {
+        ctx->mode = DOWNLOAD_MODE_REJECTED;
+    } else if (ctx->content_length > 0 && (size_t)ctx->content_length <= budget) {
+        ctx->mode = DOWNLOAD_MODE_BUFFERED;
+        ctx->max_live_segments = free_segments;
+    } else if (free_segments >= AUDIO_STREAM_MIN_SEGMENTS) {
+        // 超出预算或长度未知 - 边下边播，内存占用固定
+        ctx->mode = DOWNLOAD_MODE_STREAM;
+        ctx->max_live_segments = free_segments < AUDIO_STREAM_WINDOW ? free_segments : AUDIO_STREAM_WINDOW;
+        ctx->start_segments = ctx->max_live_segments < AUDIO_STREAM_START_SEGMENTS ?
+                              ctx->max_live_segments : AUDIO_STREAM_START_SEGMENTS;
+    } else {
+        ESP_LOGE(TAG, "Not enough free segments (%d) to admit download", free_segments);
+        ctx->mode = DOWNLOAD_MODE_REJECTED;
+    }
+
+    ESP_LOGI(TAG, "Admission: content_length=%lld, budget=%d, free_segments=%d -> %s",
+             ctx->content_length, budget, free_segments, download_mode_names[ctx->mode]);
+}
+
+/* 流式播放：缓冲到起播水位后交给播放任务 */
+static void clip_download_start_stream(clip_download_t *ctx) {
+    audio_state_t *state = ctx->state;
+    strncpy(state->current_audio_id, ctx->audio_id, sizeof(state->current_audio_id) - 1);
+    state->audio_position = 0;
+    state->download_complete = false;
+    state->streaming = true;
+    audio_player_submit(state);
+    latency_trace_mark(state->trace_turn, LATENCY_WATERMARK, audio_clip_available(&state->clip));
+    ESP_LOGI(TAG, "Streaming playback started after %d bytes", audio_clip_available(&state->clip));
+}
+
+/* 读取一次响应的响应体 - 直接读入段池空间，返回ESP_OK表示响应体已读完 */
+static esp_err_t clip_download_body(clip_download_t *ctx, http_reader_t *reader) {
+    audio_clip_t *clip = &ctx->state->clip;
+    
+    while (!ctx->truncated) {
+        if (ctx->skip > 0) {
+            ctx->skip -= http_reader_discard(reader, ctx->skip);
+            if (ctx->skip > 0) {
+                return ESP_FAIL;
+            }
+            continue;
+        }
+        
+        if (ctx->read_limit > 0 && ctx->received >= ctx->read_limit) {
+            return ESP_OK;
+        }
+        
+        if (ctx->content_length > 0 && ctx->received >= (size_t)ctx->content_length) {
+            // 长度来自推送通知时，服务器可能发送得更多
+            if (reader->content_length < 0 && http_reader_discard(reader, 1) > 0) {
+                ESP_LOGW(TAG, "Audio exceeds admitted size, truncating at %d bytes", ctx->received);
+                ctx->truncated = true;
+            }
+            return ESP_OK;
+        }
+        
+        size_t space;
+        uint8_t *dst = audio_clip_reserve(clip, ctx->max_live_segments, &space);
+        if (!dst) {
+            if (ctx->mode == DOWNLOAD_MODE_STREAM) {
+                // 窗口已满 - 等播放端归还段，TCP窗口随之形成背压
+                vTaskDelay(pdMS_TO_TICKS(10));
+                continue;
+            }
+            // 缓冲模式下段用完，还有数据说明超过了准入的大小
+            if (http_reader_discard(reader, 1) > 0) {
+                ESP_LOGW(TAG, "Audio exceeds admitted size, truncating at %d bytes", ctx->received);
+                ctx->truncated = true;
+            }
+            return ESP_OK;
+        }
+        if (space > HTTP_READ_MAX) {
+            space = HTTP_READ_MAX;
+        }
+        
+#if DOWNLOAD_ZERO_COPY
+        int n = http_reader_read(reader, dst, space);
+#else
+        // 对照基线：先读入中转缓冲区再复制，相当于原先事件回调中的memcpy
+        static uint8_t bounce[HTTP_READ_MAX];
+        int n = http_reader_read(reader, bounce, space);
+        if (n > 0) {
+            memcpy(dst, bounce, n);
+            http_reader_note_copy(reader, n);
+        }
+#endif
+        if (n < 0) {
+            return n == -ESP_ERR_HTTP_EAGAIN ? ESP_ERR_TIMEOUT : ESP_FAIL;
+        }
+        if (n == 0) {
+            return esp_http_client_is_complete_data_received(reader->client) ? ESP_OK : ESP_FAIL;
+        }
+        
+        audio_clip_commit(clip, n);
+        ctx->received += n;
+        
+        if (ctx->mode == DOWNLOAD_MODE_STREAM && !ctx->state->has_audio &&
+            clip->segment_count >= ctx->start_segments) {
+            clip_download_start_stream(ctx);
+        }
+    }
+    return ESP_OK;
+}
+
+/* 并行下载的连续前缀增长 - 发布给播放端，块0完成即开始播放 */
+static void clip_download_on_prefix(void *arg, size_t prefix) {
+    clip_download_t *ctx = (clip_download_t *)arg;
+    audio_clip_publish(&ctx->state->clip, prefix);
+    if (!ctx->state->has_audio) {
+        clip_download_start_stream(ctx);
+    }
+}
+
+/* 并行下载 - 首个连接继续读块0，工作连接同时用Range取后面的块；
+ * 没有完成的部分留给单连接续传 */
+static esp_err_t clip_download_parallel(clip_download_t *ctx, http_reader_t *reader) {
+    // 只在下载任务中使用，信号量和统计不占任务栈
+    static range_download_t rd;
+    audio_clip_t *clip = &ctx->state->clip;
+    
+    esp_err_t err = range_download_start(&rd, ctx->url, clip, (size_t)ctx->content_length,
+                                         DOWNLOAD_PARALLEL_CHUNK, ctx->connections,
+                                         clip_download_on_prefix, ctx);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Parallel download unavailable (%s), using one connection", esp_err_to_name(err));
+        ctx->connections = 1;
+        return clip_download_body(ctx, reader);
+    }
+    ctx->connections = rd.connections;
+    
+    ctx->read_limit = rd.chunk_size;
+    err = clip_download_body(ctx, reader);
+    ctx->read_limit = 0;
+    range_download_first_done(&rd, err == ESP_OK && ctx->received >= rd.chunk_size, ctx->received);
+    http_reader_close(reader);
+    
+    // 首个连接读完块0后也用Range认领剩余的块
+    size_t prefix = range_download_finish(&rd, reader->client);
+    range_download_log_stats(&rd);
+    if (prefix > ctx->received) {
+        ctx->received = prefix;
+    }
+    return ctx->received >= (size_t)ctx->content_length ? ESP_OK : ESP_FAIL;
+}
+
+/* 发出一次请求（首次或Range续传）并读取响应 */
+static esp_err_t clip_download_request(clip_download_t *ctx, http_reader_t *reader, esp_http_client_handle_t client) {
+    uint16_t turn = ctx->mode == DOWNLOAD_MODE_PENDING ? ctx->state->trace_turn : LATENCY_TRACE_TURN_NONE;
+    latency_trace_mark(turn, LATENCY_DL_CONNECT, 0);
+    esp_err_t err = http_reader_open(reader, client);
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    if (ctx->mode == DOWNLOAD_MODE_PENDING) {
+        latency_trace_mark(turn, LATENCY_DL_FIRST_BYTE, reader->status);
+        net_power_record_first_byte((uint32_t)(esp_timer_get_time() - ctx->request_start_us));
+        clip_download_admit(ctx, client);
+    } else if (ctx->resume_offset > 0) {
+        if (reader->status == 200) {
+            // 服务器不支持Range，从头发送 - 丢弃已收到的部分
+            ctx->skip = ctx->resume_offset;
+        } else if (reader->status != 206) {
+            ESP_LOGW(TAG, "Resume rejected: status=%d", reader->status);
+            ctx->truncated = true;
+        }
+    }
+    
+    // 只对服务器给出长度的整段缓冲片段分块，推送通知中的大小可能不准
+    if (ctx->mode == DOWNLOAD_MODE_BUFFERED && ctx->resume_offset == 0 && ctx->connections > 1 &&
+        reader->content_length >= DOWNLOAD_PARALLEL_MIN_SIZE && reader->content_length == ctx->content_length) {
+        err = clip_download_parallel(ctx, reader);
+    } else if (ctx->mode != DOWNLOAD_MODE_REJECTED && !ctx->truncated) {
+        if (ctx->resume_offset == 0) {
+            ctx->connections = 1;
+        }
+        err = clip_download_body(ctx, reader);
+    }
+    http_reader_close(reader);
+    return err;
+}
+
+/* 批量长轮询：一次取回服务器上排队的所有任务（X-Poll-Batch），流式解析后放入本地播放列表 */
+static esp_err_t poll_request(void) {
+    // 解析器和任务数组只在轮询任务中使用，放在静态区避免占用任务栈
+    static poll_state_t poll_state;
+    static tts_job_t jobs[TTS_POLL_BATCH_MAX];
     
     esp_http_client_config_t config = {
         .url = TTS_SERVER_URL "/esp32/poll",
         .method = HTTP_METHOD_GET,
         .timeout_ms = 30000,  // 30秒长轮询
-        .event_handler = download_event_handler,
+        .event_handler = poll_event_handler,
         .user_data = &poll_state,
     };
     
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    size_t client_mem = 0;
+    esp_http_client_handle_t client = tracked_client_init(&config, &client_mem);
     if (!client) {
         ESP_LOGE(TAG, "Failed to initialize HTTP client");
         return ESP_FAIL;
@@ -128,151 +383,383 @@ esp_err_t tts_poll_new_content(char *audio_id, size_t id_size) {
     
     esp_http_client_set_header(client, "X-Device-ID", DEVICE_ID);
     
+    // 请求批量返回，数量不超过播放列表剩余空位
+    size_t batch = tts_playlist_space();
+    if (batch > TTS_POLL_BATCH_MAX) {
+        batch = TTS_POLL_BATCH_MAX;
+    }
+    if (batch == 0) {
+        tracked_client_cleanup(client, client_mem);
+        return ESP_ERR_NO_MEM;
+    }
+    char batch_str[8];
+    snprintf(batch_str, sizeof(batch_str), "%d", batch);
+    esp_http_client_set_header(client, "X-Poll-Batch", batch_str);
+    tts_job_parser_init(&poll_state.parser, jobs, batch);
+    poll_state.received = 0;
+    
+    // 上报上一次下载的模式和是否截断
+    if (s_download_report[0] != '\0') {
+        esp_http_client_set_header(client, "X-Download-Report", s_download_report);
+    }
+    
     ESP_LOGI(TAG, "Polling for new tasks (Device: %s)...", DEVICE_ID);
     
+    int64_t sent_us = esp_timer_get_time();
     esp_err_t err = esp_http_client_perform(client);
     
+    // 服务器已收到报告
+    if (err == ESP_OK) {
+        s_download_report[0] = '\0';
+    }
+    
     if (err == ESP_OK) {
         // 确保头部被完全读取
         int content_length = esp_http_client_fetch_headers(client);
         int status_code = esp_http_client_get_status_code(client);
         
         ESP_LOGI(TAG, "Poll response: status=%d, content_length=%d, received=%d", 
-                 status_code, content_length, poll_state.size);
+                 status_code, content_length, poll_state.received);
         
-        if (status_code == 200 && poll_state.size > 0) {
-            poll_buffer[poll_state.size] = '\0';
-            ESP_LOGI(TAG, "Poll response data: %s", poll_buffer);
-            
-            // 简单JSON解析提取audio_id
-            char *audio_id_start = strstr(poll_buffer, "\"audio_id\":\"");
-            if (audio_id_start) {
-                audio_id_start += 12;
-                char *audio_id_end = strchr(audio_id_start, '"');
-                if (audio_id_end) {
-                    size_t id_len = audio_id_end - audio_id_start;
-                    if (id_len < id_size - 1) {
-                        strncpy(audio_id, audio_id_start, id_len);
-                        audio_id[id_len] = '\0';
-                        ESP_LOGI(TAG, "New TTS task: %s", audio_id);
-                        err = ESP_OK;
-                    } else {
-                        ESP_LOGW(TAG, "Audio ID too long");
-                        err = ESP_FAIL;
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to parse audio_id");
-                    err = ESP_FAIL;
+        if (status_code == 200 && poll_state.received > 0) {
+            // 解析任务列表（兼容单任务旧格式），按顺序加入播放列表
+            json_stream_status_t parse_status;
+            size_t count = tts_job_parser_finish(&poll_state.parser, &parse_status);
+            int64_t parsed_us = esp_timer_get_time();
+            size_t added = 0;
+            for (size_t i = 0; i < count; i++) {
+                jobs[i].poll_sent_us = sent_us;
+                jobs[i].poll_parsed_us = parsed_us;
+                if (tts_playlist_add(&jobs[i]) == ESP_OK) {
+                    added++;
                 }
+            }
+            if (added > 0) {
+                ESP_LOGI(TAG, "Poll returned %d jobs, playlist now %d", added, tts_playlist_count());
+                err = ESP_OK;
             } else {
-                ESP_LOGW(TAG, "No audio_id found in response");
+                ESP_LOGW(TAG, "No audio_id found in response (%s)",
+                         parse_status == JSON_STREAM_DONE ? "complete" : "malformed");
                 err = ESP_FAIL;
             }
         } else if (status_code == 204) {
             // 无内容 - 无新任务
             ESP_LOGD(TAG, "No new tasks (204)");
             err = ESP_ERR_NOT_FOUND;
-        } else if (status_code == 200 && poll_state.size == 0) {
+        } else if (status_code == 200 && poll_state.received == 0) {
             // 200状态但无内容
             ESP_LOGW(TAG, "Empty response with status 200");
             err = ESP_ERR_INVALID_RESPONSE;
         } else {
-            ESP_LOGW(TAG, "Unexpected response: status=%d, size=%d", status_code, poll_state.size);
-            if (poll_state.size > 0) {
-                poll_buffer[poll_state.size] = '\0';
-                ESP_LOGW(TAG, "Response content: %s", poll_buffer);
-            }
+            ESP_LOGW(TAG, "Unexpected response: status=%d, size=%d", status_code, poll_state.received);
             err = ESP_FAIL;
         }
     } else {
         ESP_LOGE(TAG, "HTTP poll failed: %s", esp_err_to_name(err));
     }
     
-    esp_http_client_cleanup(client);
+    tracked_client_cleanup(client, client_mem);
     return err;
 }
 
-/* 下载PCM音频文件 - 修改为使用PSRAM */
-esp_err_t download_pcm_audio(const char *audio_id) {
+/* 长轮询期间使用min-modem，长时间空闲后由策略切到max-modem */
+esp_err_t tts_poll_new_content(void) {
+    net_power_set_activity(NET_ACTIVITY_POLL);
+    esp_err_t err = poll_request();
+    net_power_set_activity(NET_ACTIVITY_IDLE);
+    return err;
+}
+
+/* 下载PCM音频文件到state - 拉模式直接读入PSRAM段池，超出内存预算时边下边播 */
+static esp_err_t clip_download_run(audio_state_t *state, const tts_job_t *job) {
+    const char *audio_id = job->audio_id;
     char url[256];
-    snprintf(url, sizeof(url), "%s/audio/%s.pcm", TTS_SERVER_URL, audio_id);
-    
-    ESP_LOGI(TAG, "Downloading PCM: %s", url);
-    ESP_LOGI(TAG, "Free heap before download: %d bytes", esp_get_free_heap_size());
-    ESP_LOGI(TAG, "Free PSRAM: %d bytes", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
-    
-    // 获取音频状态以释放旧缓冲区
-    audio_state_t *state = audio_player_get_state();
-    
-    // 释放之前的音频缓冲区
-    if (state->audio_buffer) {
-        free(state->audio_buffer);
-        state->audio_buffer = NULL;
+    if (strncmp(job->url, "http", 4) == 0) {
+        snprintf(url, sizeof(url), "%s", job->url);
+    } else if (job->url[0] == '/') {
+        snprintf(url, sizeof(url), "%s%s", TTS_SERVER_URL, job->url);
+    } else {
+        snprintf(url, sizeof(url), "%s/audio/%s.pcm", TTS_SERVER_URL, audio_id);
     }
     
-    // 在PSRAM中分配初始缓冲区
-    uint8_t *initial_buffer = psram_malloc(DOWNLOAD_CHUNK_SIZE);
-    if (!initial_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate initial download buffer");
-        return ESP_FAIL;
+    // 播放器只支持原始PCM
+    if (job->format[0] != '\0' && strncmp(job->format, "pcm", 3) != 0) {
+        ESP_LOGE(TAG, "Unsupported audio format: %s", job->format);
+        return ESP_ERR_NOT_SUPPORTED;
     }
     
-    download_state_t download_state = {
-        .buffer = initial_buffer,
-        .capacity = DOWNLOAD_CHUNK_SIZE,
-        .size = 0
+    ESP_LOGI(TAG, "Downloading PCM: %s", url);
+    ESP_LOGI(TAG, "Free segments: %d x %d bytes", audio_pool_free_segments(), AUDIO_SEGMENT_SIZE);
+    
+    // 释放slot中的旧片段
+    audio_clip_release(&state->clip);
+    state->keep_clip = false;
+    
+    audio_clip_t *clip = &state->clip;
+    clip_download_t ctx = {
+        .state = state,
+        .audio_id = audio_id,
+        .mode = DOWNLOAD_MODE_PENDING,
+        .content_length = -1,
+        .expected_size = job->size,
+        .url = url,
+        .connections = DOWNLOAD_PARALLEL_CONNECTIONS,
     };
+#if DOWNLOAD_PARALLEL_AB_COMPARE
+    // 交替单连接和并行，两组吞吐在上报中按conns区分
+    static uint32_t ab_counter;
+    if (ab_counter++ & 1) {
+        ctx.connections = 1;
+    }
+#endif
     
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_GET,
         .timeout_ms = 30000,
-        .event_handler = download_event_handler,
-        .user_data = &download_state,
+        .event_handler = clip_header_handler,
+        .user_data = &ctx,
     };
+    http_reader_t reader;
+    http_reader_init(&reader, HTTP_READ_UNIT);
     
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    size_t client_mem = 0;
+    esp_http_client_handle_t client = tracked_client_init(&config, &client_mem);
     if (!client) {
         ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        free(initial_buffer);
         return ESP_FAIL;
     }
     
-    esp_err_t err = esp_http_client_perform(client);
+    ctx.request_start_us = esp_timer_get_time();
+    esp_err_t err = clip_download_request(&ctx, &reader, client);
+    int status_code = reader.status;
     
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
+    // WiFi掉线导致下载中断 - 等待后台重连后用Range从断点继续
+    while ((ctx.mode == DOWNLOAD_MODE_BUFFERED || ctx.mode == DOWNLOAD_MODE_STREAM) &&
+           !ctx.truncated && ctx.received > 0 &&
+           (err != ESP_OK || (ctx.content_length > 0 && ctx.received < (size_t)ctx.content_length)) &&
+           ctx.resumes < DOWNLOAD_RESUME_ATTEMPTS) {
+        ESP_LOGW(TAG, "Download interrupted at %d bytes (%s), waiting for network", 
+                 ctx.received, esp_err_to_name(err));
+        if (wifi_wait_connected(pdMS_TO_TICKS(DOWNLOAD_RESUME_WAIT_MS)) != ESP_OK) {
+            break;
+        }
+        
+        tracked_client_cleanup(client, client_mem);
+        client = tracked_client_init(&config, &client_mem);
+        if (!client) {
+            ESP_LOGE(TAG, "Failed to initialize HTTP client");
+            state->download_complete = true;
+            audio_clip_set_complete(clip);
+            if (!state->has_audio) {
+                audio_clip_release(clip);
+            }
+            return ESP_FAIL;
+        }
         
-        if (status_code == 200 && download_state.size > 0) {
-            // 成功下载，转移缓冲区所有权给audio_state
-            state->audio_buffer = download_state.buffer;
-            state->audio_size = download_state.size;
-            state->audio_capacity = download_state.capacity;
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%u-", (unsigned)ctx.received);
+        esp_http_client_set_header(client, "Range", range);
+        ctx.resume_offset = ctx.received;
+        ctx.skip = 0;
+        ctx.resumes++;
+        
+        ESP_LOGI(TAG, "Resuming download from %d bytes (attempt %d)", ctx.received, ctx.resumes);
+        err = clip_download_request(&ctx, &reader, client);
+        status_code = reader.status;
+        if (status_code == 206) {
+            status_code = 200;
+        }
+    }
+    
+    // 连接中断导致尾部丢失
+    if (ctx.content_length > 0 && ctx.received < (size_t)ctx.content_length) {
+        ctx.truncated = true;
+    }
+    
+    if (state->has_audio) {
+        // 流式播放已经开始：只标记结束，片段由播放任务播放完后归还
+        state->download_complete = true;
+        audio_clip_set_complete(clip);
+        if (err == ESP_OK && status_code != 200) {
+            err = ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Stream download finished: %d bytes for audio: %s", ctx.received, audio_id);
+    } else if (err == ESP_OK) {
+        if (status_code == 200 && ctx.mode != DOWNLOAD_MODE_REJECTED && clip->size > 0) {
+            // 成功下载，片段已在audio_state中
+            audio_clip_set_complete(clip);
+            
+            // 较短的片段播放结束后写入缓存，下次直接从flash播放
+            const char *key = ctx.content_hash[0] != '\0' ? ctx.content_hash : clip_cache_key(job);
+            if (!ctx.truncated && ctx.received <= CLIP_CACHE_MAX_CLIP && strlen(key) < sizeof(state->cache_key) &&
+                !clip_cache_contains(key)) {
+                strcpy(state->cache_key, key);
+                state->keep_clip = true;
+            }
             state->audio_position = 0;
-            state->has_audio = true;
+            state->streaming = false;
             state->download_complete = true;
             strncpy(state->current_audio_id, audio_id, sizeof(state->current_audio_id) - 1);
+            latency_trace_mark(state->trace_turn, LATENCY_WATERMARK, ctx.received);
+            audio_player_submit(state);
             
-            ESP_LOGI(TAG, "Downloaded %d bytes for audio: %s", download_state.size, audio_id);
-            ESP_LOGI(TAG, "Free heap after download: %d bytes", esp_get_free_heap_size());
-            ESP_LOGI(TAG, "Free PSRAM after download: %d bytes", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+            ESP_LOGI(TAG, "Downloaded %d bytes (%d segments) for audio: %s", 
+                     ctx.received, clip->segment_count, audio_id);
+            audio_pool_log_stats();
+            mem_track_log();
         } else {
-            ESP_LOGW(TAG, "Download failed: status=%d, size=%d", status_code, download_state.size);
-            free(download_state.buffer);
+            ESP_LOGW(TAG, "Download failed: status=%d, size=%d", status_code, ctx.received);
+            audio_clip_release(clip);
             err = ESP_FAIL;
         }
     } else {
         ESP_LOGE(TAG, "HTTP download failed: %s", esp_err_to_name(err));
-        free(download_state.buffer);
+        audio_clip_release(clip);
     }
     
-    esp_http_client_cleanup(client);
+    if (ctx.truncated) {
+        ESP_LOGW(TAG, "Audio %s truncated: received %d of %lld bytes", 
+                 audio_id, ctx.received, ctx.content_length);
+    }
+    
+    http_reader_log_stats(&reader, audio_id);
+    
+    // 记录结果，随下一次轮询上报；rate为从发出请求到下载结束的平均吞吐
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - ctx.request_start_us) / 1000);
+    uint32_t rate_kbps = elapsed_ms ? (uint32_t)((uint64_t)ctx.received * 8 / elapsed_ms) : 0;
+    ESP_LOGI(TAG, "Download took %u ms (%u kbit/s, %d connection%s)",
+             (unsigned)elapsed_ms, (unsigned)rate_kbps, ctx.connections, ctx.connections > 1 ? "s" : "");
+    snprintf(s_download_report, sizeof(s_download_report),
+             "audio_id=%s;mode=%s;content_length=%lld;received=%u;truncated=%d;resumes=%d;copy_x100=%u;"
+             "conns=%d;rate_kbps=%u;cache=miss",
+             audio_id, download_mode_names[ctx.mode], ctx.content_length,
+             (unsigned)ctx.received, ctx.truncated ? 1 : 0, ctx.resumes,
+             (unsigned)http_reader_copy_ratio_x100(&reader), ctx.connections, (unsigned)rate_kbps);
+    
+    tracked_client_cleanup(client, client_mem);
     return err;
 }
 
-/* TTS轮询任务 - 保持不变 */
+/* 片段缓存命中时直接播放flash映射的数据（映射失败时读入段池），不发起任何网络请求
+ * 同时只有一个映射，建立映射会解除旧映射：调用前其他slot必须已播放完并回收（见clip_slot_load） */
+static esp_err_t clip_cache_play(audio_state_t *state, const tts_job_t *job) {
+    const char *key = clip_cache_key(job);
+    audio_clip_release(&state->clip);
+    state->keep_clip = false;
+    
+    esp_err_t err = clip_cache_map(key, &state->clip);
+    bool mapped = (err == ESP_OK);
+    if (err != ESP_OK && err != ESP_ERR_NOT_FOUND && err != ESP_ERR_INVALID_CRC) {
+        err = clip_cache_load(key, &state->clip);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    audio_clip_set_complete(&state->clip);
+    state->audio_position = 0;
+    state->streaming = false;
+    state->download_complete = true;
+    strncpy(state->current_audio_id, job->audio_id, sizeof(state->current_audio_id) - 1);
+    latency_trace_mark(state->trace_turn, LATENCY_WATERMARK, audio_clip_available(&state->clip));
+    audio_player_submit(state);
+    
+    // 告诉服务器片段已在本地，无需再合成和下载
+    snprintf(s_download_report, sizeof(s_download_report),
+             "audio_id=%s;mode=cache;received=0;cache=hit;map=%d;key=%s", job->audio_id, mapped ? 1 : 0, key);
+    return ESP_OK;
+}
+
+/* 播放结束后的收尾：flash映射的片段解除映射，刚下载的片段写入缓存并归还段池，不与I2S播放争用flash
+ * 只有本slot的片段是映射来的（clip.external）才解除映射；新映射建立前所有已播完的slot都已回收，
+ * 所以此时的映射一定属于本slot */
+static void clip_cache_store_played(audio_state_t *state) {
+    if (state->clip.external) {
+        audio_clip_release(&state->clip);
+        clip_cache_unmap();
+        return;
+    }
+    if (!state->keep_clip) {
+        return;
+    }
+    esp_err_t err = clip_cache_store(state->cache_key, &state->clip);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "Clip cache store failed for %s: %s", state->cache_key, esp_err_to_name(err));
+    }
+    state->keep_clip = false;
+    state->cache_key[0] = '\0';
+    audio_clip_release(&state->clip);
+}
+
+/* 回收已播放完的slot；写flash会暂停cache（PSRAM也经cache访问），另一个片段正在播放时推迟 */
+static void clip_slots_reap(void) {
+    for (int i = 0; i < AUDIO_PLAYER_SLOTS; i++) {
+        audio_state_t *state = audio_player_get_slot(i);
+        if (state->finished && !(state->keep_clip && audio_player_busy())) {
+            clip_cache_store_played(state);
+            state->finished = false;
+        }
+    }
+}
+
+/* 把任务装入一个空闲slot：先查片段缓存；下载期间关闭modem sleep，避免首字节和吞吐受DTIM影响 */
+static esp_err_t clip_slot_load(audio_state_t *state, const tts_job_t *job) {
+    // 缓存命中的片段从flash映射播放，同时只能有一个映射：等其他片段播完，
+    // 再回收所有已播完的slot（已播完的slot不算busy，可能还持有上一个映射）
+    if (clip_cache_contains(clip_cache_key(job))) {
+        while (audio_player_busy()) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        clip_slots_reap();
+    }
+    
+    esp_err_t err = clip_cache_play(state, job);
+    if (err != ESP_OK) {
+        net_power_set_activity(NET_ACTIVITY_TRANSFER);
+        err = clip_download_run(state, job);
+        net_power_set_activity(NET_ACTIVITY_IDLE);
+    }
+    
+    // 推送模式下不再轮询，下载结果单独上报
+    if (push_client_is_connected() && s_download_report[0] != '\0') {
+        if (http_post(TTS_SERVER_URL "/esp32/report", "text/plain",
+                      s_download_report, strlen(s_download_report)) == ESP_OK) {
+            s_download_report[0] = '\0';
+        }
+    }
+    return err;
+}
+
+/* 按任务下载到空闲slot，没有空闲slot返回ESP_ERR_INVALID_STATE */
+esp_err_t download_tts_job(const tts_job_t *job) {
+    audio_state_t *state = audio_player_free_slot();
+    if (!state) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return clip_slot_load(state, job);
+}
+
+/* 下载默认路径的PCM音频 */
+esp_err_t download_pcm_audio(const char *audio_id) {
+    tts_job_t job = { .size = -1 };
+    strncpy(job.audio_id, audio_id, sizeof(job.audio_id) - 1);
+    return download_tts_job(&job);
+}
+
+/* 上传二进制堆报告 - 作为mem_track的报告回调 */
+void http_send_heap_report(const uint8_t *report, size_t len) {
+    esp_err_t err = http_post(TTS_SERVER_URL "/esp32/telemetry/heap", "application/octet-stream",
+                              (const char *)report, len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Heap report upload failed: %s", esp_err_to_name(err));
+    }
+}
+
+/* TTS轮询任务 - 播放一个片段的同时下载下一个，播放列表按网络速度排空 */
 void tts_polling_task(void *pvParameters) {
-    char audio_id[64];
+    tts_job_t job;
+    char *audio_id = job.audio_id;
     
     ESP_LOGI(TAG, "TTS polling task started, device ID: %s", DEVICE_ID);
     
@@ -280,40 +767,78 @@ void tts_polling_task(void *pvParameters) {
     vTaskDelay(pdMS_TO_TICKS(2000));
     
     while (1) {
-        audio_state_t *state = audio_player_get_state();
+        // 掉线时等待后台重连，不再把断网当作轮询错误
+        if (!wifi_is_connected()) {
+            ESP_LOGW(TAG, "WiFi disconnected, waiting for reconnect...");
+            wifi_wait_connected(portMAX_DELAY);
+            ESP_LOGI(TAG, "WiFi reconnected, resuming polling");
+        }
+        
+        // 播放完的片段：解除映射、写入片段缓存
+        clip_slots_reap();
         
-        // 如果正在播放音频，等待
-        if (state->is_playing) {
+        // 空闲时导出时间线，避免上传与下载、播放争抢
+        if (event_trace_dump_pending() && !audio_player_busy()) {
+            event_trace_dump();
+        }
+        
+        // 两个slot都在使用（一个播放、一个已下载好等待播放），
+        // 或当前片段占满了段池（准入会拒绝下一个），等当前片段播完
+        audio_state_t *state = audio_player_free_slot();
+        if (!state || (audio_player_busy() && audio_pool_free_segments() < AUDIO_STREAM_MIN_SEGMENTS)) {
             vTaskDelay(pdMS_TO_TICKS(100));
             continue;
         }
         
-        // 清空audio_id缓冲区
-        memset(audio_id, 0, sizeof(audio_id));
+        // 清空任务
+        memset(&job, 0, sizeof(job));
+        job.size = -1;
         
-        // 轮询新的TTS任务
-        esp_err_t err = tts_poll_new_content(audio_id, sizeof(audio_id));
+        // 播放列表非空时直接连续下载；否则等推送，推送未连接时退回批量长轮询
+        esp_err_t err = tts_playlist_next(&job, 0);
+        if (err != ESP_OK) {
+            if (audio_player_busy()) {
+                // 正在播放时不发起长轮询，推送来的任务进入播放列表，下一圈取走
+                vTaskDelay(pdMS_TO_TICKS(100));
+                continue;
+            }
+            if (push_client_is_connected()) {
+                err = tts_playlist_next(&job, pdMS_TO_TICKS(PUSH_WAIT_MS));
+                if (err == ESP_ERR_TIMEOUT) {
+                    err = ESP_ERR_NOT_FOUND;
+                }
+            } else {
+                err = tts_poll_new_content();
+                if (err == ESP_OK) {
+                    err = tts_playlist_next(&job, 0);
+                }
+            }
+        }
         
         if (err == ESP_OK && strlen(audio_id) > 0) {
-            ESP_LOGI(TAG, "🎵 New TTS task: %s", audio_id);
+            ESP_LOGI(TAG, "🎵 New TTS task: %s (%d more queued)", audio_id, tts_playlist_count());
             
-            // 下载PCM音频文件
-            esp_err_t download_err = download_pcm_audio(audio_id);
+            // 每个任务一个追踪回合；从播放列表取出的任务带着当初轮询的时间
+            state->trace_turn = latency_trace_begin_turn();
+            if (job.poll_sent_us > 0) {
+                latency_trace_mark_at(state->trace_turn, LATENCY_POLL_SENT, 0, job.poll_sent_us);
+            }
+            if (job.poll_parsed_us > 0) {
+                latency_trace_mark_at(state->trace_turn, LATENCY_POLL_PARSED, 0, job.poll_parsed_us);
+            }
+            
+            // 下载到空闲slot，不等播放结束：当前片段播放时即可开始下一个的下载
+            esp_err_t download_err = clip_slot_load(state, &job);
             if (download_err == ESP_OK) {
-                ESP_LOGI(TAG, "✅ Audio downloaded successfully: %s", audio_id);
-                
-                // 等待播放完成
-                while (state->is_playing || state->has_audio) {
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                }
-                
-                ESP_LOGI(TAG, "✅ Finished playing: %s", audio_id);
+                ESP_LOGI(TAG, "✅ Audio ready for playback: %s", audio_id);
             } else {
                 ESP_LOGE(TAG, "❌ Failed to download audio: %s", audio_id);
             }
             
-            // 播放完成后短暂延迟
-            vTaskDelay(pdMS_TO_TICKS(1000));
+            // 播放列表还有任务时立即继续，否则稍作停顿
+            if (tts_playlist_count() == 0) {
+                vTaskDelay(pdMS_TO_TICKS(1000));
+            }
             
         } else if (err == ESP_ERR_NOT_FOUND) {
             // 无新任务，正常情况
@@ -324,4 +849,4 @@ void tts_polling_task(void *pvParameters) {
             vTaskDelay(pdMS_TO_TICKS(5000));
         }
     }
-}
\ No newline at end of file
+}
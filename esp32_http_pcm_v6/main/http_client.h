@@ -4,6 +4,9 @@
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_http_client.h"
+#include "audio_pool.h"
+#include "tts_job.h"
 
 /* HTTP Configuration - 保持不变 */
 // #define TTS_SERVER_IP          "10.129.113.191"
@@ -12,25 +15,49 @@
 #define TTS_SERVER_URL         "http://" TTS_SERVER_IP ":8001"
 #define DEVICE_ID              "ESP32_VOICE_01"
 
-/* Audio buffer configuration - 使用PSRAM后可以增大缓冲区 */
-#define MAX_AUDIO_SIZE         (4 * 1024 * 1024)  // 增大到4MB
-#define DOWNLOAD_CHUNK_SIZE    (64 * 1024)        // 增大到64KB
+/* Audio buffer configuration - 由启动时预留的PSRAM段池决定 */
+#define MAX_AUDIO_SIZE         (AUDIO_SEGMENT_SIZE * AUDIO_SEGMENT_COUNT)  // 4MB
 #define POLL_INTERVAL_MS       2000
+#define PUSH_WAIT_MS           30000        // 推送通道已连接时每次等待任务的时间
 
-/* HTTP下载状态 */
-typedef struct {
-    uint8_t *buffer;
-    size_t size;
-    size_t capacity;
-} download_state_t;
+/* 下载准入控制 - 分配前按Content-Length决定整段缓冲还是边下边播 */
+#define AUDIO_MEMORY_BUDGET          (3 * 1024 * 1024)  // 整段缓冲允许占用的最大内存
+#define AUDIO_STREAM_WINDOW          8                  // 流式播放最多同时持有的段数（512KB）
+#define AUDIO_STREAM_START_SEGMENTS  2                  // 流式播放开始前需缓冲的段数
+#define AUDIO_STREAM_MIN_SEGMENTS    3                  // 空闲段少于此数时拒绝下载
+
+/* 拉模式读取 - 响应体直接读入段池，读取长度为播放块（DMA帧整数倍）的整数倍 */
+#define HTTP_READ_UNIT               AUDIO_FRAME_SIZE   // 与audio_stage的播放块一致
+#define HTTP_READ_MAX                (4 * HTTP_READ_UNIT)
+#define DOWNLOAD_ZERO_COPY           1                  // 0: 经中转缓冲区复制，用于对比
+
+/* 下载断点续传 - WiFi掉线后等待后台重连，用Range请求继续 */
+#define DOWNLOAD_RESUME_ATTEMPTS     3
+#define DOWNLOAD_RESUME_WAIT_MS      30000
+
+/* 并行分段下载 - 已知长度的整段缓冲片段拆成Range块，由多个连接同时下载 */
+#define DOWNLOAD_PARALLEL_CONNECTIONS  1                  // 2~3启用，1为单连接
+#define DOWNLOAD_PARALLEL_MIN_SIZE     (512 * 1024)       // 较小的片段建连开销大于收益
+#define DOWNLOAD_PARALLEL_CHUNK        (AUDIO_STREAM_START_SEGMENTS * AUDIO_SEGMENT_SIZE)  // 块0即起播水位
+#define DOWNLOAD_PARALLEL_AB_COMPARE   0                  // 1: 片段交替单连接/并行，对比吞吐
+
+/* 创建HTTP客户端，句柄和收发缓冲区记到网络子系统；charged为记入的字节数，释放时原样扣除 */
+esp_http_client_handle_t tracked_client_init(const esp_http_client_config_t *config, size_t *charged);
+void tracked_client_cleanup(esp_http_client_handle_t client, size_t charged);
 
 /* TTS轮询任务 */
 void tts_polling_task(void *pvParameters);
 
-/* 轮询新的TTS内容 */
-esp_err_t tts_poll_new_content(char *audio_id, size_t id_size);
+/* 批量轮询新的TTS任务并加入播放列表，无新任务返回ESP_ERR_NOT_FOUND */
+esp_err_t tts_poll_new_content(void);
 
 /* 下载PCM音频文件 */
 esp_err_t download_pcm_audio(const char *audio_id);
 
+/* 按任务通知中的URL/格式/大小下载 */
+esp_err_t download_tts_job(const tts_job_t *job);
+
+/* 上传二进制堆报告（mem_track报告回调） */
+void http_send_heap_report(const uint8_t *report, size_t len);
+
 #endif /* HTTP_CLIENT_H */
\ No newline at end of file
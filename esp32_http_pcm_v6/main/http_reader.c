@@ -0,0 +1,115 @@
+#include "http_reader.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_trace.h"
+
+static const char *TAG = "HTTP_READER";
+
+static bool is_redirect(int status) {
+    return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
+
+void http_reader_init(http_reader_t *reader, size_t read_unit) {
+    memset(reader, 0, sizeof(*reader));
+    reader->read_unit = read_unit;
+    reader->content_length = -1;
+}
+
+esp_err_t http_reader_open(http_reader_t *reader, esp_http_client_handle_t client) {
+    reader->client = client;
+    reader->status = 0;
+    reader->content_length = -1;
+
+    while (1) {
+        esp_err_t err = esp_http_client_open(client, 0);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        esp_http_client_fetch_headers(client);
+        reader->status = esp_http_client_get_status_code(client);
+        if (reader->status <= 0) {
+            esp_http_client_close(client);
+            return ESP_FAIL;
+        }
+
+        if (is_redirect(reader->status) && reader->redirects < HTTP_READER_MAX_REDIRECTS) {
+            // 丢弃重定向响应体，按Location重新请求
+            esp_http_client_flush_response(client, NULL);
+            esp_http_client_set_redirection(client);
+            esp_http_client_close(client);
+            reader->redirects++;
+            ESP_LOGI(TAG, "Following redirect (%d)", reader->status);
+            continue;
+        }
+        break;
+    }
+
+    if (!esp_http_client_is_chunked_response(client)) {
+        reader->content_length = esp_http_client_get_content_length(client);
+    }
+    return ESP_OK;
+}
+
+int http_reader_read(http_reader_t *reader, void *buf, size_t len) {
+    size_t want = len;
+    if (reader->read_unit > 0 && want > reader->read_unit) {
+        want -= want % reader->read_unit;
+    }
+
+    // esp_http_client_read在请求长度读满、响应结束或超时后才返回
+    int64_t start_us = esp_timer_get_time();
+    int n = esp_http_client_read(reader->client, (char *)buf, want);
+    event_trace_http_read(start_us, n);
+    if (n > 0) {
+        reader->received += n;
+        reader->reads++;
+        if ((size_t)n < want) {
+            reader->short_reads++;
+        }
+    }
+    return n;
+}
+
+size_t http_reader_discard(http_reader_t *reader, size_t len) {
+    char scratch[256];
+    size_t done = 0;
+
+    while (done < len) {
+        size_t want = (len - done) < sizeof(scratch) ? (len - done) : sizeof(scratch);
+        int n = esp_http_client_read(reader->client, scratch, want);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    reader->discarded += done;
+    return done;
+}
+
+void http_reader_note_copy(http_reader_t *reader, size_t len) {
+    reader->copied += len;
+}
+
+uint32_t http_reader_copy_ratio_x100(const http_reader_t *reader) {
+    if (reader->received == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)reader->copied * 100 / reader->received);
+}
+
+void http_reader_log_stats(const http_reader_t *reader, const char *label) {
+    uint32_t ratio = http_reader_copy_ratio_x100(reader);
+    ESP_LOGI(TAG, "%s: received=%u in %u reads (avg %u, short %u), discarded=%u, copies/byte=%u.%02u",
+             label, (unsigned)reader->received, (unsigned)reader->reads,
+             reader->reads ? (unsigned)(reader->received / reader->reads) : 0,
+             (unsigned)reader->short_reads, (unsigned)reader->discarded,
+             (unsigned)(ratio / 100), (unsigned)(ratio % 100));
+}
+
+void http_reader_close(http_reader_t *reader) {
+    if (reader->client) {
+        esp_http_client_close(reader->client);
+    }
+}
@@ -0,0 +1,154 @@
+#include "i2s_monitor.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "audio_hal.h"
+#include "event_trace.h"
+
+static const char *TAG = "I2S_MONITOR";
+
+#define BYTES_PER_MS    (SAMPLE_RATE * 2 * sizeof(int16_t) / 1000)
+
+#if I2S_MONITOR_ENABLED
+// 回调和播放任务共享，均在内部RAM
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_armed = false;
+static volatile uint32_t s_position = 0;
+static volatile uint32_t s_available = 0;
+static volatile int64_t s_start_us = 0;
+static uint32_t s_sent = 0;                 // 播放完的DMA缓冲区序号
+static uint32_t s_last_ovf = 0;             // 上一次欠载触发时的序号，相邻则合并
+static uint32_t s_silent_bytes = 0;
+static uint32_t s_clip_underruns = 0;
+static uint32_t s_clip_buffers = 0;
+static i2s_glitch_t s_glitches[I2S_MONITOR_MAX_GLITCHES];
+static i2s_monitor_stats_t s_stats = {0};
+#endif
+
+static IRAM_ATTR bool i2s_sent_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    event_trace_record(EVENT_I2S_SENT, 0, (uint32_t)event->size, 0);
+#if I2S_MONITOR_ENABLED
+    portENTER_CRITICAL_ISR(&s_lock);
+    s_sent++;
+    portEXIT_CRITICAL_ISR(&s_lock);
+#endif
+    return false;
+}
+
+static IRAM_ATTR bool i2s_overflow_cb(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    event_trace_record(EVENT_I2S_UNDERFLOW, 0, (uint32_t)event->size, 0);
+#if I2S_MONITOR_ENABLED
+    // 第一次写入之前DMA还在空转，不算欠载
+    if (!s_armed || s_position == 0) {
+        return false;
+    }
+    portENTER_CRITICAL_ISR(&s_lock);
+    s_silent_bytes += event->size;
+    s_clip_buffers++;
+    if (s_clip_underruns > 0 && s_last_ovf + 1 == s_sent) {
+        if (s_clip_underruns <= I2S_MONITOR_MAX_GLITCHES) {
+            s_glitches[s_clip_underruns - 1].buffers++;
+        }
+    } else {
+        if (s_clip_underruns < I2S_MONITOR_MAX_GLITCHES) {
+            i2s_glitch_t *g = &s_glitches[s_clip_underruns];
+            g->time_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+            g->position = s_position;
+            g->ahead = s_available > s_position ? s_available - s_position : 0;
+            g->buffers = 1;
+        }
+        s_clip_underruns++;
+    }
+    s_last_ovf = s_sent;
+    portEXIT_CRITICAL_ISR(&s_lock);
+#endif
+    return false;
+}
+
+esp_err_t i2s_monitor_attach(i2s_chan_handle_t tx) {
+    i2s_event_callbacks_t cbs = {
+        .on_sent = i2s_sent_cb,
+        .on_send_q_ovf = i2s_overflow_cb,
+    };
+    return i2s_channel_register_event_callback(tx, &cbs, NULL);
+}
+
+void i2s_monitor_clip_begin(void) {
+#if I2S_MONITOR_ENABLED
+    portENTER_CRITICAL(&s_lock);
+    s_position = 0;
+    s_available = 0;
+    s_silent_bytes = 0;
+    s_clip_underruns = 0;
+    s_clip_buffers = 0;
+    s_armed = true;
+    portEXIT_CRITICAL(&s_lock);
+#endif
+}
+
+void i2s_monitor_note_write(uint32_t position, uint32_t available) {
+#if I2S_MONITOR_ENABLED
+    if (s_position == 0) {
+        s_start_us = esp_timer_get_time();
+    }
+    s_available = available;
+    s_position = position;
+#endif
+}
+
+void i2s_monitor_clip_end(const char *audio_id) {
+#if I2S_MONITOR_ENABLED
+    i2s_glitch_t glitches[I2S_MONITOR_MAX_GLITCHES];
+    uint32_t underruns, buffers, silent_bytes;
+
+    // 之后DMA播完剩余数据进入空转，不再计数
+    portENTER_CRITICAL(&s_lock);
+    s_armed = false;
+    underruns = s_clip_underruns;
+    buffers = s_clip_buffers;
+    silent_bytes = s_silent_bytes;
+    memcpy(glitches, s_glitches, sizeof(glitches));
+    portEXIT_CRITICAL(&s_lock);
+
+    uint32_t duration_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+    s_stats.clips++;
+    if (underruns == 0) {
+        ESP_LOGD(TAG, "No underruns in %s (%u ms)", audio_id, (unsigned)duration_ms);
+        return;
+    }
+    s_stats.clips_glitched++;
+    s_stats.underruns += underruns;
+    s_stats.silent_buffers += buffers;
+
+    ESP_LOGW(TAG, "%u underruns in %s: %u DMA buffers, %u ms silence over %u ms",
+             (unsigned)underruns, audio_id, (unsigned)buffers,
+             (unsigned)(silent_bytes / BYTES_PER_MS), (unsigned)duration_ms);
+    uint32_t shown = underruns < I2S_MONITOR_MAX_GLITCHES ? underruns : I2S_MONITOR_MAX_GLITCHES;
+    for (uint32_t i = 0; i < shown; i++) {
+        const i2s_glitch_t *g = &glitches[i];
+        bool network = g->ahead < I2S_MONITOR_NETWORK_AHEAD;
+        if (network) {
+            s_stats.network_underruns++;
+        }
+        ESP_LOGW(TAG, "  +%6u ms  pos %7u  ahead %7u  %2u buffers  %s",
+                 (unsigned)g->time_ms, (unsigned)g->position, (unsigned)g->ahead,
+                 (unsigned)g->buffers, network ? "network" : "scheduling");
+    }
+    if (underruns > shown) {
+        ESP_LOGW(TAG, "  ... %u more", (unsigned)(underruns - shown));
+    }
+    ESP_LOGI(TAG, "Totals: %u/%u clips glitched, %u underruns (%u network), %u silent buffers",
+             (unsigned)s_stats.clips_glitched, (unsigned)s_stats.clips, (unsigned)s_stats.underruns,
+             (unsigned)s_stats.network_underruns, (unsigned)s_stats.silent_buffers);
+#endif
+}
+
+void i2s_monitor_get_stats(i2s_monitor_stats_t *stats) {
+#if I2S_MONITOR_ENABLED
+    *stats = s_stats;
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
@@ -0,0 +1,55 @@
+#ifndef I2S_MONITOR_H
+#define I2S_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2s_std.h"
+
+/**
+ * I2S输出欠载检测 - 发送通道开启了auto_clear，没有新数据时DMA输出静音，欠载只能靠耳朵发现。
+ * on_send_q_ovf在一个DMA缓冲区播放完、而所有缓冲区都已空闲（没有待播数据）时触发，
+ * 即DMA开始播放清零后的缓冲区，每次触发约等于一个DMA缓冲区（DMA_BUF_LEN帧）的静音。
+ * 空闲时DMA持续空转也会触发，因此只统计片段第一次写入之后、最后一次写入之前的触发；
+ * 连续触发合并为一次欠载，记录发生时间、播放位置和当时已下载未写入的字节数：
+ * 余量耗尽说明网络没跟上，余量充足却欠载说明播放任务没被及时调度。片段结束时打印报告。
+ * 回调同时转发给event_trace（EVENT_I2S_SENT/EVENT_I2S_UNDERFLOW）。
+ * 输出端的实际波形可以录下后用tools/glitch_analyzer.py与源片段对比。
+ */
+
+#define I2S_MONITOR_ENABLED         1
+#define I2S_MONITOR_MAX_GLITCHES    16          // 每个片段详细记录的欠载数，超出只计数
+#define I2S_MONITOR_NETWORK_AHEAD   4096        // 欠载时余量不足一次写入（audio_stage块）归因于网络
+
+/* 一次欠载（连续静音的DMA缓冲区） */
+typedef struct {
+    uint32_t time_ms;           // 相对片段第一次写入
+    uint32_t position;          // 已写入I2S的字节数
+    uint32_t ahead;             // 已下载未写入的字节数
+    uint32_t buffers;           // 连续静音的DMA缓冲区数
+} i2s_glitch_t;
+
+/* 累计统计 */
+typedef struct {
+    uint32_t clips;             // 播放的片段数
+    uint32_t clips_glitched;    // 出现过欠载的片段数
+    uint32_t underruns;         // 欠载次数
+    uint32_t silent_buffers;    // 静音DMA缓冲区总数
+    uint32_t network_underruns; // 其中归因于网络的次数
+} i2s_monitor_stats_t;
+
+/* 注册发送通道回调，必须在通道使能前调用 */
+esp_err_t i2s_monitor_attach(i2s_chan_handle_t tx);
+
+/* 片段开始播放（第一次写入前调用） */
+void i2s_monitor_clip_begin(void);
+
+/* 每次写入I2S后调用：position为累计写入字节数，available为片段已下载字节数 */
+void i2s_monitor_note_write(uint32_t position, uint32_t available);
+
+/* 最后一次写入后调用，停止计数并打印本片段的欠载报告 */
+void i2s_monitor_clip_end(const char *audio_id);
+
+void i2s_monitor_get_stats(i2s_monitor_stats_t *stats);
+
+#endif /* I2S_MONITOR_H */
@@ -0,0 +1,479 @@
+#include "json_stream.h"
+#include <string.h>
+
+/* 主状态 */
+enum {
+    ST_VALUE = 0,           // 期望一个值
+    ST_KEY_OR_END,          // '{'之后：键或'}'
+    ST_KEY,                 // 下一个键（','之后）
+    ST_COLON,
+    ST_AFTER_VALUE,         // ','、'}'或']'
+    ST_VALUE_OR_END,        // '['之后：值或']'
+    ST_STRING,
+    ST_ESCAPE,
+    ST_UNICODE,
+    ST_NUMBER,
+    ST_LITERAL,
+    ST_DONE,
+    ST_ERROR,
+};
+
+/* 数字子状态，按JSON语法逐段检查 */
+enum {
+    NUM_SIGN = 0,           // 读到'-'，需要数字
+    NUM_ZERO,               // 整数部分是0
+    NUM_INT,
+    NUM_DOT,                // 读到'.'，需要数字
+    NUM_FRAC,
+    NUM_EXP,                // 读到'e'，需要符号或数字
+    NUM_EXP_SIGN,           // 读到指数符号，需要数字
+    NUM_EXP_DIGITS,
+};
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool in_array(const json_stream_t *js) {
+    return js->depth > 0 && (js->array_bits & (1u << (js->depth - 1)));
+}
+
+/* 根据刚读完的键找出要写入的字段 */
+static json_field_t *find_field(json_stream_t *js) {
+    if (js->key_overflow) {
+        return NULL;
+    }
+    for (size_t i = 0; i < js->field_count; i++) {
+        const char *key = js->fields[i].key;
+        if (strlen(key) == js->key_len && memcmp(key, js->key, js->key_len) == 0) {
+            js->fields[i].depth = js->depth;
+            return &js->fields[i];
+        }
+    }
+    return NULL;
+}
+
+/* 追加一个字节到当前字符串（键或值） */
+static void string_put(json_stream_t *js, char c) {
+    if (js->in_key) {
+        if (js->key_len < sizeof(js->key)) {
+            js->key[js->key_len++] = c;
+        } else {
+            js->key_overflow = true;
+        }
+        return;
+    }
+    json_field_t *f = js->target;
+    if (!f || f->type != JSON_FIELD_STRING) {
+        return;
+    }
+    if (js->str_len + 1 < f->dest_size) {
+        char *dest = (char *)f->dest;
+        dest[js->str_len++] = c;
+        dest[js->str_len] = '\0';
+    } else {
+        f->truncated = true;
+    }
+}
+
+/* 把码点按UTF-8写入当前字符串 */
+static void string_put_codepoint(json_stream_t *js, uint32_t cp) {
+    if (cp < 0x80) {
+        string_put(js, (char)cp);
+    } else if (cp < 0x800) {
+        string_put(js, (char)(0xC0 | (cp >> 6)));
+        string_put(js, (char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        string_put(js, (char)(0xE0 | (cp >> 12)));
+        string_put(js, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        string_put(js, (char)(0x80 | (cp & 0x3F)));
+    } else {
+        string_put(js, (char)(0xF0 | (cp >> 18)));
+        string_put(js, (char)(0x80 | ((cp >> 12) & 0x3F)));
+        string_put(js, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        string_put(js, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+/* 孤立的高代理项输出为U+FFFD */
+static void flush_surrogate(json_stream_t *js) {
+    if (js->high_surrogate) {
+        string_put_codepoint(js, 0xFFFD);
+        js->high_surrogate = 0;
+    }
+}
+
+/* 一个值结束，进入等待分隔符的状态 */
+static void value_done(json_stream_t *js) {
+    js->target = NULL;
+    js->state = js->depth == 0 ? ST_DONE : ST_AFTER_VALUE;
+}
+
+static void number_done(json_stream_t *js) {
+    json_field_t *f = js->target;
+    if (f && f->type == JSON_FIELD_INT) {
+        *(int64_t *)f->dest = js->negative ? -js->number : js->number;
+        f->found = true;
+    }
+    value_done(js);
+}
+
+static bool push(json_stream_t *js, bool array) {
+    if (js->depth >= JSON_STREAM_MAX_DEPTH) {
+        return false;
+    }
+    if (array) {
+        js->array_bits |= 1u << js->depth;
+    } else {
+        js->array_bits &= ~(1u << js->depth);
+    }
+    js->depth++;
+    // 容器不是字段值，丢弃之前匹配的键
+    js->target = NULL;
+    js->state = array ? ST_VALUE_OR_END : ST_KEY_OR_END;
+    return true;
+}
+
+static bool pop(json_stream_t *js, bool array) {
+    if (js->depth == 0 || in_array(js) != array) {
+        return false;
+    }
+    int depth = js->depth;
+    js->depth--;
+    if (!array && js->on_object_end) {
+        js->on_object_end(js->cb_ctx, depth);
+    }
+    value_done(js);
+    return true;
+}
+
+static bool start_string(json_stream_t *js, bool key) {
+    js->in_key = key;
+    js->str_len = 0;
+    js->high_surrogate = 0;
+    if (key) {
+        js->key_len = 0;
+        js->key_overflow = false;
+    } else if (js->target && js->target->type == JSON_FIELD_STRING) {
+        if (js->target->dest_size == 0) {
+            js->target = NULL;
+        } else {
+            ((char *)js->target->dest)[0] = '\0';
+            js->target->truncated = false;
+        }
+    }
+    js->state = ST_STRING;
+    return true;
+}
+
+/* 解析值的第一个字符 */
+static bool start_value(json_stream_t *js, char c) {
+    switch (c) {
+    case '{':
+        return push(js, false);
+    case '[':
+        return push(js, true);
+    case '"':
+        return start_string(js, false);
+    case 't':
+        js->literal = "true";
+        break;
+    case 'f':
+        js->literal = "false";
+        break;
+    case 'n':
+        js->literal = "null";
+        break;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            js->negative = c == '-';
+            js->number = c == '-' ? 0 : c - '0';
+            js->substate = c == '-' ? NUM_SIGN : (c == '0' ? NUM_ZERO : NUM_INT);
+            js->state = ST_NUMBER;
+            return true;
+        }
+        return false;
+    }
+    js->substate = 1;
+    js->state = ST_LITERAL;
+    return true;
+}
+
+/* 数字的一个字符，返回false表示数字已结束（c需要重新处理）；*ok置false表示语法错误 */
+static bool number_char(json_stream_t *js, char c, bool *ok) {
+    bool digit = c >= '0' && c <= '9';
+    *ok = true;
+
+    switch (js->substate) {
+    case NUM_SIGN:
+        if (!digit) {
+            *ok = false;
+            return true;
+        }
+        js->substate = c == '0' ? NUM_ZERO : NUM_INT;
+        js->number = c - '0';
+        return true;
+    case NUM_ZERO:
+    case NUM_INT:
+        if (digit && js->substate == NUM_INT) {
+            // 超出范围后不再累加，避免溢出
+            if (js->number <= (INT64_MAX - 9) / 10) {
+                js->number = js->number * 10 + (c - '0');
+            }
+            return true;
+        }
+        if (c == '.') {
+            js->substate = NUM_DOT;
+            return true;
+        }
+        if (c == 'e' || c == 'E') {
+            js->substate = NUM_EXP;
+            return true;
+        }
+        if (digit) {
+            *ok = false;        // 前导0
+            return true;
+        }
+        return false;
+    case NUM_DOT:
+        if (!digit) {
+            *ok = false;
+            return true;
+        }
+        js->substate = NUM_FRAC;
+        return true;
+    case NUM_FRAC:
+        if (digit) {
+            return true;
+        }
+        if (c == 'e' || c == 'E') {
+            js->substate = NUM_EXP;
+            return true;
+        }
+        return false;
+    case NUM_EXP:
+        if (c == '+' || c == '-') {
+            js->substate = NUM_EXP_SIGN;
+            return true;
+        }
+        // fall through
+    case NUM_EXP_SIGN:
+        if (!digit) {
+            *ok = false;
+            return true;
+        }
+        js->substate = NUM_EXP_DIGITS;
+        return true;
+    default:
+        return digit;
+    }
+}
+
+/* 处理一个字节，返回false表示语法错误 */
+static bool step(json_stream_t *js, char c) {
+    switch (js->state) {
+    case ST_STRING:
+        if (c == '"') {
+            flush_surrogate(js);
+            if (js->in_key) {
+                js->target = find_field(js);
+                js->state = ST_COLON;
+            } else {
+                if (js->target && js->target->type == JSON_FIELD_STRING) {
+                    js->target->found = true;
+                }
+                value_done(js);
+            }
+            return true;
+        }
+        if (c == '\\') {
+            js->state = ST_ESCAPE;
+            return true;
+        }
+        if ((unsigned char)c < 0x20) {
+            return false;
+        }
+        flush_surrogate(js);
+        string_put(js, c);
+        return true;
+
+    case ST_ESCAPE: {
+        char out;
+        switch (c) {
+        case '"':  out = '"'; break;
+        case '\\': out = '\\'; break;
+        case '/':  out = '/'; break;
+        case 'b':  out = '\b'; break;
+        case 'f':  out = '\f'; break;
+        case 'n':  out = '\n'; break;
+        case 'r':  out = '\r'; break;
+        case 't':  out = '\t'; break;
+        case 'u':
+            js->unicode = 0;
+            js->substate = 0;
+            js->state = ST_UNICODE;
+            return true;
+        default:
+            return false;
+        }
+        flush_surrogate(js);
+        string_put(js, out);
+        js->state = ST_STRING;
+        return true;
+    }
+
+    case ST_UNICODE: {
+        int v = hex_value(c);
+        if (v < 0) {
+            return false;
+        }
+        js->unicode = (js->unicode << 4) | (uint32_t)v;
+        if (++js->substate < 4) {
+            return true;
+        }
+        uint32_t cp = js->unicode;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            flush_surrogate(js);
+            js->high_surrogate = cp;
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            if (js->high_surrogate) {
+                string_put_codepoint(js, 0x10000 + ((js->high_surrogate - 0xD800) << 10) + (cp - 0xDC00));
+                js->high_surrogate = 0;
+            } else {
+                string_put_codepoint(js, 0xFFFD);
+            }
+        } else {
+            flush_surrogate(js);
+            string_put_codepoint(js, cp);
+        }
+        js->state = ST_STRING;
+        return true;
+    }
+
+    case ST_NUMBER: {
+        bool ok;
+        if (number_char(js, c, &ok)) {
+            return ok;
+        }
+        number_done(js);
+        return step(js, c);
+    }
+
+    case ST_LITERAL:
+        if (js->literal[js->substate] != c) {
+            return false;
+        }
+        if (js->literal[++js->substate] == '\0') {
+            value_done(js);
+        }
+        return true;
+
+    default:
+        break;
+    }
+
+    // 以下状态跳过空白
+    if (is_space(c)) {
+        return true;
+    }
+
+    switch (js->state) {
+    case ST_VALUE:
+        return start_value(js, c);
+    case ST_VALUE_OR_END:
+        if (c == ']') {
+            return pop(js, true);
+        }
+        return start_value(js, c);
+    case ST_KEY_OR_END:
+        if (c == '}') {
+            return pop(js, false);
+        }
+        // fall through
+    case ST_KEY:
+        return c == '"' && start_string(js, true);
+    case ST_COLON:
+        if (c != ':') {
+            return false;
+        }
+        js->state = ST_VALUE;
+        return true;
+    case ST_AFTER_VALUE:
+        if (c == ',') {
+            js->state = in_array(js) ? ST_VALUE : ST_KEY;
+            return true;
+        }
+        if (c == '}' || c == ']') {
+            return pop(js, c == ']');
+        }
+        return false;
+    case ST_DONE:
+        // 顶层值之后只允许空白
+        return false;
+    default:
+        return false;
+    }
+}
+
+void json_stream_reset_fields(json_field_t *fields, size_t field_count) {
+    for (size_t i = 0; i < field_count; i++) {
+        json_field_t *f = &fields[i];
+        f->found = false;
+        f->truncated = false;
+        f->depth = 0;
+        if (f->type == JSON_FIELD_STRING && f->dest_size > 0) {
+            ((char *)f->dest)[0] = '\0';
+        } else if (f->type == JSON_FIELD_INT) {
+            *(int64_t *)f->dest = 0;
+        }
+    }
+}
+
+void json_stream_init(json_stream_t *js, json_field_t *fields, size_t field_count,
+                      json_object_end_cb_t on_object_end, void *cb_ctx) {
+    memset(js, 0, sizeof(*js));
+    js->fields = fields;
+    js->field_count = field_count;
+    js->on_object_end = on_object_end;
+    js->cb_ctx = cb_ctx;
+    js->state = ST_VALUE;
+    json_stream_reset_fields(fields, field_count);
+}
+
+json_stream_status_t json_stream_feed(json_stream_t *js, const char *data, size_t len) {
+    for (size_t i = 0; i < len && js->state != ST_ERROR; i++) {
+        if (!step(js, data[i])) {
+            js->state = ST_ERROR;
+            js->target = NULL;
+        }
+        js->offset++;
+    }
+    if (js->state == ST_ERROR) {
+        return JSON_STREAM_ERROR;
+    }
+    return js->state == ST_DONE ? JSON_STREAM_DONE : JSON_STREAM_MORE;
+}
+
+json_stream_status_t json_stream_finish(json_stream_t *js) {
+    // 顶层数字没有结束符，输入结束时才算完整
+    if (js->state == ST_NUMBER && js->depth == 0) {
+        bool ok;
+        if (number_char(js, ' ', &ok) || !ok) {
+            js->state = ST_ERROR;
+        } else {
+            number_done(js);
+        }
+    }
+    if (js->state == ST_DONE) {
+        return JSON_STREAM_DONE;
+    }
+    js->state = ST_ERROR;
+    return JSON_STREAM_ERROR;
+}
@@ -0,0 +1,192 @@
+#include "latency_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define RING_MASK   (LATENCY_TRACE_RING_SIZE - 1)
+
+_Static_assert((LATENCY_TRACE_RING_SIZE & RING_MASK) == 0, "ring size must be a power of two");
+
+/* 序号：写入第i个事件期间为2i+1，写完为2i+2，0表示从未写过 */
+typedef struct {
+    _Atomic uint32_t seq;
+    latency_event_t event;
+} trace_slot_t;
+
+static trace_slot_t s_ring[LATENCY_TRACE_RING_SIZE];
+static _Atomic uint32_t s_head;
+static _Atomic uint32_t s_next_turn;
+static int64_t (*s_clock_us)(void);
+static latency_trace_listener_t s_listener;
+
+static const char *const point_names[LATENCY_POINT_COUNT] = {
+    "vad_start", "vad_stop", "upload_start", "upload_response", "poll_sent", "poll_parsed",
+    "dl_connect", "first_byte", "watermark", "first_i2s", "last_sample",
+};
+
+void latency_trace_init(int64_t (*clock_us)(void)) {
+    s_clock_us = clock_us;
+    for (int i = 0; i < LATENCY_TRACE_RING_SIZE; i++) {
+        atomic_store(&s_ring[i].seq, 0);
+    }
+    atomic_store(&s_head, 0);
+    atomic_store(&s_next_turn, 0);
+}
+
+void latency_trace_set_listener(latency_trace_listener_t listener) {
+    s_listener = listener;
+}
+
+int64_t latency_trace_now(void) {
+    return s_clock_us ? s_clock_us() : 0;
+}
+
+uint16_t latency_trace_begin_turn(void) {
+    uint16_t turn;
+    do {
+        turn = (uint16_t)(atomic_fetch_add(&s_next_turn, 1) + 1);
+    } while (turn == LATENCY_TRACE_TURN_NONE);
+    return turn;
+}
+
+void latency_trace_mark_at(uint16_t turn, latency_point_t point, uint32_t arg, int64_t time_us) {
+    if (turn == LATENCY_TRACE_TURN_NONE || point >= LATENCY_POINT_COUNT) {
+        return;
+    }
+    uint32_t index = atomic_fetch_add(&s_head, 1);
+    trace_slot_t *slot = &s_ring[index & RING_MASK];
+
+    atomic_store_explicit(&slot->seq, index * 2 + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->event.time_us = time_us;
+    slot->event.arg = arg;
+    slot->event.turn = turn;
+    slot->event.point = (uint8_t)point;
+    atomic_store_explicit(&slot->seq, index * 2 + 2, memory_order_release);
+
+    latency_trace_listener_t listener = s_listener;
+    if (listener) {
+        listener(turn, point, arg);
+    }
+}
+
+void latency_trace_mark(uint16_t turn, latency_point_t point, uint32_t arg) {
+    if (turn != LATENCY_TRACE_TURN_NONE) {
+        latency_trace_mark_at(turn, point, arg, latency_trace_now());
+    }
+}
+
+/* 读取第index个事件，槽位已被覆盖或正在写入时返回false */
+static bool read_event(uint32_t index, latency_event_t *out) {
+    const trace_slot_t *slot = &s_ring[index & RING_MASK];
+    uint32_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (before != index * 2 + 2) {
+        return false;
+    }
+    *out = slot->event;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == before;
+}
+
+size_t latency_trace_snapshot(latency_event_t *out, size_t max) {
+    uint32_t head = atomic_load(&s_head);
+    uint32_t first = head > LATENCY_TRACE_RING_SIZE ? head - LATENCY_TRACE_RING_SIZE : 0;
+    size_t count = 0;
+
+    for (uint32_t i = first; i != head && count < max; i++) {
+        if (read_event(i, &out[count])) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool latency_trace_summarize(uint16_t turn, latency_turn_t *out) {
+    uint32_t head = atomic_load(&s_head);
+    uint32_t first = head > LATENCY_TRACE_RING_SIZE ? head - LATENCY_TRACE_RING_SIZE : 0;
+
+    memset(out, 0, sizeof(*out));
+    out->turn = turn;
+    for (uint32_t i = first; i != head; i++) {
+        latency_event_t ev;
+        if (!read_event(i, &ev) || ev.turn != turn) {
+            continue;
+        }
+        uint32_t bit = 1u << ev.point;
+        if (!(out->mask & bit)) {
+            out->mask |= bit;
+            out->stamp_us[ev.point] = ev.time_us;
+            out->arg[ev.point] = ev.arg;
+        }
+    }
+    return out->mask != 0;
+}
+
+void latency_trace_accumulate(const latency_turn_t *t, latency_stage_stats_t stats[LATENCY_POINT_COUNT]) {
+    int prev = -1;
+    for (int p = 0; p < LATENCY_POINT_COUNT; p++) {
+        if (!(t->mask & (1u << p))) {
+            continue;
+        }
+        if (prev >= 0) {
+            int64_t delta = t->stamp_us[p] - t->stamp_us[prev];
+            stats[p].count++;
+            stats[p].sum_us += delta;
+            if (delta > stats[p].max_us) {
+                stats[p].max_us = delta;
+            }
+        }
+        prev = p;
+    }
+}
+
+int latency_trace_format(const latency_turn_t *t, char *buf, size_t len) {
+    size_t pos = 0;
+    int prev = -1;
+    int first = -1;
+
+#define APPEND(...) do { \
+        int n = snprintf(buf + pos, pos < len ? len - pos : 0, __VA_ARGS__); \
+        if (n > 0) pos += (size_t)n; \
+    } while (0)
+
+    if (len == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+    APPEND("turn %u:", t->turn);
+    for (int p = 0; p < LATENCY_POINT_COUNT; p++) {
+        if (!(t->mask & (1u << p))) {
+            continue;
+        }
+        if (first < 0) {
+            first = p;
+        }
+        double delta_ms = prev >= 0 ? (t->stamp_us[p] - t->stamp_us[prev]) / 1000.0 : 0.0;
+        APPEND("%s %s %+.1f", prev >= 0 ? " |" : "", point_names[p], delta_ms);
+        prev = p;
+    }
+
+    // 关键指标：从回合开始、以及从说完话到第一个样本
+    if (first >= 0 && (t->mask & (1u << LATENCY_FIRST_I2S))) {
+        APPEND(" | first sample %.1f ms", (t->stamp_us[LATENCY_FIRST_I2S] - t->stamp_us[first]) / 1000.0);
+        if (t->mask & (1u << LATENCY_VAD_STOP)) {
+            APPEND(" (%.1f ms after speech end)",
+                   (t->stamp_us[LATENCY_FIRST_I2S] - t->stamp_us[LATENCY_VAD_STOP]) / 1000.0);
+        }
+    }
+    if (first >= 0 && prev != first) {
+        APPEND(", total %.1f ms", (t->stamp_us[prev] - t->stamp_us[first]) / 1000.0);
+    }
+#undef APPEND
+
+    return (int)(pos < len ? pos : len - 1);
+}
+
+const char *latency_point_name(latency_point_t point) {
+    return point < LATENCY_POINT_COUNT ? point_names[point] : "?";
+}
+
+uint32_t latency_trace_event_count(void) {
+    return atomic_load(&s_head);
+}
@@ -18,9 +18,106 @@
 #include "audio_hal.h"
 #include "audio_player.h"
 #include "http_client.h"
+#include "audio_pool.h"
+#include "mem_track.h"
+#include "boot.h"
+#include "net_power.h"
+#include "tts_job.h"
+#include "push_client.h"
+#include "clip_cache.h"
+#include "latency_trace.h"
+#include "event_trace.h"
+#include "net_bench.h"
+#include "esp_timer.h"
 
 static const char *TAG = "ESP32_POLLING_AUDIO";
 
+/* 启动阶段 - 顺序与下面的表一致，依赖用BOOT_DEP声明 */
+enum {
+    PHASE_NVS = 0,
+    PHASE_POOL,
+    PHASE_CACHE,
+    PHASE_WIFI,
+    PHASE_CODEC,
+    PHASE_PLAYER,
+    PHASE_POLLER,
+    PHASE_TELEMETRY,
+    PHASE_COUNT
+};
+
+/* 初始化NVS */
+static esp_err_t phase_nvs(void) {
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    return ret;
+}
+
+/* 加载片段缓存索引，没有缓存分区时照常下载 */
+static esp_err_t phase_cache(void) {
+    esp_err_t ret = clip_cache_init();
+    return ret == ESP_ERR_NOT_FOUND ? ESP_OK : ret;
+}
+
+/* 创建音频播放任务 */
+static esp_err_t phase_player(void) {
+    audio_player_init();
+    if (xTaskCreate(audio_playback_task, "audio_playback", 4096, NULL, 10, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* 创建TTS轮询任务 */
+static esp_err_t phase_poller(void) {
+#if NET_BENCH_ENABLED
+    // 基准测试模式：独占网络和段池，不接收任务
+    return net_bench_start();
+#else
+    // WiFi已启动，按播放/下载状态和空闲时间切换modem sleep
+    esp_err_t ret = net_power_start();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // 推送和批量轮询共用的播放列表
+    ret = tts_playlist_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // 服务器推送通道，连接失败时轮询任务自动使用长轮询
+    ret = push_client_start();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (xTaskCreate(tts_polling_task, "tts_polling", 4096, NULL, 5, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+#endif
+}
+
+/* 定期上报各子系统内存占用 */
+static esp_err_t phase_telemetry(void) {
+    return mem_track_start_reporting(MEM_TRACK_REPORT_INTERVAL_MS, http_send_heap_report);
+}
+
+/* 音频池最先预留，避免WiFi和驱动的分配先把堆切碎；WiFi关联与编解码器初始化并行 */
+static const boot_phase_t s_boot_phases[PHASE_COUNT] = {
+    [PHASE_NVS]       = { "nvs",       phase_nvs,       0,                                             0 },
+    [PHASE_POOL]      = { "pool",      audio_pool_init, 0,                                             0 },
+    [PHASE_CACHE]     = { "cache",     phase_cache,     0,                                             0 },
+    [PHASE_WIFI]      = { "wifi",      wifi_init_sta,   BOOT_DEP(PHASE_NVS) | BOOT_DEP(PHASE_POOL),    4096 },
+    [PHASE_CODEC]     = { "codec",     audio_hal_init,  BOOT_DEP(PHASE_POOL),                          0 },
+    [PHASE_PLAYER]    = { "player",    phase_player,    BOOT_DEP(PHASE_CODEC) | BOOT_DEP(PHASE_POOL),  0 },
+    [PHASE_POLLER]    = { "poller",    phase_poller,    BOOT_DEP(PHASE_WIFI) | BOOT_DEP(PHASE_PLAYER) | BOOT_DEP(PHASE_CACHE), 0 },
+    [PHASE_TELEMETRY] = { "telemetry", phase_telemetry, BOOT_DEP(PHASE_WIFI),                          0 },
+};
+
 void app_main(void) {
     ESP_LOGI(TAG, "ESP32 Polling-based TTS Audio Player with PSRAM Support");
     ESP_LOGI(TAG, "Device ID: %s", DEVICE_ID);
@@ -35,30 +132,18 @@ void app_main(void) {
         ESP_LOGW(TAG, "No PSRAM detected! Large audio files may fail.");
     }
     
-    // 初始化NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+    // 语音回合延迟追踪
+    latency_trace_init(esp_timer_get_time);
+    
+    // 时间线追踪，须在I2S初始化之前分配
+    if (event_trace_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Event trace disabled");
     }
-    ESP_ERROR_CHECK(ret);
-
-    // 初始化WiFi
-    ESP_ERROR_CHECK(wifi_init_sta());
-
-    // 初始化音频硬件
-    ESP_ERROR_CHECK(audio_hal_init());
-
-    // 初始化音频播放器
-    audio_player_init();
-
-    // 创建音频播放任务
-    xTaskCreate(audio_playback_task, "audio_playback", 4096, NULL, 10, NULL);
-
-    // 创建TTS轮询任务
-    xTaskCreate(tts_polling_task, "tts_polling", 4096, NULL, 5, NULL);
+    
+    // 并行启动：WiFi关联、编解码器/I2S初始化同时进行
+    ESP_ERROR_CHECK(boot_run(s_boot_phases, PHASE_COUNT, portMAX_DELAY));
 
     ESP_LOGI(TAG, "System ready. TTS polling started.");
     ESP_LOGI(TAG, "Server URL: %s", TTS_SERVER_URL);
     ESP_LOGI(TAG, "Device ID: %s", DEVICE_ID);
-}
\ No newline at end of file
+}
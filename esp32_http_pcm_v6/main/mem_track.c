@@ -0,0 +1,215 @@
+#include "mem_track.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "MEM_TRACK";
+
+static const char *s_tag_names[MEM_TAG_COUNT] = {
+    [MEM_TAG_NETWORK] = "network",
+    [MEM_TAG_PLAYER]  = "player",
+    [MEM_TAG_CAPTURE] = "capture",
+    [MEM_TAG_DECODER] = "decoder",
+    [MEM_TAG_CODEC]   = "codec",
+};
+
+static const struct {
+    const char *name;
+    uint32_t caps;
+} s_caps[MEM_CAPS_COUNT] = {
+    [MEM_CAPS_INTERNAL] = { "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+    [MEM_CAPS_SPIRAM]   = { "psram",    MALLOC_CAP_SPIRAM },
+    [MEM_CAPS_DMA]      = { "dma",      MALLOC_CAP_DMA },
+};
+
+static mem_tag_stats_t s_stats[MEM_TAG_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static mem_track_sink_t s_sink = NULL;
+static uint32_t s_interval_ms = MEM_TRACK_REPORT_INTERVAL_MS;
+static uint16_t s_seq = 0;
+
+static void track_alloc(mem_tag_t tag, void *ptr, size_t size) {
+    if (tag >= MEM_TAG_COUNT) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    mem_tag_stats_t *st = &s_stats[tag];
+    if (ptr) {
+        st->alloc_count++;
+        st->current += size;
+        if (st->current > st->peak) {
+            st->peak = st->current;
+        }
+    } else {
+        st->fail_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void track_free(mem_tag_t tag, size_t size) {
+    if (tag >= MEM_TAG_COUNT) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    mem_tag_stats_t *st = &s_stats[tag];
+    st->free_count++;
+    st->current = st->current > size ? st->current - size : 0;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* 按堆实际分配的块大小记账，释放时用同一个值扣除 */
+static size_t allocated_size(void *ptr) {
+    return ptr ? heap_caps_get_allocated_size(ptr) : 0;
+}
+
+void *mem_track_malloc(mem_tag_t tag, size_t size, uint32_t caps) {
+    void *ptr = heap_caps_malloc(size, caps);
+    track_alloc(tag, ptr, allocated_size(ptr));
+    return ptr;
+}
+
+void *mem_track_calloc(mem_tag_t tag, size_t n, size_t size, uint32_t caps) {
+    void *ptr = heap_caps_calloc(n, size, caps);
+    track_alloc(tag, ptr, allocated_size(ptr));
+    return ptr;
+}
+
+void *mem_track_aligned_alloc(mem_tag_t tag, size_t alignment, size_t size, uint32_t caps) {
+    void *ptr = heap_caps_aligned_alloc(alignment, size, caps);
+    track_alloc(tag, ptr, allocated_size(ptr));
+    return ptr;
+}
+
+void mem_track_free(mem_tag_t tag, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    track_free(tag, allocated_size(ptr));
+    heap_caps_free(ptr);
+}
+
+void mem_track_charge(mem_tag_t tag, size_t size) {
+    track_alloc(tag, (void *)1, size);
+}
+
+void mem_track_discharge(mem_tag_t tag, size_t size) {
+    track_free(tag, size);
+}
+
+void mem_track_get_tag_stats(mem_tag_t tag, mem_tag_stats_t *stats) {
+    if (tag >= MEM_TAG_COUNT || !stats) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats[tag];
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void mem_track_get_caps_stats(mem_caps_id_t id, mem_caps_stats_t *stats) {
+    if (id >= MEM_CAPS_COUNT || !stats) {
+        return;
+    }
+
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, s_caps[id].caps);
+    stats->free_size = info.total_free_bytes;
+    stats->largest_free_block = info.largest_free_block;
+    stats->min_free_size = info.minimum_free_bytes;
+}
+
+const char *mem_track_tag_name(mem_tag_t tag) {
+    return tag < MEM_TAG_COUNT ? s_tag_names[tag] : "unknown";
+}
+
+size_t mem_track_build_report(uint8_t *buf, size_t len) {
+    if (!buf || len < MEM_TRACK_REPORT_SIZE) {
+        return 0;
+    }
+
+    mem_report_header_t header = {
+        .magic = MEM_TRACK_REPORT_MAGIC,
+        .version = MEM_TRACK_REPORT_VERSION,
+        .tag_count = MEM_TAG_COUNT,
+        .caps_count = MEM_CAPS_COUNT,
+        .seq = s_seq++,
+        .uptime_ms = (uint32_t)(esp_timer_get_time() / 1000),
+    };
+    uint8_t *p = buf;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        mem_tag_stats_t st;
+        mem_track_get_tag_stats(i, &st);
+        mem_report_tag_t entry = {
+            .current = st.current,
+            .peak = st.peak,
+            .alloc_count = st.alloc_count,
+            .fail_count = st.fail_count > 0xFFFF ? 0xFFFF : st.fail_count,
+        };
+        memcpy(p, &entry, sizeof(entry));
+        p += sizeof(entry);
+    }
+
+    for (int i = 0; i < MEM_CAPS_COUNT; i++) {
+        mem_caps_stats_t st;
+        mem_track_get_caps_stats(i, &st);
+        mem_report_caps_t entry = {
+            .free_size = st.free_size,
+            .largest_free_block = st.largest_free_block,
+            .min_free_size = st.min_free_size,
+        };
+        memcpy(p, &entry, sizeof(entry));
+        p += sizeof(entry);
+    }
+
+    return p - buf;
+}
+
+void mem_track_log(void) {
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        mem_tag_stats_t st;
+        mem_track_get_tag_stats(i, &st);
+        ESP_LOGI(TAG, "%-8s current=%d peak=%d allocs=%lu frees=%lu fails=%lu",
+                 s_tag_names[i], st.current, st.peak, st.alloc_count, st.free_count, st.fail_count);
+    }
+    for (int i = 0; i < MEM_CAPS_COUNT; i++) {
+        mem_caps_stats_t st;
+        mem_track_get_caps_stats(i, &st);
+        ESP_LOGI(TAG, "%-8s free=%d largest=%d min_free=%d",
+                 s_caps[i].name, st.free_size, st.largest_free_block, st.min_free_size);
+    }
+}
+
+/* 定期报告任务 */
+static void mem_track_report_task(void *pvParameters) {
+    uint8_t report[MEM_TRACK_REPORT_SIZE];
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(s_interval_ms));
+
+        size_t len = mem_track_build_report(report, sizeof(report));
+        mem_track_log();
+        if (s_sink && len > 0) {
+            s_sink(report, len);
+        }
+    }
+}
+
+esp_err_t mem_track_start_reporting(uint32_t interval_ms, mem_track_sink_t sink) {
+    s_interval_ms = interval_ms ? interval_ms : MEM_TRACK_REPORT_INTERVAL_MS;
+    s_sink = sink;
+
+    if (xTaskCreate(mem_track_report_task, "mem_report", MEM_TRACK_REPORT_STACK, NULL, 2, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create report task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Heap report every %lu ms (%d bytes)", s_interval_ms, MEM_TRACK_REPORT_SIZE);
+    return ESP_OK;
+}
@@ -0,0 +1,111 @@
+#ifndef MEM_TRACK_H
+#define MEM_TRACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * 按子系统统计堆内存
+ * 每个子系统通过带标签的分配函数申请内存，记录当前占用、峰值和分配失败次数；
+ * 库内部的分配（HTTP客户端、编解码器驱动）通过mem_track_charge按前后空闲差值记账。
+ * 定期生成紧凑的二进制报告，内存回归可以定位到具体子系统。
+ *
+ * 注意：空闲差值记账是近似值。调用期间其他任务的分配/释放也会计入差值
+ * （多算或少算，差值为负时记0），因此库内部分配的current/peak只能看趋势；
+ * 释放时扣除的是当初记入的同一个值，误差不会随时间累积。
+ * 带标签分配函数按堆实际分配的块大小记账，是精确值。
+ */
+
+#define MEM_TRACK_REPORT_INTERVAL_MS  60000
+#define MEM_TRACK_REPORT_STACK        4096        // sink在报告任务中执行HTTP POST
+#define MEM_TRACK_REPORT_MAGIC        0x544D      // "MT"
+#define MEM_TRACK_REPORT_VERSION      1
+
+typedef enum {
+    MEM_TAG_NETWORK = 0,
+    MEM_TAG_PLAYER,
+    MEM_TAG_CAPTURE,
+    MEM_TAG_DECODER,
+    MEM_TAG_CODEC,
+    MEM_TAG_COUNT
+} mem_tag_t;
+
+/* 报告中统计的堆类型 */
+typedef enum {
+    MEM_CAPS_INTERNAL = 0,
+    MEM_CAPS_SPIRAM,
+    MEM_CAPS_DMA,
+    MEM_CAPS_COUNT
+} mem_caps_id_t;
+
+typedef struct {
+    size_t current;             // 当前占用字节数
+    size_t peak;                // 占用峰值
+    uint32_t alloc_count;
+    uint32_t free_count;
+    uint32_t fail_count;        // 分配失败次数
+} mem_tag_stats_t;
+
+typedef struct {
+    size_t free_size;
+    size_t largest_free_block;
+    size_t min_free_size;       // 启动以来的最低空闲
+} mem_caps_stats_t;
+
+/* 二进制报告格式（小端，紧凑排列） */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t tag_count;
+    uint8_t caps_count;
+    uint8_t reserved;
+    uint16_t seq;
+    uint32_t uptime_ms;
+} mem_report_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t current;
+    uint32_t peak;
+    uint32_t alloc_count;
+    uint16_t fail_count;        // 饱和到0xFFFF
+} mem_report_tag_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t free_size;
+    uint32_t largest_free_block;
+    uint32_t min_free_size;
+} mem_report_caps_t;
+
+#define MEM_TRACK_REPORT_SIZE \
+    (sizeof(mem_report_header_t) + MEM_TAG_COUNT * sizeof(mem_report_tag_t) + \
+     MEM_CAPS_COUNT * sizeof(mem_report_caps_t))
+
+/* 报告发送回调 */
+typedef void (*mem_track_sink_t)(const uint8_t *report, size_t len);
+
+/* 带标签的分配/释放，caps同heap_caps_malloc */
+void *mem_track_malloc(mem_tag_t tag, size_t size, uint32_t caps);
+void *mem_track_calloc(mem_tag_t tag, size_t n, size_t size, uint32_t caps);
+void *mem_track_aligned_alloc(mem_tag_t tag, size_t alignment, size_t size, uint32_t caps);
+void mem_track_free(mem_tag_t tag, void *ptr);
+
+/* 为库内部的分配记账（如HTTP客户端句柄），size为调用前后的空闲差值（近似值，见上） */
+void mem_track_charge(mem_tag_t tag, size_t size);
+void mem_track_discharge(mem_tag_t tag, size_t size);
+
+/* 查询接口 */
+void mem_track_get_tag_stats(mem_tag_t tag, mem_tag_stats_t *stats);
+void mem_track_get_caps_stats(mem_caps_id_t id, mem_caps_stats_t *stats);
+const char *mem_track_tag_name(mem_tag_t tag);
+
+/* 生成二进制报告，返回写入的字节数，缓冲区不足返回0 */
+size_t mem_track_build_report(uint8_t *buf, size_t len);
+
+/* 打印所有子系统和堆的统计 */
+void mem_track_log(void);
+
+/* 启动定期报告任务，sink为NULL时只打印日志 */
+esp_err_t mem_track_start_reporting(uint32_t interval_ms, mem_track_sink_t sink);
+
+#endif /* MEM_TRACK_H */
@@ -0,0 +1,289 @@
+#include "net_bench.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_http_client.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "http_client.h"
+#include "http_reader.h"
+#include "audio_pool.h"
+
+static const char *TAG = "NET_BENCH";
+
+// 各版本用过的buffer_size（512为esp_http_client默认值）
+static const uint32_t s_buffer_sizes[] = {512, 1024, 2048, 4096, 8192};
+// 每次读取长度：1KB、播放块（HTTP_READ_UNIT）、v6的最大读取长度（HTTP_READ_MAX）
+static const uint32_t s_read_sizes[] = {1024, HTTP_READ_UNIT, HTTP_READ_MAX};
+static const char *const s_sink_names[NET_BENCH_SINK_COUNT] = {"null", "psram", "bounce"};
+
+#define BUFFER_SIZE_COUNT  (sizeof(s_buffer_sizes) / sizeof(s_buffer_sizes[0]))
+#define READ_SIZE_COUNT    (sizeof(s_read_sizes) / sizeof(s_read_sizes[0]))
+#define CASE_COUNT         (BUFFER_SIZE_COUNT * READ_SIZE_COUNT * NET_BENCH_SINK_COUNT)
+
+/* 一次下载的测量结果 */
+typedef struct {
+    uint32_t kbps;
+    uint32_t worst_kbps;
+    uint32_t ttfb_ms;
+    uint32_t cpu_x10[portNUM_PROCESSORS];
+} bench_run_t;
+
+static net_bench_result_t s_results[CASE_COUNT];
+static audio_clip_t s_clip;
+static uint8_t *s_scratch;
+
+/* 各核空闲任务的运行时间（us），需要CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS */
+static void idle_snapshot(uint32_t idle_us[portNUM_PROCESSORS]) {
+    memset(idle_us, 0, portNUM_PROCESSORS * sizeof(uint32_t));
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    static TaskStatus_t status[NET_BENCH_MAX_TASKS];
+    UBaseType_t count = uxTaskGetSystemState(status, NET_BENCH_MAX_TASKS, NULL);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskHandle_t idle = xTaskGetIdleTaskHandleForCore(core);
+        for (UBaseType_t i = 0; i < count; i++) {
+            if (status[i].xHandle == idle) {
+                idle_us[core] = (uint32_t)status[i].ulRunTimeCounter;
+                break;
+            }
+        }
+    }
+#endif
+}
+
+/* 下载一次测试对象，读入的数据按sink处理 */
+static esp_err_t bench_once(uint32_t buffer_size, uint32_t read_size, net_bench_sink_t sink,
+                            http_reader_t *reader, bench_run_t *run) {
+    char url[96];
+    snprintf(url, sizeof(url), TTS_SERVER_URL "/bench/%u", (unsigned)NET_BENCH_OBJECT_SIZE);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 10000,
+        .buffer_size = buffer_size,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t idle_before[portNUM_PROCESSORS], idle_after[portNUM_PROCESSORS];
+    idle_snapshot(idle_before);
+    int64_t start_us = esp_timer_get_time();
+    size_t received_before = reader->received;
+
+    esp_err_t err = http_reader_open(reader, client);
+    if (err == ESP_OK && reader->status != 200) {
+        ESP_LOGE(TAG, "HTTP %d from %s", reader->status, url);
+        err = ESP_FAIL;
+    }
+    int64_t first_us = esp_timer_get_time();
+    int64_t window_us = first_us;
+    size_t window_bytes = 0;
+    uint32_t worst_kbps = UINT32_MAX;
+
+    while (err == ESP_OK) {
+        uint8_t *dst = s_scratch;
+        size_t want = read_size;
+        if (sink == NET_BENCH_SINK_PSRAM) {
+            size_t space;
+            dst = audio_clip_reserve(&s_clip, AUDIO_SEGMENT_COUNT, &space);
+            if (!dst) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            if (want > space) {
+                want = space;
+            }
+        }
+
+        int n = http_reader_read(reader, dst, want);
+        if (n < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        if (sink == NET_BENCH_SINK_PSRAM) {
+            audio_clip_commit(&s_clip, n);
+        } else if (sink == NET_BENCH_SINK_BOUNCE) {
+            if (audio_clip_append(&s_clip, s_scratch, n, AUDIO_SEGMENT_COUNT) != (size_t)n) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            http_reader_note_copy(reader, n);
+        }
+
+        // 最差窗口：只统计完整的窗口
+        int64_t now = esp_timer_get_time();
+        window_bytes += n;
+        if (now - window_us >= NET_BENCH_WINDOW_MS * 1000) {
+            uint32_t kbps = (uint32_t)((uint64_t)window_bytes * 8000 / (now - window_us));
+            if (kbps < worst_kbps) {
+                worst_kbps = kbps;
+            }
+            window_us = now;
+            window_bytes = 0;
+        }
+    }
+
+    int64_t end_us = esp_timer_get_time();
+    idle_snapshot(idle_after);
+    http_reader_close(reader);
+    esp_http_client_cleanup(client);
+    audio_clip_release(&s_clip);
+
+    size_t received = reader->received - received_before;
+    if (err == ESP_OK && received != NET_BENCH_OBJECT_SIZE) {
+        ESP_LOGW(TAG, "Short download: %u of %u bytes", (unsigned)received, (unsigned)NET_BENCH_OBJECT_SIZE);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    int64_t elapsed = end_us - start_us;
+    run->kbps = end_us > first_us ? (uint32_t)((uint64_t)received * 8000 / (end_us - first_us)) : 0;
+    run->worst_kbps = worst_kbps == UINT32_MAX ? run->kbps : worst_kbps;
+    run->ttfb_ms = (uint32_t)((first_us - start_us) / 1000);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t idle = idle_after[core] - idle_before[core];
+        run->cpu_x10[core] = idle < elapsed ? (uint32_t)((elapsed - idle) * 1000 / elapsed) : 0;
+    }
+    return ESP_OK;
+}
+
+/* 一个组合下载NET_BENCH_REPEATS次并汇总 */
+static void bench_case(net_bench_result_t *r) {
+    http_reader_t reader;
+    http_reader_init(&reader, 0);
+    uint64_t kbps_sum = 0, ttfb_sum = 0;
+    uint64_t cpu_sum[portNUM_PROCESSORS] = {0};
+
+    r->worst_kbps = UINT32_MAX;
+    for (int i = 0; i < NET_BENCH_REPEATS; i++) {
+        bench_run_t run;
+        esp_err_t err = bench_once(r->buffer_size, r->read_size, r->sink, &reader, &run);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Run failed: %s", esp_err_to_name(err));
+            r->failures++;
+            continue;
+        }
+        r->runs++;
+        kbps_sum += run.kbps;
+        ttfb_sum += run.ttfb_ms;
+        if (run.worst_kbps < r->worst_kbps) {
+            r->worst_kbps = run.worst_kbps;
+        }
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            cpu_sum[core] += run.cpu_x10[core];
+        }
+    }
+
+    if (r->runs == 0) {
+        r->worst_kbps = 0;
+        return;
+    }
+    r->avg_kbps = (uint32_t)(kbps_sum / r->runs);
+    r->ttfb_ms = (uint32_t)(ttfb_sum / r->runs);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        r->cpu_x10[core] = (uint32_t)(cpu_sum[core] / r->runs);
+    }
+    r->copies_x100 = http_reader_copy_ratio_x100(&reader);
+    r->avg_read = reader.reads ? (uint32_t)(reader.received / reader.reads) : 0;
+}
+
+static void log_result(const net_bench_result_t *r) {
+    // 最差窗口与实时码率之比，低于1表示该窗口内播放会欠载
+    uint32_t margin_x10 = r->worst_kbps * 10 / NET_BENCH_REALTIME_KBPS;
+    ESP_LOGI(TAG, "%-6s buf %4u read %5u | %2u.%02u Mbps worst %2u.%02u (x%u.%u RT) ttfb %4u ms | "
+             "cpu %3u.%u%% %3u.%u%% | copies %u.%02u avg read %5u | %u/%u ok",
+             s_sink_names[r->sink], (unsigned)r->buffer_size, (unsigned)r->read_size,
+             (unsigned)(r->avg_kbps / 1000), (unsigned)(r->avg_kbps % 1000 / 10),
+             (unsigned)(r->worst_kbps / 1000), (unsigned)(r->worst_kbps % 1000 / 10),
+             (unsigned)(margin_x10 / 10), (unsigned)(margin_x10 % 10), (unsigned)r->ttfb_ms,
+             (unsigned)(r->cpu_x10[0] / 10), (unsigned)(r->cpu_x10[0] % 10),
+             (unsigned)(r->cpu_x10[portNUM_PROCESSORS - 1] / 10), (unsigned)(r->cpu_x10[portNUM_PROCESSORS - 1] % 10),
+             (unsigned)(r->copies_x100 / 100), (unsigned)(r->copies_x100 % 100), (unsigned)r->avg_read,
+             (unsigned)r->runs, (unsigned)(r->runs + r->failures));
+}
+
+esp_err_t net_bench_run(void) {
+    s_scratch = heap_caps_malloc(HTTP_READ_MAX, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!s_scratch) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // lwIP/WiFi参数是编译期配置，打印出来以便对比不同sdkconfig的结果
+    ESP_LOGI(TAG, "Benchmark: %u cases x %d runs of %u KB from " TTS_SERVER_URL "/bench/",
+             (unsigned)CASE_COUNT, NET_BENCH_REPEATS, (unsigned)(NET_BENCH_OBJECT_SIZE / 1024));
+    ESP_LOGI(TAG, "lwIP: TCP_WND %d, TCP_MSS %d, RECVMBOX %d; WiFi: RX buffers %d static / %d dynamic, RX BA win %d",
+             CONFIG_LWIP_TCP_WND_DEFAULT, CONFIG_LWIP_TCP_MSS, CONFIG_LWIP_TCP_RECVMBOX_SIZE,
+             CONFIG_ESP_WIFI_STATIC_RX_BUFFER_NUM, CONFIG_ESP_WIFI_DYNAMIC_RX_BUFFER_NUM, CONFIG_ESP_WIFI_RX_BA_WIN);
+#if !CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    ESP_LOGW(TAG, "CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS disabled, CPU usage not measured");
+#endif
+
+    size_t index = 0;
+    for (int sink = 0; sink < NET_BENCH_SINK_COUNT; sink++) {
+        for (size_t b = 0; b < BUFFER_SIZE_COUNT; b++) {
+            for (size_t rd = 0; rd < READ_SIZE_COUNT; rd++) {
+                net_bench_result_t *r = &s_results[index++];
+                memset(r, 0, sizeof(*r));
+                r->sink = (net_bench_sink_t)sink;
+                r->buffer_size = s_buffer_sizes[b];
+                r->read_size = s_read_sizes[rd];
+                bench_case(r);
+                log_result(r);
+            }
+        }
+    }
+
+    // 汇总：每种接收端按最差窗口吞吐选最好的组合，相同时选CPU占用低的
+    ESP_LOGI(TAG, "Results (worst = slowest %d ms window, RT = %d kbps playback):",
+             NET_BENCH_WINDOW_MS, NET_BENCH_REALTIME_KBPS);
+    for (size_t i = 0; i < CASE_COUNT; i++) {
+        log_result(&s_results[i]);
+    }
+    for (int sink = 0; sink < NET_BENCH_SINK_COUNT; sink++) {
+        const net_bench_result_t *best = NULL;
+        for (size_t i = 0; i < CASE_COUNT; i++) {
+            const net_bench_result_t *r = &s_results[i];
+            if (r->sink != sink || r->runs == 0) {
+                continue;
+            }
+            if (!best || r->worst_kbps > best->worst_kbps ||
+                (r->worst_kbps == best->worst_kbps && r->cpu_x10[0] + r->cpu_x10[portNUM_PROCESSORS - 1] <
+                 best->cpu_x10[0] + best->cpu_x10[portNUM_PROCESSORS - 1])) {
+                best = r;
+            }
+        }
+        if (best) {
+            ESP_LOGI(TAG, "Best %s: buffer_size %u, read %u",
+                     s_sink_names[sink], (unsigned)best->buffer_size, (unsigned)best->read_size);
+        }
+    }
+
+    heap_caps_free(s_scratch);
+    s_scratch = NULL;
+    return ESP_OK;
+}
+
+static void net_bench_task(void *arg) {
+    esp_err_t err = net_bench_run();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Benchmark failed: %s", esp_err_to_name(err));
+    }
+    vTaskDelete(NULL);
+}
+
+esp_err_t net_bench_start(void) {
+    if (xTaskCreate(net_bench_task, "net_bench", 6144, NULL, 5, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
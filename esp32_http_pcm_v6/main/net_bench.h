@@ -0,0 +1,53 @@
+#ifndef NET_BENCH_H
+#define NET_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * 网络吞吐基准测试
+ * 从替身服务器（tools/mock_server.py的/bench/<字节数>）反复下载测试对象，扫描esp_http_client的
+ * buffer_size和每次读取长度，分别写入空接收端、直接读入PSRAM段池、经内部RAM中转再复制到段池，
+ * 报告平均吞吐、最差窗口吞吐（能否持续满足实时播放）、各核CPU占用和每字节复制次数。
+ * 干扰条件用mock_server的--bandwidth-kbps/--jitter-ms/--disconnect-prob模拟，或在真实环境中运行。
+ * 启用后启动阶段不创建轮询任务，基准测试独占网络和段池。
+ */
+
+#define NET_BENCH_ENABLED        0
+#define NET_BENCH_OBJECT_SIZE    (2 * 1024 * 1024)  // 测试对象大小，需小于段池（4MB）
+#define NET_BENCH_REPEATS        3                  // 每个组合的下载次数
+#define NET_BENCH_WINDOW_MS      100                // 最差窗口吞吐的统计窗口
+#define NET_BENCH_REALTIME_KBPS  1536               // 48kHz立体声16位PCM
+#define NET_BENCH_MAX_TASKS      32                 // uxTaskGetSystemState快照容量
+
+typedef enum {
+    NET_BENCH_SINK_NULL = 0,    // 读入内部RAM后丢弃，只测网络栈
+    NET_BENCH_SINK_PSRAM,       // 直接读入段池（v6零拷贝路径）
+    NET_BENCH_SINK_BOUNCE,      // 读入内部RAM再复制到段池（事件回调/DOWNLOAD_ZERO_COPY=0路径）
+    NET_BENCH_SINK_COUNT
+} net_bench_sink_t;
+
+/* 一个组合多次下载的汇总 */
+typedef struct {
+    uint32_t buffer_size;
+    uint32_t read_size;
+    net_bench_sink_t sink;
+    uint32_t runs;              // 成功的下载次数
+    uint32_t failures;
+    uint32_t avg_kbps;          // 首字节到结束的平均吞吐
+    uint32_t worst_kbps;        // 所有下载中最差的NET_BENCH_WINDOW_MS窗口
+    uint32_t ttfb_ms;           // 平均请求到首字节时间
+    uint32_t cpu_x10[portNUM_PROCESSORS];   // 各核CPU占用，放大10倍
+    uint32_t copies_x100;       // 每接收1字节的复制次数，放大100倍
+    uint32_t avg_read;          // 平均每次读取返回的字节数
+} net_bench_result_t;
+
+/* 运行全部组合并打印结果表，阻塞直到完成（需要WiFi已连接） */
+esp_err_t net_bench_run(void);
+
+/* 在独立任务中运行net_bench_run */
+esp_err_t net_bench_start(void);
+
+#endif /* NET_BENCH_H */
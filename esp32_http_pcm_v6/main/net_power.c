@@ -0,0 +1,175 @@
+#include "net_power.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "NET_POWER";
+
+static const char *s_mode_names[NET_POWER_MODE_COUNT] = { "none", "min_modem", "max_modem" };
+static const char *s_policy_names[] = { "auto", "performance", "balanced", "saver" };
+static const uint32_t s_mode_ma[NET_POWER_MODE_COUNT] = {
+    NET_POWER_MA_NONE, NET_POWER_MA_MIN_MODEM, NET_POWER_MA_MAX_MODEM
+};
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static net_power_policy_t s_policy = NET_POWER_DEFAULT_POLICY;
+static net_activity_t s_activity = NET_ACTIVITY_IDLE;
+static wifi_ps_type_t s_mode = WIFI_PS_MIN_MODEM;       // WiFi驱动的默认模式
+static int64_t s_mode_since_us = 0;
+static int64_t s_last_transfer_us = 0;
+static int64_t s_last_log_us = 0;
+static esp_timer_handle_t s_eval_timer = NULL;
+static SemaphoreHandle_t s_apply_mutex = NULL;          // 定时器和网络任务都会调用apply
+static net_power_mode_stats_t s_stats[NET_POWER_MODE_COUNT];
+
+/* 按策略和当前活动选择省电模式 */
+static wifi_ps_type_t net_power_select(int64_t now) {
+    switch (s_policy) {
+        case NET_POWER_POLICY_PERFORMANCE:
+            return WIFI_PS_NONE;
+        case NET_POWER_POLICY_BALANCED:
+            return WIFI_PS_MIN_MODEM;
+        case NET_POWER_POLICY_SAVER:
+            return WIFI_PS_MAX_MODEM;
+        default:
+            break;
+    }
+
+    if (s_activity == NET_ACTIVITY_TRANSFER) {
+        return WIFI_PS_NONE;
+    }
+    // 长轮询等的是服务器的响应，即使之前空闲很久也回到min-modem
+    if (s_activity == NET_ACTIVITY_IDLE &&
+        now - s_last_transfer_us > (int64_t)NET_POWER_DEEP_IDLE_MS * 1000) {
+        return WIFI_PS_MAX_MODEM;
+    }
+    return WIFI_PS_MIN_MODEM;
+}
+
+/* 重新选择模式，变化时才调用WiFi驱动 */
+static void net_power_apply(void) {
+    // 选择和esp_wifi_set_ps一起串行化，避免较早的选择后设置、覆盖较新的模式
+    if (s_apply_mutex) {
+        xSemaphoreTake(s_apply_mutex, portMAX_DELAY);
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_last_transfer_us == 0) {
+        s_last_transfer_us = now;
+    }
+    wifi_ps_type_t mode = net_power_select(now);
+    wifi_ps_type_t old_mode = s_mode;
+    if (s_mode_since_us != 0) {
+        s_stats[old_mode].residency_ms += (now - s_mode_since_us) / 1000;
+    }
+    s_mode_since_us = now;
+    s_mode = mode;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (mode != old_mode) {
+        esp_err_t ret = esp_wifi_set_ps(mode);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to set power save %s: %s", s_mode_names[mode], esp_err_to_name(ret));
+        } else {
+            ESP_LOGD(TAG, "Power save: %s -> %s", s_mode_names[old_mode], s_mode_names[mode]);
+        }
+    }
+
+    if (now - s_last_log_us > (int64_t)NET_POWER_LOG_INTERVAL_MS * 1000) {
+        s_last_log_us = now;
+        net_power_log_stats();
+    }
+    if (s_apply_mutex) {
+        xSemaphoreGive(s_apply_mutex);
+    }
+}
+
+/* 定时重新评估 - 空闲超时不依赖网络层的活动通知 */
+static void net_power_eval_timer_cb(void *arg) {
+    net_power_apply();
+}
+
+esp_err_t net_power_start(void) {
+    if (!s_apply_mutex) {
+        s_apply_mutex = xSemaphoreCreateMutex();
+        if (!s_apply_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (!s_eval_timer) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = net_power_eval_timer_cb,
+            .name = "net_power",
+        };
+        esp_err_t ret = esp_timer_create(&timer_args, &s_eval_timer);
+        if (ret == ESP_OK) {
+            ret = esp_timer_start_periodic(s_eval_timer, (uint64_t)NET_POWER_EVAL_INTERVAL_MS * 1000);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start evaluation timer: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    net_power_set_policy(NET_POWER_DEFAULT_POLICY);
+    return ESP_OK;
+}
+
+void net_power_set_policy(net_power_policy_t policy) {
+    s_policy = policy;
+    ESP_LOGI(TAG, "Power policy: %s", s_policy_names[policy]);
+    net_power_apply();
+}
+
+net_power_policy_t net_power_get_policy(void) {
+    return s_policy;
+}
+
+void net_power_set_activity(net_activity_t activity) {
+    portENTER_CRITICAL(&s_lock);
+    // 空闲时间从最近一次下载结束算起
+    if (s_activity == NET_ACTIVITY_TRANSFER || activity == NET_ACTIVITY_TRANSFER) {
+        s_last_transfer_us = esp_timer_get_time();
+    }
+    s_activity = activity;
+    portEXIT_CRITICAL(&s_lock);
+    net_power_apply();
+}
+
+void net_power_record_first_byte(uint32_t us) {
+    portENTER_CRITICAL(&s_lock);
+    net_power_mode_stats_t *st = &s_stats[s_mode];
+    st->first_byte_count++;
+    st->first_byte_us_total += us;
+    if (us > st->first_byte_us_max) {
+        st->first_byte_us_max = us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void net_power_get_stats(wifi_ps_type_t mode, net_power_mode_stats_t *stats) {
+    if (mode >= NET_POWER_MODE_COUNT || !stats) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats[mode];
+    if (mode == s_mode && s_mode_since_us != 0) {
+        stats->residency_ms += (esp_timer_get_time() - s_mode_since_us) / 1000;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void net_power_log_stats(void) {
+    for (int i = 0; i < NET_POWER_MODE_COUNT; i++) {
+        net_power_mode_stats_t st;
+        net_power_get_stats(i, &st);
+        uint32_t avg_us = st.first_byte_count ? (uint32_t)(st.first_byte_us_total / st.first_byte_count) : 0;
+        // 能耗估算：驻留时间 x 该模式的平均电流
+        uint32_t mah = (uint32_t)(st.residency_ms * s_mode_ma[i] / 3600000ULL);
+        ESP_LOGI(TAG, "%-9s residency=%llus est=%lumAh first_byte avg=%luus max=%luus (n=%lu)",
+                 s_mode_names[i], st.residency_ms / 1000, mah,
+                 avg_us, st.first_byte_us_max, st.first_byte_count);
+    }
+}
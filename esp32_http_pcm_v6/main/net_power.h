@@ -0,0 +1,69 @@
+#ifndef NET_POWER_H
+#define NET_POWER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+/**
+ * WiFi modem sleep策略
+ * 默认的modem省电会让每次下载和长轮询的首字节多等一个DTIM周期。
+ * AUTO策略按网络活动切换：下载/流式播放时不睡眠，长轮询时min-modem，
+ * 空闲且长时间没有音频时max-modem。其他策略固定一种模式，用于对比首字节延迟。
+ * 除了活动变化时，还由定时器周期性重新评估：使用SSE推送时两次任务之间
+ * 没有任何请求，空闲超时只能靠定时器发现。
+ */
+
+#define NET_POWER_DEFAULT_POLICY   NET_POWER_POLICY_AUTO
+#define NET_POWER_DEEP_IDLE_MS     (5 * 60 * 1000)    // 超过此时间没有下载，进入max-modem
+#define NET_POWER_LOG_INTERVAL_MS  (10 * 60 * 1000)   // 统计打印间隔
+#define NET_POWER_EVAL_INTERVAL_MS (10 * 1000)        // 定时重新评估的间隔
+
+/* 各模式平均电流估算（mA），只用于按驻留时间折算能耗，不是实测值 */
+#define NET_POWER_MA_NONE          100
+#define NET_POWER_MA_MIN_MODEM     30
+#define NET_POWER_MA_MAX_MODEM     15
+
+typedef enum {
+    NET_POWER_POLICY_AUTO = 0,      // 按网络活动切换
+    NET_POWER_POLICY_PERFORMANCE,   // 始终WIFI_PS_NONE
+    NET_POWER_POLICY_BALANCED,      // 始终WIFI_PS_MIN_MODEM
+    NET_POWER_POLICY_SAVER,         // 始终WIFI_PS_MAX_MODEM
+} net_power_policy_t;
+
+typedef enum {
+    NET_ACTIVITY_IDLE = 0,          // 没有请求进行中
+    NET_ACTIVITY_POLL,              // 长轮询等待服务器
+    NET_ACTIVITY_TRANSFER,          // 下载或流式播放
+} net_activity_t;
+
+/* 每种省电模式的统计 */
+typedef struct {
+    uint64_t residency_ms;          // 在该模式下的累计时间
+    uint32_t first_byte_count;      // 下载首字节样本数
+    uint64_t first_byte_us_total;
+    uint32_t first_byte_us_max;
+} net_power_mode_stats_t;
+
+#define NET_POWER_MODE_COUNT       3  // WIFI_PS_NONE / MIN_MODEM / MAX_MODEM
+
+/* 启动定时重新评估并应用NET_POWER_DEFAULT_POLICY，WiFi启动后调用 */
+esp_err_t net_power_start(void);
+
+/* 设置策略，立即生效 */
+void net_power_set_policy(net_power_policy_t policy);
+net_power_policy_t net_power_get_policy(void);
+
+/* 网络层在请求开始/结束时调用 */
+void net_power_set_activity(net_activity_t activity);
+
+/* 记录一次请求从发出到收到首字节的时间 */
+void net_power_record_first_byte(uint32_t us);
+
+/* 获取某个省电模式的统计 */
+void net_power_get_stats(wifi_ps_type_t mode, net_power_mode_stats_t *stats);
+
+/* 打印各模式的首字节延迟和能耗估算 */
+void net_power_log_stats(void);
+
+#endif /* NET_POWER_H */
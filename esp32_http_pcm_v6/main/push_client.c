@@ -0,0 +1,248 @@
+#include "push_client.h"
+#include <string.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "http_client.h"
+#include "wifi_manager.h"
+#include "event_trace.h"
+
+static const char *TAG = "PUSH_CLIENT";
+
+static volatile bool s_connected = false;
+static char s_last_event_id[32] = {0};
+static push_stats_t s_stats = {0};
+
+/* SSE解析状态 - 一个事件由若干行组成，空行结束 */
+typedef struct {
+    char line[PUSH_LINE_MAX];
+    size_t line_len;
+    bool line_overflow;
+    char event[16];
+    char data[PUSH_LINE_MAX];
+    size_t data_len;
+    char id[sizeof(s_last_event_id)];   // 当前事件的id，事件处理完才提交到s_last_event_id
+} sse_parser_t;
+
+/* 分发一个完整的事件，任务未能加入播放列表时返回false
+ * 此时不提交事件id，调用者断开重连，服务器按Last-Event-ID重发该任务 */
+static bool sse_dispatch(sse_parser_t *p) {
+    p->data[p->data_len] = '\0';
+    bool handled = true;
+
+    if (strcmp(p->event, "ping") == 0) {
+        s_stats.pings++;
+    } else if (strcmp(p->event, "job") == 0) {
+        tts_job_t job;
+        if (!tts_job_parse(p->data, p->data_len, &job)) {
+            ESP_LOGW(TAG, "Job event without audio_id: %s", p->data);
+            s_stats.parse_errors++;
+        } else {
+            job.poll_parsed_us = esp_timer_get_time();
+            ESP_LOGI(TAG, "Job pushed: %s (%s, %lld bytes)", job.audio_id, job.format, job.size);
+            handled = tts_playlist_add_wait(&job, pdMS_TO_TICKS(PUSH_ENQUEUE_WAIT_MS)) == ESP_OK;
+            if (handled) {
+                s_stats.jobs++;
+            } else {
+                s_stats.dropped++;
+            }
+        }
+    } else if (strcmp(p->event, "trace") == 0) {
+        ESP_LOGI(TAG, "Server requested event trace dump");
+        event_trace_request_dump();
+    } else if (p->event[0] != '\0') {
+        ESP_LOGD(TAG, "Ignoring event: %s", p->event);
+    }
+
+    if (handled && p->id[0] != '\0') {
+        strcpy(s_last_event_id, p->id);
+    }
+    p->id[0] = '\0';
+    p->event[0] = '\0';
+    p->data_len = 0;
+    return handled;
+}
+
+/* 处理一行：event:/data:/id:，空行分发事件，以':'开头的是注释；事件未能处理时返回false */
+static bool sse_process_line(sse_parser_t *p) {
+    char *line = p->line;
+    line[p->line_len] = '\0';
+
+    if (p->line_len == 0) {
+        if (p->data_len > 0 || p->event[0] != '\0') {
+            return sse_dispatch(p);
+        }
+        return true;
+    }
+    if (line[0] == ':') {
+        return true;
+    }
+
+    char *value = strchr(line, ':');
+    if (value) {
+        *value++ = '\0';
+        if (*value == ' ') {
+            value++;
+        }
+    } else {
+        value = line + p->line_len;
+    }
+
+    if (strcmp(line, "event") == 0) {
+        strncpy(p->event, value, sizeof(p->event) - 1);
+        p->event[sizeof(p->event) - 1] = '\0';
+    } else if (strcmp(line, "data") == 0) {
+        size_t len = strlen(value);
+        if (p->data_len + len + 1 < sizeof(p->data)) {
+            if (p->data_len > 0) {
+                p->data[p->data_len++] = '\n';
+            }
+            memcpy(p->data + p->data_len, value, len);
+            p->data_len += len;
+        } else {
+            s_stats.parse_errors++;
+        }
+    } else if (strcmp(line, "id") == 0) {
+        strncpy(p->id, value, sizeof(p->id) - 1);
+        p->id[sizeof(p->id) - 1] = '\0';
+    }
+    return true;
+}
+
+/* 把收到的字节按行切分，兼容\r\n；有事件未能处理时返回false，其后的数据丢弃 */
+static bool sse_feed(sse_parser_t *p, const char *buf, int len) {
+    for (int i = 0; i < len; i++) {
+        char c = buf[i];
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n') {
+            if (p->line_overflow) {
+                s_stats.parse_errors++;
+                p->line_overflow = false;
+            } else if (!sse_process_line(p)) {
+                return false;
+            }
+            p->line_len = 0;
+            continue;
+        }
+        if (p->line_len < sizeof(p->line) - 1) {
+            p->line[p->line_len++] = c;
+        } else {
+            p->line_overflow = true;
+        }
+    }
+    return true;
+}
+
+/* 建立一次SSE连接并读取直到断开 */
+static void push_session(sse_parser_t *parser, char *buf, size_t buf_size) {
+    esp_http_client_config_t config = {
+        .url = TTS_SERVER_URL PUSH_EVENTS_PATH,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 5000,
+        .buffer_size = 1024,
+    };
+
+    size_t client_mem = 0;
+    esp_http_client_handle_t client = tracked_client_init(&config, &client_mem);
+    if (!client) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return;
+    }
+
+    esp_http_client_set_header(client, "X-Device-ID", DEVICE_ID);
+    esp_http_client_set_header(client, "Accept", "text/event-stream");
+    if (s_last_event_id[0] != '\0') {
+        esp_http_client_set_header(client, "Last-Event-ID", s_last_event_id);
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open event stream: %s", esp_err_to_name(err));
+        tracked_client_cleanup(client, client_mem);
+        return;
+    }
+
+    esp_http_client_fetch_headers(client);
+    int status = esp_http_client_get_status_code(client);
+    if (status != 200) {
+        // 服务器不支持推送 - 轮询任务继续使用长轮询
+        ESP_LOGW(TAG, "Event stream rejected: status=%d", status);
+        esp_http_client_close(client);
+        tracked_client_cleanup(client, client_mem);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Event stream connected");
+    s_connected = true;
+    s_stats.connects++;
+    memset(parser, 0, sizeof(*parser));
+    int64_t last_data_us = esp_timer_get_time();
+
+    while (1) {
+        int len = esp_http_client_read(client, buf, buf_size);
+        if (len > 0) {
+            last_data_us = esp_timer_get_time();
+            if (!sse_feed(parser, buf, len)) {
+                // 播放列表一直满：不确认该任务，重连后服务器从Last-Event-ID之后重发
+                ESP_LOGW(TAG, "Playlist full, reconnecting for redelivery after id '%s'", s_last_event_id);
+                break;
+            }
+        } else if (len == -ESP_ERR_HTTP_EAGAIN) {
+            // 读超时，检查是否长时间没有ping
+            if (esp_timer_get_time() - last_data_us > (int64_t)PUSH_IDLE_TIMEOUT_MS * 1000) {
+                ESP_LOGW(TAG, "Event stream idle, reconnecting");
+                break;
+            }
+        } else {
+            ESP_LOGW(TAG, "Event stream closed (%d)", len);
+            break;
+        }
+    }
+
+    s_connected = false;
+    s_stats.disconnects++;
+    esp_http_client_close(client);
+    tracked_client_cleanup(client, client_mem);
+}
+
+/* 推送任务：保持SSE连接，断开后退避重连 */
+static void push_client_task(void *pvParameters) {
+    static sse_parser_t parser;
+    static char buf[512];
+    uint32_t backoff_ms = PUSH_RECONNECT_MIN_MS;
+
+    while (1) {
+        wifi_wait_connected(portMAX_DELAY);
+
+        uint32_t connects = s_stats.connects;
+        push_session(&parser, buf, sizeof(buf));
+
+        if (s_stats.connects != connects) {
+            // 成功连接过，重置退避
+            backoff_ms = PUSH_RECONNECT_MIN_MS;
+        } else {
+            backoff_ms = backoff_ms * 2 > PUSH_RECONNECT_MAX_MS ? PUSH_RECONNECT_MAX_MS : backoff_ms * 2;
+        }
+        vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+    }
+}
+
+esp_err_t push_client_start(void) {
+    if (xTaskCreate(push_client_task, "push_client", PUSH_TASK_STACK, NULL, PUSH_TASK_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool push_client_is_connected(void) {
+    return s_connected;
+}
+
+void push_client_get_stats(push_stats_t *stats) {
+    if (stats) {
+        *stats = s_stats;
+    }
+}
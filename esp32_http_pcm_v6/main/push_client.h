@@ -0,0 +1,44 @@
+#ifndef PUSH_CLIENT_H
+#define PUSH_CLIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "tts_job.h"
+
+/**
+ * 服务器推送通道（Server-Sent Events）
+ * 与服务器保持一条长连接，任务一产生就收到通知，不必每次轮询都新建连接。
+ * 收到的任务追加到本地播放列表；推送通道断开时由轮询任务退回到HTTP长轮询。
+ */
+
+#define PUSH_EVENTS_PATH       "/esp32/events"
+#define PUSH_LINE_MAX          512              // 单行最大长度
+#define PUSH_IDLE_TIMEOUT_MS   45000            // 服务器每15秒发送ping，超过此时间无数据视为断开
+#define PUSH_RECONNECT_MIN_MS  1000
+#define PUSH_RECONNECT_MAX_MS  30000
+#define PUSH_ENQUEUE_WAIT_MS   10000            // 播放列表满时等待空位的时间，超时后断开重连，由服务器重发
+#define PUSH_TASK_STACK        4096
+#define PUSH_TASK_PRIO         5
+
+/* 推送通道统计 */
+typedef struct {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t jobs;
+    uint32_t dropped;           // 播放列表满未能加入、等待服务器重发的任务
+    uint32_t pings;
+    uint32_t parse_errors;
+} push_stats_t;
+
+/* 启动推送任务 */
+esp_err_t push_client_start(void);
+
+/* 推送通道当前是否已连接 */
+bool push_client_is_connected(void);
+
+/* 获取推送通道统计 */
+void push_client_get_stats(push_stats_t *stats);
+
+#endif /* PUSH_CLIENT_H */
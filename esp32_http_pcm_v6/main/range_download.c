@@ -0,0 +1,260 @@
+#include "range_download.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "http_client.h"
+#include "http_reader.h"
+#include "mem_track.h"
+#include "wifi_manager.h"
+
+static const char *TAG = "RANGE_DL";
+
+/* 工作连接的句柄和收发缓冲区同样记到网络子系统 */
+static esp_http_client_handle_t range_client_init(const char *url, size_t *charged) {
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 30000,
+    };
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    *charged = (client && free_before > free_after) ? free_before - free_after : 0;
+    mem_track_charge(MEM_TAG_NETWORK, *charged);
+    return client;
+}
+
+static size_t range_prefix_bytes(const range_download_t *rd) {
+    size_t bytes = rd->prefix_chunks * rd->chunk_size;
+    return bytes < rd->total ? bytes : rd->total;
+}
+
+/* 认领下一个块 - 按块号递增，越靠前的块越早开始 */
+static bool range_claim(range_download_t *rd, size_t *chunk) {
+    xSemaphoreTake(rd->lock, portMAX_DELAY);
+    bool ok = !rd->abort && rd->next_chunk < rd->chunk_count;
+    if (ok) {
+        *chunk = rd->next_chunk++;
+    }
+    xSemaphoreGive(rd->lock);
+    return ok;
+}
+
+/* 标记块完成，连续前缀增长时通知播放端 */
+static void range_mark_done(range_download_t *rd, size_t chunk) {
+    xSemaphoreTake(rd->lock, portMAX_DELAY);
+    rd->done_mask |= 1u << chunk;
+    size_t before = rd->prefix_chunks;
+    while (rd->prefix_chunks < rd->chunk_count && (rd->done_mask & (1u << rd->prefix_chunks))) {
+        rd->prefix_chunks++;
+    }
+    if (rd->prefix_chunks != before && rd->on_prefix) {
+        rd->on_prefix(rd->cb_arg, range_prefix_bytes(rd));
+    }
+    xSemaphoreGive(rd->lock);
+}
+
+/* 用Range请求把一个块读入段池，中断后从中断处重试；成功时连接保持打开供下一块复用 */
+static bool range_fetch_chunk(range_download_t *rd, int conn, http_reader_t *reader,
+                              esp_http_client_handle_t client, size_t chunk) {
+    range_download_conn_t *stats = &rd->conn[conn];
+    size_t pos = chunk * rd->chunk_size;
+    size_t end = pos + rd->chunk_size < rd->total ? pos + rd->chunk_size : rd->total;
+    int attempts = 0;
+
+    while (!rd->abort) {
+        char range[48];
+        snprintf(range, sizeof(range), "bytes=%u-%u", (unsigned)pos, (unsigned)(end - 1));
+        esp_http_client_set_header(client, "Range", range);
+        stats->requests++;
+
+        esp_err_t err = http_reader_open(reader, client);
+        if (err == ESP_OK && reader->status != 206) {
+            // 服务器忽略Range，无法分块 - 剩余部分交给单连接续传
+            ESP_LOGW(TAG, "Range not honoured (status=%d), stopping parallel fetch", reader->status);
+            rd->abort = true;
+            http_reader_close(reader);
+            return false;
+        }
+
+        while (err == ESP_OK && pos < end) {
+            size_t space = AUDIO_SEGMENT_SIZE - pos % AUDIO_SEGMENT_SIZE;
+            if (space > end - pos) {
+                space = end - pos;
+            }
+            if (space > HTTP_READ_MAX) {
+                space = HTTP_READ_MAX;
+            }
+            int n = http_reader_read(reader, AUDIO_CLIP_SEGMENT(rd->clip, pos), space);
+            if (n <= 0) {
+                err = ESP_FAIL;
+                break;
+            }
+            pos += n;
+            stats->bytes += n;
+        }
+        if (err == ESP_OK) {
+            return true;
+        }
+
+        http_reader_close(reader);
+        if (++attempts > RANGE_DOWNLOAD_RETRIES) {
+            return false;
+        }
+        stats->retries++;
+        ESP_LOGW(TAG, "Chunk %d interrupted at %d bytes, retrying", chunk, pos);
+        if (wifi_wait_connected(pdMS_TO_TICKS(DOWNLOAD_RESUME_WAIT_MS)) != ESP_OK) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/* 在一个连接上循环认领并下载块，失败时停止所有连接的认领 */
+static void range_download_work(range_download_t *rd, int conn, esp_http_client_handle_t client) {
+    http_reader_t reader;
+    http_reader_init(&reader, HTTP_READ_UNIT);
+
+    size_t chunk;
+    while (range_claim(rd, &chunk)) {
+        if (!range_fetch_chunk(rd, conn, &reader, client, chunk)) {
+            rd->abort = true;
+            break;
+        }
+        rd->conn[conn].chunks++;
+        range_mark_done(rd, chunk);
+    }
+    http_reader_close(&reader);
+}
+
+static void range_worker_task(void *pvParameters) {
+    range_download_t *rd = (range_download_t *)pvParameters;
+    int conn = __atomic_add_fetch(&rd->next_conn, 1, __ATOMIC_RELAXED);
+
+    size_t client_mem = 0;
+    esp_http_client_handle_t client = range_client_init(rd->url, &client_mem);
+    if (client) {
+        range_download_work(rd, conn, client);
+        esp_http_client_cleanup(client);
+        mem_track_discharge(MEM_TAG_NETWORK, client_mem);
+    } else {
+        ESP_LOGE(TAG, "Worker %d: failed to initialize HTTP client", conn);
+    }
+
+    xSemaphoreGive(rd->done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t range_download_start(range_download_t *rd, const char *url, audio_clip_t *clip, size_t total,
+                               size_t chunk_size, int connections,
+                               range_download_prefix_cb_t on_prefix, void *arg) {
+    memset(rd, 0, sizeof(*rd));
+    if (connections > RANGE_DOWNLOAD_MAX_CONNECTIONS) {
+        connections = RANGE_DOWNLOAD_MAX_CONNECTIONS;
+    }
+    if (connections < 2 || total == 0 || chunk_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 块数超过位图上限时放大块，保持段对齐使一次读取不跨段
+    if ((total + chunk_size - 1) / chunk_size > RANGE_DOWNLOAD_MAX_CHUNKS) {
+        chunk_size = (total + RANGE_DOWNLOAD_MAX_CHUNKS - 1) / RANGE_DOWNLOAD_MAX_CHUNKS;
+    }
+    chunk_size = (chunk_size + AUDIO_SEGMENT_SIZE - 1) / AUDIO_SEGMENT_SIZE * AUDIO_SEGMENT_SIZE;
+
+    rd->url = url;
+    rd->clip = clip;
+    rd->total = total;
+    rd->chunk_size = chunk_size;
+    rd->chunk_count = (total + chunk_size - 1) / chunk_size;
+    rd->on_prefix = on_prefix;
+    rd->cb_arg = arg;
+    rd->next_chunk = 1;
+    rd->start_us = esp_timer_get_time();
+    if (rd->chunk_count < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 各连接按偏移写入，需要一次取足所有段
+    if (!audio_clip_preallocate(clip, total)) {
+        ESP_LOGW(TAG, "Not enough segments to preallocate %d bytes", total);
+        return ESP_ERR_NO_MEM;
+    }
+
+    rd->lock = xSemaphoreCreateMutex();
+    rd->done = xSemaphoreCreateCounting(RANGE_DOWNLOAD_MAX_CONNECTIONS, 0);
+    if (!rd->lock || !rd->done) {
+        if (rd->lock) {
+            vSemaphoreDelete(rd->lock);
+        }
+        if (rd->done) {
+            vSemaphoreDelete(rd->done);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 工作任务优先级低于调用方，块0所在的首个连接优先得到CPU
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    if (priority > 1) {
+        priority--;
+    }
+    rd->connections = 1;
+    for (int i = 1; i < connections; i++) {
+        if (xTaskCreate(range_worker_task, "range_dl", RANGE_DOWNLOAD_TASK_STACK, rd, priority, NULL) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to start worker %d", i);
+            break;
+        }
+        rd->workers++;
+        rd->connections++;
+    }
+
+    ESP_LOGI(TAG, "Parallel download: %d bytes in %d chunks of %d, %d connections",
+             total, rd->chunk_count, rd->chunk_size, rd->connections);
+    return ESP_OK;
+}
+
+void range_download_first_done(range_download_t *rd, bool ok, size_t bytes) {
+    rd->conn[0].bytes += bytes;
+    rd->conn[0].requests++;
+    if (ok) {
+        rd->conn[0].chunks++;
+        range_mark_done(rd, 0);
+    } else {
+        rd->abort = true;
+    }
+}
+
+size_t range_download_finish(range_download_t *rd, esp_http_client_handle_t client) {
+    if (!rd->abort) {
+        range_download_work(rd, 0, client);
+    }
+
+    for (int i = 0; i < rd->workers; i++) {
+        xSemaphoreTake(rd->done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(rd->done);
+    vSemaphoreDelete(rd->lock);
+    rd->done = NULL;
+    rd->lock = NULL;
+
+    return range_prefix_bytes(rd);
+}
+
+void range_download_log_stats(const range_download_t *rd) {
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - rd->start_us) / 1000);
+    size_t prefix = range_prefix_bytes(rd);
+
+    ESP_LOGI(TAG, "Parallel download: %d/%d bytes in %u ms (%u KB/s), %d connections%s",
+             prefix, rd->total, (unsigned)elapsed_ms,
+             elapsed_ms ? (unsigned)((uint64_t)prefix * 1000 / 1024 / elapsed_ms) : 0,
+             rd->connections, rd->abort ? ", aborted" : "");
+    for (int i = 0; i < rd->connections; i++) {
+        const range_download_conn_t *c = &rd->conn[i];
+        ESP_LOGI(TAG, "  conn %d: %u bytes, %u chunks, %u requests, %u retries",
+                 i, (unsigned)c->bytes, (unsigned)c->chunks, (unsigned)c->requests, (unsigned)c->retries);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef RANGE_DOWNLOAD_H
+#define RANGE_DOWNLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "audio_pool.h"
+
+/**
+ * 并行分段下载 - 已知长度的片段切成若干Range块，由2~3个连接同时下载，
+ * 各连接按偏移直接读入预先取好的段池空间。块0由调用方已经收到响应头的
+ * 首个连接读取，工作连接从块1开始按顺序认领，播放需要的开头最先到达；
+ * 连续完成的前缀通过回调发布给播放端。
+ */
+
+#define RANGE_DOWNLOAD_MAX_CONNECTIONS  3
+#define RANGE_DOWNLOAD_MAX_CHUNKS       32     // 完成状态用一个uint32_t位图记录
+#define RANGE_DOWNLOAD_RETRIES          2      // 块中断后从中断处重试的次数
+#define RANGE_DOWNLOAD_TASK_STACK       4096
+
+/* 连续前缀增长时调用（在持有锁的下载任务或工作任务中） */
+typedef void (*range_download_prefix_cb_t)(void *arg, size_t prefix);
+
+/* 每个连接的统计，下标0为调用方连接 */
+typedef struct {
+    uint32_t bytes;
+    uint32_t chunks;
+    uint32_t requests;
+    uint32_t retries;
+} range_download_conn_t;
+
+typedef struct {
+    const char *url;
+    audio_clip_t *clip;
+    size_t total;
+    size_t chunk_size;
+    size_t chunk_count;
+    int connections;
+    range_download_prefix_cb_t on_prefix;
+    void *cb_arg;
+
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t done;     // 每个工作任务退出时give一次
+    int workers;
+    int next_conn;
+    size_t next_chunk;
+    uint32_t done_mask;
+    size_t prefix_chunks;
+    bool abort;                 // 服务器忽略Range或块重试失败，停止认领
+    int64_t start_us;
+    range_download_conn_t conn[RANGE_DOWNLOAD_MAX_CONNECTIONS];
+} range_download_t;
+
+/* 按chunk_size切块（块数超过上限时按段对齐放大），预取覆盖total的段并启动connections-1个工作任务 */
+esp_err_t range_download_start(range_download_t *rd, const char *url, audio_clip_t *clip, size_t total,
+                               size_t chunk_size, int connections,
+                               range_download_prefix_cb_t on_prefix, void *arg);
+
+/* 调用方读完块0（或失败）后调用，bytes为首个连接读入的字节数 */
+void range_download_first_done(range_download_t *rd, bool ok, size_t bytes);
+
+/* 调用方的连接用Range认领剩余的块，再等待工作任务退出；返回连续完成的前缀字节数 */
+size_t range_download_finish(range_download_t *rd, esp_http_client_handle_t client);
+
+/* 打印总吞吐和各连接的分担 */
+void range_download_log_stats(const range_download_t *rd);
+
+#endif /* RANGE_DOWNLOAD_H */
@@ -0,0 +1,26 @@
+#ifndef TRACE_HOOKS_H
+#define TRACE_HOOKS_H
+
+/**
+ * FreeRTOS追踪宏 - 由顶层CMakeLists在EVENT_TRACE_TASK_SWITCH=ON时以-include注入所有组件，
+ * 使tasks.c中的traceTASK_SWITCHED_IN调用event_trace的调度器钩子。
+ * 钩子在关中断的调度器上下文中运行，只做一次无锁写入。
+ */
+
+#ifndef __ASSEMBLER__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void event_trace_task_switched_in(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define traceTASK_SWITCHED_IN()     event_trace_task_switched_in()
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* TRACE_HOOKS_H */
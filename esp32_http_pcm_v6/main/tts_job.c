@@ -0,0 +1,122 @@
+#include "tts_job.h"
+#include <string.h>
+#include "freertos/queue.h"
+#include "esp_log.h"
+
+static const char *TAG = "TTS_JOB";
+
+static QueueHandle_t s_playlist = NULL;
+
+enum {
+    FIELD_AUDIO_ID = 0,
+    FIELD_URL,
+    FIELD_FORMAT,
+    FIELD_SIZE,
+    FIELD_HASH,
+};
+
+/* 对象结束：audio_id直接属于这个对象时输出一条任务 */
+static void job_object_end(void *ctx, int depth) {
+    tts_job_parser_t *p = (tts_job_parser_t *)ctx;
+    json_field_t *id = &p->fields[FIELD_AUDIO_ID];
+
+    if (!id->found || id->depth != depth) {
+        return;
+    }
+    if (id->truncated || p->count >= p->max_jobs) {
+        ESP_LOGW(TAG, "Dropping job %s%s", p->current.audio_id, id->truncated ? " (id too long)" : "");
+        p->dropped++;
+    } else {
+        tts_job_t *job = &p->jobs[p->count++];
+        *job = p->current;
+        if (!p->fields[FIELD_SIZE].found) {
+            job->size = -1;
+        }
+        if (p->fields[FIELD_URL].truncated) {
+            // 截断的URL不可用，退回默认路径
+            job->url[0] = '\0';
+        }
+        if (p->fields[FIELD_HASH].truncated) {
+            job->hash[0] = '\0';
+        }
+    }
+    json_stream_reset_fields(p->fields, sizeof(p->fields) / sizeof(p->fields[0]));
+}
+
+void tts_job_parser_init(tts_job_parser_t *parser, tts_job_t *jobs, size_t max_jobs) {
+    memset(parser, 0, sizeof(*parser));
+    parser->jobs = jobs;
+    parser->max_jobs = max_jobs;
+
+    tts_job_t *job = &parser->current;
+    parser->fields[FIELD_AUDIO_ID] = (json_field_t){ .key = "audio_id", .type = JSON_FIELD_STRING, .dest = job->audio_id, .dest_size = sizeof(job->audio_id) };
+    parser->fields[FIELD_URL] = (json_field_t){ .key = "url", .type = JSON_FIELD_STRING, .dest = job->url, .dest_size = sizeof(job->url) };
+    parser->fields[FIELD_FORMAT] = (json_field_t){ .key = "format", .type = JSON_FIELD_STRING, .dest = job->format, .dest_size = sizeof(job->format) };
+    parser->fields[FIELD_SIZE] = (json_field_t){ .key = "size", .type = JSON_FIELD_INT, .dest = &job->size, .dest_size = sizeof(job->size) };
+    parser->fields[FIELD_HASH] = (json_field_t){ .key = "hash", .type = JSON_FIELD_STRING, .dest = job->hash, .dest_size = sizeof(job->hash) };
+
+    json_stream_init(&parser->stream, parser->fields, sizeof(parser->fields) / sizeof(parser->fields[0]),
+                     job_object_end, parser);
+}
+
+json_stream_status_t tts_job_parser_feed(tts_job_parser_t *parser, const char *data, size_t len) {
+    return json_stream_feed(&parser->stream, data, len);
+}
+
+size_t tts_job_parser_finish(tts_job_parser_t *parser, json_stream_status_t *status) {
+    json_stream_status_t st = json_stream_finish(&parser->stream);
+    if (st != JSON_STREAM_DONE) {
+        ESP_LOGW(TAG, "Malformed job JSON at byte %d, keeping %d complete jobs",
+                 (int)parser->stream.offset, (int)parser->count);
+    }
+    if (status) {
+        *status = st;
+    }
+    return parser->count;
+}
+
+bool tts_job_parse(const char *json, size_t len, tts_job_t *job) {
+    tts_job_parser_t parser;
+
+    memset(job, 0, sizeof(*job));
+    tts_job_parser_init(&parser, job, 1);
+    tts_job_parser_feed(&parser, json, len);
+    return tts_job_parser_finish(&parser, NULL) == 1;
+}
+
+esp_err_t tts_playlist_init(void) {
+    if (!s_playlist) {
+        s_playlist = xQueueCreate(TTS_PLAYLIST_LEN, sizeof(tts_job_t));
+    }
+    return s_playlist ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t tts_playlist_add(const tts_job_t *job) {
+    return tts_playlist_add_wait(job, 0);
+}
+
+esp_err_t tts_playlist_add_wait(const tts_job_t *job, TickType_t timeout) {
+    if (!s_playlist) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xQueueSend(s_playlist, job, timeout) != pdTRUE) {
+        ESP_LOGW(TAG, "Playlist full, dropping %s", job->audio_id);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t tts_playlist_next(tts_job_t *job, TickType_t timeout) {
+    if (!s_playlist) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return xQueueReceive(s_playlist, job, timeout) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+size_t tts_playlist_count(void) {
+    return s_playlist ? uxQueueMessagesWaiting(s_playlist) : 0;
+}
+
+size_t tts_playlist_space(void) {
+    return s_playlist ? uxQueueSpacesAvailable(s_playlist) : 0;
+}
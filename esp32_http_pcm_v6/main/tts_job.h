@@ -0,0 +1,72 @@
+#ifndef TTS_JOB_H
+#define TTS_JOB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "json_stream.h"
+
+/**
+ * TTS任务和本地播放列表
+ * 推送通道和批量轮询都把任务放进同一个有序播放列表，
+ * 轮询任务按顺序连续下载播放，列表非空时不再发起轮询。
+ * 轮询响应{"jobs":[{...},...]}和旧格式{"audio_id":...}都由增量解析器处理，
+ * 字段顺序无关，不需要缓冲整个响应。
+ */
+
+#define TTS_PLAYLIST_LEN       16
+#define TTS_POLL_BATCH_MAX     8        // 每次轮询最多请求的任务数
+
+/* 一条TTS任务 */
+typedef struct {
+    char audio_id[64];
+    char url[128];              // 相对服务器根的路径，空表示默认的/audio/<id>.pcm
+    char format[24];            // 例如"pcm_s16le_16k"
+    int64_t size;               // 字节数，未知为-1
+    char hash[48];              // 内容哈希，片段缓存的键；空表示用audio_id
+    int64_t poll_sent_us;       // 取到该任务的轮询请求发出时间，推送的任务为0（延迟追踪用）
+    int64_t poll_parsed_us;     // 轮询响应或推送事件解析完成的时间
+} tts_job_t;
+
+/* 增量任务解析器 - 直接喂入HTTP数据，每个带audio_id的对象结束时输出一条任务 */
+typedef struct {
+    json_stream_t stream;
+    json_field_t fields[5];
+    tts_job_t current;
+    tts_job_t *jobs;
+    size_t max_jobs;
+    size_t count;
+    size_t dropped;             // 超出max_jobs或字段被截断而丢弃的任务
+} tts_job_parser_t;
+
+/* 初始化解析器，jobs[max_jobs]接收结果；解析器不能在使用中移动 */
+void tts_job_parser_init(tts_job_parser_t *parser, tts_job_t *jobs, size_t max_jobs);
+
+/* 喂入一段响应数据 */
+json_stream_status_t tts_job_parser_feed(tts_job_parser_t *parser, const char *data, size_t len);
+
+/* 输入结束，返回解析出的任务数；响应不完整时已完成的任务仍然有效 */
+size_t tts_job_parser_finish(tts_job_parser_t *parser, json_stream_status_t *status);
+
+/* 解析单个任务对象，要求有audio_id */
+bool tts_job_parse(const char *json, size_t len, tts_job_t *job);
+
+/* 创建播放列表 */
+esp_err_t tts_playlist_init(void);
+
+/* 追加到播放列表末尾，列表满返回ESP_ERR_NO_MEM */
+esp_err_t tts_playlist_add(const tts_job_t *job);
+
+/* 同上，列表满时最多等待timeout */
+esp_err_t tts_playlist_add_wait(const tts_job_t *job, TickType_t timeout);
+
+/* 取出下一条任务，超时返回ESP_ERR_TIMEOUT */
+esp_err_t tts_playlist_next(tts_job_t *job, TickType_t timeout);
+
+/* 列表中的任务数和剩余空位 */
+size_t tts_playlist_count(void);
+size_t tts_playlist_space(void);
+
+#endif /* TTS_JOB_H */
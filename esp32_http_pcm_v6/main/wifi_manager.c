@@ -5,45 +5,219 @@
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
 #include "esp_log.h"
+#include "nvs.h"
 
 static const char *TAG = "WIFI_MANAGER";
 static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 
-/* WiFi事件处理器 - 保持不变 */
+/* 上次成功连接的AP，用于下次启动跳过全信道扫描 */
+typedef struct {
+    uint32_t version;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    esp_netif_ip_info_t ip_info;    // 上次的DHCP租约
+} wifi_cache_t;
+
+#define WIFI_CACHE_VERSION     1
+
+static esp_netif_t *s_sta_netif = NULL;
+static wifi_config_t s_wifi_config;
+static wifi_cache_t s_cache;
+static bool s_fast_path = false;        // 当前正在用缓存直连
+static bool s_static_ip = false;        // 当前使用缓存的IP而非DHCP
+static bool s_dhcp_confirming = false;  // 已用缓存的IP连上，等待DHCP确认租约
+static bool s_connected = false;
+static bool s_reconnecting = false;     // 连接后掉线，正在后台重连
+static uint32_t s_backoff_ms = WIFI_RECONNECT_MIN_MS;
+static int64_t s_connect_start = 0;
+static esp_timer_handle_t s_reconnect_timer = NULL;
+static wifi_stats_t s_stats = {0};
+
+/* 从NVS读取缓存，SSID不匹配视为无效 */
+static bool wifi_cache_load(wifi_cache_t *cache) {
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    size_t len = sizeof(*cache);
+    esp_err_t ret = nvs_get_blob(nvs, "ap", cache, &len);
+    nvs_close(nvs);
+
+    return ret == ESP_OK && len == sizeof(*cache) &&
+           cache->version == WIFI_CACHE_VERSION &&
+           strcmp(cache->ssid, WIFI_SSID) == 0 &&
+           cache->channel != 0;
+}
+
+static void wifi_cache_store(const wifi_cache_t *cache) {
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(nvs, "ap", cache, sizeof(*cache)) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+/* 连接成功后更新缓存，内容与NVS中的（s_cache）相同时不写flash */
+static void wifi_cache_update(const esp_netif_ip_info_t *ip_info) {
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return;
+    }
+
+    wifi_cache_t cache = {0};
+    cache.version = WIFI_CACHE_VERSION;
+    strncpy(cache.ssid, WIFI_SSID, sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+    cache.channel = ap_info.primary;
+    cache.ip_info = *ip_info;
+
+    if (memcmp(&cache, &s_cache, sizeof(cache)) != 0) {
+        s_cache = cache;
+        wifi_cache_store(&cache);
+        ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %d", MAC2STR(cache.bssid), cache.channel);
+    }
+}
+
+/* 直连失败 - 回到全信道扫描和DHCP
+ * 只改运行时的配置，NVS中的缓存不擦除：AP短暂掉线不应丢掉缓存、也不应写flash，
+ * 缓存在下次连接成功时按需覆盖 */
+static void wifi_fast_path_disable(void) {
+    s_fast_path = false;
+    s_wifi_config.sta.bssid_set = false;
+    s_wifi_config.sta.channel = 0;
+    s_wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+
+    if (s_static_ip) {
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_static_ip = false;
+    }
+    s_dhcp_confirming = false;
+}
+
+static void wifi_reconnect_timer_cb(void *arg) {
+    ESP_LOGI(TAG, "Reconnecting...");
+    esp_wifi_connect();
+}
+
+/* 掉线后按指数退避在后台重连，不再放弃 */
+static void wifi_schedule_reconnect(void) {
+    esp_timer_stop(s_reconnect_timer);
+    esp_timer_start_once(s_reconnect_timer, (uint64_t)s_backoff_ms * 1000);
+    ESP_LOGI(TAG, "Reconnect in %lu ms", s_backoff_ms);
+
+    s_backoff_ms *= 2;
+    if (s_backoff_ms > WIFI_RECONNECT_MAX_MS) {
+        s_backoff_ms = WIFI_RECONNECT_MAX_MS;
+    }
+}
+
+/* WiFi事件处理器 */
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        s_connect_start = esp_timer_get_time();
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_num < WIFI_MAXIMUM_RETRY) {
+        if (s_connected) {
+            // 连接后掉线 - 后台重连，正在进行的轮询/下载等待恢复
+            s_connected = false;
+            s_reconnecting = true;
+            s_backoff_ms = WIFI_RECONNECT_MIN_MS;
+            s_connect_start = esp_timer_get_time();
+            s_stats.disconnects++;
+            s_dhcp_confirming = false;
+            xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+            ESP_LOGW(TAG, "Disconnected from AP");
+            esp_wifi_connect();
+        } else if (s_fast_path) {
+            ESP_LOGW(TAG, "Fast connect failed, falling back to full scan");
+            s_stats.fast_path_failures++;
+            wifi_fast_path_disable();
+            esp_wifi_connect();
+        } else if (s_reconnecting) {
+            // 首次重连仍指定原AP，失败后放开BSSID，允许漫游到其他AP
+            if (s_wifi_config.sta.bssid_set) {
+                wifi_fast_path_disable();
+            }
+            wifi_schedule_reconnect();
+        } else if (s_retry_num < WIFI_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
             ESP_LOGI(TAG, "Retry to connect to the AP (%d/%d)", s_retry_num, WIFI_MAXIMUM_RETRY);
         } else {
+            ESP_LOGI(TAG, "Connect to the AP failed");
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
         }
-        ESP_LOGI(TAG, "Connect to the AP failed");
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+
+        if (s_dhcp_confirming) {
+            // 用缓存的IP连上后重新走DHCP，确认后的租约才写回缓存
+            s_dhcp_confirming = false;
+            ESP_LOGI(TAG, "DHCP lease: " IPSTR "%s", IP2STR(&event->ip_info.ip),
+                     event->ip_info.ip.addr != s_cache.ip_info.ip.addr ? " (cached IP was stale)" : "");
+            wifi_cache_update(&event->ip_info);
+            return;
+        }
+
+        uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - s_connect_start) / 1000);
+
+        if (s_reconnecting) {
+            s_stats.reconnects++;
+            s_stats.last_reconnect_ms = elapsed_ms;
+            ESP_LOGI(TAG, "Reconnected in %lu ms (%lu reconnects)", elapsed_ms, s_stats.reconnects);
+        } else {
+            s_stats.connect_ms = elapsed_ms;
+            s_stats.fast_path = s_fast_path;
+            ESP_LOGI(TAG, "Connected in %lu ms (%s)", elapsed_ms, s_fast_path ? "cached AP" : "full scan");
+        }
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+
         s_retry_num = 0;
+        s_connected = true;
+        s_reconnecting = false;
+        // 直连成功后仍保留BSSID，下次掉线直接重连同一AP
+        s_fast_path = false;
+        if (s_static_ip) {
+            // 缓存的IP只是提示：租约可能已过期或地址池已变，关联后立即重新走DHCP，
+            // 之后由DHCP客户端正常续租
+            s_static_ip = false;
+            s_dhcp_confirming = true;
+            esp_netif_dhcpc_start(s_sta_netif);
+        } else {
+            wifi_cache_update(&event->ip_info);
+        }
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
 
-/* WiFi初始化函数 - 保持不变 */
+/* WiFi初始化函数 - 有缓存时直连上次的AP */
 esp_err_t wifi_init_sta(void) {
     s_wifi_event_group = xEventGroupCreate();
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+    s_sta_netif = esp_netif_create_default_wifi_sta();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
+    const esp_timer_create_args_t timer_args = {
+        .callback = wifi_reconnect_timer_cb,
+        .name = "wifi_reconnect",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_reconnect_timer));
+
     esp_event_handler_instance_t instance_any_id;
     esp_event_handler_instance_t instance_got_ip;
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
@@ -62,14 +236,39 @@ esp_err_t wifi_init_sta(void) {
             .ssid = WIFI_SSID,
             .password = WIFI_PASSWORD,
             .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .listen_interval = WIFI_LISTEN_INTERVAL,
             .pmf_cfg = {
                 .capable = true,
                 .required = false
             },
         },
     };
+
+    // 快速路径：指定BSSID和信道，跳过全信道扫描；可选先用上次的IP，关联后再由DHCP确认
+    if (wifi_cache_load(&s_cache)) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, s_cache.bssid, sizeof(s_cache.bssid));
+        wifi_config.sta.channel = s_cache.channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        s_fast_path = true;
+        ESP_LOGI(TAG, "Fast connect to cached AP " MACSTR " on channel %d",
+                 MAC2STR(s_cache.bssid), s_cache.channel);
+
+#if WIFI_FAST_REUSE_IP
+        if (s_cache.ip_info.ip.addr != 0 &&
+            esp_netif_dhcpc_stop(s_sta_netif) == ESP_OK &&
+            esp_netif_set_ip_info(s_sta_netif, &s_cache.ip_info) == ESP_OK) {
+            s_static_ip = true;
+            ESP_LOGI(TAG, "Reusing cached IP " IPSTR, IP2STR(&s_cache.ip_info.ip));
+        }
+#endif
+    } else {
+        memset(&s_cache, 0, sizeof(s_cache));
+    }
+    s_wifi_config = wifi_config;
+
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "WiFi initialization finished.");
@@ -90,4 +289,24 @@ esp_err_t wifi_init_sta(void) {
         ESP_LOGE(TAG, "UNEXPECTED EVENT");
         return ESP_FAIL;
     }
-}
\ No newline at end of file
+}
+
+bool wifi_is_connected(void) {
+    return s_wifi_event_group &&
+           (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT);
+}
+
+esp_err_t wifi_wait_connected(TickType_t timeout) {
+    if (!s_wifi_event_group) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT,
+                                           pdFALSE, pdTRUE, timeout);
+    return (bits & WIFI_CONNECTED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void wifi_get_stats(wifi_stats_t *stats) {
+    if (stats) {
+        *stats = s_stats;
+    }
+}
@@ -1,7 +1,10 @@
 #ifndef WIFI_MANAGER_H
 #define WIFI_MANAGER_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
 
 /* WiFi Configuration - 保持不变 */
 // #define WIFI_SSID              "CE-Hub-Student"
@@ -11,8 +14,34 @@
 #define WIFI_CONNECTED_BIT     BIT0
 #define WIFI_FAIL_BIT          BIT1
 #define WIFI_MAXIMUM_RETRY     5
+#define WIFI_LISTEN_INTERVAL   3            // max-modem省电时每3个beacon醒一次
+
+/* 快速重连 - 上次成功的BSSID/信道/IP缓存在NVS中 */
+#define WIFI_CACHE_NAMESPACE   "wifi_cache"
+#define WIFI_FAST_REUSE_IP     0            // 1: 关联前先配上次的IP，关联后立即重新走DHCP确认租约
+#define WIFI_RECONNECT_MIN_MS  500          // 掉线后重连退避下限
+#define WIFI_RECONNECT_MAX_MS  30000        // 掉线后重连退避上限
+
+/* 连接耗时和重连统计 */
+typedef struct {
+    uint32_t connect_ms;        // 启动到获得IP的时间
+    bool fast_path;             // 启动时是否走了缓存直连
+    uint32_t fast_path_failures;
+    uint32_t disconnects;
+    uint32_t reconnects;
+    uint32_t last_reconnect_ms; // 最近一次掉线到重新获得IP的时间
+} wifi_stats_t;
 
 /* 初始化WiFi站点模式 */
 esp_err_t wifi_init_sta(void);
 
+/* 当前是否已获得IP */
+bool wifi_is_connected(void);
+
+/* 等待连接（掉线后由后台重连恢复） */
+esp_err_t wifi_wait_connected(TickType_t timeout);
+
+/* 获取连接统计 */
+void wifi_get_stats(wifi_stats_t *stats);
+
 #endif /* WIFI_MANAGER_H */
\ No newline at end of file
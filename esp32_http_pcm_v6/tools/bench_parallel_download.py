@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+并行分段下载基准 - 在主机上按设备端的方式下载同一个片段，对比单连接和并行吞吐
+
+设备端流程（main/range_download.c）:
+  首个连接发普通GET，收到响应头后只读块0（起播水位）；
+  其余连接同时用Range认领块1、块2…，首个连接读完块0后也加入认领。
+
+默认在本进程中启动替身服务器（tools/mock_server.py），并用--stream-kbps限制每个连接的速率，
+模拟单条TCP流受窗口/RTT限制的WiFi链路；也可用--url指向已运行的服务器。
+
+用法:
+  python3 bench_parallel_download.py --seconds 30 --stream-kbps 4000 --runs 3
+  python3 bench_parallel_download.py --url http://192.168.32.177:8001
+"""
+
+import argparse
+import http.client
+import json
+import os
+import sys
+import threading
+import time
+from urllib.parse import urlparse
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools"))
+import mock_server  # noqa: E402
+
+SEGMENT_SIZE = 64 * 1024
+CHUNK_SIZE = 2 * SEGMENT_SIZE          # DOWNLOAD_PARALLEL_CHUNK
+MAX_CHUNKS = 32                        # RANGE_DOWNLOAD_MAX_CHUNKS
+READ_SIZE = 4 * 2048                   # HTTP_READ_MAX
+
+
+def chunk_layout(total):
+    """与range_download_start相同的切块规则"""
+    chunk = CHUNK_SIZE
+    if (total + chunk - 1) // chunk > MAX_CHUNKS:
+        chunk = (total + MAX_CHUNKS - 1) // MAX_CHUNKS
+    chunk = (chunk + SEGMENT_SIZE - 1) // SEGMENT_SIZE * SEGMENT_SIZE
+    return chunk, (total + chunk - 1) // chunk
+
+
+def read_into(resp, buf, pos, end):
+    while pos < end:
+        data = resp.read(min(READ_SIZE, end - pos))
+        if not data:
+            raise IOError("short body at %d" % pos)
+        buf[pos:pos + len(data)] = data
+        pos += len(data)
+    return pos
+
+
+def download(host, port, path, connections):
+    """返回(数据, 总耗时, 块0耗时, 各连接字节数)"""
+    started = time.monotonic()
+    primary = http.client.HTTPConnection(host, port, timeout=30)
+    primary.request("GET", path)
+    resp = primary.getresponse()
+    if resp.status != 200:
+        raise IOError("status %d" % resp.status)
+    total = int(resp.getheader("Content-Length"))
+    buf = bytearray(total)
+    chunk, count = chunk_layout(total)
+
+    if connections < 2 or count < 2:
+        read_into(resp, buf, 0, min(chunk, total))
+        first_chunk = time.monotonic() - started
+        read_into(resp, buf, min(chunk, total), total)
+        primary.close()
+        return bytes(buf), time.monotonic() - started, first_chunk, [total]
+
+    lock = threading.Lock()
+    state = {"next": 1, "error": None}
+    per_conn = [0] * connections
+
+    def claim():
+        with lock:
+            if state["error"] or state["next"] >= count:
+                return None
+            state["next"] += 1
+            return state["next"] - 1
+
+    def work(conn_index, conn):
+        try:
+            while True:
+                index = claim()
+                if index is None:
+                    break
+                pos = index * chunk
+                end = min(pos + chunk, total)
+                conn.request("GET", path, headers={"Range": "bytes=%d-%d" % (pos, end - 1)})
+                r = conn.getresponse()
+                if r.status != 206:
+                    raise IOError("range status %d" % r.status)
+                read_into(r, buf, pos, end)
+                per_conn[conn_index] += end - pos
+        except Exception as e:  # noqa: BLE001
+            with lock:
+                state["error"] = e
+        finally:
+            conn.close()
+
+    workers = [threading.Thread(target=work, args=(i, http.client.HTTPConnection(host, port, timeout=30)))
+               for i in range(1, connections)]
+    for t in workers:
+        t.start()
+
+    # 块0在首个连接上，读完即可起播
+    read_into(resp, buf, 0, chunk)
+    per_conn[0] += chunk
+    first_chunk = time.monotonic() - started
+    primary.close()
+    work(0, http.client.HTTPConnection(host, port, timeout=30))
+    for t in workers:
+        t.join()
+    if state["error"]:
+        raise state["error"]
+    return bytes(buf), time.monotonic() - started, first_chunk, per_conn
+
+
+def add_clip(host, port, seconds):
+    conn = http.client.HTTPConnection(host, port, timeout=30)
+    conn.request("POST", "/jobs?tone=440&seconds=%g" % seconds)
+    resp = conn.getresponse()
+    body = resp.read()
+    conn.close()
+    if resp.status != 200:
+        raise IOError("add job failed: %d" % resp.status)
+    return json.loads(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Single-stream vs parallel Range download benchmark")
+    parser.add_argument("--url", help="已运行的mock服务器，例如 http://127.0.0.1:8001；缺省时在本进程启动")
+    parser.add_argument("--seconds", type=float, default=30.0, help="测试片段长度（48kHz 16-bit立体声）")
+    parser.add_argument("--stream-kbps", type=int, default=4000, help="本进程服务器的每连接速率上限")
+    parser.add_argument("--connections", type=int, nargs="+", default=[1, 2, 3])
+    parser.add_argument("--runs", type=int, default=3)
+    args = parser.parse_args()
+
+    if args.url:
+        u = urlparse(args.url)
+        host, port = u.hostname, u.port or 80
+    else:
+        mock_server.FAULTS.update({"bandwidth_kbps": args.stream_kbps})
+        server = mock_server.start_server("127.0.0.1", 0, quiet=True)
+        host, port = server.server_address
+        print("Local stand-in server on %s:%d (%d kbit/s per connection)" % (host, port, args.stream_kbps))
+
+    job = add_clip(host, port, args.seconds)
+    path = job["url"]
+    reference = None
+    print("Clip %s: %d bytes, chunks of %d" % (job["audio_id"], job["size"], chunk_layout(job["size"])[0]))
+    print("%-6s %10s %12s %12s  %s" % ("conns", "total ms", "kbit/s", "chunk0 ms", "bytes per connection"))
+
+    baseline = None
+    for connections in args.connections:
+        totals = []
+        firsts = []
+        for _ in range(args.runs):
+            data, elapsed, first, per_conn = download(host, port, path, connections)
+            if reference is None:
+                reference = data
+            elif data != reference:
+                raise SystemExit("data mismatch with %d connections" % connections)
+            totals.append(elapsed)
+            firsts.append(first)
+        elapsed = sorted(totals)[len(totals) // 2]
+        first = sorted(firsts)[len(firsts) // 2]
+        rate = len(reference) * 8 / elapsed / 1000
+        if baseline is None:
+            baseline = rate
+        print("%-6d %10.0f %12.0f %12.0f  %s  (x%.2f)" % (connections, elapsed * 1000, rate, first * 1000,
+                                                          "/".join(str(b) for b in per_conn), rate / baseline))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+"""
+时间线追踪转换 - 把设备导出的事件日志（main/event_log.h）转换为Chrome trace JSON，
+在https://ui.perfetto.dev或chrome://tracing中打开
+
+输入:
+  mock_tts_server.py保存的trace_*.bin（EVENT_TRACE_SINK_HTTP），
+  或包含EVENT_TRACE_BEGIN ... EVENT_TRACE_END的串口日志（EVENT_TRACE_SINK_UART，base64）
+
+输出中的轨道:
+  core 0 / core 1   任务切换切片（需EVENT_TRACE_TASK_SWITCH=ON构建），看哪个任务占着CPU
+  i2s               每个DMA缓冲区播放完的时刻，underflow为发送队列溢出
+  http              esp_http_client事件；http read切片为拉模式读取的阻塞时间
+  latency           latency_trace的打点（回合编号在args中）
+  heap              按内部RAM/PSRAM统计的、追踪窗口内分配且未释放的字节数
+
+用法:
+  python3 event_trace_to_chrome.py trace_ESP32_VOICE_01_1.bin -o trace.json
+  python3 event_trace_to_chrome.py monitor.log --summary
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+MAGIC = 0x474C5645
+HEADER = struct.Struct("<IHHIIIII")
+TASK = struct.Struct("<I16s")
+RECORD = struct.Struct("<IBBHII")
+
+(EVENT_TASK_SWITCH, EVENT_I2S_SENT, EVENT_I2S_UNDERFLOW, EVENT_HTTP,
+ EVENT_HTTP_READ, EVENT_ALLOC, EVENT_FREE, EVENT_MARK) = range(1, 9)
+
+ALLOC_SPIRAM = 0x2
+ALLOC_DMA = 0x4
+
+HTTP_EVENT_NAMES = ["error", "connected", "headers_sent", "on_header", "on_data",
+                    "on_finish", "disconnected", "redirect"]
+LATENCY_POINT_NAMES = ["vad_start", "vad_stop", "upload_start", "upload_response", "poll_sent",
+                       "poll_parsed", "dl_connect", "first_byte", "watermark", "first_i2s", "last_sample"]
+
+PID = 1
+TID_CORE = 0            # core N -> tid N
+TID_I2S = 10
+TID_HTTP = 11
+TID_HTTP_READ = 12
+TID_LATENCY = 13
+TRACK_NAMES = {TID_I2S: "i2s", TID_HTTP: "http", TID_HTTP_READ: "http read", TID_LATENCY: "latency"}
+
+
+class TraceError(Exception):
+    pass
+
+
+def extract_uart(text):
+    """从串口日志中取出base64块"""
+    lines = text.splitlines()
+    for i, line in enumerate(lines):
+        if line.strip().startswith("EVENT_TRACE_BEGIN"):
+            size = int(line.split()[1])
+            chunks = []
+            for body in lines[i + 1:]:
+                body = body.strip()
+                if body == "EVENT_TRACE_END":
+                    data = base64.b64decode("".join(chunks))
+                    if len(data) != size:
+                        raise TraceError("UART block is %d bytes, expected %d" % (len(data), size))
+                    return data
+                chunks.append(body)
+            raise TraceError("EVENT_TRACE_END not found")
+    raise TraceError("no EVENT_TRACE_BEGIN block in log")
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+    return extract_uart(data.decode(errors="replace"))
+
+
+def parse(data):
+    """返回(头字段, {句柄: 任务名}, [(绝对时间us, type, core, aux, a, b)])"""
+    if len(data) < HEADER.size:
+        raise TraceError("short trace (%d bytes)" % len(data))
+    magic, version, record_size, task_count, record_count, first_index, dropped, capacity = \
+        HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise TraceError("bad magic 0x%08x" % magic)
+    if version != 1 or record_size != RECORD.size:
+        raise TraceError("unsupported version %d / record size %d" % (version, record_size))
+    expected = HEADER.size + task_count * TASK.size + record_count * RECORD.size
+    if len(data) != expected:
+        raise TraceError("trace is %d bytes, header says %d" % (len(data), expected))
+
+    offset = HEADER.size
+    tasks = {}
+    for _ in range(task_count):
+        handle, name = TASK.unpack_from(data, offset)
+        tasks[handle] = name.split(b"\0", 1)[0].decode(errors="replace")
+        offset += TASK.size
+
+    # 时间戳为32位微秒，相邻记录的差按有符号数展开（两个核心的记录可能略微乱序）
+    records = []
+    now = None
+    last_raw = 0
+    for _ in range(record_count):
+        raw, rtype, core, aux, a, b = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+        if not 1 <= rtype <= EVENT_MARK:
+            raise TraceError("unknown record type %d at offset %d" % (rtype, offset - RECORD.size))
+        if now is None:
+            now = raw
+        else:
+            delta = (raw - last_raw) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            now += delta
+        last_raw = raw
+        records.append((now, rtype, core, aux, a, b))
+
+    header = {"task_count": task_count, "record_count": record_count, "first_index": first_index,
+              "dropped": dropped, "capacity": capacity}
+    return header, tasks, records
+
+
+def task_name(tasks, handle):
+    return tasks.get(handle, "task 0x%08x" % handle)
+
+
+def convert(tasks, records):
+    if not records:
+        return []
+    base = min(r[0] for r in records)
+    events = []
+    cores = set()
+    running = {}            # core -> (开始时间, 任务名)
+    live = {}               # 指针 -> (字节数, 是否PSRAM)
+    heap = {"internal": 0, "spiram": 0}
+
+    def instant(ts, tid, name, args=None, scope="t"):
+        events.append({"ph": "i", "pid": PID, "tid": tid, "ts": ts, "name": name, "s": scope,
+                       "args": args or {}})
+
+    for t, rtype, core, aux, a, b in records:
+        ts = t - base
+        if rtype == EVENT_TASK_SWITCH:
+            cores.add(core)
+            prev = running.get(core)
+            if prev:
+                events.append({"ph": "X", "pid": PID, "tid": TID_CORE + core, "ts": prev[0],
+                               "dur": ts - prev[0], "name": prev[1]})
+            running[core] = (ts, task_name(tasks, a))
+        elif rtype == EVENT_I2S_SENT:
+            instant(ts, TID_I2S, "dma sent", {"bytes": a, "core": core})
+        elif rtype == EVENT_I2S_UNDERFLOW:
+            instant(ts, TID_I2S, "underflow", {"bytes": a}, scope="g")
+        elif rtype == EVENT_HTTP:
+            name = HTTP_EVENT_NAMES[aux] if aux < len(HTTP_EVENT_NAMES) else "event %d" % aux
+            instant(ts, TID_HTTP, name, {"len": a, "client": "0x%08x" % b})
+        elif rtype == EVENT_HTTP_READ:
+            events.append({"ph": "X", "pid": PID, "tid": TID_HTTP_READ, "ts": max(ts - b, 0), "dur": b,
+                           "name": "read", "args": {"bytes": a}})
+        elif rtype in (EVENT_ALLOC, EVENT_FREE):
+            # 窗口开始前分配的块释放时大小未知，不计入
+            if rtype == EVENT_ALLOC:
+                spiram = bool(aux & ALLOC_SPIRAM)
+                live[a] = (b, spiram)
+                heap["spiram" if spiram else "internal"] += b
+            elif a in live:
+                size, spiram = live.pop(a)
+                heap["spiram" if spiram else "internal"] -= size
+            else:
+                continue
+            events.append({"ph": "C", "pid": PID, "ts": ts, "name": "heap", "args": dict(heap)})
+        elif rtype == EVENT_MARK:
+            name = LATENCY_POINT_NAMES[aux] if aux < len(LATENCY_POINT_NAMES) else "point %d" % aux
+            instant(ts, TID_LATENCY, name, {"turn": a, "arg": b})
+
+    end = records[-1][0] - base
+    for core, (start, name) in running.items():
+        events.append({"ph": "X", "pid": PID, "tid": TID_CORE + core, "ts": start, "dur": end - start,
+                       "name": name})
+
+    meta = [{"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "esp32"}}]
+    for core in sorted(cores):
+        meta.append({"ph": "M", "pid": PID, "tid": TID_CORE + core, "name": "thread_name",
+                     "args": {"name": "core %d" % core}})
+    for tid, name in TRACK_NAMES.items():
+        meta.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name", "args": {"name": name}})
+    return meta + events
+
+
+def summarize(header, tasks, records, events):
+    span = (records[-1][0] - records[0][0]) if records else 0
+    counts = {}
+    for r in records:
+        counts[r[1]] = counts.get(r[1], 0) + 1
+    print("%d records over %.1f ms (%d tasks named, %d overwritten, %d dropped)"
+          % (len(records), span / 1000, len(tasks), header["first_index"], header["dropped"]))
+    names = {EVENT_TASK_SWITCH: "task_switch", EVENT_I2S_SENT: "i2s_sent", EVENT_I2S_UNDERFLOW: "i2s_underflow",
+             EVENT_HTTP: "http", EVENT_HTTP_READ: "http_read", EVENT_ALLOC: "alloc", EVENT_FREE: "free",
+             EVENT_MARK: "mark"}
+    for rtype in sorted(counts):
+        print("  %-14s %d" % (names[rtype], counts[rtype]))
+
+    # 各核心上各任务的运行时间占比
+    busy = {}
+    for e in events:
+        if e["ph"] == "X" and e["tid"] < TID_I2S:
+            key = (e["tid"], e["name"])
+            busy[key] = busy.get(key, 0) + e["dur"]
+    for (core, name), dur in sorted(busy.items(), key=lambda kv: (kv[0][0], -kv[1])):
+        print("  core %d %-16s %6.1f%%" % (core, name, 100.0 * dur / span if span else 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an esp32 event trace to Chrome trace JSON")
+    parser.add_argument("input", help="trace .bin或包含EVENT_TRACE_BEGIN块的串口日志")
+    parser.add_argument("-o", "--output", help="输出JSON路径，默认为输入文件名加.json")
+    parser.add_argument("--summary", action="store_true", help="打印事件计数和各任务CPU占比")
+    args = parser.parse_args()
+
+    try:
+        header, tasks, records = parse(load(args.input))
+    except (TraceError, OSError, ValueError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    events = convert(tasks, records)
+    output = args.output or args.input + ".json"
+    with open(output, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, f)
+    print("wrote %d trace events to %s" % (len(events), output))
+    if args.summary:
+        summarize(header, tasks, records, events)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
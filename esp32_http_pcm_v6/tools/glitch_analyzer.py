@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+"""
+I2S输出毛刺分析 - 把录下的输出流与源片段逐样本对比，找出：
+  dropout   一段零值，源里没有（auto_clear在欠载时输出的静音）；之后若接不上原位置，同时给出丢失/重复的量
+  repeat    输出回到源中较早的位置（关闭auto_clear时DMA重放旧缓冲区）
+  skip      输出跳到源中较晚的位置（样本丢失）
+  corrupt   既不是零也对不上源的样本（爆音、位错误）
+  truncated 输出在源结束前中断
+
+输出流需要是I2S数据线的数字录音（逻辑分析仪/I2S嗅探器，或另一块板的I2S RX），与源片段逐位一致；
+模拟录音（经过DAC/ADC）无法逐样本对比。只分析左声道。每个毛刺给出输出流时间和源时间，
+源时间可与设备端i2s_monitor报告中的播放位置（字节数/192000）对应。
+含纯音等周期性内容的片段，恰好等于整数个周期的重复/跳跃无法区分，尽量用语音片段。
+
+也可作为接收端在其它工具中使用：GlitchSink(source).write(data)...close() 返回同样的结果。
+
+用法:
+  python3 glitch_analyzer.py capture.wav source.pcm
+  python3 glitch_analyzer.py capture.raw source.pcm --rate 48000 --channels 2 --json glitches.json
+  python3 glitch_analyzer.py --self-test
+"""
+
+import argparse
+import array
+import json
+import math
+import sys
+import wave
+
+BLOCK = 256                 # 快速比较的块大小（样本）
+FINGERPRINT = 32            # 重新对齐时用于查找的样本数
+MIN_ZERO_RUN = 16           # 至少这么多连续零值才算dropout
+SEARCH_MS = 500             # 重新对齐时在源中向前后搜索的范围
+CORRUPT_LIMIT = 48000       # corrupt最长向后扫描的样本数
+
+
+def load(path, rate, channels):
+    """读取WAV或原始s16le，返回(左声道字节, 采样率)"""
+    if path.lower().endswith(".wav"):
+        with wave.open(path, "rb") as w:
+            if w.getsampwidth() != 2:
+                raise ValueError("%s: only 16-bit PCM is supported" % path)
+            rate, channels = w.getframerate(), w.getnchannels()
+            data = w.readframes(w.getnframes())
+    else:
+        with open(path, "rb") as f:
+            data = f.read()
+    return left_channel(data, channels), rate
+
+
+def left_channel(data, channels):
+    samples = array.array("h")
+    samples.frombytes(data[:len(data) - len(data) % (2 * channels)])
+    if sys.byteorder == "big":
+        samples.byteswap()
+    return samples[0::channels].tobytes() if channels > 1 else samples.tobytes()
+
+
+def find_nearest(hay, needle, expected, lo, hi):
+    """在hay的样本区间[lo, hi)中找needle（按样本对齐），返回离expected最近的位置或None"""
+    best = None
+    start = max(0, lo) * 2
+    end = min(len(hay), max(0, hi) * 2 + len(needle))
+    while True:
+        pos = hay.find(needle, start, end)
+        if pos < 0:
+            break
+        start = pos + 1
+        if pos % 2:
+            continue
+        s = pos // 2
+        if best is None or abs(s - expected) < abs(best - expected):
+            best = s
+        if s > expected:
+            break
+    return best
+
+
+class Analyzer:
+    def __init__(self, cap, src, rate):
+        self.cap = cap
+        self.src = src
+        self.rate = rate
+        self.C = len(cap) // 2
+        self.S = len(src) // 2
+        self.window = rate * SEARCH_MS // 1000
+
+    def zero_run(self, p):
+        n = 0
+        while p + n < self.C and self.cap[2 * (p + n)] == 0 and self.cap[2 * (p + n) + 1] == 0:
+            n += 1
+        return n
+
+    def resync(self, p, expected):
+        """输出流p处的指纹在源中的位置（离expected最近）"""
+        if p + FINGERPRINT > self.C:
+            return None
+        needle = self.cap[2 * p:2 * (p + FINGERPRINT)]
+        if not any(needle):
+            return None         # 全零指纹无法定位
+        return find_nearest(self.src, needle, expected, expected - self.window, expected + self.window)
+
+    def glitch(self, kind, p, s, samples, lost=0):
+        return {
+            "type": kind,
+            "capture_s": round(p / self.rate, 4),
+            "source_s": round(s / self.rate, 4),
+            "capture_sample": p,
+            "source_sample": s,
+            "duration_ms": round(samples * 1000 / self.rate, 2),
+            "lost_ms": round(lost * 1000 / self.rate, 2),
+        }
+
+    def classify(self, p, s):
+        """p/s处第一个不一致的样本，返回(毛刺, 继续比较的p, s)；无法继续时p为None"""
+        z = self.zero_run(p)
+        if z >= MIN_ZERO_RUN:
+            q = p + z
+            if q >= self.C:
+                return self.glitch("truncated", p, s, self.S - s), None, None
+            s2 = self.resync(q, s)
+            if s2 is None:
+                return self.glitch("dropout", p, s, z), q, s
+            return self.glitch("dropout", p, s, z, s2 - s), q, s2
+
+        s2 = self.resync(p, s)
+        if s2 is not None:
+            kind = "skip" if s2 > s else "repeat"
+            return self.glitch(kind, p, s, abs(s2 - s), s2 - s), p, s2
+
+        # 对不上：逐样本向后找，直到重新接上源
+        q = p + 1
+        while q < min(self.C, p + CORRUPT_LIMIT):
+            s2 = self.resync(q, s + (q - p))
+            if s2 is not None:
+                return self.glitch("corrupt", p, s, q - p, s2 - (s + q - p)), q, s2
+            q += 1
+        return self.glitch("corrupt", p, s, self.C - p), None, None
+
+    def run(self):
+        first = next((i for i in range(self.S) if self.src[2 * i] or self.src[2 * i + 1]), None)
+        if first is None:
+            raise ValueError("source clip is silent")
+        needle = self.src[2 * first:2 * (first + FINGERPRINT)]
+        p = find_nearest(self.cap, needle, 0, 0, self.C)
+        if p is None:
+            raise ValueError("source clip not found in capture (not a bit-exact capture?)")
+        s = first
+        start = p - first
+        glitches = []
+        while s < self.S and p is not None and p < self.C:
+            n = min(BLOCK, self.S - s, self.C - p)
+            if self.cap[2 * p:2 * (p + n)] == self.src[2 * s:2 * (s + n)]:
+                p += n
+                s += n
+                continue
+            i = 0
+            while i < n and self.cap[2 * (p + i):2 * (p + i + 1)] == self.src[2 * (s + i):2 * (s + i + 1)]:
+                i += 1
+            p += i
+            s += i
+            if i == n:
+                continue
+            g, p, s = self.classify(p, s)
+            glitches.append(g)
+        if p is not None and p >= self.C and s < self.S:
+            glitches.append(self.glitch("truncated", self.C, s, self.S - s))
+        return {"start_s": round(start / self.rate, 4), "capture_s": round(self.C / self.rate, 3),
+                "source_s": round(self.S / self.rate, 3), "glitches": glitches}
+
+
+class GlitchSink:
+    """接收输出流，close()时与源片段对比"""
+
+    def __init__(self, source, rate=48000, channels=2):
+        self.src = left_channel(source, channels)
+        self.rate = rate
+        self.channels = channels
+        self.buf = bytearray()
+
+    def write(self, data):
+        self.buf += data
+
+    def close(self):
+        return Analyzer(left_channel(bytes(self.buf), self.channels), self.src, self.rate).run()
+
+
+def print_report(result):
+    glitches = result["glitches"]
+    print("Source %.3f s found at %.3f s in %.3f s capture: %d glitches"
+          % (result["source_s"], result["start_s"], result["capture_s"], len(glitches)))
+    for g in glitches:
+        extra = ""
+        if g["type"] == "dropout" and g["lost_ms"]:
+            extra = "  (%s %.2f ms)" % ("then skipped" if g["lost_ms"] > 0 else "then repeated", abs(g["lost_ms"]))
+        print("  %9.4f s  src %9.4f s  %-9s %8.2f ms%s"
+              % (g["capture_s"], g["source_s"], g["type"], g["duration_ms"], extra))
+    kinds = {}
+    for g in glitches:
+        kinds.setdefault(g["type"], []).append(g["duration_ms"])
+    for kind, durations in sorted(kinds.items()):
+        print("  %-9s x%-4d total %8.2f ms  max %8.2f ms" % (kind, len(durations), sum(durations), max(durations)))
+
+
+def self_test():
+    """合成带已知毛刺的输出流，检查检测结果"""
+    rate = 48000
+    src = array.array("h")
+    for i in range(rate * 3):
+        t = i / rate
+        # 频率随时间变化的扫频，任何窗口都不重复
+        src.append(int(8000 * math.sin(2 * math.pi * (200 * t + 300 * t * t))) + (i * 7919) % 64 - 32)
+    dma = 1024
+    cap = array.array("h", [0] * (rate // 10))          # 开头0.1秒静音
+    a, b, c, d = rate // 2, rate, rate * 3 // 2, rate * 2
+    cap.extend(src[:a])
+    cap.extend([0] * dma)                               # 欠载：插入一个DMA缓冲区的静音
+    cap.extend(src[a:b])
+    cap.extend(src[b - dma:b])                          # 重放上一个DMA缓冲区
+    cap.extend(src[b:c])
+    cap.extend(src[c + 512:d])                          # 丢失512个样本
+    corrupt = src[d:d + 5]
+    for i in range(5):
+        corrupt[i] = -corrupt[i] + 5
+    cap.extend(corrupt)                                 # 5个样本被破坏
+    cap.extend(src[d + 5:])
+
+    def stereo(mono):
+        out = array.array("h", bytes(4 * len(mono)))
+        out[0::2] = mono
+        out[1::2] = mono
+        return out.tobytes()
+
+    sink = GlitchSink(stereo(src), rate, 2)
+    data = stereo(cap)
+    for off in range(0, len(data), 4096):
+        sink.write(data[off:off + 4096])
+    result = sink.close()
+    print_report(result)
+
+    lead = rate // 10
+    expected = [
+        ("dropout", lead + a, dma),
+        ("repeat", lead + dma + b, dma),
+        ("skip", lead + 2 * dma + c, 512),
+        ("corrupt", lead + 2 * dma + d - 512, 5),
+    ]
+    got = [(g["type"], g["capture_sample"], round(g["duration_ms"] * rate / 1000)) for g in result["glitches"]]
+    if got != expected or result["start_s"] != lead / rate:
+        print("self-test FAILED: expected %s, got %s" % (expected, got))
+        return 1
+    print("self-test passed")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare a captured I2S output stream against the source clip")
+    parser.add_argument("capture", nargs="?", help="录下的输出流（.wav或原始s16le）")
+    parser.add_argument("source", nargs="?", help="源片段（.wav或原始s16le）")
+    parser.add_argument("--rate", type=int, default=48000, help="原始PCM的采样率")
+    parser.add_argument("--channels", type=int, default=2, help="原始PCM的声道数")
+    parser.add_argument("--json", help="保存毛刺列表")
+    parser.add_argument("--self-test", action="store_true")
+    args = parser.parse_args()
+
+    if args.self_test:
+        return self_test()
+    if not args.capture or not args.source:
+        parser.error("capture and source are required")
+    cap, cap_rate = load(args.capture, args.rate, args.channels)
+    src, src_rate = load(args.source, args.rate, args.channels)
+    if cap_rate != src_rate:
+        parser.error("sample rate mismatch: capture %d Hz, source %d Hz" % (cap_rate, src_rate))
+    try:
+        result = Analyzer(cap, src, cap_rate).run()
+    except ValueError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 2
+    print_report(result)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(result, f, indent=1)
+    return 1 if result["glitches"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+"""
+本地替身TTS服务器 - 用于在没有真实TTS服务时测试esp32_http_pcm_v6
+
+实现在仓库根目录的tools/mock_server.py（所有固件版本共用，带故障注入），本脚本只是v6的入口，
+参数和故障注入选项与mock_server.py相同。v6用到的接口:
+  GET  /esp32/events         Server-Sent Events推送通道 (event: job / ping / trace)，
+                             重连时重发Last-Event-ID之后已推送的任务
+  GET  /esp32/poll           长轮询回退 (200 {"jobs":[...]} 或 204；无X-Poll-Batch头时返回单个任务)
+  GET  /audio/<id>.pcm       PCM音频，支持Range断点续传和分段（bytes=a-b），带X-Content-Hash头
+  GET  /bench/<字节数>        网络基准测试对象（main/net_bench.c）
+  POST /esp32/report         下载结果上报 (也接受轮询请求的X-Download-Report头)，
+                             cache=hit表示设备直接从片段缓存播放
+  POST /esp32/telemetry/heap 二进制堆报告 (mem_track.h中的格式)
+  POST /esp32/telemetry/trace 时间线追踪导出 (event_log.h中的格式)，保存为trace_<设备>_<n>.bin
+  POST /trace                请求设备导出时间线：下一个轮询响应带X-Trace-Dump头，推送通道发event: trace
+  POST /jobs?file=<path>     添加任务，file为16-bit PCM文件
+  POST /jobs?tone=<hz>&seconds=<n>  添加一个正弦测试音
+
+用法:
+  python3 mock_tts_server.py --port 8001 --jobs 1 --tone 440 --seconds 3
+然后把main/http_client.h中的TTS_SERVER_IP改成运行本脚本的主机地址。
+
+--bandwidth-kbps限制每个连接的发送速率，模拟单条TCP流受窗口和RTT限制的链路，
+用于对比单连接和并行分段下载（见bench_parallel_download.py）。
+--trace在每个任务下发时请求一次时间线导出，用event_trace_to_chrome.py转换后在Perfetto中查看。
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools"))
+import mock_server  # noqa: E402
+
+if __name__ == "__main__":
+    mock_server.main()
@@ -0,0 +1,674 @@
+#!/usr/bin/env python3
+"""
+本地替身TTS/STT服务器（带故障注入）- 所有固件版本共用，不依赖真实的LAN服务器
+
+实现各版本用到的接口:
+  GET  /esp32/poll             长轮询，200 {"audio_id":...}（X-Poll-Batch时为{"jobs":[...]}）或204
+                               esp32_http_pcm ~ _v6、esp32_http_pcm_record
+  GET  /esp32/events           Server-Sent Events推送通道 (event: job / ping / trace)，esp32_http_pcm_v6
+                               重连时重发Last-Event-ID之后已推送的任务
+  GET  /audio/<id>.pcm         16-bit 48kHz立体声PCM，支持Range（bytes=a-b），带X-Content-Hash头
+  POST /esp32/tts              {"text":...} -> {"filename":...}，esp32_http_mp3
+  GET  /esp32/download/<f>     下载/esp32/tts生成的文件（静音MP3帧，或--mp3指定的文件）
+  POST /upload_pcm             multipart录音上传 -> {"text":...,"device_id":...}，esp32_http_pcm_record
+                               --reply-seconds>0时同时排入一个回复任务，模拟完整的对话回合
+  POST /esp32/report           下载结果上报（只记录，也接受轮询请求的X-Download-Report头），
+                               cache=hit表示设备直接从片段缓存播放
+  POST /esp32/telemetry/heap   二进制堆报告 (esp32_http_pcm_v6/main/mem_track.h中的格式)
+  POST /esp32/telemetry/trace  时间线追踪导出 (event_log.h中的格式)，保存为trace_<设备>_<n>.bin
+  GET  /bench/<字节数>          固定内容的测试对象（不超过BENCH_MAX_SIZE），esp32_http_pcm_v6的网络基准测试（net_bench.c）
+测试控制:
+  POST /jobs?tone=<hz>&seconds=<n> 或 /jobs?file=<path>  添加任务
+  GET  /stats                  各任务时间线和累计计数（JSON），soak_test.py据此出报告
+  GET|POST /faults             查看/修改故障参数（JSON），可在运行中切换
+  POST /trace                  请求设备导出时间线：下一个轮询响应带X-Trace-Dump头，推送通道发event: trace
+
+故障注入（命令行参数或POST /faults）:
+  bandwidth_kbps   每个连接的发送速率上限
+  latency_ms       响应头之前的延迟；jitter_ms为其上随机加减的幅度，也作用于每个发送块
+  disconnect_at    音频响应发送N字节后断开连接（0为不断开）；disconnect_prob为断开的概率
+  chunked          响应改用Transfer-Encoding: chunked，不发Content-Length
+  storm_204        每storm_every次轮询中有storm_204次立即返回204（即使有任务），模拟空轮询风暴
+  error_rate       按概率返回500
+推送通道只受latency_ms/jitter_ms影响，其余故障作用于轮询和下载。
+
+让固件连到本服务器：把各版本的TTS_SERVER_URL/TTS_SERVER_IP（和STT_SERVER_URL）改为运行本脚本的主机，
+QEMU用户态网络中主机地址为10.0.2.2。用法:
+  python3 mock_server.py --port 8001 --every 5 --seconds 3 --bandwidth-kbps 2000 --disconnect-prob 0.1
+--trace在每个任务下发时请求一次时间线导出，用esp32_http_pcm_v6/tools/event_trace_to_chrome.py转换。
+"""
+
+import argparse
+import array
+import collections
+import hashlib
+import json
+import math
+import os
+import queue
+import random
+import re
+import socket
+import struct
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+SAMPLE_RATE = 48000
+CHANNELS = 2
+BYTES_PER_SECOND = SAMPLE_RATE * CHANNELS * 2
+POLL_HOLD_S = 25             # 小于固件30秒的HTTP超时
+PING_INTERVAL_S = 15         # 推送通道空闲时的心跳间隔
+PUSH_HISTORY = 64            # 保留最近推送的事件，按Last-Event-ID重发
+SEND_PIECE = 4096
+BENCH_MAX_SIZE = 16 * 1024 * 1024
+
+MP3_FRAME_HEADER = b"\xff\xfb\x90\x00"   # MPEG-1 Layer III, 128kbit/s, 44.1kHz
+MP3_FRAME_SIZE = 417
+MP3_FRAME_SECONDS = 1152 / 44100
+
+HEAP_HEADER = struct.Struct("<HBBBBHI")
+HEAP_TAG = struct.Struct("<IIIH")
+HEAP_CAPS = struct.Struct("<III")
+HEAP_TAG_NAMES = ["network", "player", "capture", "decoder", "codec"]
+HEAP_CAPS_NAMES = ["internal", "psram", "dma"]
+
+
+def make_tone(freq, seconds, amplitude=0.3):
+    """生成16-bit 48kHz立体声正弦波，与固件的I2S配置一致"""
+    count = int(SAMPLE_RATE * seconds)
+    scale = 32767 * amplitude
+    step = 2 * math.pi * freq / SAMPLE_RATE
+    samples = array.array("h", bytes(count * CHANNELS * 2))
+    for i in range(count):
+        v = int(scale * math.sin(step * i))
+        samples[2 * i] = v
+        samples[2 * i + 1] = v
+    return samples.tobytes()
+
+
+def make_silent_mp3(seconds):
+    """全零边信息的MP3帧解码为静音，足够让固件识别帧同步"""
+    frames = max(1, int(seconds / MP3_FRAME_SECONDS))
+    return (MP3_FRAME_HEADER + bytes(MP3_FRAME_SIZE - len(MP3_FRAME_HEADER))) * frames
+
+
+class Faults:
+    """故障参数，所有连接共享，可在运行中修改"""
+
+    FIELDS = {
+        "bandwidth_kbps": 0, "latency_ms": 0, "jitter_ms": 0, "disconnect_at": 0, "disconnect_prob": 0.0,
+        "chunked": False, "storm_204": 0, "storm_every": 0, "error_rate": 0.0,
+    }
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.values = dict(self.FIELDS)
+        self.polls = 0
+
+    def update(self, changes):
+        with self.lock:
+            for key, value in changes.items():
+                if key not in self.FIELDS:
+                    raise KeyError(key)
+                self.values[key] = type(self.FIELDS[key])(value)
+
+    def get(self, key):
+        with self.lock:
+            return self.values[key]
+
+    def snapshot(self):
+        with self.lock:
+            return dict(self.values)
+
+    def header_delay(self):
+        latency = self.get("latency_ms")
+        jitter = self.get("jitter_ms")
+        return max(0.0, latency + random.uniform(-jitter, jitter)) / 1000
+
+    def in_storm(self):
+        """本次轮询是否落在204风暴中"""
+        with self.lock:
+            self.polls += 1
+            every = self.values["storm_every"]
+            return every > 0 and (self.polls - 1) % every < self.values["storm_204"]
+
+    def cut_point(self, length):
+        """本次音频响应在第几个字节断开，None为不断开"""
+        at = self.get("disconnect_at")
+        prob = self.get("disconnect_prob")
+        if not at and not prob:
+            return None
+        if prob and random.random() >= prob:
+            return None
+        point = at if at else random.randint(1, max(1, length - 1))
+        return point if point < length else None
+
+
+class Stats:
+    """每个任务的时间线（服务器侧观察）和累计计数"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.started = time.monotonic()
+        self.jobs = {}
+        self.counters = {}
+
+    def count(self, name, n=1):
+        with self.lock:
+            self.counters[name] = self.counters.get(name, 0) + n
+
+    def job_event(self, audio_id, event, **fields):
+        now = time.monotonic() - self.started
+        with self.lock:
+            job = self.jobs.setdefault(audio_id, {"audio_id": audio_id, "bytes_sent": 0, "requests": 0})
+            if event not in job:
+                job[event] = now
+            for key, value in fields.items():
+                job[key] = job.get(key, 0) + value if isinstance(value, int) and key in job else value
+
+    def snapshot(self):
+        with self.lock:
+            return {"uptime": time.monotonic() - self.started, "counters": dict(self.counters),
+                    "jobs": [dict(j) for j in self.jobs.values()]}
+
+
+class JobStore:
+    """待下发任务和文件，推送、轮询和下载共享同一个队列，每个任务只下发一次"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.files = {}
+        self.hashes = {}
+        self.pending = queue.Queue()
+        self.next_id = 1
+        self.event_id = 0
+        self.pushed = collections.deque(maxlen=PUSH_HISTORY)
+
+    def add(self, data, ext="pcm", queue_job=True):
+        # 相同内容得到相同的哈希，esp32_http_pcm_v6据此命中片段缓存
+        content_hash = hashlib.sha1(data).hexdigest()[:32]
+        with self.lock:
+            name = "job_%04d" % self.next_id
+            self.next_id += 1
+            self.files["%s.%s" % (name, ext)] = data
+            self.hashes["%s.%s" % (name, ext)] = content_hash
+        if queue_job:
+            job = {"audio_id": name, "url": "/audio/%s.pcm" % name, "format": "pcm_s16le_48k_stereo",
+                   "size": len(data), "hash": content_hash}
+            STATS.job_event(name, "queued", size=len(data))
+            self.pending.put(job)
+            print("[jobs] queued %s (%d bytes, %.1f s)" % (name, len(data), len(data) / BYTES_PER_SECOND))
+        return name
+
+    def take(self, timeout):
+        try:
+            return self.pending.get(timeout=timeout) if timeout else self.pending.get_nowait()
+        except queue.Empty:
+            return None
+
+    def next_event_id(self):
+        with self.lock:
+            self.event_id += 1
+            return self.event_id
+
+    def mark_pushed(self, event_id, job):
+        with self.lock:
+            self.pushed.append((event_id, job))
+
+    def pushed_after(self, last_id):
+        """设备未确认的推送事件（id大于Last-Event-ID），重连时按顺序重发"""
+        with self.lock:
+            return [item for item in self.pushed if item[0] > last_id]
+
+
+FAULTS = Faults()
+STATS = Stats()
+STORE = JobStore()
+TRACE_REQUESTED = threading.Event()
+
+
+_bench_pattern = bytes(range(256))
+_bench_cache = {}
+
+
+def bench_object(size):
+    """基准测试对象：0..255循环，按大小缓存"""
+    if size not in _bench_cache:
+        _bench_cache[size] = (_bench_pattern * (size // 256 + 1))[:size]
+    return _bench_cache[size]
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    poll_hold = POLL_HOLD_S
+    reply_seconds = 0.0
+    mp3_data = None
+    quiet = False
+    trace_each_job = False   # 每个任务下发时请求一次时间线导出
+    trace_dir = "."
+
+    def log_message(self, fmt, *args):
+        if not self.quiet:
+            print("[http] %s %s" % (self.address_string(), fmt % args))
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        return self.rfile.read(length) if length else b""
+
+    # ---- 发送（故障注入都在这里） ----
+
+    def respond(self, status, body=b"", content_type="application/json", headers=None, cut=None):
+        """发送响应，返回实际发送的正文字节数；cut为断开位置"""
+        time.sleep(FAULTS.header_delay())
+        if status < 400 and FAULTS.get("error_rate") and random.random() < FAULTS.get("error_rate"):
+            STATS.count("injected_500")
+            status, body, content_type, headers, cut = 500, b'{"error":"injected"}', "application/json", None, None
+
+        chunked = FAULTS.get("chunked") and status != 204
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        if chunked:
+            self.send_header("Transfer-Encoding", "chunked")
+        elif status != 204:
+            self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if status == 204:
+            return 0
+
+        limit = len(body) if cut is None else cut
+        sent = 0
+        try:
+            sent = self.write_paced(body[:limit], chunked)
+            if cut is not None:
+                # 发到一半断开：不发chunked结束块，直接关闭TCP
+                STATS.count("injected_disconnects")
+                self.close_connection = True
+                self.connection.shutdown(socket.SHUT_RDWR)
+            elif chunked:
+                self.wfile.write(b"0\r\n\r\n")
+        except (BrokenPipeError, ConnectionResetError):
+            STATS.count("client_aborts")
+            self.close_connection = True
+        return sent
+
+    def write_paced(self, body, chunked):
+        kbps = FAULTS.get("bandwidth_kbps")
+        jitter = FAULTS.get("jitter_ms")
+        bytes_per_s = kbps * 1000 / 8 if kbps else 0
+        started = time.monotonic()
+        sent = 0
+        for offset in range(0, len(body), SEND_PIECE):
+            piece = body[offset:offset + SEND_PIECE]
+            if chunked:
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(piece), piece))
+            else:
+                self.wfile.write(piece)
+            sent += len(piece)
+            delay = 0.0
+            if bytes_per_s:
+                delay = started + sent / bytes_per_s - time.monotonic()
+            if jitter:
+                delay += random.uniform(0, jitter) / 1000
+            if delay > 0:
+                time.sleep(delay)
+        return sent
+
+    # ---- GET ----
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        report = self.headers.get("X-Download-Report")
+        if report:
+            log_report(report)
+
+        if url.path == "/esp32/events":
+            self.serve_events()
+        elif url.path == "/esp32/poll":
+            self.serve_poll()
+        elif url.path.startswith("/audio/"):
+            self.serve_file(url.path, r"^/audio/([\w.-]+\.pcm)$", track=True)
+        elif url.path.startswith("/esp32/download/"):
+            self.serve_file(url.path, r"^/esp32/download/([\w.-]+)$", track=False)
+        elif url.path.startswith("/bench/"):
+            self.serve_bench(url.path)
+        elif url.path == "/stats":
+            self.respond(200, json.dumps(STATS.snapshot()).encode())
+        elif url.path == "/faults":
+            self.respond(200, json.dumps(FAULTS.snapshot()).encode())
+        else:
+            self.respond(404)
+
+    def serve_events(self):
+        time.sleep(FAULTS.header_delay())
+        self.send_response(200)
+        self.send_header("Content-Type", "text/event-stream")
+        self.send_header("Cache-Control", "no-cache")
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        STATS.count("push_connects")
+        print("[push] %s connected (Last-Event-ID=%s)"
+              % (self.headers.get("X-Device-ID"), self.headers.get("Last-Event-ID")))
+
+        def send_chunk(text):
+            data = text.encode()
+            self.wfile.write(b"%x\r\n%s\r\n" % (len(data), data))
+            self.wfile.flush()
+
+        def send_job(event_id, job):
+            send_chunk("id: %d\nevent: job\ndata: %s\n\n" % (event_id, json.dumps(job, separators=(",", ":"))))
+
+        last_id = self.headers.get("Last-Event-ID", "")
+        replay = STORE.pushed_after(int(last_id)) if last_id.isdigit() else []
+
+        job = None
+        try:
+            send_chunk(": connected\n\n")
+            for event_id, old_job in replay:
+                send_job(event_id, old_job)
+                STATS.count("push_resent")
+                print("[push] resent %s (id %d)" % (old_job["audio_id"], event_id))
+            while True:
+                job = STORE.take(PING_INTERVAL_S)
+                if job is None:
+                    send_chunk("event: ping\ndata: {}\n\n")
+                else:
+                    event_id = STORE.next_event_id()
+                    send_job(event_id, job)
+                    STORE.mark_pushed(event_id, job)
+                    STATS.job_event(job["audio_id"], "delivered")
+                    print("[push] sent %s" % job["audio_id"])
+                    job = None
+                    self.note_job_sent()
+                if TRACE_REQUESTED.is_set():
+                    TRACE_REQUESTED.clear()
+                    send_chunk("event: trace\ndata: {}\n\n")
+                    print("[trace] requested dump over push channel")
+        except (BrokenPipeError, ConnectionResetError):
+            print("[push] client disconnected")
+            self.close_connection = True
+            if job is not None:
+                # 发送失败的任务放回队列，由重连或长轮询取走
+                STORE.pending.put(job)
+
+    def note_job_sent(self):
+        if self.trace_each_job:
+            TRACE_REQUESTED.set()
+
+    def serve_poll(self):
+        STATS.count("polls")
+        if FAULTS.in_storm():
+            STATS.count("storm_204")
+            self.respond(204)
+            return
+        job = STORE.take(self.poll_hold)
+        if job is None:
+            STATS.count("poll_204")
+            self.respond(204)
+            return
+        STATS.job_event(job["audio_id"], "delivered")
+        self.note_job_sent()
+        headers = {}
+        if TRACE_REQUESTED.is_set():
+            TRACE_REQUESTED.clear()
+            headers["X-Trace-Dump"] = "1"
+            print("[trace] requested dump in poll response")
+        batch = int(self.headers.get("X-Poll-Batch", "0") or 0)
+        if batch > 0:
+            jobs = [job]
+            while len(jobs) < batch:
+                more = STORE.take(0)
+                if more is None:
+                    break
+                STATS.job_event(more["audio_id"], "delivered")
+                jobs.append(more)
+            body = {"jobs": jobs}
+        else:
+            body = job
+        self.respond(200, json.dumps(body, separators=(",", ":")).encode(), headers=headers)
+
+    def serve_file(self, path, pattern, track):
+        match = re.match(pattern, path)
+        name = match.group(1) if match else None
+        data = STORE.files.get(name) if name else None
+        if data is None:
+            self.respond(404)
+            return
+        audio_id = name.rsplit(".", 1)[0]
+
+        start, end, status = 0, len(data), 200
+        headers = {"Accept-Ranges": "bytes", "X-Content-Hash": STORE.hashes[name]}
+        range_header = self.headers.get("Range")
+        if range_header:
+            m = re.match(r"bytes=(\d+)-(\d*)$", range_header)
+            if not m or int(m.group(1)) >= len(data):
+                self.respond(416)
+                return
+            start = int(m.group(1))
+            if m.group(2):
+                end = min(int(m.group(2)) + 1, len(data))
+            status = 206
+            headers["Content-Range"] = "bytes %d-%d/%d" % (start, end - 1, len(data))
+            STATS.count("range_requests")
+
+        body = data[start:end]
+        if track:
+            STATS.job_event(audio_id, "first_request", requests=1)
+        sent = self.respond(status, body, "application/octet-stream", headers, cut=FAULTS.cut_point(len(body)))
+        STATS.count("audio_bytes", sent)
+        if track:
+            STATS.job_event(audio_id, "first_byte_sent", bytes_sent=sent)
+            if start + sent == len(data):
+                STATS.job_event(audio_id, "completed")
+
+    def serve_bench(self, path):
+        match = re.match(r"^/bench/(\d+)$", path)
+        size = int(match.group(1)) if match else -1
+        if not 0 < size <= BENCH_MAX_SIZE:
+            self.respond(404)
+            return
+        STATS.count("bench_requests")
+        sent = self.respond(200, bench_object(size), "application/octet-stream", cut=FAULTS.cut_point(size))
+        STATS.count("bench_bytes", sent)
+
+    # ---- POST ----
+
+    def do_POST(self):
+        url = urlparse(self.path)
+        body = self.read_body()
+
+        if url.path == "/esp32/tts":
+            self.serve_tts(body)
+        elif url.path == "/upload_pcm":
+            self.serve_upload(body)
+        elif url.path == "/esp32/report":
+            log_report(body.decode(errors="replace"))
+            self.respond(200)
+        elif url.path == "/esp32/telemetry/heap":
+            print_heap_report(body)
+            self.respond(200)
+        elif url.path == "/esp32/telemetry/trace":
+            self.save_trace(parse_qs(url.query), body)
+            self.respond(200)
+        elif url.path == "/trace":
+            TRACE_REQUESTED.set()
+            self.respond(200)
+        elif url.path == "/faults":
+            try:
+                FAULTS.update(json.loads(body or b"{}"))
+            except (ValueError, KeyError, TypeError) as e:
+                self.respond(400, json.dumps({"error": str(e)}).encode())
+                return
+            print("[faults] %s" % FAULTS.snapshot())
+            self.respond(200, json.dumps(FAULTS.snapshot()).encode())
+        elif url.path == "/jobs":
+            self.add_job(parse_qs(url.query))
+        else:
+            self.respond(404)
+
+    def save_trace(self, query, body):
+        device = re.sub(r"[^\w-]", "_", query.get("device_id", ["device"])[0])
+        index = 1
+        while True:
+            path = os.path.join(self.trace_dir, "trace_%s_%d.bin" % (device, index))
+            if not os.path.exists(path):
+                break
+            index += 1
+        with open(path, "wb") as f:
+            f.write(body)
+        print("[trace] saved %d bytes to %s (convert with event_trace_to_chrome.py)" % (len(body), path))
+
+    def serve_tts(self, body):
+        try:
+            text = json.loads(body).get("text", "")
+        except ValueError:
+            self.respond(400)
+            return
+        data = self.mp3_data or make_silent_mp3(max(1.0, len(text) * 0.1))
+        name = STORE.add(data, ext="mp3", queue_job=False) + ".mp3"
+        STATS.count("tts_requests")
+        print("[tts] %r -> %s (%d bytes)" % (text[:40], name, len(data)))
+        self.respond(200, json.dumps({"status": "ok", "filename": name, "size": len(data)}).encode())
+
+    def serve_upload(self, body):
+        # 只需找出文件部分的大小，不做完整的multipart解析
+        boundary = re.search(r"boundary=([^;]+)", self.headers.get("Content-Type", ""))
+        device = self.headers.get("X-Device-ID", "unknown")
+        size = len(body)
+        if boundary:
+            parts = body.split(b"--" + boundary.group(1).encode())
+            for part in parts:
+                head, _, content = part.partition(b"\r\n\r\n")
+                if b'name="file"' in head:
+                    size = len(content) - 2   # 去掉结尾的\r\n
+        STATS.count("uploads")
+        STATS.count("upload_bytes", size)
+        print("[stt] %s uploaded %d bytes (%.1f s of audio)" % (device, size, size / BYTES_PER_SECOND))
+        if self.reply_seconds > 0:
+            STORE.add(make_tone(440, self.reply_seconds))
+        reply = {"text": "mock transcript of %d bytes" % size, "device_id": device}
+        self.respond(200, json.dumps(reply).encode())
+
+    def add_job(self, query):
+        if "file" in query:
+            try:
+                with open(query["file"][0], "rb") as f:
+                    data = f.read()
+            except OSError as e:
+                self.respond(400, str(e).encode(), "text/plain")
+                return
+        else:
+            data = make_tone(float(query.get("tone", ["440"])[0]), float(query.get("seconds", ["2"])[0]))
+        name = STORE.add(data)
+        job = {"audio_id": name, "url": "/audio/%s.pcm" % name, "size": len(data)}
+        self.respond(200, json.dumps(job, separators=(",", ":")).encode())
+
+
+def log_report(report):
+    print("[report] %s" % report)
+    if "cache=hit" in report:
+        STATS.count("cache_hits")
+        print("[cache] device played from its clip cache, no audio transfer")
+
+
+def print_heap_report(data):
+    """解码mem_track的二进制堆报告"""
+    if len(data) < HEAP_HEADER.size:
+        print("[heap] short report (%d bytes)" % len(data))
+        return
+    magic, version, tag_count, caps_count, _, seq, uptime_ms = HEAP_HEADER.unpack_from(data, 0)
+    if magic != 0x544D:
+        print("[heap] bad magic 0x%04x" % magic)
+        return
+    print("[heap] seq=%d uptime=%.1fs" % (seq, uptime_ms / 1000))
+    offset = HEAP_HEADER.size
+    for i in range(tag_count):
+        current, peak, allocs, fails = HEAP_TAG.unpack_from(data, offset)
+        offset += HEAP_TAG.size
+        name = HEAP_TAG_NAMES[i] if i < len(HEAP_TAG_NAMES) else str(i)
+        print("[heap]   %-8s current=%d peak=%d allocs=%d fails=%d" % (name, current, peak, allocs, fails))
+    for i in range(caps_count):
+        free, largest, min_free = HEAP_CAPS.unpack_from(data, offset)
+        offset += HEAP_CAPS.size
+        name = HEAP_CAPS_NAMES[i] if i < len(HEAP_CAPS_NAMES) else str(i)
+        print("[heap]   %-8s free=%d largest=%d min_free=%d" % (name, free, largest, min_free))
+
+
+def add_fault_arguments(parser):
+    """故障注入参数，soak_test.py等共用"""
+    parser.add_argument("--bandwidth-kbps", type=int, default=0, help="每个连接的发送速率上限 (kbit/s)")
+    parser.add_argument("--latency-ms", type=int, default=0, help="响应头之前的延迟")
+    parser.add_argument("--jitter-ms", type=int, default=0, help="延迟的随机抖动幅度")
+    parser.add_argument("--disconnect-at", type=int, default=0, help="音频发送N字节后断开")
+    parser.add_argument("--disconnect-prob", type=float, default=0.0, help="音频响应断开的概率")
+    parser.add_argument("--chunked", action="store_true", help="使用chunked编码而不是Content-Length")
+    parser.add_argument("--storm-204", type=int, default=0, help="每storm-every次轮询中立即返回204的次数")
+    parser.add_argument("--storm-every", type=int, default=0)
+    parser.add_argument("--error-rate", type=float, default=0.0, help="返回500的概率")
+
+
+def apply_fault_arguments(args):
+    FAULTS.update({
+        "bandwidth_kbps": args.bandwidth_kbps, "latency_ms": args.latency_ms, "jitter_ms": args.jitter_ms,
+        "disconnect_at": args.disconnect_at, "disconnect_prob": args.disconnect_prob, "chunked": args.chunked,
+        "storm_204": args.storm_204, "storm_every": args.storm_every, "error_rate": args.error_rate,
+    })
+
+
+def start_server(host, port, poll_hold=POLL_HOLD_S, quiet=False):
+    """在后台线程中启动服务器，返回server对象（port=0时由系统分配端口）"""
+    Handler.poll_hold = poll_hold
+    Handler.quiet = quiet
+    server = ThreadingHTTPServer((host, port), Handler)
+    server.daemon_threads = True
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stand-in TTS/STT server with fault injection")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8001)
+    parser.add_argument("--tone", type=float, default=440, help="测试音频率 (Hz)")
+    parser.add_argument("--seconds", type=float, default=2.0, help="测试音时长")
+    parser.add_argument("--jobs", type=int, default=0, help="启动时排入的任务数")
+    parser.add_argument("--every", type=float, help="每隔N秒自动添加一个任务")
+    parser.add_argument("--poll-hold", type=float, default=POLL_HOLD_S, help="长轮询最长等待 (秒)，0为立即返回")
+    parser.add_argument("--reply-seconds", type=float, default=0.0, help="收到录音后排入的回复时长")
+    parser.add_argument("--mp3", help="/esp32/tts返回的MP3文件，默认生成静音帧")
+    parser.add_argument("--trace", action="store_true", help="每个任务下发时请求设备导出时间线")
+    parser.add_argument("--trace-dir", default=".", help="时间线导出的保存目录")
+    add_fault_arguments(parser)
+    args = parser.parse_args()
+
+    apply_fault_arguments(args)
+    Handler.reply_seconds = args.reply_seconds
+    Handler.trace_each_job = args.trace
+    Handler.trace_dir = args.trace_dir
+    if args.mp3:
+        with open(args.mp3, "rb") as f:
+            Handler.mp3_data = f.read()
+
+    for _ in range(args.jobs):
+        STORE.add(make_tone(args.tone, args.seconds))
+    if args.every:
+        def producer():
+            while True:
+                time.sleep(args.every)
+                STORE.add(make_tone(args.tone, args.seconds))
+        threading.Thread(target=producer, daemon=True).start()
+
+    server = start_server(args.host, args.port, args.poll_hold)
+    print("Mock server on %s:%d, faults %s" % (args.host, server.server_address[1], FAULTS.snapshot()))
+    try:
+        while True:
+            time.sleep(3600)
+    except KeyboardInterrupt:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
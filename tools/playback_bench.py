@@ -0,0 +1,583 @@
+#!/usr/bin/env python3
+"""
+播放策略基准 - 各代固件（esp32_http_pcm ~ _v6、_record）"下载+播放"核心的可复现对比
+
+每个策略按对应固件的代码建模：缓冲结构、扩容方式、每次读/写的块大小、起播条件、重试方式，
+常量（DMA_BUF_LEN、DOWNLOAD_CHUNK_SIZE、环形缓冲区/段大小等）在运行时从各项目源码中读取，
+改了固件参数后重跑即可。所有策略对同一个mock_server（同一组故障参数）下载同一组片段，
+片段按各版本期望的线上格式生成（v1: 48k单声道，v2/v4/v5/record: 16k单声道，v3/v6: 48k立体声），
+时长相同。播放端是实时的虚拟I2S：DMA_BUF_COUNT个DMA_BUF_LEN帧的描述符队列按48kHz立体声消耗，
+写满时阻塞（与i2s_channel_write的portMAX_DELAY一致），队列播空即记一次欠载。
+
+指标（不含轮询，从发起下载请求开始计时）:
+  ttfs      time-to-first-sample，请求发出到第一次写I2S
+  wall      请求发出到最后一个样本播完
+  peak      建模的堆占用峰值：下载缓冲（含realloc期间新旧两块并存）、环形缓冲区/段、播放中转缓冲和DMA描述符
+  copies/B  每个线上字节被复制的次数：socket->缓冲、事件回调memcpy、realloc搬移、上采样/单声道转立体声、
+            中转memcpy以及写入DMA描述符（假设realloc总是搬移数据，PSRAM上大块扩容基本如此）
+  underruns 播放开始后DMA队列被播空的次数
+
+未建模: v6的并行Range下载（DOWNLOAD_PARALLEL_CONNECTIONS默认为1）和GDMA预取的时间收益（仍计为一次复制）。
+
+用法:
+  python3 playback_bench.py                                   # 默认8 Mbps，片段1/3/8秒
+  python3 playback_bench.py --bandwidth-kbps 1500 --clips 3   # 慢网络下流式策略的欠载
+  python3 playback_bench.py --chunked --json bench.json       # 无Content-Length（v6走流式，record逐块扩容）
+  python3 playback_bench.py --strategies v1,v6 --disconnect-prob 0.3 --repeat 3
+"""
+
+import argparse
+import array
+import http.client
+import json
+import os
+import queue
+import re
+import statistics
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import mock_server  # noqa: E402
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+I2S_BYTES_PER_SECOND = 48000 * 2 * 2
+HTTP_DEFAULT_BUFFER = 512           # esp_http_client默认buffer_size（v2/v4/v5未设置）
+RINGBUF_ITEM_HEADER = 8             # NOSPLIT环形缓冲区每项的头
+V3_DOWNLOAD_RETRIES = 3             # download_pcm_audio_with_retry，间隔2秒*次数
+
+# 线上格式: (采样率, 声道数)
+WIRE_FORMATS = {"mono48": (48000, 1), "mono16": (16000, 1), "stereo48": (48000, 2)}
+
+
+def read_defines(*paths):
+    """读取源文件中的整数#define，表达式可引用前面已读到的宏"""
+    defines = {}
+    for path in paths:
+        with open(os.path.join(REPO, path), encoding="utf-8") as f:
+            for line in f:
+                m = re.match(r"\s*#define\s+(\w+)\s+(.+)$", line)
+                if not m:
+                    continue
+                expr = re.sub(r"//.*|/\*.*", "", m.group(2)).strip().replace("sizeof(int16_t)", "2")
+                expr = re.sub(r"\b[A-Z_][A-Z0-9_]*\b", lambda t: str(defines.get(t.group(0), t.group(0))), expr)
+                try:
+                    defines[m.group(1)] = int(eval(expr, {"__builtins__": {}}))
+                except Exception:
+                    pass
+    return defines
+
+
+class DownloadError(Exception):
+    pass
+
+
+class Meter:
+    """建模的堆占用和复制字节数"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.heap = 0
+        self.peak = 0
+        self.copied = 0
+
+    def alloc(self, n):
+        with self.lock:
+            self.heap += n
+            self.peak = max(self.peak, self.heap)
+
+    def free(self, n):
+        with self.lock:
+            self.heap -= n
+
+    def copy(self, n):
+        with self.lock:
+            self.copied += n
+
+
+class I2sSink:
+    """实时虚拟I2S：DMA描述符队列按采样率消耗，写满时阻塞，播空记欠载"""
+
+    def __init__(self, meter, dma_buf_len, dma_buf_count):
+        self.meter = meter
+        self.capacity = dma_buf_len * 4 * dma_buf_count
+        self.queued = 0.0
+        self.last = None
+        self.first = None
+        self.end = None
+        self.underruns = 0
+        self.starved = 0.0
+        meter.alloc(self.capacity)
+
+    def update(self):
+        now = time.monotonic()
+        if self.last is not None:
+            drained = (now - self.last) * I2S_BYTES_PER_SECOND
+            if drained > self.queued:
+                self.underruns += 1
+                self.starved += (drained - self.queued) / I2S_BYTES_PER_SECOND
+                self.queued = 0.0
+            else:
+                self.queued -= drained
+        self.last = now
+
+    def write(self, n):
+        if self.first is None:
+            self.first = self.last = time.monotonic()
+        else:
+            self.update()
+        while self.queued + n > self.capacity:
+            time.sleep((self.queued + n - self.capacity) / I2S_BYTES_PER_SECOND)
+            self.update()
+        self.meter.copy(n)      # i2s_channel_write复制到DMA描述符
+        self.queued += n
+
+    def finish(self):
+        """等DMA队列播完；播完最后一个样本不算欠载"""
+        if self.first is None:
+            self.end = time.monotonic()
+            return
+        remaining = self.queued / I2S_BYTES_PER_SECOND - (time.monotonic() - self.last)
+        if remaining > 0:
+            time.sleep(remaining)
+            self.end = time.monotonic()
+        else:
+            self.end = self.last + self.queued / I2S_BYTES_PER_SECOND
+        self.queued = 0.0
+
+
+class Run:
+    """一次"下载+播放"，策略函数通过它访问服务器、计量和I2S"""
+
+    def __init__(self, port, name, size, consts):
+        self.port = port
+        self.name = name
+        self.size = size
+        self.c = consts
+        self.meter = Meter()
+        self.sink = I2sSink(self.meter, consts["DMA_BUF_LEN"], consts["DMA_BUF_COUNT"])
+
+    def open(self, start=0):
+        conn = http.client.HTTPConnection("127.0.0.1", self.port, timeout=30)
+        try:
+            conn.request("GET", "/audio/%s.pcm" % self.name, headers={"Range": "bytes=%d-" % start} if start else {})
+            resp = conn.getresponse()
+        except (http.client.HTTPException, OSError) as e:
+            conn.close()
+            raise DownloadError(str(e))
+        if resp.status not in (200, 206):
+            conn.close()
+            raise DownloadError("HTTP %d" % resp.status)
+        length = resp.getheader("Content-Length")
+        return conn, resp, int(length) if length else None
+
+    def read(self, resp, n):
+        """读满n字节或到EOF；连接中断（含Content-Length未读满就EOF）抛DownloadError"""
+        try:
+            data = resp.read(n)
+        except (http.client.HTTPException, OSError) as e:
+            raise DownloadError(str(e))
+        if not data and resp.length:
+            raise DownloadError("connection closed with %d bytes missing" % resp.length)
+        return data
+
+
+# ---------------- 下载模型 ----------------
+
+def download_event(run, conn, resp, capacity, grow, piece):
+    """事件回调模式（v2~v5）：响应体先进esp_http_client的buffer，再在回调中memcpy到下载缓冲区"""
+    buffer_size = 0
+    run.meter.alloc(capacity)
+    try:
+        while True:
+            data = run.read(resp, piece)
+            if not data:
+                break
+            run.meter.copy(2 * len(data))
+            if buffer_size + len(data) > capacity:
+                new_capacity = grow(capacity, buffer_size + len(data))
+                run.meter.alloc(new_capacity)           # 新旧两块并存
+                run.meter.copy(buffer_size)
+                run.meter.free(capacity)
+                capacity = new_capacity
+            buffer_size += len(data)
+    except DownloadError:
+        run.meter.free(capacity)
+        raise
+    finally:
+        conn.close()
+    return buffer_size, capacity
+
+
+def download_pull(run, conn, resp, length, chunk, read_max):
+    """拉模式（record）：已知长度一次分配到位，响应体直接读入缓冲区"""
+    capacity = length if length else chunk
+    size = 0
+    run.meter.alloc(capacity)
+    try:
+        while True:
+            if size == capacity:
+                if length and size >= length:
+                    break
+                run.meter.alloc(capacity + chunk)
+                run.meter.copy(size)
+                run.meter.free(capacity)
+                capacity += chunk
+            data = run.read(resp, min(capacity - size, read_max))
+            if not data:
+                break
+            run.meter.copy(len(data))
+            size += len(data)
+    except DownloadError:
+        run.meter.free(capacity)
+        raise
+    finally:
+        conn.close()
+    return size, capacity
+
+
+# ---------------- 播放模型 ----------------
+
+def play_upsample(run, size):
+    """16kHz单声道：每次DMA_BUF_LEN/3个样本，3倍上采样再转立体声（v2/v4/v5/record）"""
+    dma = run.c["DMA_BUF_LEN"]
+    scratch = dma * 2 * 2 + dma * 3 * 2
+    run.meter.alloc(scratch)
+    chunk = (dma // 3) * 2
+    for pos in range(0, size, chunk):
+        n = min(chunk, size - pos)
+        run.meter.copy(3 * n)
+        run.meter.copy(6 * n)
+        run.sink.write(6 * n)
+    run.meter.free(scratch)
+
+
+def play_copy(run, size):
+    """48kHz立体声：每次DMA_BUF_LEN*2字节memcpy到DMA可用缓冲区后写I2S（v3）"""
+    chunk = run.c["DMA_BUF_LEN"] * 2
+    run.meter.alloc(chunk)
+    for pos in range(0, size, chunk):
+        n = min(chunk, size - pos)
+        run.meter.copy(n)
+        run.sink.write(n)
+    run.meter.free(chunk)
+
+
+# ---------------- 策略 ----------------
+
+def strategy_ring(run):
+    """v1：边下边播，socket数据直接读入环形缓冲区的定长项，播放任务转立体声后写I2S"""
+    c = run.c
+    item = c["AUDIO_RING_ITEM_SIZE"]
+    ring = queue.Queue(c["AUDIO_RING_BUF_SIZE"] // (item + RINGBUF_ITEM_HEADER))
+    run.meter.alloc(c["AUDIO_RING_BUF_SIZE"] + c["DMA_BUF_LEN"] * 2 * 2 + 2048)
+
+    def player():
+        while True:
+            data = ring.get()
+            if data is None:
+                return
+            run.meter.copy(2 * data)
+            run.sink.write(2 * data)
+
+    thread = threading.Thread(target=player, daemon=True)
+    thread.start()
+    try:
+        conn, resp, _ = run.open()
+        try:
+            while True:
+                data = run.read(resp, item)
+                run.meter.copy(len(data))
+                ring.put(item)              # 最后一项不足补静音，EOF时再送一整项静音
+                if not data:
+                    break
+        finally:
+            conn.close()
+    finally:
+        ring.put(None)
+        thread.join()
+
+
+def make_buffered(initial, grow, piece, play, retries=1):
+    """整段下载后播放（v2~v5）"""
+
+    def strategy(run):
+        for attempt in range(retries):
+            try:
+                conn, resp, _ = run.open()
+                size, capacity = download_event(run, conn, resp, initial(run.c), lambda cap, need: grow(run.c, cap, need),
+                                                piece(run.c))
+                break
+            except DownloadError:
+                if attempt + 1 == retries:
+                    raise
+                time.sleep(2 * (attempt + 1))
+        play(run, size)
+        run.meter.free(capacity)
+
+    return strategy
+
+
+def grow_linear(c, capacity, need):
+    while capacity < need:
+        capacity += c["DOWNLOAD_CHUNK_SIZE"]
+    return min(capacity, c["MAX_AUDIO_SIZE"])
+
+
+def grow_double(c, capacity, need):
+    while capacity < need:
+        capacity *= 2
+    return min(capacity, c["MAX_AUDIO_SIZE"])
+
+
+def strategy_record(run):
+    """record：拉模式直接读入一次分配到位的缓冲区，下载完成后播放"""
+    c = run.c
+    conn, resp, length = run.open()
+    size, capacity = download_pull(run, conn, resp, length, c["DOWNLOAD_CHUNK_SIZE"], c["DOWNLOAD_READ_MAX"])
+    play_upsample(run, size)
+    run.meter.free(capacity)
+
+
+class SegmentClip:
+    """v6分段片段：段按需取用，流式播放时已播放的段立即归还"""
+
+    def __init__(self, run, window):
+        self.run = run
+        self.window = window
+        self.cond = threading.Condition()
+        self.size = 0
+        self.segments = 0
+        self.released = 0
+        self.complete = False
+        self.failed = False
+
+    def reserve(self, pos):
+        """为pos处的写入取段，流式窗口已满时等待播放端归还"""
+        seg = self.run.c["AUDIO_SEGMENT_SIZE"]
+        with self.cond:
+            while pos // seg >= self.segments:
+                while self.segments - self.released >= self.window:
+                    self.cond.wait()
+                self.segments += 1
+                self.run.meter.alloc(seg)
+
+    def commit(self, n):
+        with self.cond:
+            self.size += n
+            self.cond.notify_all()
+
+    def finish(self, failed=False):
+        with self.cond:
+            self.complete = True
+            self.failed = failed
+            self.cond.notify_all()
+
+    def wait_for(self, pos):
+        """等到pos之前的数据可用，返回可用字节数"""
+        with self.cond:
+            while self.size < pos and not self.complete:
+                self.cond.wait()
+            return self.size
+
+    def release_before(self, pos):
+        seg = self.run.c["AUDIO_SEGMENT_SIZE"]
+        with self.cond:
+            while self.released < min(pos // seg, self.segments):
+                self.released += 1
+                self.run.meter.free(seg)
+            self.cond.notify_all()
+
+    def release_all(self):
+        with self.cond:
+            self.run.meter.free((self.segments - self.released) * self.run.c["AUDIO_SEGMENT_SIZE"])
+            self.released = self.segments
+
+
+def strategy_segments(run):
+    """v6：准入控制决定整段缓冲或流式；响应体直接读入段池，断线用Range续传，播放经4KB中转块写I2S"""
+    c = run.c
+    seg = c["AUDIO_SEGMENT_SIZE"]
+    run.meter.alloc(c["AUDIO_FRAME_SIZE"] * c["AUDIO_FRAME_COUNT"])
+    conn, resp, length = run.open()
+    stream = not length or length > c["AUDIO_MEMORY_BUDGET"]
+    clip = SegmentClip(run, c["AUDIO_STREAM_WINDOW"] if stream else c["AUDIO_SEGMENT_COUNT"])
+    start_at = c["AUDIO_STREAM_START_SEGMENTS"] * seg if stream else None
+
+    def player():
+        pos = 0
+        clip.wait_for(start_at if stream else float("inf"))
+        while True:
+            available = clip.wait_for(pos + c["AUDIO_FRAME_SIZE"])
+            if available <= pos:
+                return
+            n = min(c["AUDIO_FRAME_SIZE"], available - pos)
+            run.meter.copy(n)           # audio_stage：CPU memcpy或GDMA预取到内部RAM
+            run.sink.write(n)
+            pos += n
+            if stream:
+                clip.release_before(pos)
+
+    thread = threading.Thread(target=player, daemon=True)
+    thread.start()
+    try:
+        for attempt in range(c["DOWNLOAD_RESUME_ATTEMPTS"] + 1):
+            if attempt:
+                conn, resp, _ = run.open(clip.size)
+            try:
+                while True:
+                    clip.reserve(clip.size)
+                    room = seg - clip.size % seg
+                    data = run.read(resp, min(room, c["HTTP_READ_MAX"]))
+                    if not data:
+                        break
+                    run.meter.copy(len(data))
+                    clip.commit(len(data))
+                break
+            except DownloadError:
+                if attempt == c["DOWNLOAD_RESUME_ATTEMPTS"]:
+                    raise
+            finally:
+                conn.close()
+        clip.finish()
+    except BaseException:
+        clip.finish(failed=True)
+        raise
+    finally:
+        thread.join()
+        clip.release_all()
+    if clip.failed:
+        raise DownloadError("download failed")
+
+
+STRATEGIES = [
+    ("v1", "esp32_http_pcm", "mono48", ["main/esp32_audio_wifi.c"], strategy_ring,
+     "ring buffer, stream"),
+    ("v2", "esp32_http_pcm_v2", "mono16", ["main/esp32_audio_wifi.c"],
+     make_buffered(lambda c: c["DOWNLOAD_CHUNK_SIZE"], grow_linear, lambda c: HTTP_DEFAULT_BUFFER, play_upsample),
+     "realloc +chunk, then play"),
+    ("v3", "esp32_http_pcm_v3", "stereo48", ["main/esp32_audio_wifi.c"],
+     make_buffered(lambda c: c["INITIAL_BUFFER_SIZE"], grow_double, lambda c: 4096, play_copy, V3_DOWNLOAD_RETRIES),
+     "doubling buffer + retry, then play"),
+    ("v4", "esp32_http_pcm_v4", "mono16", ["main/esp32_audio_wifi.c"],
+     make_buffered(lambda c: c["DOWNLOAD_CHUNK_SIZE"], grow_linear, lambda c: HTTP_DEFAULT_BUFFER, play_upsample),
+     "PSRAM realloc +chunk, then play"),
+    ("v5", "esp32_http_pcm_v5", "mono16", ["main/esp32_audio_wifi.c"],
+     make_buffered(lambda c: c["DOWNLOAD_CHUNK_SIZE"], grow_linear, lambda c: HTTP_DEFAULT_BUFFER, play_upsample),
+     "PSRAM realloc +chunk, then play"),
+    ("record", "esp32_http_pcm_record", "mono16", ["main/esp32_audio_wifi.c"], strategy_record,
+     "pull into sized buffer, then play"),
+    ("v6", "esp32_http_pcm_v6", "stereo48",
+     ["main/audio_hal.h", "main/audio_pool.h", "main/http_client.h"], strategy_segments,
+     "segment pool, admission, Range resume"),
+]
+
+
+def render_clip(stereo48, wire):
+    samples = array.array("h", stereo48)
+    if wire == "stereo48":
+        return stereo48
+    left = samples[0::2]
+    return (left if wire == "mono48" else left[0::3]).tobytes()
+
+
+def run_one(port, key, consts, wire, stereo48, fn):
+    data = render_clip(stereo48, wire)
+    name = mock_server.STORE.add(data, queue_job=False)
+    run = Run(port, name, len(data), consts)
+    started = time.monotonic()
+    error = None
+    try:
+        fn(run)
+    except DownloadError as e:
+        error = str(e)
+    run.sink.finish()
+    rate, channels = WIRE_FORMATS[wire]
+    return {
+        "strategy": key,
+        "clip_s": round(len(data) / (rate * channels * 2), 3),
+        "wire_bytes": len(data),
+        "ok": error is None,
+        "error": error,
+        "ttfs_ms": round((run.sink.first - started) * 1000, 1) if run.sink.first else None,
+        "wall_s": round(run.sink.end - started, 3),
+        "peak_kb": round(run.meter.peak / 1024, 1),
+        "copies_per_byte": round(run.meter.copied / len(data), 2),
+        "underruns": run.sink.underruns,
+        "starved_ms": round(run.sink.starved * 1000, 1),
+    }
+
+
+def summarize(rows):
+    out = []
+    for key in dict.fromkeys(r["strategy"] for r in rows):
+        mine = [r for r in rows if r["strategy"] == key]
+        ok = [r for r in mine if r["ok"]]
+        out.append({
+            "strategy": key,
+            "runs": len(mine),
+            "failed": len(mine) - len(ok),
+            "ttfs_ms_p50": round(statistics.median(r["ttfs_ms"] for r in ok), 1) if ok else None,
+            "overhead_s_p50": round(statistics.median(r["wall_s"] - r["clip_s"] for r in ok), 3) if ok else None,
+            "peak_kb_max": max(r["peak_kb"] for r in mine),
+            "copies_per_byte": round(statistics.mean(r["copies_per_byte"] for r in ok), 2) if ok else None,
+            "underruns": sum(r["underruns"] for r in mine),
+        })
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cross-version download+playback benchmark")
+    parser.add_argument("--clips", default="1,3,8", help="片段时长列表 (秒)")
+    parser.add_argument("--repeat", type=int, default=1)
+    parser.add_argument("--strategies", help="只运行这些策略，如v1,v3,v6")
+    parser.add_argument("--json", help="保存每次运行的结果和读到的常量")
+    mock_server.add_fault_arguments(parser)
+    parser.set_defaults(bandwidth_kbps=8000)
+    args = parser.parse_args()
+
+    selected = set(args.strategies.split(",")) if args.strategies else None
+    strategies = [s for s in STRATEGIES if not selected or s[0] in selected]
+    if not strategies:
+        parser.error("no strategy matches %s" % args.strategies)
+    consts = {s[0]: read_defines(*[os.path.join(s[1], p) for p in s[3]]) for s in strategies}
+
+    mock_server.apply_fault_arguments(args)
+    server = mock_server.start_server("127.0.0.1", 0, quiet=True)
+    port = server.server_address[1]
+    print("Benchmark: server port %d, faults %s" % (port, mock_server.FAULTS.snapshot()))
+
+    rows = []
+    for seconds in [float(s) for s in args.clips.split(",")]:
+        stereo48 = mock_server.make_tone(440, seconds)
+        for _ in range(args.repeat):
+            for key, _, wire, _, fn, _ in strategies:
+                row = run_one(port, key, consts[key], wire, stereo48, fn)
+                rows.append(row)
+                print("  %-7s %5.1fs  %s  ttfs %7s ms  wall %6.2f s  peak %7.1f KB  copies/B %5.2f  underruns %d"
+                      % (key, row["clip_s"], "ok  " if row["ok"] else "FAIL", row["ttfs_ms"], row["wall_s"],
+                         row["peak_kb"], row["copies_per_byte"], row["underruns"]))
+    server.shutdown()
+
+    print("\n%-7s %-38s %5s %10s %11s %9s %9s %9s"
+          % ("version", "strategy", "fail", "ttfs p50", "overhead", "peak KB", "copies/B", "underruns"))
+    notes = {s[0]: s[5] for s in strategies}
+    summary = summarize(rows)
+    for s in summary:
+        print("%-7s %-38s %5d %10s %11s %9.1f %9s %9d"
+              % (s["strategy"], notes[s["strategy"]], s["failed"],
+                 "-" if s["ttfs_ms_p50"] is None else "%.0f ms" % s["ttfs_ms_p50"],
+                 "-" if s["overhead_s_p50"] is None else "%.2f s" % s["overhead_s_p50"],
+                 s["peak_kb_max"], s["copies_per_byte"], s["underruns"]))
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"faults": mock_server.FAULTS.snapshot(), "constants": consts, "summary": summary, "runs": rows},
+                      f, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
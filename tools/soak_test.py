@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+吞吐/延迟耐久测试 - 启动mock_server（带故障注入）并按固定节奏排入任务，周期性汇总服务器侧观察到的
+每个任务的时间线：排队 -> 被轮询取走 -> 开始下载 -> 最后一个字节发出，以及断线、Range续传、204和500次数。
+
+被测设备:
+  - 真实固件（开发板，或QEMU中运行的固件）：把TTS_SERVER_URL指向本机后运行，本脚本只做服务器和统计
+  - --emulate N：在本进程中启动N个模拟设备（轮询、下载、按播放时长等待），无需硬件即可跑通整条链路，
+    --resume让模拟设备在断线后用Range续传（v6的行为），否则整段重下（v1~v5的行为）
+
+输出: 每--report-every秒一行摘要，结束时打印最终报告，--json另存完整的任务时间线。
+用法:
+  python3 soak_test.py --duration 600 --job-every 4 --seconds 3 --bandwidth-kbps 3000 --disconnect-prob 0.2
+  python3 soak_test.py --duration 60 --emulate 1 --resume --time-scale 10 --storm-204 5 --storm-every 20
+"""
+
+import argparse
+import http.client
+import json
+import os
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import mock_server  # noqa: E402
+
+DOWNLOAD_ATTEMPTS = 3
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(p / 100 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+class EmulatedDevice(threading.Thread):
+    """最小的设备模型：长轮询 -> 下载整段（可选Range续传）-> 按音频时长"播放" -> 继续轮询"""
+
+    def __init__(self, port, resume, time_scale, stop):
+        super().__init__(daemon=True)
+        self.port = port
+        self.resume = resume
+        self.time_scale = time_scale
+        self.stop = stop
+        self.played = 0
+        self.failed = 0
+
+    def request(self, path, headers=None, timeout=30):
+        conn = http.client.HTTPConnection("127.0.0.1", self.port, timeout=timeout)
+        conn.request("GET", path, headers=headers or {})
+        return conn, conn.getresponse()
+
+    def poll(self):
+        conn, resp = self.request("/esp32/poll", {"X-Device-ID": "EMULATED"})
+        try:
+            body = resp.read()
+            if resp.status == 200:
+                return json.loads(body)["audio_id"]
+            if resp.status not in (204, 500):
+                raise IOError("poll status %d" % resp.status)
+            return None
+        finally:
+            conn.close()
+
+    def download(self, audio_id):
+        data = bytearray()
+        total = None
+        for _ in range(DOWNLOAD_ATTEMPTS):
+            headers = {"Range": "bytes=%d-" % len(data)} if self.resume and data else {}
+            if not self.resume:
+                data = bytearray()
+            try:
+                conn, resp = self.request("/audio/%s.pcm" % audio_id, headers)
+                if resp.status not in (200, 206):
+                    conn.close()
+                    continue
+                if total is None and resp.status == 200:
+                    length = resp.getheader("Content-Length")
+                    total = int(length) if length else None
+                while True:
+                    piece = resp.read1(8192) if hasattr(resp, "read1") else resp.read(8192)
+                    if not piece:
+                        break
+                    data += piece
+                complete = resp.isclosed() or total is None or len(data) >= total
+                conn.close()
+                if total is not None and len(data) >= total or total is None and complete:
+                    return bytes(data)
+            except (http.client.HTTPException, OSError):
+                pass
+        return None
+
+    def run(self):
+        while not self.stop.is_set():
+            try:
+                audio_id = self.poll()
+            except (http.client.HTTPException, OSError, ValueError):
+                time.sleep(1)
+                continue
+            if not audio_id:
+                time.sleep(0.1)
+                continue
+            data = self.download(audio_id)
+            if data is None:
+                self.failed += 1
+                continue
+            time.sleep(len(data) / mock_server.BYTES_PER_SECOND / self.time_scale)
+            self.played += 1
+
+
+def summarize(stats):
+    jobs = stats["jobs"]
+    delivered = [j for j in jobs if "delivered" in j]
+    completed = [j for j in jobs if "completed" in j]
+    queue_wait = [j["delivered"] - j["queued"] for j in delivered if "queued" in j]
+    start_delay = [j["first_request"] - j["delivered"] for j in delivered if "first_request" in j]
+    download = [j["completed"] - j["first_request"] for j in completed if "first_request" in j]
+    throughput = [j["size"] * 8 / 1000 / max(d, 1e-6) for j, d in
+                  zip([j for j in completed if "first_request" in j], download) if "size" in j]
+    c = stats["counters"]
+    return {
+        "uptime_s": round(stats["uptime"], 1),
+        "jobs_queued": len(jobs),
+        "jobs_delivered": len(delivered),
+        "jobs_completed": len(completed),
+        "queue_wait_p50_s": round(percentile(queue_wait, 50), 3),
+        "queue_wait_p95_s": round(percentile(queue_wait, 95), 3),
+        "start_delay_p50_s": round(percentile(start_delay, 50), 3),
+        "download_p50_s": round(percentile(download, 50), 3),
+        "download_p95_s": round(percentile(download, 95), 3),
+        "throughput_p50_kbps": round(percentile(throughput, 50)),
+        "audio_mb": round(c.get("audio_bytes", 0) / 1e6, 2),
+        "polls": c.get("polls", 0),
+        "poll_204": c.get("poll_204", 0) + c.get("storm_204", 0),
+        "range_requests": c.get("range_requests", 0),
+        "disconnects": c.get("injected_disconnects", 0),
+        "errors_500": c.get("injected_500", 0),
+        "client_aborts": c.get("client_aborts", 0),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Throughput/latency soak test against the mock server")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8001, help="0为自动分配（仅--emulate时有意义）")
+    parser.add_argument("--duration", type=float, default=300, help="测试时长 (秒)")
+    parser.add_argument("--job-every", type=float, default=5.0, help="每隔N秒排入一个任务")
+    parser.add_argument("--seconds", type=float, default=3.0, help="每个任务的音频时长")
+    parser.add_argument("--report-every", type=float, default=30.0)
+    parser.add_argument("--poll-hold", type=float, default=mock_server.POLL_HOLD_S)
+    parser.add_argument("--emulate", type=int, default=0, help="在本进程中运行N个模拟设备")
+    parser.add_argument("--resume", action="store_true", help="模拟设备断线后用Range续传")
+    parser.add_argument("--time-scale", type=float, default=1.0, help="模拟设备的播放加速倍数")
+    parser.add_argument("--json", help="结束时保存完整统计")
+    mock_server.add_fault_arguments(parser)
+    args = parser.parse_args()
+
+    mock_server.apply_fault_arguments(args)
+    server = mock_server.start_server(args.host, args.port, args.poll_hold, quiet=True)
+    port = server.server_address[1]
+    print("Soak test: server on port %d, faults %s" % (port, mock_server.FAULTS.snapshot()))
+
+    stop = threading.Event()
+    devices = [EmulatedDevice(port, args.resume, args.time_scale, stop) for _ in range(args.emulate)]
+    for device in devices:
+        device.start()
+
+    clip = mock_server.make_tone(440, args.seconds)
+    started = time.monotonic()
+    next_job = started
+    next_report = started + args.report_every
+    while time.monotonic() - started < args.duration:
+        now = time.monotonic()
+        if now >= next_job:
+            mock_server.STORE.add(clip)
+            next_job += args.job_every
+        if now >= next_report:
+            s = summarize(mock_server.STATS.snapshot())
+            print("[%6.0fs] jobs %d/%d/%d (queued/delivered/done) wait p50 %.2fs download p50 %.2fs "
+                  "%d kbps, 204 %d, range %d, cut %d, 500 %d"
+                  % (s["uptime_s"], s["jobs_queued"], s["jobs_delivered"], s["jobs_completed"],
+                     s["queue_wait_p50_s"], s["download_p50_s"], s["throughput_p50_kbps"], s["poll_204"],
+                     s["range_requests"], s["disconnects"], s["errors_500"]))
+            next_report += args.report_every
+        time.sleep(min(0.05, max(0.0, min(next_job, next_report) - time.monotonic())))
+
+    stop.set()
+    stats = mock_server.STATS.snapshot()
+    report = summarize(stats)
+    if devices:
+        report["emulated_played"] = sum(d.played for d in devices)
+        report["emulated_failed"] = sum(d.failed for d in devices)
+    print(json.dumps(report, indent=2))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"summary": report, "faults": mock_server.FAULTS.snapshot(), "jobs": stats["jobs"]}, f, indent=1)
+    server.shutdown()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())